@@ -3422,10 +3422,9 @@ void Bin::slotSendAudioThumb(QString id)
 {
     ProjectClip *clip = m_rootFolder->clip(id);
     if (clip && clip->audioThumbCreated()) {
-        m_monitor->prepareAudioThumb(clip->audioChannels(), clip->audioFrameCache);
+        m_monitor->prepareAudioThumb(clip->audioLevels());
     } else {
-        QVariantList list;
-        m_monitor->prepareAudioThumb(0, list);
+        m_monitor->prepareAudioThumb(AudioLevelsPtr());
     }
 }
 
@@ -27,15 +27,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timecode.h"
 #include "doc/kthumb.h"
 #include "kdenlivesettings.h"
+#include "lib/fileHasher.h"
 #include "timeline/clip.h"
 #include "project/projectcommands.h"
 #include "mltcontroller/clipcontroller.h"
 #include "lib/audio/audioStreamInfo.h"
+#include "lib/audio/audioPeakReducer.h"
+#include "lib/audio/audioEnvelope.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/clippropertiescontroller.h"
 
 #include <QDomElement>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
 #include <QDebug>
 #include <QCryptographicHash>
@@ -43,12 +47,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <KLocalizedString>
 #include <KMessageBox>
 
+// Number of peak values stored per frame in audio thumbnails decoded by ffmpeg
+static const int audioSubFrames = 8;
+// MLT's avformat producer decodes forward for smaller steps, and seeks for larger ones
+static const int avformatSeekDistance = 12;
 
 ProjectClip::ProjectClip(const QString &id, QIcon thumb, ClipController *controller, ProjectFolder* parent) :
     AbstractProjectItem(AbstractProjectItem::ClipItem, id, parent)
     , m_abortAudioThumb(false)
     , m_controller(controller)
     , m_thumbsProducer(NULL)
+    , m_keyframeIndexLoaded(false)
+    , m_keyframeIndexRequested(false)
+    , m_abortKeyframeIndex(false)
 {
     m_clipStatus = StatusReady;
     m_name = m_controller->clipName();
@@ -76,6 +87,9 @@ ProjectClip::ProjectClip(const QDomElement& description, QIcon thumb, ProjectFol
     , m_controller(NULL)
     , m_type(Unknown)
     , m_thumbsProducer(NULL)
+    , m_keyframeIndexLoaded(false)
+    , m_keyframeIndexRequested(false)
+    , m_abortKeyframeIndex(false)
 {
     Q_ASSERT(description.hasAttribute("id"));
     m_clipStatus = StatusWaiting;
@@ -111,8 +125,9 @@ ProjectClip::~ProjectClip()
     m_requestedThumbs.clear();
     m_thumbMutex.unlock();
     m_thumbThread.waitForFinished();
+    m_abortKeyframeIndex = true;
+    m_keyframeThread.waitForFinished();
     delete m_thumbsProducer;
-    audioFrameCache.clear();
 }
 
 void ProjectClip::abortAudioThumbs()
@@ -139,9 +154,11 @@ QString ProjectClip::getXmlProperty(const QDomElement &producer, const QString &
     return value;
 }
 
-void ProjectClip::updateAudioThumbnail(QVariantList audioLevels)
+void ProjectClip::updateAudioThumbnail(AudioLevelsPtr levels)
 {
-    audioFrameCache = audioLevels;
+    m_audioLevelsMutex.lock();
+    m_audioLevels = levels;
+    m_audioLevelsMutex.unlock();
     m_controller->audioThumbCreated = true;
     bin()->emitRefreshAudioThumbs(m_id);
     emit gotAudioData();
@@ -159,6 +176,12 @@ QStringList ProjectClip::markersText(GenTime in, GenTime out) const
     return QStringList();
 }
 
+AudioLevelsPtr ProjectClip::audioLevels() const
+{
+    QMutexLocker lock(&m_audioLevelsMutex);
+    return m_audioLevels;
+}
+
 bool ProjectClip::audioThumbCreated() const
 {
     return (m_controller && m_controller->audioThumbCreated);
@@ -339,6 +362,11 @@ bool ProjectClip::setProducer(ClipController *controller, bool replaceProducer)
         // Replace clip for this controller
         resetProducerProperty("kdenlive:file_hash");
         isNewProducer = false;
+        // The new producer may decode another file, like a proxy
+        QMutexLocker locker(&m_keyframeMutex);
+        m_keyframeIndex = KeyframeIndex();
+        m_keyframeIndexLoaded = false;
+        m_keyframeIndexRequested = false;
     }
     else if (controller) {
         // We did not yet have the controller, update info
@@ -546,24 +574,16 @@ const QString ProjectClip::getFileHash() const
           fileData = m_controller ? m_controller->property(QStringLiteral("resource")).toUtf8() : name().toUtf8();
           fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
           break;
-      default:
-          QFile file(m_controller ? m_controller->clipUrl().toLocalFile() : m_temporaryUrl.toLocalFile());
-          if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-              /*
-               * 1 MB = 1 second per 450 files (or faster)
-               * 10 MB = 9 seconds per 450 files (or faster)
-               */
-            if (file.size() > 2000000) {
-                fileData = file.read(1000000);
-                if (file.seek(file.size() - 1000000))
-                    fileData.append(file.readAll());
-            } else
-                fileData = file.readAll();
-            file.close();
-            if (m_controller) m_controller->setProperty(QStringLiteral("kdenlive:file_size"), QString::number(file.size()));
-            fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+      default: {
+          const QString path = m_controller ? m_controller->clipUrl().toLocalFile() : m_temporaryUrl.toLocalFile();
+          // Files that did not change since they were last hashed are not read again
+          const QString result = FileHasher::fileHash(path);
+          if (!result.isEmpty() && m_controller) { // write size and hash only if resource points to a file
+              m_controller->setProperty(QStringLiteral("kdenlive:file_size"), QString::number(QFileInfo(path).size()));
+              m_controller->setProperty(QStringLiteral("kdenlive:file_hash"), result);
           }
-          break;
+          return result;
+      }
     }
     if (fileHash.isEmpty()) return QString();
     QString result = fileHash.toHex();
@@ -848,6 +868,8 @@ void ProjectClip::doExtractIntra()
     double dar = prod->profile()->dar();
     int max = prod->get_length();
     int pos;
+    const KeyframeIndex keyframes = keyframeIndex();
+    int decoderPos = -1;
     while (!m_intraThumbs.isEmpty()) {
         m_intraThumbMutex.lock();
         pos = m_intraThumbs.takeFirst();
@@ -859,8 +881,7 @@ void ProjectClip::doExtractIntra()
             // Cache already contains image
             continue;
         }
-	prod->seek(pos);
-	Mlt::Frame *frame = prod->get_frame();
+	Mlt::Frame *frame = thumbFrame(prod, pos, decoderPos, keyframes);
         frame->set("deinterlace_method", "onefield");
         frame->set("top_field_first", -1 );
 	if (frame && frame->is_valid()) {
@@ -895,6 +916,8 @@ void ProjectClip::doExtractImage()
     bool ok = false;
     QDir thumbFolder = bin()->getCacheDir(CacheThumbs, &ok);
     int max = prod->get_length();
+    const KeyframeIndex keyframes = keyframeIndex();
+    int decoderPos = -1;
     while (!m_requestedThumbs.isEmpty()) {
         m_thumbMutex.lock();
         int pos = m_requestedThumbs.takeFirst();
@@ -910,8 +933,7 @@ void ProjectClip::doExtractImage()
             emit thumbReady(pos, img);
             continue;
         }
-	prod->seek(pos);
-	Mlt::Frame *frame = prod->get_frame();
+	Mlt::Frame *frame = thumbFrame(prod, pos, decoderPos, keyframes);
         frame->set("deinterlace_method", "onefield");
         frame->set("top_field_first", -1 );
 	if (frame && frame->is_valid()) {
@@ -923,6 +945,87 @@ void ProjectClip::doExtractImage()
     }
 }
 
+Mlt::Frame *ProjectClip::thumbFrame(Mlt::Producer *prod, int pos, int &decoderPos, const KeyframeIndex &keyframes)
+{
+    if (decoderPos >= 0 && pos - decoderPos >= avformatSeekDistance && !keyframes.isEmpty()
+            && keyframes.keyframeBefore(pos, prod->get_fps()) <= decoderPos) {
+        // A seek would restart at a keyframe the decoder already passed
+        for (int i = decoderPos + 1; i < pos; ++i) {
+            prod->seek(i);
+            QScopedPointer<Mlt::Frame> frame(prod->get_frame());
+            if (frame) {
+                mlt_image_format format = mlt_image_yuv420p;
+                int width = 0;
+                int height = 0;
+                frame->get_image(format, width, height);
+            }
+        }
+    }
+    prod->seek(pos);
+    decoderPos = pos;
+    return prod->get_frame();
+}
+
+KeyframeIndex ProjectClip::keyframeIndex()
+{
+    QMutexLocker locker(&m_keyframeMutex);
+    if (!m_keyframeIndexLoaded && !m_keyframeIndexRequested && (m_type == AV || m_type == Video)) {
+        m_keyframeIndex = KeyframeIndex::load(keyframeIndexPath());
+        m_keyframeIndexLoaded = true;
+    }
+    return m_keyframeIndex;
+}
+
+KeyframeIndex ProjectClip::sourceKeyframeIndex()
+{
+    const QString sourcePath = keyframeIndexPath(true);
+    if (sourcePath == keyframeIndexPath()) {
+        return keyframeIndex();
+    }
+    // The loaded index lists the proxy keyframes
+    return KeyframeIndex::load(sourcePath);
+}
+
+void ProjectClip::requestKeyframeIndex()
+{
+    QMutexLocker locker(&m_keyframeMutex);
+    if (m_keyframeIndexRequested || m_keyframeThread.isRunning() || !m_keyframeIndex.isEmpty() || !m_controller || (m_type != AV && m_type != Video)) {
+        return;
+    }
+    m_keyframeIndexRequested = true;
+    m_keyframeThread = QtConcurrent::run(this, &ProjectClip::doCreateKeyframeIndex);
+}
+
+const QString ProjectClip::keyframeIndexPath(bool source)
+{
+    const QString clipHash = hash();
+    bool ok = false;
+    QDir thumbFolder = bin()->getCacheDir(CacheThumbs, &ok);
+    if (!ok || clipHash.isEmpty()) {
+        return QString();
+    }
+    // A proxy has its own keyframes
+    const QString resource = getProducerProperty(QStringLiteral("resource"));
+    bool isProxy = !source && hasProxy() && resource == getProducerProperty(QStringLiteral("kdenlive:proxy"));
+    return thumbFolder.absoluteFilePath(clipHash + (isProxy ? QStringLiteral("_proxy") : QString()) + QStringLiteral(".keyframes"));
+}
+
+void ProjectClip::doCreateKeyframeIndex()
+{
+    const QString resource = getProducerProperty(QStringLiteral("resource"));
+    const QString cachePath = keyframeIndexPath();
+    KeyframeIndex index = KeyframeIndex::load(cachePath);
+    if (index.isEmpty()) {
+        index = KeyframeIndex::probe(KdenliveSettings::ffprobepath(), resource, m_controller->int_property(QStringLiteral("video_index")), &m_abortKeyframeIndex);
+        index.save(cachePath);
+    }
+    QMutexLocker locker(&m_keyframeMutex);
+    if (getProducerProperty(QStringLiteral("resource")) == resource) {
+        m_keyframeIndex = index;
+        m_keyframeIndexLoaded = true;
+    }
+}
+
 int ProjectClip::audioChannels() const
 {
     if (!m_controller || !m_controller->audioInfo()) return 0;
@@ -936,13 +1039,33 @@ void ProjectClip::discardAudioThumb()
     QString audioThumbPath = getAudioThumbPath(m_controller->audioInfo());
     if (!audioThumbPath.isEmpty())
         QFile::remove(audioThumbPath);
-    audioFrameCache.clear();
+    audioThumbPath = getAudioThumbPath(m_controller->audioInfo(), true);
+    if (!audioThumbPath.isEmpty())
+        QFile::remove(audioThumbPath);
+    audioThumbPath = getAudioEnvelopePath();
+    if (!audioThumbPath.isEmpty())
+        QFile::remove(audioThumbPath);
+    m_audioLevelsMutex.lock();
+    m_audioLevels.clear();
+    m_audioLevelsMutex.unlock();
     qDebug()<<"////////////////////  DISCARD AUIIO THUMBNS";
     m_controller->audioThumbCreated = false;
     m_abortAudioThumb = false;
 }
 
-const QString ProjectClip::getAudioThumbPath(AudioStreamInfo *audioInfo)
+const QString ProjectClip::getAudioThumbPath(AudioStreamInfo *audioInfo, bool legacyImage)
+{
+    return audioCachePath(audioInfo, legacyImage ? QStringLiteral("png") : QStringLiteral("levels"));
+}
+
+const QString ProjectClip::getAudioEnvelopePath()
+{
+    if (!m_controller)
+        return QString();
+    return audioCachePath(m_controller->audioInfo(), QStringLiteral("envelope"));
+}
+
+const QString ProjectClip::audioCachePath(AudioStreamInfo *audioInfo, const QString &extension)
 {
     if (audioInfo == NULL) 
         return QString();
@@ -957,7 +1080,7 @@ const QString ProjectClip::getAudioThumbPath(AudioStreamInfo *audioInfo)
         audioPath.append("_" + QString::number(audioInfo->audio_index()));
     }
     int roundedFps = (int) m_controller->profile()->fps();
-    audioPath.append(QString("_%1_audio.png").arg(roundedFps));
+    audioPath.append(QString("_%1_audio.%2").arg(roundedFps).arg(extension));
     return audioPath;
 }
 
@@ -976,160 +1099,86 @@ void ProjectClip::slotCreateAudioThumbs()
     if (frequency <= 0) frequency = 48000;
     int channels = audioInfo->channels();
     if (channels <= 0) channels = 2;
-    QVariantList audioLevels;
-    QImage image(audioPath);
-    if (!image.isNull()) {
-        // convert cached image
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p = image.pixel(i / channels, i % channels);
-            audioLevels << qRed(p);
-            audioLevels << qGreen(p);
-            audioLevels << qBlue(p);
-            audioLevels << qAlpha(p);
+    // Memory map the cached levels if any
+    AudioLevelsPtr cached(AudioLevels::load(audioPath));
+    if (cached.isNull()) {
+        // Convert thumbnails cached as an image by previous versions
+        const QString legacyPath = getAudioThumbPath(audioInfo, true);
+        QScopedPointer<AudioLevels> converted(AudioLevels::fromLegacyImage(QImage(legacyPath), channels));
+        if (converted && converted->save(audioPath)) {
+            QFile::remove(legacyPath);
+            cached = AudioLevelsPtr(AudioLevels::load(audioPath));
         }
     }
-    if (audioLevels.size() > 0) {
+    if (!cached.isNull()) {
         emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
-        updateAudioThumbnail(audioLevels);
+        updateAudioThumbnail(cached);
         return;
     }
+    QScopedPointer<AudioLevels> audioLevels(new AudioLevels(channels, lengthInFrames));
+    // The audio alignment envelope is computed from the same decoded samples
+    const QString envelopePath = getAudioEnvelopePath();
+    QVector<qint64> envelope;
+    if (!envelopePath.isEmpty() && !QFile::exists(envelopePath)) {
+        envelope.fill(0, lengthInFrames);
+    }
     bool jobFinished = false;
     if (KdenliveSettings::ffmpegaudiothumbnails() && m_type != Playlist) {
-        QStringList args;
-        QList <QTemporaryFile*> channelFiles;
-        for (int i = 0; i < channels; i++) {
-            QTemporaryFile *channelTmpfile = new QTemporaryFile;
-            if (!channelTmpfile->open()) {
-                delete channelTmpfile;
-                bin()->emitMessage(i18n("Cannot create temporary file, check disk space and permissions"), 100, ErrorMessage);
-                return;
-            }
-            channelTmpfile->close();
-            channelFiles << channelTmpfile;
+        // Decode all channels interleaved to stdout and reduce the samples while they arrive
+        QScopedPointer<AudioLevels> peakLevels(new AudioLevels(channels, lengthInFrames, audioSubFrames));
+        double fps = m_controller->profile()->fps();
+        AudioPeakReducer reducer(peakLevels.data(), frequency, fps);
+        if (!envelope.isEmpty()) {
+            reducer.setEnvelope(&envelope);
         }
+        QStringList args;
         args << QStringLiteral("-i") << QUrl::fromLocalFile(prod->get("resource")).path();
-        // Output progress info
-        args << QStringLiteral("-progress") << QStringLiteral("/dev/stdout");
-
-        bool isFFmpeg = KdenliveSettings::ffmpegpath().contains("ffmpeg");
-
-        if (channels == 1) {
-            if (isFFmpeg) {
-                args << QStringLiteral("-filter_complex:a") << QStringLiteral("aformat=channel_layouts=mono,aresample=async=100");
-                args << QStringLiteral("-map") << QStringLiteral("0:a%1").arg(audioStream > 0 ? ":" + QString::number(audioStream) : "") << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("data")<< channelFiles[0]->fileName();
-            } else {
-                args << QStringLiteral("-filter_complex:a") << QStringLiteral("aformat=channel_layouts=mono:sample_rates=100");
-                args << QStringLiteral("-map") << QStringLiteral("0:a%1").arg(audioStream > 0 ? ":" + QString::number(audioStream) : "") << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("s16le")<< channelFiles[0]->fileName();
-            }
-        } else if (channels == 2) {
-            if (isFFmpeg) {
-                args << QStringLiteral("-filter_complex:a") << QStringLiteral("[0:a%1]aresample=async=100,channelsplit=channel_layout=stereo[0:0][0:1]").arg(audioStream > 0 ? ":" + QString::number(audioStream) : "");
-                // Channel 1
-                args << QStringLiteral("-map") << QStringLiteral("[0:1]") << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("data")<< channelFiles[0]->fileName();
-                // Channel 2
-                args << QStringLiteral("-map") << QStringLiteral("[0:0]") << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("data")<< channelFiles[1]->fileName();
-            } else {
-                args << QStringLiteral("-filter_complex:a") << QStringLiteral("[0:a%1]aformat=sample_rates=100,channelsplit=channel_layout=stereo[0:0][0:1]").arg(audioStream > 0 ? ":" + QString::number(audioStream) : "");
-                // Channel 1
-                args << QStringLiteral("-map") << QStringLiteral("[0:1]") << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("s16le")<< channelFiles[0]->fileName();
-                // Channel 2
-                args << QStringLiteral("-map") << QStringLiteral("[0:0]") << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("s16le")<< channelFiles[1]->fileName();
-            }
-        } else if (channels == 6) {
-            args << QStringLiteral("-filter_complex:a") << QStringLiteral("[0:a%1]aresample=async=100,channelsplit=channel_layout=5.1[0:0][0:1][0:2][0:3][0:4][0:5]").arg(audioStream > 0 ? ":" + QString::number(audioStream) : "");
-                for (int i = 0; i < channels; i++) {
-                    // Channel 1
-                    args << QStringLiteral("-map") << QStringLiteral("[0:%1]").arg(i) << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("data")<< channelFiles[i]->fileName();
-                }
+        args << QStringLiteral("-map") << QStringLiteral("0:a%1").arg(audioStream > 0 ? ":" + QString::number(audioStream) : "");
+        if (KdenliveSettings::ffmpegpath().contains("ffmpeg")) {
+            args << QStringLiteral("-af") << QStringLiteral("aresample=async=100");
         }
+        args << QStringLiteral("-ac") << QString::number(channels) << QStringLiteral("-ar") << QString::number(frequency);
+        args << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-f") << QStringLiteral("s16le") << QStringLiteral("-");
         QProcess audioThumbsProcess;
         connect(this, SIGNAL(doAbortAudioThumbs()), &audioThumbsProcess, SLOT(kill()), Qt::DirectConnection);
-        connect(&audioThumbsProcess, &QProcess::readyReadStandardOutput, this, &ProjectClip::updateFfmpegProgress);
         audioThumbsProcess.start(KdenliveSettings::ffmpegpath(), args);
         bool ffmpegError = false;
         if (!audioThumbsProcess.waitForStarted()) {
             ffmpegError = true;
+        } else {
+            int progress = 0;
+            audioThumbsProcess.closeWriteChannel();
+            while (!m_abortAudioThumb) {
+                bool running = audioThumbsProcess.state() == QProcess::Running && audioThumbsProcess.waitForReadyRead(500);
+                reducer.addData(audioThumbsProcess.readAllStandardOutput());
+                // Discard the ffmpeg log so that its pipe never fills up
+                audioThumbsProcess.readAllStandardError();
+                int p = reducer.processedFrames() * 100 / lengthInFrames;
+                if (p != progress) {
+                    emit updateJobStatus(AbstractClipJob::THUMBJOB, JobWorking, p);
+                    emit updateThumbProgress((long) (reducer.processedFrames() * 1000 / fps));
+                    progress = p;
+                }
+                if (!running && audioThumbsProcess.state() != QProcess::Running) {
+                    break;
+                }
+            }
+            audioThumbsProcess.waitForFinished(-1);
+            reducer.addData(audioThumbsProcess.readAllStandardOutput());
         }
-        audioThumbsProcess.waitForFinished(-1);
         if (m_abortAudioThumb) {
-            // Cleanup temporary ffmpeg audio thumb file
-            while (!channelFiles.isEmpty()) {
-                    delete channelFiles.takeFirst();
-            }            
             emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
             m_abortAudioThumb = false;
             return;
         }
 
-        if (!ffmpegError && audioThumbsProcess.exitStatus() != QProcess::CrashExit) {
-            int dataSize = 0;
-            QList <const qint16*> rawChannels;
-            QList <QByteArray> sourceChannels;
-            QList<qint16> data2;
-            for (int i = 0; i < channelFiles.count(); i++) {
-                channelFiles[i]->open();
-                QByteArray res = channelFiles[i]->readAll();
-                channelFiles[i]->close();
-                if (dataSize == 0) {
-                    dataSize = res.size();
-                }
-                if (res.isEmpty() || res.size() != dataSize) {
-                    // Something went wrong, abort
-                   // Cleanup temporary ffmpeg audio thumb file
-                    while (!channelFiles.isEmpty()) {
-                        delete channelFiles.takeFirst();
-                    }      
-                    emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
-                    bin()->emitMessage(i18n("Error reading audio thumbnail"), 100, ErrorMessage);
-                    return;
-                }
-                rawChannels << (const qint16*) res.constData();
-                // We need to keep res2 alive or rawChannels data will die
-                sourceChannels << res;
-            }
-            int progress = 0;
-            QList <long> channelsData;
-            double offset = (double) dataSize / (2.0 * lengthInFrames);
-            int intraOffset = 1;
-            if (offset > 1000) {
-                intraOffset = offset / 60;
-            } else if (offset > 250) {
-                intraOffset = offset / 10;
-            }
-            double factor = 800.0 / 32768;
-            for (int i = 0; i < lengthInFrames; i++) {
-                channelsData.clear();
-                for (int k = 0; k < rawChannels.count(); k++) {
-                    channelsData << 0;
-                }
-                int pos = (int) (i * offset);
-                int steps = 0;
-                for (int j = 0; j < (int) offset && (pos + j < dataSize); j += intraOffset) {
-                    steps ++;
-                    for (int k = 0; k < rawChannels.count(); k++) {
-                        channelsData[k] += abs(rawChannels[k][pos + j]);
-                    }
-                }
-                for (int k = 0; k < channelsData.count(); k++) {
-                    if (steps) channelsData[k] /= steps;
-                    audioLevels << channelsData[k] * factor;
-                }
-                int p = 80 + (i * 20 / lengthInFrames);
-                if (p != progress) {
-                    emit updateJobStatus(AbstractClipJob::THUMBJOB, JobWorking, p);
-                    progress = p;
-                }
-                if (m_abortAudioThumb) break;
-            }
+        if (!ffmpegError && audioThumbsProcess.exitStatus() != QProcess::CrashExit && reducer.processedFrames() > 0) {
+            reducer.finish();
+            audioLevels.reset(peakLevels.take());
             jobFinished = true;
         } else {
             bin()->emitMessage(i18n("Failed to create FFmpeg audio thumbnails, using MLT"), 100, ErrorMessage);
         }
-        // Cleanup temporary ffmpeg audio thumb file
-        while (!channelFiles.isEmpty()) {
-            delete channelFiles.takeFirst();
-        }
     }
     if (!jobFinished && !m_abortAudioThumb) {
         // MLT audio thumbs: slower but safer
@@ -1168,65 +1217,42 @@ void ProjectClip::slotCreateAudioThumbs()
             QScopedPointer<Mlt::Frame> mlt_frame(audioProducer->get_frame());
             if (mlt_frame && mlt_frame->is_valid() && !mlt_frame->get_int("test_audio")) {
                 int samples = mlt_sample_calculator(framesPerSecond, frequency, z);
-                mlt_frame->get_audio(audioFormat, frequency, channels, samples);
+                int frameChannels = channels;
+                qint16 *data = static_cast<qint16*>(mlt_frame->get_audio(audioFormat, frequency, frameChannels, samples));
+                if (data && !envelope.isEmpty() && frameChannels > 0) {
+                    qint64 sum = 0;
+                    for (int k = 0; k < samples * frameChannels; ++k) {
+                        sum += abs(data[k]);
+                    }
+                    envelope[z] = sum / frameChannels;
+                }
                 for (int channel = 0; channel < channels; ++channel) {
                     double level = 256 * qMin(mlt_frame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
-                    audioLevels << level;
+                    audioLevels->setLevel(channel, z, level);
                 }
-            } else if (!audioLevels.isEmpty()) {
+            } else if (z > 0) {
                 for (int channel = 0; channel < channels; channel++)
-                    audioLevels << audioLevels.last();
+                    audioLevels->setLevel(channel, z, audioLevels->level(channel, z - 1));
             }
             if (m_abortAudioThumb) break;
         }
     }
 
     emit updateJobStatus(AbstractClipJob::THUMBJOB, JobDone, 0);
-    if (!m_abortAudioThumb) {
-        updateAudioThumbnail(audioLevels);
-    }
-
-    if (!m_abortAudioThumb && audioLevels.size() > 0) {
-        // Put into an image for caching.
-        int count = audioLevels.size();
-        QImage image(lrint((count + 3) / 4.0 / channels), channels, QImage::Format_ARGB32);
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i ++) {
-            QRgb p; 
-            if ((4*i + 3) < count) {
-                p = qRgba(audioLevels.at(4*i).toInt(), audioLevels.at(4*i+1).toInt(), audioLevels.at(4*i+2).toInt(), audioLevels.at(4*i+3).toInt());
-            } else {
-                int last = audioLevels.last().toInt();
-                int r = (4*i+0) < count? audioLevels.at(4*i+0).toInt() : last;
-                int g = (4*i+1) < count? audioLevels.at(4*i+1).toInt() : last;
-                int b = (4*i+2) < count? audioLevels.at(4*i+2).toInt() : last;
-                int a = last;
-                p = qRgba(r, g, b, a);
-            }
-            image.setPixel(i / channels, i % channels, p);
+    if (!m_abortAudioThumb && !audioLevels->isEmpty()) {
+        AudioEnvelope::saveCache(envelopePath, envelope);
+        audioLevels->buildPeaks();
+        // Save to cache and switch to the mapped file so that the levels don't stay in memory
+        AudioLevelsPtr result;
+        if (audioLevels->save(audioPath)) {
+            result = AudioLevelsPtr(AudioLevels::load(audioPath));
         }
-        image.save(audioPath);
-    }
-    m_abortAudioThumb = false;
-}
-
-void ProjectClip::updateFfmpegProgress()
-{
-    QProcess *callerProcess = qobject_cast<QProcess *> (QObject::sender());
-    if (!callerProcess)
-        return;
-    QString result = callerProcess->readAllStandardOutput();
-    QStringList lines = result.split('\n');
-    foreach(const QString & data, lines) {
-        if (data.startsWith(QStringLiteral("out_time_ms"))) {
-            long ms = data.section(QLatin1Char('='), 1).toLong();
-            // Update clip progressbar
-            emit updateJobStatus(AbstractClipJob::THUMBJOB, JobWorking, ms / duration().ms() * 0.08);
-            // Update general statusbar progressbar
-            emit updateThumbProgress(ms/1000);
-            break;
+        if (result.isNull()) {
+            result = AudioLevelsPtr(audioLevels.take());
         }
+        updateAudioThumbnail(result);
     }
+    m_abortAudioThumb = false;
 }
 
 bool ProjectClip::isTransparent() const
@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "abstractprojectitem.h"
 #include "definitions.h"
+#include "lib/audio/audioLevels.h"
+#include "lib/keyframeIndex.h"
 
 
 #include <QUrl>
@@ -150,6 +152,13 @@ public:
 
     /** @brief The clip hash created from the clip's resource. */
     const QString hash();
+
+    /** @brief Keyframes of the clip's video, read from the cache on first use. Empty if they were never listed. */
+    KeyframeIndex keyframeIndex();
+    /** @brief Keyframes of the original file, even when its proxy is loaded. Empty if they were never listed. */
+    KeyframeIndex sourceKeyframeIndex();
+    /** @brief Lists the keyframes in the background with ffprobe if they are not cached. */
+    void requestKeyframeIndex();
     
     /** @brief Set a property on the MLT producer. */
     void setProducerProperty(const QString &name, int data);
@@ -175,9 +184,8 @@ public:
     /** @brief Returns true if we are using a proxy for this clip. */
     bool hasProxy() const;
 
-    /** Cache for every audio Frame with 10 Bytes */
-    /** format is frame -> channel ->bytes */
-    QVariantList audioFrameCache;
+    /** @brief Returns the audio levels (one byte per frame and channel), empty pointer if not created yet. */
+    AudioLevelsPtr audioLevels() const;
     bool audioThumbCreated() const;
 
     void updateParentInfo(const QString &folderid, const QString &foldername);
@@ -209,8 +217,11 @@ public:
     QStringList subClipIds() const;
     /** @brief Delete cached audio thumb - needs to be recreated */
     void discardAudioThumb();
-    /** @brief Get path for this clip's audio thumbnail */
-    const QString getAudioThumbPath(AudioStreamInfo *audioInfo);
+    /** @brief Get path for this clip's audio thumbnail
+     *  @param legacyImage if true, return the path of the image format used by previous versions */
+    const QString getAudioThumbPath(AudioStreamInfo *audioInfo, bool legacyImage = false);
+    /** @brief Get path of the cached audio envelope used for audio alignment, empty if the clip has no audio */
+    const QString getAudioEnvelopePath();
     /** @brief Returns a cached pixmap for a frame of this clip */
     QImage findCachedThumb(int pos);
     void slotQueryIntraThumbs(QList <int> frames);
@@ -218,7 +229,7 @@ public:
     bool isSplittable() const;
 
 public slots:
-    void updateAudioThumbnail(QVariantList audioLevels);
+    void updateAudioThumbnail(AudioLevelsPtr levels);
     /** @brief Extract image thumbnails for timeline. */
     void slotExtractImage(QList <int> frames);
     void slotCreateAudioThumbs();
@@ -243,16 +254,31 @@ private:
     QMutex m_thumbMutex;
     QMutex m_intraThumbMutex;
     QMutex m_audioMutex;
+    /** @brief Protects m_audioLevels, which is replaced from the audio thumb thread */
+    mutable QMutex m_audioLevelsMutex;
+    AudioLevelsPtr m_audioLevels;
     QFuture <void> m_thumbThread;
     QList <int> m_requestedThumbs;
     QFuture <void> m_intraThread;
     QList <int> m_intraThumbs;
     const QString geometryWithOffset(const QString &data, int offset);
+    /** @brief Path of a cache file for the clip's audio stream, based on its hash */
+    const QString audioCachePath(AudioStreamInfo *audioInfo, const QString &extension);
     void doExtractImage();
     void doExtractIntra();
-
-private slots:
-    void updateFfmpegProgress();
+    QMutex m_keyframeMutex;
+    KeyframeIndex m_keyframeIndex;
+    bool m_keyframeIndexLoaded;
+    bool m_keyframeIndexRequested;
+    bool m_abortKeyframeIndex;
+    QFuture <void> m_keyframeThread;
+    /** @brief Path of the keyframe cache file of the decoded resource, or of the original file if @param source is true, based on the clip hash */
+    const QString keyframeIndexPath(bool source = false);
+    void doCreateKeyframeIndex();
+    /** @brief Returns the frame at @param pos of the thumbnail producer.
+     *  If @param decoderPos, the last decoded frame, is in the same group of pictures,
+     *  the frames up to @param pos are decoded instead of seeking back to the keyframe. */
+    Mlt::Frame *thumbFrame(Mlt::Producer *prod, int pos, int &decoderPos, const KeyframeIndex &keyframes);
 
 signals:
     void gotAudioData();
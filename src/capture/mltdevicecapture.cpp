@@ -230,22 +230,22 @@ void MltDeviceCapture::showAudio(Mlt::Frame& frame)
     if (!frame.is_valid() || frame.get_int("test_audio") != 0) {
         return;
     }
+    // Keep the rate and layout of the frame, they are only requested if it has no audio yet
     mlt_audio_format audio_format = mlt_audio_s16;
-    int freq = 0;
-    int num_channels = 0;
-    int samples = 0;
-    qint16* data = (qint16*)frame.get_audio(audio_format, freq, num_channels, samples);
-
-    if (!data) {
-        return;
+    int freq = frame.get_int("audio_frequency");
+    int num_channels = frame.get_int("audio_channels");
+    if (freq <= 0) {
+        freq = 48000;
     }
+    if (num_channels <= 0) {
+        num_channels = 2;
+    }
+    int samples = 0;
+    void *data = frame.get_audio(audio_format, freq, num_channels, samples);
 
-    // Data format: [ c00 c10 c01 c11 c02 c12 c03 c13 ... c0{samples-1} c1{samples-1} for 2 channels.
-    // So the vector is of size samples*channels.
-    audioShortVector sampleVector(samples*num_channels);
-    memcpy(sampleVector.data(), data, samples*num_channels*sizeof(qint16));
-    if (samples > 0) {
-        emit audioSamplesSignal(sampleVector, freq, num_channels, samples);
+    AudioBlock block = AudioBlock::fromData(data, audio_format, freq, num_channels, samples, frame.get_position());
+    if (!block.isNull()) {
+        emit audioSamplesSignal(block);
     }
 }
 
@@ -171,7 +171,8 @@ enum CacheType {
     CachePreview = 2,
     CacheProxy = 3,
     CacheAudio = 4,
-    CacheThumbs = 5
+    CacheThumbs = 5,
+    CachePreviewChunks = 6
 };
 
 enum TrimMode {
@@ -23,6 +23,7 @@
 
 #include "titler/titlewidget.h"
 #include "kdenlivesettings.h"
+#include "lib/fileHasher.h"
 #include "utils/KoIconUtils.h"
 
 #include <KUrlRequesterDialog>
@@ -35,7 +36,6 @@
 #include <QTreeWidgetItem>
 #include <QFile>
 #include <QFileDialog>
-#include <QCryptographicHash>
 #include <QStandardPaths>
 
 const int hashRole = Qt::UserRole;
@@ -582,31 +582,14 @@ QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &m
 {
     if (matchSize.isEmpty() && matchHash.isEmpty()) return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
     QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
     QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
         QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
         if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                * 1 MB = 1 second per 450 files (or faster)
-                * 10 MB = 9 seconds per 450 files (or faster)
-                */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000))
-                        fileData.append(file.readAll());
-                } else
-                    fileData = file.readAll();
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
+            if (FileHasher::fileHash(file.fileName()) == matchHash) {
+                return file.fileName();
             }
         }
-        ////qDebug() << filesAndDirs.at(i) << file.size() << fileHash.toHex();
     }
     filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
@@ -38,6 +38,7 @@
 #include "core.h"
 #include "bin/bin.h"
 #include "bin/projectclip.h"
+#include "lib/fileHasher.h"
 #include "utils/KoIconUtils.h"
 #include "mltcontroller/bincontroller.h"
 #include "mltcontroller/effectscontroller.h"
@@ -51,7 +52,6 @@
 #include <KBookmarkManager>
 #include <KBookmark>
 
-#include <QCryptographicHash>
 #include <QFile>
 #include <QDebug>
 #include <QFileDialog>
@@ -911,32 +911,15 @@ const QString KdenliveDoc::description() const
 QString KdenliveDoc::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const
 {
     QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
     QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
         QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (file.open(QIODevice::ReadOnly)) {
-            if (QString::number(file.size()) == matchSize) {
-                /*
-                * 1 MB = 1 second per 450 files (or faster)
-                * 10 MB = 9 seconds per 450 files (or faster)
-                */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000))
-                        fileData.append(file.readAll());
-                } else
-                    fileData = file.readAll();
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString(fileHash.toHex()) == matchHash)
-                    return file.fileName();
-                else
-                    qDebug() << filesAndDirs.at(i) << "size match but not hash";
-            }
+        if (QString::number(file.size()) == matchSize) {
+            if (FileHasher::fileHash(file.fileName()) == matchHash)
+                return file.fileName();
+            else
+                qDebug() << filesAndDirs.at(i) << "size match but not hash";
         }
-        ////qDebug() << filesAndDirs.at(i) << file.size() << fileHash.toHex();
     }
     filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
@@ -1690,6 +1673,11 @@ QDir KdenliveDoc::getCacheDir(CacheType type, bool *ok) const
         case CacheThumbs:
             basePath.append(QStringLiteral("/videothumbs"));
             break;
+        case CachePreviewChunks:
+            // Rendered preview chunks are shared by all projects
+            basePath = kdenliveCacheDir;
+            basePath.append(QStringLiteral("/timelinepreview"));
+            break;
         default:
             break;
     }
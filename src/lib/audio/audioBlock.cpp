@@ -0,0 +1,225 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "audioBlock.h"
+
+#include <QMutex>
+
+#include <cstring>
+#include <math.h>
+
+struct AudioBlock::Data
+{
+    audioShortVector samples;
+    QVector<float> peaks;
+    QVector<float> rms;
+    int frequency;
+    int channels;
+    int sampleCount;
+    int position;
+};
+
+struct AudioBlockPool
+{
+    QMutex mutex;
+    QVector<AudioBlock::Data *> buffers;
+    ~AudioBlockPool() { qDeleteAll(buffers); }
+};
+
+namespace
+{
+/** Blocks in flight at the same time: one per monitor, plus the ones queued for the scopes */
+const int maxPooledBuffers = 8;
+
+Q_GLOBAL_STATIC(AudioBlockPool, bufferPool)
+
+inline qint16 floatToShort(float value)
+{
+    return (qint16) (qBound(-1.0f, value, 1.0f) * 32767);
+}
+}
+
+AudioBlock::AudioBlock()
+{
+}
+
+AudioBlock::Data *AudioBlock::acquire()
+{
+    AudioBlockPool *pool = bufferPool();
+    QMutexLocker locker(&pool->mutex);
+    if (pool->buffers.isEmpty()) {
+        return new Data;
+    }
+    Data *data = pool->buffers.last();
+    pool->buffers.removeLast();
+    return data;
+}
+
+void AudioBlock::release(Data *data)
+{
+    if (!bufferPool.isDestroyed()) {
+        AudioBlockPool *pool = bufferPool();
+        QMutexLocker locker(&pool->mutex);
+        if (pool->buffers.size() < maxPooledBuffers) {
+            pool->buffers.append(data);
+            return;
+        }
+    }
+    delete data;
+}
+
+int AudioBlock::pooledBuffers()
+{
+    AudioBlockPool *pool = bufferPool();
+    QMutexLocker locker(&pool->mutex);
+    return pool->buffers.size();
+}
+
+AudioBlock AudioBlock::fromData(const void *data, mlt_audio_format format, int frequency, int channels, int samples, int position)
+{
+    AudioBlock block;
+    if (!data || channels <= 0 || samples <= 0) {
+        return block;
+    }
+    switch (format) {
+    case mlt_audio_s16:
+    case mlt_audio_s32:
+    case mlt_audio_float:
+    case mlt_audio_s32le:
+    case mlt_audio_f32le:
+    case mlt_audio_u8:
+        break;
+    default:
+        return block;
+    }
+    block.d = QSharedPointer<Data>(acquire(), &AudioBlock::release);
+    Data *d = block.d.data();
+    d->frequency = frequency;
+    d->channels = channels;
+    d->sampleCount = samples;
+    d->position = position;
+
+    // Resizing a pooled vector keeps its allocation unless a receiver still shares it
+    const int count = channels * samples;
+    d->samples.resize(count);
+    qint16 *out = d->samples.data();
+    switch (format) {
+    case mlt_audio_s16:
+        memcpy(out, data, count * sizeof(qint16));
+        break;
+    case mlt_audio_s32le: {
+        const qint32 *in = (const qint32 *) data;
+        for (int i = 0; i < count; ++i) {
+            out[i] = in[i] >> 16;
+        }
+        break;
+    }
+    case mlt_audio_f32le: {
+        const float *in = (const float *) data;
+        for (int i = 0; i < count; ++i) {
+            out[i] = floatToShort(in[i]);
+        }
+        break;
+    }
+    case mlt_audio_u8: {
+        const quint8 *in = (const quint8 *) data;
+        for (int i = 0; i < count; ++i) {
+            out[i] = (in[i] - 128) * 256;
+        }
+        break;
+    }
+    case mlt_audio_s32: {
+        // Planar, one block of samples per channel
+        const qint32 *in = (const qint32 *) data;
+        for (int c = 0; c < channels; ++c) {
+            for (int i = 0; i < samples; ++i) {
+                out[i * channels + c] = in[c * samples + i] >> 16;
+            }
+        }
+        break;
+    }
+    case mlt_audio_float: {
+        const float *in = (const float *) data;
+        for (int c = 0; c < channels; ++c) {
+            for (int i = 0; i < samples; ++i) {
+                out[i * channels + c] = floatToShort(in[c * samples + i]);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    // Measure all channels in a single pass over the interleaved samples
+    d->peaks.resize(channels);
+    d->rms.resize(channels);
+    QVector<int> peaks(channels, 0);
+    QVector<qint64> squares(channels, 0);
+    int *peak = peaks.data();
+    qint64 *square = squares.data();
+    const qint16 *in = d->samples.constData();
+    for (int i = 0; i < samples; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            const int value = in[c];
+            peak[c] = qMax(peak[c], qAbs(value));
+            square[c] += value * value;
+        }
+        in += channels;
+    }
+    for (int c = 0; c < channels; ++c) {
+        d->peaks[c] = peak[c] / 32768.0f;
+        d->rms[c] = sqrt((double) square[c] / samples) / 32768.0;
+    }
+    return block;
+}
+
+bool AudioBlock::isNull() const
+{
+    return d.isNull();
+}
+
+int AudioBlock::frequency() const
+{
+    return d ? d->frequency : 0;
+}
+
+int AudioBlock::channels() const
+{
+    return d ? d->channels : 0;
+}
+
+int AudioBlock::sampleCount() const
+{
+    return d ? d->sampleCount : 0;
+}
+
+int AudioBlock::position() const
+{
+    return d ? d->position : -1;
+}
+
+const audioShortVector &AudioBlock::samples() const
+{
+    static const audioShortVector empty;
+    return d ? d->samples : empty;
+}
+
+float AudioBlock::peak(int channel) const
+{
+    Q_ASSERT(d && channel >= 0 && channel < d->channels);
+    return d->peaks.at(channel);
+}
+
+float AudioBlock::rms(int channel) const
+{
+    Q_ASSERT(d && channel >= 0 && channel < d->channels);
+    return d->rms.at(channel);
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef AUDIOBLOCK_H
+#define AUDIOBLOCK_H
+
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <mlt/framework/mlt_types.h>
+
+#include "definitions.h"
+
+/**
+  \brief The audio of one displayed frame, as handed to the audio meters and scopes.
+
+  A block holds the samples as interleaved 16 bit integers in the sample rate
+  and channel layout of the frame, together with the peak and RMS level of
+  each channel, measured once when the block is created. Meters only read
+  these levels and never touch the samples.
+
+  Blocks are read-only and reference counted, so one block can be sent to
+  every receiver, also across threads, without copying the samples. When the
+  last copy is gone, the sample buffer goes back to a small pool and is reused
+  for the next frame instead of being freed.
+  */
+class AudioBlock
+{
+public:
+    /** Creates a null block. */
+    AudioBlock();
+
+    /** @brief Converts the audio of an MLT frame to a block.
+        @param data the samples in MLT audio @param format, interleaved or planar
+        @param position the frame number, -1 if unknown
+        @return a null block if there are no samples or the format is not supported */
+    static AudioBlock fromData(const void *data, mlt_audio_format format, int frequency, int channels, int samples, int position = -1);
+
+    bool isNull() const;
+    int frequency() const;
+    int channels() const;
+    /** Number of samples per channel */
+    int sampleCount() const;
+    int position() const;
+    /** Interleaved samples, channels() * sampleCount() values */
+    const audioShortVector &samples() const;
+
+    /** Highest absolute sample value of @param channel, 1.0 being full scale */
+    float peak(int channel) const;
+    /** Root mean square of @param channel, 1.0 being a full scale square wave */
+    float rms(int channel) const;
+
+    /** Number of sample buffers waiting in the pool for reuse */
+    static int pooledBuffers();
+
+private:
+    friend struct AudioBlockPool;
+    struct Data;
+    QSharedPointer<Data> d;
+
+    static Data *acquire();
+    static void release(Data *data);
+};
+
+Q_DECLARE_METATYPE(AudioBlock)
+
+#endif // AUDIOBLOCK_H
@@ -14,12 +14,31 @@ the Free Software Foundation, either version 3 of the License, or
 #include "klocalizedstring.h"
 #include <QDebug>
 #include <QTime>
+#include <QVector>
+#include <QtConcurrent>
 #include <cmath>
 #include <iostream>
 
+namespace {
+    /// Envelopes are decimated to about this size for the coarse search
+    const int coarseSize = 4096;
+    /// Number of coarse maxima refined at full resolution
+    const int coarseCandidates = 3;
+
+    QVector<qint64> decimate(const qint64 *envelope, int size, int factor)
+    {
+        QVector<qint64> decimated((size + factor - 1) / factor, 0);
+        for (int i = 0; i < size; ++i) {
+            decimated[i / factor] += envelope[i];
+        }
+        return decimated;
+    }
+}
+
 
 AudioCorrelation::AudioCorrelation(AudioEnvelope *mainTrackEnvelope) :
-    m_mainTrackEnvelope(mainTrackEnvelope)
+    m_mainTrackEnvelope(mainTrackEnvelope),
+    m_mainReady(false)
 {
     m_mainTrackEnvelope->normalizeEnvelope();
     connect(m_mainTrackEnvelope, SIGNAL(envelopeReady(AudioEnvelope*)), this, SLOT(slotAnnounceEnvelope()));
@@ -27,6 +46,13 @@ AudioCorrelation::AudioCorrelation(AudioEnvelope *mainTrackEnvelope) :
 
 AudioCorrelation::~AudioCorrelation()
 {
+    // Running correlations read the envelopes
+    foreach (QFutureWatcher<void> *watcher, m_running) {
+        watcher->waitForFinished();
+    }
+    qDeleteAll(m_runningChildren);
+    qDeleteAll(m_runningInfos);
+    qDeleteAll(m_pending);
     delete m_mainTrackEnvelope;
     foreach (AudioEnvelope *envelope, m_children) {
         delete envelope;
@@ -40,7 +66,12 @@ AudioCorrelation::~AudioCorrelation()
 
 void AudioCorrelation::slotAnnounceEnvelope()
 {
+    m_mainReady = true;
     emit displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage);
+    // Children that were ready before the reference
+    while (!m_pending.isEmpty()) {
+        startCorrelation(m_pending.takeFirst());
+    }
 }
 
 void AudioCorrelation::addChild(AudioEnvelope *envelope)
@@ -50,35 +81,48 @@ void AudioCorrelation::addChild(AudioEnvelope *envelope)
 }
 
 void AudioCorrelation::slotProcessChild(AudioEnvelope *envelope)
+{
+    if (!m_mainReady) {
+        m_pending.append(envelope);
+        return;
+    }
+    startCorrelation(envelope);
+}
+
+void AudioCorrelation::startCorrelation(AudioEnvelope *envelope)
 {
     const int sizeMain = m_mainTrackEnvelope->envelopeSize();
     const int sizeSub = envelope->envelopeSize();
 
     AudioCorrelationInfo *info = new AudioCorrelationInfo(sizeMain, sizeSub);
-    qint64 *correlation = info->correlationVector();
-
-    const qint64 *envMain = m_mainTrackEnvelope->envelope();
-    const qint64 *envSub = envelope->envelope();
-    qint64 max = 0;
+    QFutureWatcher<void> *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(slotCorrelationDone()));
+    m_running.append(watcher);
+    m_runningChildren.append(envelope);
+    m_runningInfos.append(info);
+
+    // Both envelopes are complete and normalized at this point, they are only read from now on
+    watcher->setFuture(QtConcurrent::run(&AudioCorrelation::align,
+                                         m_mainTrackEnvelope->envelope(), sizeMain,
+                                         envelope->envelope(), sizeSub,
+                                         info));
+}
 
-    if (sizeSub > 200) {
-        FFTCorrelation::correlate(envMain, sizeMain,
-                                  envSub, sizeSub,
-                                  correlation);
-    } else {
-        correlate(envMain, sizeMain,
-                  envSub, sizeSub,
-                  correlation,
-                  &max);
-        info->setMax(max);
+void AudioCorrelation::slotCorrelationDone()
+{
+    QFutureWatcher<void> *watcher = static_cast<QFutureWatcher<void>*>(sender());
+    int running = m_running.indexOf(watcher);
+    if (running < 0) {
+        return;
     }
-
-
+    m_running.removeAt(running);
+    AudioEnvelope *envelope = m_runningChildren.takeAt(running);
     m_children.append(envelope);
-    m_correlations.append(info);
+    m_correlations.append(m_runningInfos.takeAt(running));
+    watcher->deleteLater();
 
     Q_ASSERT(m_correlations.size() == m_children.size());
-    int index = m_children.indexOf(envelope);
+    int index = m_children.size() - 1;
     int shift = getShift(index);
     emit gotAudioAlignData(envelope->track(), envelope->startPos(), shift);
 }
@@ -107,6 +151,18 @@ void AudioCorrelation::correlate(const qint64 *envMain, int sizeMain,
                                  const qint64 *envSub, int sizeSub,
                                  qint64 *correlation,
                                  qint64 *out_max)
+{
+    QTime t;
+    t.start();
+    correlateWindow(envMain, sizeMain, envSub, sizeSub, -sizeSub, sizeMain, correlation, out_max);
+    qDebug() << "Correlation calculated. Time taken: " << t.elapsed() << " ms.";
+}
+
+void AudioCorrelation::correlateWindow(const qint64 *envMain, int sizeMain,
+                                       const qint64 *envSub, int sizeSub,
+                                       int minShift, int maxShift,
+                                       qint64 *correlation,
+                                       qint64 *out_max)
 {
     Q_ASSERT(correlation != NULL);
 
@@ -132,10 +188,9 @@ void AudioCorrelation::correlate(const qint64 *envMain, int sizeMain,
 
     */
 
-
-    QTime t;
-    t.start();
-    for (int shift = -sizeSub; shift <= sizeMain; ++shift) {
+    minShift = qMax(minShift, -sizeSub);
+    maxShift = qMin(maxShift, sizeMain);
+    for (int shift = minShift; shift <= maxShift; ++shift) {
 
         if (shift <= 0) {
             left = envSub-shift;
@@ -147,11 +202,10 @@ void AudioCorrelation::correlate(const qint64 *envMain, int sizeMain,
             size = std::min(sizeSub, sizeMain-shift);
         }
 
+        // Indexed loop without dependencies other than the sum, so that the compiler vectorizes it
         sum = 0;
         for (int i = 0; i < size; ++i) {
-            sum += (*left) * (*right);
-            left++;
-            right++;
+            sum += left[i] * right[i];
         }
         correlation[sizeSub+shift] = qAbs(sum);
 
@@ -160,11 +214,67 @@ void AudioCorrelation::correlate(const qint64 *envMain, int sizeMain,
         }
 
     }
-    qDebug() << "Correlation calculated. Time taken: " << t.elapsed() << " ms.";
 
     if (out_max != NULL) {
         *out_max = max;
     }
 }
 
+void AudioCorrelation::align(const qint64 *envMain, int sizeMain,
+                             const qint64 *envSub, int sizeSub,
+                             AudioCorrelationInfo *info)
+{
+    qint64 *correlation = info->correlationVector();
+    const int size = sizeMain + sizeSub + 1;
+    const int factor = qMax(sizeMain, sizeSub) / coarseSize + 1;
 
+    if (sizeSub <= 200) {
+        qint64 max = 0;
+        correlate(envMain, sizeMain, envSub, sizeSub, correlation, &max);
+        info->setMax(max);
+        return;
+    }
+    if (factor == 1) {
+        FFTCorrelation::correlate(envMain, sizeMain, envSub, sizeSub, correlation);
+        return;
+    }
+
+    // Global search on the decimated envelopes
+    const QVector<qint64> coarseMain = decimate(envMain, sizeMain, factor);
+    const QVector<qint64> coarseSub = decimate(envSub, sizeSub, factor);
+    QVector<float> coarse(coarseMain.size() + coarseSub.size() + 1);
+    FFTCorrelation::correlate(coarseMain.constData(), coarseMain.size(),
+                              coarseSub.constData(), coarseSub.size(),
+                              coarse.data());
+
+    // Keep the best distinct maxima, the decimated signal may rank them slightly differently
+    QList<int> candidates;
+    for (int c = 0; c < coarseCandidates; ++c) {
+        int best = -1;
+        for (int i = 0; i < coarse.size(); ++i) {
+            bool taken = false;
+            foreach (int candidate, candidates) {
+                if (qAbs(candidate - i) <= 2) {
+                    taken = true;
+                    break;
+                }
+            }
+            if (!taken && (best < 0 || coarse.at(i) > coarse.at(best))) {
+                best = i;
+            }
+        }
+        if (best < 0 || coarse.at(best) <= 0) {
+            break;
+        }
+        candidates << best;
+    }
+
+    // Refine each candidate at full resolution
+    std::fill(correlation, correlation + size, 0);
+    foreach (int candidate, candidates) {
+        const int shift = (candidate - coarseSub.size()) * factor;
+        correlateWindow(envMain, sizeMain, envSub, sizeSub,
+                        shift - 2 * factor, shift + 2 * factor,
+                        correlation);
+    }
+}
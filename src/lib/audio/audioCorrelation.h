@@ -15,6 +15,7 @@
 #include "audioEnvelope.h"
 #include "definitions.h"
 #include <QList>
+#include <QFutureWatcher>
 
 
 /**
@@ -23,6 +24,9 @@
 
   It uses one main track (used in the initializer); further tracks will be
   aligned relative to this main track.
+
+  Children are correlated on worker threads, so that many clips can be
+  aligned to the same reference in parallel.
   */
 class AudioCorrelation : public QObject
 {
@@ -48,15 +52,47 @@ public:
                           const qint64 *envSub, int sizeSub,
                           qint64 *correlation,
                           qint64 *out_max = NULL);
+
+    /**
+      Same as correlate(), but only for the shifts in [minShift..maxShift].
+      The other entries of \c correlation are left untouched.
+      */
+    static void correlateWindow(const qint64 *envMain, int sizeMain,
+                                const qint64 *envSub, int sizeSub,
+                                int minShift, int maxShift,
+                                qint64 *correlation,
+                                qint64 *out_max = NULL);
+
+    /**
+      Coarse to fine alignment: a global FFT search on decimated envelopes
+      finds the best candidate shifts, which are then refined at full
+      resolution in a small window around each of them.
+      The correlation vector of \c info is filled around the candidates
+      and zero elsewhere, so its maximum is the best shift.
+      */
+    static void align(const qint64 *envMain, int sizeMain,
+                      const qint64 *envSub, int sizeSub,
+                      AudioCorrelationInfo *info);
+
 private:
     AudioEnvelope *m_mainTrackEnvelope;
+    bool m_mainReady;
 
     QList<AudioEnvelope*> m_children;
     QList<AudioCorrelationInfo*> m_correlations;
+    /// Children whose envelope is ready but not correlated yet
+    QList<AudioEnvelope*> m_pending;
+    /// Correlations running on worker threads
+    QList<QFutureWatcher<void>*> m_running;
+    QList<AudioEnvelope*> m_runningChildren;
+    QList<AudioCorrelationInfo*> m_runningInfos;
+
+    void startCorrelation(AudioEnvelope *envelope);
 
-private slots:    
+private slots:
     void slotProcessChild(AudioEnvelope *envelope);
     void slotAnnounceEnvelope();
+    void slotCorrelationDone();
     
 signals:
     void gotAudioAlignData(int, int, int);
@@ -12,17 +12,28 @@
 
 #include "audioStreamInfo.h"
 #include <QDebug>
+#include <QFile>
 #include <QImage>
+#include <QSaveFile>
 #include <QTime>
 #include <QtConcurrent>
+#include <QtEndian>
 #include <cmath>
 
+namespace {
+    // File layout: magic, version, frames (little endian quint32), then one little endian qint64 per frame
+    const char envelopeMagic[4] = { 'K', 'A', 'E', 'V' };
+    const quint32 envelopeVersion = 1;
+    const int headerSize = 12;
+}
+
 AudioEnvelope::AudioEnvelope(const QString &url, Mlt::Producer *producer, int offset, int length, int track, int startPos) :
     m_envelope(NULL),
     m_offset(offset),
     m_length(length),
     m_track(track),
     m_startpos(startPos),
+    m_clipLength(producer->get_length()),
     m_envelopeSize(producer->get_length()),
     m_envelopeMax(0),
     m_envelopeMean(0),
@@ -38,6 +49,12 @@ AudioEnvelope::AudioEnvelope(const QString &url, Mlt::Producer *producer, int of
     connect(&m_watcher, SIGNAL(finished()), this, SLOT(slotProcessEnveloppe()));
     if (!m_producer || !m_producer->is_valid()) {
 	qDebug()<<"// Cannot create envelope for producer: "<<path;
+    } else {
+        // The envelope is computed on a worker thread, don't decode the video we never look at
+        m_producer->set("video_index", -1);
+        if (producer->get("audio_index")) {
+            m_producer->set("audio_index", producer->get("audio_index"));
+        }
     }
     m_info = new AudioInfo(m_producer);
 
@@ -71,56 +88,128 @@ int AudioEnvelope::envelopeSize() const
     return m_envelopeSize;
 }
 
+void AudioEnvelope::setCacheFile(const QString &path)
+{
+    m_cacheFile = path;
+}
+
+QVector<qint64> AudioEnvelope::loadCache(const QString &path)
+{
+    QVector<qint64> envelope;
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return envelope;
+    }
+    const QByteArray data = file.readAll();
+    const uchar *header = (const uchar *) data.constData();
+    if (data.size() < headerSize || memcmp(header, envelopeMagic, 4) != 0
+            || qFromLittleEndian<quint32>(header + 4) != envelopeVersion) {
+        return envelope;
+    }
+    const int frames = (int) qFromLittleEndian<quint32>(header + 8);
+    if (frames <= 0 || data.size() != headerSize + frames * (int) sizeof(qint64)) {
+        return envelope;
+    }
+    envelope.resize(frames);
+    const uchar *values = header + headerSize;
+    for (int i = 0; i < frames; ++i) {
+        envelope[i] = qFromLittleEndian<qint64>(values + i * sizeof(qint64));
+    }
+    return envelope;
+}
+
+bool AudioEnvelope::saveCache(const QString &path, const QVector<qint64> &envelope)
+{
+    if (path.isEmpty() || envelope.isEmpty()) {
+        return false;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write audio envelope" << path;
+        return false;
+    }
+    QByteArray data(headerSize + envelope.size() * sizeof(qint64), 0);
+    uchar *header = (uchar *) data.data();
+    memcpy(header, envelopeMagic, 4);
+    qToLittleEndian<quint32>(envelopeVersion, header + 4);
+    qToLittleEndian<quint32>((quint32) envelope.size(), header + 8);
+    uchar *values = header + headerSize;
+    for (int i = 0; i < envelope.size(); ++i) {
+        qToLittleEndian<qint64>(envelope.at(i), values + i * sizeof(qint64));
+    }
+    file.write(data);
+    return file.commit();
+}
+
 void AudioEnvelope::loadEnvelope()
 {
     Q_ASSERT(m_envelope == NULL);
 
     qDebug() << "Loading envelope ...";
 
-    int samplingRate = m_info->info(0)->samplingRate();
-    mlt_audio_format format_s16 = mlt_audio_s16;
-    int channels = 1;
-
     m_envelope = new qint64[m_envelopeSize];
     m_envelopeMax = 0;
     m_envelopeMean = 0;
 
     QTime t;
     t.start();
-    int count = 0;
-    m_producer->seek(m_offset);
-    m_producer->set_speed(1.0); // This is necessary, otherwise we don't get any new frames in the 2nd run.
+    bool loaded = false;
+    if (!m_cacheFile.isEmpty()) {
+        QVector<qint64> clipEnvelope = loadCache(m_cacheFile);
+        if (clipEnvelope.isEmpty() && m_clipLength > 0) {
+            // Decode the whole clip once, any range of it can then be aligned without decoding
+            clipEnvelope.resize(m_clipLength);
+            decodeFrames(0, m_clipLength, clipEnvelope.data());
+            saveCache(m_cacheFile, clipEnvelope);
+        }
+        if (clipEnvelope.size() >= m_offset + m_envelopeSize) {
+            std::copy(clipEnvelope.constData() + m_offset, clipEnvelope.constData() + m_offset + m_envelopeSize, m_envelope);
+            loaded = true;
+        }
+    }
+    if (!loaded) {
+        decodeFrames(m_offset, m_envelopeSize, m_envelope);
+    }
+
     for (int i = 0; i < m_envelopeSize; ++i) {
+        m_envelopeMean += m_envelope[i];
+        if (m_envelope[i] > m_envelopeMax) {
+            m_envelopeMax = m_envelope[i];
+        }
+    }
+    m_envelopeMean /= m_envelopeSize;
+    qDebug() << "Calculating the envelope (" << m_envelopeSize << " frames) took "
+              << t.elapsed() << " ms.";
+}
+
+void AudioEnvelope::decodeFrames(int offset, int count, qint64 *envelope)
+{
+    int samplingRate = m_info->info(0)->samplingRate();
+    mlt_audio_format format_s16 = mlt_audio_s16;
+
+    m_producer->seek(offset);
+    m_producer->set_speed(1.0); // This is necessary, otherwise we don't get any new frames in the 2nd run.
+    for (int i = 0; i < count; ++i) {
         Mlt::Frame *frame = m_producer->get_frame(i);
         qint64 position = mlt_frame_get_position(frame->get_frame());
         int samples = mlt_sample_calculator(m_producer->get_fps(), samplingRate, position);
+        // The producer may return more channels than requested
+        int channels = 1;
 
         qint16 *data = static_cast<qint16*>(frame->get_audio(format_s16, samplingRate, channels, samples));
 
         qint64 sum = 0;
-        for (int k = 0; k < samples; ++k) {
-            sum += abs(data[k]);
-        }
-        m_envelope[i] = sum;
-
-        m_envelopeMean += sum;
-        if (sum > m_envelopeMax) {
-            m_envelopeMax = sum;
+        if (data && channels > 0) {
+            const int values = samples * channels;
+            for (int k = 0; k < values; ++k) {
+                sum += abs(data[k]);
+            }
+            sum /= channels;
         }
-
-//        qDebug() << position << '|' << m_producer->get_playtime()
-//                  << '-' << m_producer->get_in() << '+' << m_producer->get_out() << ' ';
+        envelope[i] = sum;
 
         delete frame;
-
-        count++;
-        if (m_length > 0 && count > m_length) {
-            break;
-        }
     }
-    m_envelopeMean /= m_envelopeSize;
-    qDebug() << "Calculating the envelope (" << m_envelopeSize << " frames) took "
-              << t.elapsed() << " ms.";
 }
 
 int AudioEnvelope::track() const
@@ -16,13 +16,18 @@
 
 #include <QFutureWatcher>
 #include <QObject>
+#include <QVector>
 
 class QImage;
 
 /**
   The audio envelope is a simplified version of an audio track
   with frame resolution. One entry is calculated by the sum
-  of the absolute values of all samples in the current frame.
+  of the absolute values of all samples in the current frame,
+  divided by the number of channels.
+
+  With a cache file, the envelope of the whole clip is decoded once
+  and stored, any range of the clip is then read from the cache.
 
   See also: http://bemasc.net/wordpress/2011/07/26/an-auto-aligner-for-pitivi/
   */
@@ -41,6 +46,12 @@ public:
     void loadEnvelope();
     void normalizeEnvelope(bool clampTo0 = false);
 
+    /// Use (and create if missing) a cache of the whole clip's envelope. Must be set before loading.
+    void setCacheFile(const QString &path);
+    /// Returns the cached envelope of a whole clip, empty if there is no valid cache
+    static QVector<qint64> loadCache(const QString &path);
+    static bool saveCache(const QString &path, const QVector<qint64> &envelope);
+
     QImage drawEnvelope();
 
     void dumpInfo() const;
@@ -59,6 +70,8 @@ private:
     int m_length;
     int m_track;
     int m_startpos;
+    int m_clipLength;
+    QString m_cacheFile;
 
     int m_envelopeSize;
     qint64 m_envelopeMax;
@@ -68,6 +81,9 @@ private:
     bool m_envelopeStdDevCalculated;
     bool m_envelopeIsNormalized;
     
+    /// Decodes \c count frames starting at \c offset into \c envelope
+    void decodeFrames(int offset, int count, qint64 *envelope);
+
 private slots:
     void slotProcessEnveloppe();
     
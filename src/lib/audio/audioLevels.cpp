@@ -0,0 +1,287 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "audioLevels.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QImage>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+    // File layout: magic, version, channels, frames, sub-frames (little endian quint32), then channel planes,
+    // for each pyramid level a min and a max plane per channel, and the sub-frame peak planes
+    const char levelsMagic[4] = { 'K', 'A', 'L', 'V' };
+    const quint32 levelsVersion = 4;
+    const int headerSize = 20;
+}
+
+AudioLevels::AudioLevels() :
+    m_channels(0),
+    m_frames(0),
+    m_subFrames(0),
+    m_subFrameOffset(0),
+    m_dataSize(0),
+    m_file(NULL),
+    m_data(NULL)
+{
+}
+
+AudioLevels::AudioLevels(int channels, int frames, int subFrames) :
+    m_channels(qMax(0, channels)),
+    m_frames(qMax(0, frames)),
+    m_subFrames(qMax(0, subFrames)),
+    m_subFrameOffset(0),
+    m_dataSize(0),
+    m_file(NULL),
+    m_data(NULL)
+{
+    m_buffer.fill(0, (int) initLayout());
+    m_data = m_buffer.constData();
+}
+
+AudioLevels::~AudioLevels()
+{
+    // Deleting the file unmaps it
+    delete m_file;
+}
+
+AudioLevels *AudioLevels::load(const QString &path)
+{
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < headerSize) {
+        delete file;
+        return NULL;
+    }
+    uchar *data = file->map(0, file->size());
+    if (!data) {
+        qDebug() << "Cannot map audio thumbnail" << path;
+        delete file;
+        return NULL;
+    }
+    quint32 version = qFromLittleEndian<quint32>(data + 4);
+    int channels = (int) qFromLittleEndian<quint32>(data + 8);
+    int frames = (int) qFromLittleEndian<quint32>(data + 12);
+    int subFrames = (int) qFromLittleEndian<quint32>(data + 16);
+    if (memcmp(data, levelsMagic, 4) != 0 || version != levelsVersion || channels <= 0 || frames <= 0 || subFrames < 0) {
+        qDebug() << "Invalid audio thumbnail" << path;
+        delete file;
+        return NULL;
+    }
+    AudioLevels *levels = new AudioLevels;
+    levels->m_channels = channels;
+    levels->m_frames = frames;
+    levels->m_subFrames = subFrames;
+    if (file->size() < headerSize + levels->initLayout()) {
+        qDebug() << "Truncated audio thumbnail" << path;
+        delete levels;
+        delete file;
+        return NULL;
+    }
+    // The mapping stays valid without the file descriptor, large projects map many thumbnails
+    file->close();
+    levels->m_file = file;
+    levels->m_data = data + headerSize;
+    return levels;
+}
+
+AudioLevels *AudioLevels::fromLegacyImage(const QImage &image, int channels)
+{
+    if (image.isNull() || channels <= 0) return NULL;
+    // Legacy images store the frame interleaved levels, 4 per pixel (r, g, b, a)
+    int n = image.width() * image.height();
+    int frames = 4 * n / channels;
+    if (frames == 0) return NULL;
+    AudioLevels *levels = new AudioLevels(channels, frames);
+    int index = 0;
+    for (int i = 0; i < n; i++) {
+        QRgb p = image.pixel(i / channels, i % channels);
+        const int values[4] = { qRed(p), qGreen(p), qBlue(p), qAlpha(p) };
+        for (int j = 0; j < 4; ++j, ++index) {
+            if (index / channels < frames) {
+                levels->setLevel(index % channels, index / channels, values[j]);
+            }
+        }
+    }
+    levels->buildPeaks();
+    return levels;
+}
+
+bool AudioLevels::save(const QString &path) const
+{
+    if (isEmpty()) return false;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write audio thumbnail" << path;
+        return false;
+    }
+    uchar header[headerSize];
+    memcpy(header, levelsMagic, 4);
+    qToLittleEndian<quint32>(levelsVersion, header + 4);
+    qToLittleEndian<quint32>((quint32) m_channels, header + 8);
+    qToLittleEndian<quint32>((quint32) m_frames, header + 12);
+    qToLittleEndian<quint32>((quint32) m_subFrames, header + 16);
+    file.write((const char *) header, headerSize);
+    file.write((const char *) m_data, m_dataSize);
+    return file.commit();
+}
+
+qint64 AudioLevels::initLayout()
+{
+    m_peakOffsets.clear();
+    m_peakCounts.clear();
+    qint64 size = (qint64) m_channels * m_frames;
+    // Halve the bucket count until a single bucket covers the whole clip
+    for (int level = 1; level < 31 && (m_frames - 1) >> (level - 1) > 0; ++level) {
+        int count = (int) (((qint64) m_frames + (1 << level) - 1) >> level);
+        m_peakOffsets << size;
+        m_peakCounts << count;
+        size += 2 * (qint64) m_channels * count;
+    }
+    m_subFrameOffset = size;
+    size += (qint64) m_channels * m_frames * m_subFrames;
+    m_dataSize = size;
+    return size;
+}
+
+int AudioLevels::channels() const
+{
+    return m_channels;
+}
+
+int AudioLevels::frames() const
+{
+    return m_frames;
+}
+
+int AudioLevels::subFrames() const
+{
+    return m_subFrames;
+}
+
+bool AudioLevels::isEmpty() const
+{
+    return m_channels == 0 || m_frames == 0;
+}
+
+bool AudioLevels::isMapped() const
+{
+    return m_file != NULL;
+}
+
+const quint8 *AudioLevels::channelData(int channel) const
+{
+    return m_data + channel * m_frames;
+}
+
+void AudioLevels::setLevel(int channel, int frame, double level)
+{
+    if (m_file || channel < 0 || channel >= m_channels || frame < 0 || frame >= m_frames) return;
+    m_buffer[channel * m_frames + frame] = (quint8) qBound(0.0, level, 255.0);
+}
+
+void AudioLevels::buildPeaks()
+{
+    if (m_file || isEmpty()) return;
+    quint8 *data = m_buffer.data();
+    for (int level = 0; level < m_peakOffsets.count(); ++level) {
+        const int count = m_peakCounts.at(level);
+        for (int channel = 0; channel < m_channels; ++channel) {
+            quint8 *min = data + m_peakOffsets.at(level) + 2 * channel * count;
+            quint8 *max = min + count;
+            if (level == 0) {
+                // First level is built from the frame levels
+                const quint8 *src = data + channel * m_frames;
+                for (int i = 0; i < count; ++i) {
+                    const int second = qMin(2 * i + 1, m_frames - 1);
+                    min[i] = qMin(src[2 * i], src[second]);
+                    max[i] = qMax(src[2 * i], src[second]);
+                }
+            } else {
+                const int previousCount = m_peakCounts.at(level - 1);
+                const quint8 *srcMin = data + m_peakOffsets.at(level - 1) + 2 * channel * previousCount;
+                const quint8 *srcMax = srcMin + previousCount;
+                for (int i = 0; i < count; ++i) {
+                    const int second = qMin(2 * i + 1, previousCount - 1);
+                    min[i] = qMin(srcMin[2 * i], srcMin[second]);
+                    max[i] = qMax(srcMax[2 * i], srcMax[second]);
+                }
+            }
+        }
+    }
+}
+
+int AudioLevels::peakLevels() const
+{
+    return m_peakOffsets.count();
+}
+
+void AudioLevels::peakRange(int channel, int firstFrame, int lastFrame, quint8 *min, quint8 *max) const
+{
+    firstFrame = qBound(0, firstFrame, m_frames - 1);
+    lastFrame = qBound(firstFrame + 1, lastFrame, m_frames);
+    // Coarsest level whose buckets are not larger than the range, so at most 3 buckets are read
+    int pyramid = 0;
+    while (pyramid < m_peakOffsets.count() && (2 << pyramid) <= lastFrame - firstFrame) {
+        pyramid++;
+    }
+    if (pyramid == 0) {
+        *min = *max = level(channel, firstFrame);
+        return;
+    }
+    const int count = m_peakCounts.at(pyramid - 1);
+    const quint8 *minData = m_data + m_peakOffsets.at(pyramid - 1) + 2 * channel * count;
+    const quint8 *maxData = minData + count;
+    const int last = (lastFrame - 1) >> pyramid;
+    *min = 255;
+    *max = 0;
+    for (int i = firstFrame >> pyramid; i <= last; ++i) {
+        *min = qMin(*min, minData[i]);
+        *max = qMax(*max, maxData[i]);
+    }
+}
+
+quint8 AudioLevels::maxPeak(int firstFrame, int lastFrame) const
+{
+    quint8 value = 0;
+    for (int channel = 0; channel < m_channels; ++channel) {
+        quint8 min, max;
+        peakRange(channel, firstFrame, lastFrame, &min, &max);
+        value = qMax(value, max);
+    }
+    return value;
+}
+
+void AudioLevels::setSubFramePeak(int channel, int index, double level)
+{
+    if (m_file || channel < 0 || channel >= m_channels || index < 0 || index >= m_frames * m_subFrames) return;
+    m_buffer[(int) (m_subFrameOffset + channel * m_frames * m_subFrames + index)] = (quint8) qBound(0.0, level, 255.0);
+}
+
+quint8 AudioLevels::subFramePeak(int channel, int first, int last) const
+{
+    const int count = m_frames * m_subFrames;
+    if (count == 0) return 0;
+    first = qBound(0, first, count - 1);
+    last = qBound(first + 1, last, count);
+    quint8 value = 0;
+    const int firstChannel = channel < 0 ? 0 : channel;
+    const int lastChannel = channel < 0 ? m_channels - 1 : qMin(channel, m_channels - 1);
+    for (int ch = firstChannel; ch <= lastChannel; ++ch) {
+        const quint8 *data = m_data + m_subFrameOffset + ch * count;
+        for (int i = first; i < last; ++i) {
+            value = qMax(value, data[i]);
+        }
+    }
+    return value;
+}
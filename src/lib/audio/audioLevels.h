@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef AUDIOLEVELS_H
+#define AUDIOLEVELS_H
+
+#include <QString>
+#include <QVector>
+#include <QSharedPointer>
+
+class QFile;
+class QImage;
+
+/**
+  Audio thumbnail data: one level (0-255) per frame and channel, stored as
+  one contiguous byte plane per channel.
+
+  The levels are followed by a min/max peak pyramid: pyramid level n holds,
+  for every channel, the lowest and highest level of each bucket of 2^n frames.
+  Painting a zoomed out clip reads a few buckets per pixel instead of every frame.
+
+  Thumbnails created from the decoded samples can also hold a fixed number of
+  sub-frame peaks per frame, used to draw the waveform at full zoom.
+
+  The cache file is a small header followed by the channel planes, the
+  pyramid and the sub-frame peaks, so a saved thumbnail can be memory-mapped and painted without
+  being read into memory.
+  */
+class AudioLevels
+{
+public:
+    /** @brief Creates a writable, zero filled store.
+     *  @param subFrames number of peak values stored for each frame, 0 for none */
+    AudioLevels(int channels, int frames, int subFrames = 0);
+    ~AudioLevels();
+
+    /** @brief Memory-maps a level file written by save(), returns NULL if it is missing or invalid. */
+    static AudioLevels *load(const QString &path);
+    /** @brief Converts a cached thumbnail from the former ARGB image format. */
+    static AudioLevels *fromLegacyImage(const QImage &image, int channels);
+
+    /** @brief Writes the levels to a cache file. */
+    bool save(const QString &path) const;
+
+    int channels() const;
+    int frames() const;
+    /** @brief Number of sub-frame peaks per frame, 0 if not available. */
+    int subFrames() const;
+    bool isEmpty() const;
+    /** @brief True if the data is read from a mapped cache file. */
+    bool isMapped() const;
+
+    /** @brief The levels of one channel, frames() bytes. */
+    const quint8 *channelData(int channel) const;
+    /** @brief Set a level, the value is clamped to 0-255. Only valid for stores created in memory. */
+    void setLevel(int channel, int frame, double level);
+    /** @brief Compute the peak pyramid, must be called once all levels are set. */
+    void buildPeaks();
+    /** @brief Number of pyramid levels above the frame levels. */
+    int peakLevels() const;
+    /** @brief Lowest and highest level of a channel between @param firstFrame and @param lastFrame (excluded).
+     *  The range is read from the coarsest pyramid level fitting in it, so it can be rounded outwards by up to one bucket. */
+    void peakRange(int channel, int firstFrame, int lastFrame, quint8 *min, quint8 *max) const;
+    /** @brief Highest level of all channels between @param firstFrame and @param lastFrame (excluded). */
+    quint8 maxPeak(int firstFrame, int lastFrame) const;
+    /** @brief Set the peak of a sub-frame bucket (frame * subFrames() + bucket), clamped to 0-255. */
+    void setSubFramePeak(int channel, int index, double level);
+    /** @brief Highest sub-frame peak of a channel between buckets @param first and @param last (excluded),
+     *  channel -1 for all channels. */
+    quint8 subFramePeak(int channel, int first, int last) const;
+
+    /** @brief Level for a channel at a frame, positions past the end return the last frame. */
+    inline quint8 level(int channel, int frame) const {
+        return m_data[channel * m_frames + qBound(0, frame, m_frames - 1)];
+    }
+    /** @brief Highest level of all channels at a frame. */
+    inline quint8 maxLevel(int frame) const {
+        frame = qBound(0, frame, m_frames - 1);
+        quint8 value = m_data[frame];
+        for (int channel = 1; channel < m_channels; ++channel) {
+            value = qMax(value, m_data[channel * m_frames + frame]);
+        }
+        return value;
+    }
+
+private:
+    Q_DISABLE_COPY(AudioLevels)
+    AudioLevels();
+    int m_channels;
+    int m_frames;
+    int m_subFrames;
+    qint64 m_subFrameOffset;
+    qint64 m_dataSize;
+    /** @brief Offset of each pyramid level in the data, and its bucket count */
+    QVector<qint64> m_peakOffsets;
+    QVector<int> m_peakCounts;
+    /** @brief Set up the pyramid layout, returns the total data size */
+    qint64 initLayout();
+    /** @brief Storage when the levels are not mapped from a file */
+    QVector<quint8> m_buffer;
+    QFile *m_file;
+    const quint8 *m_data;
+};
+
+typedef QSharedPointer<AudioLevels> AudioLevelsPtr;
+
+#endif // AUDIOLEVELS_H
@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "audioPeakReducer.h"
+#include "audioLevels.h"
+
+#include <QtEndian>
+
+namespace {
+    // Scale of the frame levels and sub-frame peaks, same as the former ffmpeg thumbnails.
+    // Both use it so that the waveform keeps its height when the timeline zoom switches between them.
+    const double levelFactor = 800.0 / 32768;
+}
+
+AudioPeakReducer::AudioPeakReducer(AudioLevels *levels, int frequency, double fps) :
+    m_levels(levels),
+    m_channels(levels->channels()),
+    m_buckets(qMax(1, levels->subFrames())),
+    m_bucketCount(levels->frames() * m_buckets),
+    m_samplesPerBucket(frequency / (fps > 0 ? fps : 25.0) / m_buckets),
+    m_bucket(0),
+    m_bucketEnd(qRound64(m_samplesPerBucket)),
+    m_sample(0),
+    m_bucketSamples(0),
+    m_frameSamples(0),
+    m_min(m_channels, 32767),
+    m_max(m_channels, -32768),
+    m_sum(m_channels, 0),
+    m_envelope(NULL)
+{
+}
+
+void AudioPeakReducer::addData(const QByteArray &data)
+{
+    if (m_channels == 0 || m_bucket >= m_bucketCount) return;
+    m_pending.append(data);
+    const int frameBytes = 2 * m_channels;
+    const int count = m_pending.size() / frameBytes;
+    const qint16 *samples = (const qint16 *) m_pending.constData();
+    int pos = 0;
+    while (pos < count && m_bucket < m_bucketCount) {
+        const int run = (int) qMin<qint64>(count - pos, qMax<qint64>(1, m_bucketEnd - m_sample));
+        reduceRun(samples + pos * m_channels, run);
+        pos += run;
+        m_sample += run;
+        m_bucketSamples += run;
+        m_frameSamples += run;
+        if (m_sample >= m_bucketEnd) {
+            closeBucket();
+        }
+    }
+    if (m_bucket >= m_bucketCount) {
+        // Samples past the clip length are ignored
+        m_pending.clear();
+    } else {
+        m_pending.remove(0, count * frameBytes);
+    }
+}
+
+void AudioPeakReducer::reduceRun(const qint16 *samples, int count)
+{
+    if (m_scratch.size() < count) m_scratch.resize(count);
+    qint16 *scratch = m_scratch.data();
+    for (int channel = 0; channel < m_channels; ++channel) {
+        for (int i = 0; i < count; ++i) {
+            scratch[i] = qFromLittleEndian<qint16>(samples[i * m_channels + channel]);
+        }
+        // Branch free min / max / sum loop on contiguous data, so that the compiler vectorizes it
+        int min = m_min.at(channel);
+        int max = m_max.at(channel);
+        qint64 sum = 0;
+        for (int i = 0; i < count; ++i) {
+            const int value = scratch[i];
+            min = qMin(min, value);
+            max = qMax(max, value);
+            sum += value < 0 ? -value : value;
+        }
+        m_min[channel] = min;
+        m_max[channel] = max;
+        m_sum[channel] += sum;
+    }
+}
+
+void AudioPeakReducer::closeBucket()
+{
+    if (m_levels->subFrames() > 0) {
+        for (int channel = 0; channel < m_channels; ++channel) {
+            const int peak = m_bucketSamples > 0 ? qMax(-m_min.at(channel), m_max.at(channel)) : 0;
+            m_levels->setSubFramePeak(channel, m_bucket, peak * levelFactor);
+        }
+    }
+    m_min.fill(32767);
+    m_max.fill(-32768);
+    m_bucketSamples = 0;
+    m_bucket++;
+    if (m_bucket % m_buckets == 0) {
+        closeFrame(m_bucket / m_buckets - 1);
+    }
+    m_bucketEnd = qRound64((m_bucket + 1) * m_samplesPerBucket);
+}
+
+void AudioPeakReducer::closeFrame(int frame)
+{
+    qint64 envelope = 0;
+    for (int channel = 0; channel < m_channels; ++channel) {
+        const double average = m_frameSamples > 0 ? (double) m_sum.at(channel) / m_frameSamples : 0;
+        m_levels->setLevel(channel, frame, average * levelFactor);
+        envelope += m_sum.at(channel);
+    }
+    if (m_envelope && frame < m_envelope->size()) {
+        (*m_envelope)[frame] = envelope / m_channels;
+    }
+    m_sum.fill(0);
+    m_frameSamples = 0;
+}
+
+void AudioPeakReducer::finish()
+{
+    if (m_bucket >= m_bucketCount) return;
+    if (m_bucketSamples > 0) {
+        closeBucket();
+    }
+    if (m_frameSamples > 0) {
+        closeFrame(m_bucket / m_buckets);
+    }
+    m_pending.clear();
+}
+
+void AudioPeakReducer::setEnvelope(QVector<qint64> *envelope)
+{
+    m_envelope = envelope;
+}
+
+int AudioPeakReducer::processedFrames() const
+{
+    return m_bucket / m_buckets;
+}
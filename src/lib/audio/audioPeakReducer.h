@@ -0,0 +1,67 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef AUDIOPEAKREDUCER_H
+#define AUDIOPEAKREDUCER_H
+
+#include <QByteArray>
+#include <QVector>
+
+class AudioLevels;
+
+/**
+  Reduces a stream of interleaved signed 16 bit little endian samples
+  into an AudioLevels store while it is being decoded.
+
+  Each frame gets the average absolute level of all its samples, and each
+  sub-frame bucket the peak absolute sample. Data can be fed in blocks of any
+  size, so the decoded audio never needs to be held in memory.
+  */
+class AudioPeakReducer
+{
+public:
+    /** @param levels the store to fill, its sub-frame count sets the bucket size */
+    AudioPeakReducer(AudioLevels *levels, int frequency, double fps);
+
+    /** @brief Reduce a block of samples, incomplete sample frames are kept for the next call. */
+    void addData(const QByteArray &data);
+    /** @brief Flush the last incomplete frame at the end of the stream. */
+    void finish();
+    /** @brief Number of frames completed so far. */
+    int processedFrames() const;
+    /** @brief Also fill @param envelope (one entry per frame) with the AudioEnvelope values. */
+    void setEnvelope(QVector<qint64> *envelope);
+
+private:
+    AudioLevels *m_levels;
+    int m_channels;
+    /** @brief Buckets per frame, 1 if the store has no sub-frame peaks */
+    int m_buckets;
+    int m_bucketCount;
+    double m_samplesPerBucket;
+    /** @brief Index of the current bucket and sample where it ends */
+    int m_bucket;
+    qint64 m_bucketEnd;
+    qint64 m_sample;
+    int m_bucketSamples;
+    int m_frameSamples;
+    QVector<int> m_min;
+    QVector<int> m_max;
+    QVector<qint64> m_sum;
+    /** @brief Deinterleaved samples of one channel */
+    QVector<qint16> m_scratch;
+    QByteArray m_pending;
+    QVector<qint64> *m_envelope;
+    void reduceRun(const qint16 *samples, int count);
+    void closeBucket();
+    void closeFrame(int frame);
+};
+
+#endif // AUDIOPEAKREDUCER_H
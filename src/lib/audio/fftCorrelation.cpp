@@ -17,14 +17,16 @@ extern "C"
 
 #include <QDebug>
 #include <QTime>
+#include <QVector>
 #include <algorithm>
 
 void FFTCorrelation::correlate(const qint64 *left, const int leftSize,
                                const qint64 *right, const int rightSize,
                                qint64 *out_correlated)
 {
-    float correlatedFloat[leftSize+rightSize+1];
-    correlate(left, leftSize, right, rightSize, correlatedFloat);
+    // Heap buffers: clips of an hour do not fit on the stack
+    QVector<float> correlatedFloat(leftSize+rightSize+1);
+    correlate(left, leftSize, right, rightSize, correlatedFloat.data());
 
     // The correlation vector will have entries up to N (number of entries
     // of the vector), so converting to integers will not lose that much
@@ -41,8 +43,8 @@ void FFTCorrelation::correlate(const qint64 *left, const int leftSize,
     QTime t;
     t.start();
 
-    float leftF[leftSize];
-    float rightF[rightSize];
+    QVector<float> leftF(leftSize);
+    QVector<float> rightF(rightSize);
 
     // First the qint64 values need to be normalized to floats
     // Dividing by the max value is maybe not the best solution, but the
@@ -72,7 +74,7 @@ void FFTCorrelation::correlate(const qint64 *left, const int leftSize,
     }
 
     // Now we can convolve to get the correlation
-    convolve(leftF, leftSize, rightF, rightSize, out_correlated);
+    convolve(leftF.constData(), leftSize, rightF.constData(), rightSize, out_correlated);
 
     qDebug() << "Correlation (FFT based) computed in " << t.elapsed() << " ms.";
 }
@@ -102,9 +104,10 @@ void FFTCorrelation::convolve(const float *left, const int leftSize,
 
     kiss_fftr_cfg fftConfig = kiss_fftr_alloc(size, false, NULL,NULL);
     kiss_fftr_cfg ifftConfig = kiss_fftr_alloc(size, true, NULL,NULL);
-    kiss_fft_cpx leftFFT[size/2];
-    kiss_fft_cpx rightFFT[size/2];
-    kiss_fft_cpx correlatedFFT[size/2];
+    // A real FFT of size n has n/2+1 complex output values
+    QVector<kiss_fft_cpx> leftFFT(size/2+1);
+    QVector<kiss_fft_cpx> rightFFT(size/2+1);
+    QVector<kiss_fft_cpx> correlatedFFT(size/2+1);
 
 
     // Fill in the data into our new vectors with padding
@@ -119,11 +122,11 @@ void FFTCorrelation::convolve(const float *left, const int leftSize,
     std::copy(right, right+rightSize, rightData);
 
     // Fourier transformation of the vectors
-    kiss_fftr(fftConfig, leftData, leftFFT);
-    kiss_fftr(fftConfig, rightData, rightFFT);
+    kiss_fftr(fftConfig, leftData, leftFFT.data());
+    kiss_fftr(fftConfig, rightData, rightFFT.data());
 
     // Convolution in spacial domain is a multiplication in fourier domain. O(n).
-    for (int i = 0; i < size/2; ++i) {
+    for (int i = 0; i <= size/2; ++i) {
         correlatedFFT[i].r = leftFFT[i].r*rightFFT[i].r - leftFFT[i].i*rightFFT[i].i;
         correlatedFFT[i].i = leftFFT[i].r*rightFFT[i].i + leftFFT[i].i*rightFFT[i].r;
     }
@@ -134,7 +137,7 @@ void FFTCorrelation::convolve(const float *left, const int leftSize,
     *out_convolved = 0;
     int out_size = leftSize+rightSize+1;
 
-    kiss_fftri(ifftConfig, correlatedFFT, convolved);
+    kiss_fftri(ifftConfig, correlatedFFT.constData(), convolved);
     std::copy(convolved, convolved+out_size-1, out_convolved+1);
 
     // Finally some cleanup.
@@ -12,16 +12,12 @@
 #define FFTTOOLS_H
 
 #include <QVector>
-#include <QHash>
 #include "../../definitions.h"
 #include "../external/kiss_fft/tools/kiss_fftr.h"
 
 class FFTTools
 {
 public:
-    FFTTools();
-    ~FFTTools();
-
     enum WindowType { Window_Rect, Window_Triangle, Window_Hamming };
 
     /** Creates a vector containing the factors for the selected window functions.
@@ -39,25 +35,6 @@ public:
     */
     static const QVector<float> window(const WindowType windowType, const int size, const float param = 0);
 
-    static const QString windowSignature(const WindowType windowType, const int size, const float param = 0);
-
-    /** Returns a signature for a kiss_fft configuration
-        used as a hash in the cache */
-    static const QString cfgSignature(const int size);
-
-    /** Calculates the Fourier Tranformation of the input audio frame.
-        The resulting values will be given in relative dezibel: The maximum power is 0 dB, lower powers have
-        negative dB values.
-        * audioFrame: Interleaved format with #numChannels channels
-        * freqSpectrum: Array pointer to write the data into
-        * windowSize must be divisible by 2,
-        * freqSpectrum has to be of size windowSize/2
-        For windowType and param see the FFTTools::window() function above.
-    */
-    void fftNormalized(const audioShortVector audioFrame, const uint channel, const uint numChannels, float *freqSpectrum,
-                       const WindowType windowType, const uint windowSize, const float param = 0);
-
-
     /** This is linear interpolation with the special property that it preserves peaks, which is required
         for e.g. showing correct Decibel values (where the peak values are of interest because of clipping which
         may occur for too strong frequencies; The lower values are smeared by the window function anyway).
@@ -72,12 +49,10 @@ public:
         @param fill         If right lies outside of the array bounds (which is perfectly fine here) then this value
                             will be used for filling the missing information.
         */
-    static const QVector<float> interpolatePeakPreserving(const QVector<float> in, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
-
-private:
-    QHash<QString, kiss_fftr_cfg> m_fftCfgs; // FFT cfg cache
-    QHash<QString, QVector<float> > m_windowFunctions; // Window function cache
+    static const QVector<float> interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
 
+    /** Same as above for @param inSize values of @param in, writing @param targetSize values to @param out. */
+    static void interpolatePeakPreserving(const float *in, const uint inSize, float *out, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
 };
 
 #endif // FFTTOOLS_H
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "peakPreservingMap.h"
+
+#include <math.h>
+
+PeakPreservingMap::PeakPreservingMap() :
+    m_inSize(0),
+    m_targetSize(0),
+    m_left(0),
+    m_right(0),
+    m_interpolate(true),
+    m_covered(0)
+{
+}
+
+void PeakPreservingMap::prepare(uint inSize, uint targetSize, uint left, uint right)
+{
+    if (right == 0) {
+        right = inSize-1;
+    }
+    if (inSize == m_inSize && targetSize == m_targetSize && left == m_left && right == m_right) {
+        return;
+    }
+    Q_ASSERT(targetSize > 0);
+    Q_ASSERT(left < right);
+    m_inSize = inSize;
+    m_targetSize = targetSize;
+    m_left = left;
+    m_right = right;
+    m_first.resize(targetSize);
+    m_second.resize(targetSize);
+    m_weights.resize(targetSize);
+    m_peakCandidates.resize(targetSize);
+
+    // Same positions as in FFTTools::interpolatePeakPreserving(), see there
+    const float divisor = qMax(1u, targetSize-1);
+    float x;
+    uint xi;
+    uint i;
+    m_interpolate = ((float) (right-left))/targetSize < 2;
+    if (m_interpolate) {
+        float x_prev = 0;
+        for (i = 0; i < targetSize; ++i) {
+            x = ((float) i) / divisor * (right-left) + left;
+            xi = (int) floor(x);
+            if (x > inSize-1) {
+                break;
+            }
+            m_first[i] = xi;
+            if (xi == 0 || xi == inSize-1) {
+                m_second[i] = xi;
+                m_weights[i] = 0;
+                m_peakCandidates[i] = false;
+            } else {
+                m_second[i] = xi+1;
+                m_weights[i] = x - xi;
+                m_peakCandidates[i] = x_prev < xi;
+            }
+            x_prev = x;
+        }
+        m_covered = i;
+    } else {
+        uint src = left;
+        for (i = 0; i < targetSize; ++i) {
+            x = ((float) (i+1)) / divisor * (right-left) + left;
+            xi = (int) floor(x);
+            m_first[i] = src;
+            src = qMax(src, qMin(xi, inSize));
+            m_second[i] = src;
+        }
+        m_covered = targetSize;
+    }
+}
+
+bool PeakPreservingMap::isValid() const
+{
+    return m_targetSize > 0;
+}
+
+uint PeakPreservingMap::inSize() const
+{
+    return m_inSize;
+}
+
+uint PeakPreservingMap::targetSize() const
+{
+    return m_targetSize;
+}
+
+void PeakPreservingMap::apply(const float *in, float *out, float fill) const
+{
+    const uint *first = m_first.constData();
+    const uint *second = m_second.constData();
+    uint i;
+    if (m_interpolate) {
+        const float *weights = m_weights.constData();
+        const bool *peakCandidates = m_peakCandidates.constData();
+        for (i = 0; i < m_covered; ++i) {
+            const float a = in[first[i]];
+            const float b = in[second[i]];
+            if (peakCandidates[i] && a > b) {
+                out[i] = a;
+            } else {
+                out[i] = (1 - weights[i]) * a + weights[i] * b;
+            }
+        }
+    } else {
+        for (i = 0; i < m_covered; ++i) {
+            float value = fill;
+            for (uint src = first[i]; src < second[i]; ++src) {
+                if (value < in[src]) {
+                    value = in[src];
+                }
+            }
+            out[i] = value;
+        }
+    }
+    for (; i < m_targetSize; ++i) {
+        out[i] = fill;
+    }
+}
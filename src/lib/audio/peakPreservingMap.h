@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef PEAKPRESERVINGMAP_H
+#define PEAKPRESERVINGMAP_H
+
+#include <QVector>
+
+/**
+  \brief Precomputed FFTTools::interpolatePeakPreserving() for a fixed geometry.
+
+  The source positions, weights and ranges only depend on the input size,
+  the target size and the borders, so they are computed once and every
+  spectrum of the same geometry is then mapped in a single pass over the
+  target values, with the same results as interpolatePeakPreserving().
+  */
+class PeakPreservingMap
+{
+public:
+    PeakPreservingMap();
+
+    /** Prepares the mapping; does nothing if the geometry is the one already prepared.
+        For the parameters see FFTTools::interpolatePeakPreserving(). */
+    void prepare(uint inSize, uint targetSize, uint left = 0, uint right = 0);
+    bool isValid() const;
+    uint inSize() const;
+    uint targetSize() const;
+
+    /** Maps inSize() values of @param in to targetSize() values written to @param out. */
+    void apply(const float *in, float *out, float fill = 0.0) const;
+
+private:
+    uint m_inSize;
+    uint m_targetSize;
+    uint m_left;
+    uint m_right;
+    /** Interpolating (less than 2 source values per target value) or taking the maximum */
+    bool m_interpolate;
+    /** Number of target values covered by the input, the others are filled */
+    uint m_covered;
+
+    /** Interpolation: source index, the next one and the weight of the next one.
+        Maximum: first and end source index. */
+    QVector<uint> m_first;
+    QVector<uint> m_second;
+    QVector<float> m_weights;
+    /** Interpolation: the target value is the first one after m_first, a peak there is kept */
+    QVector<bool> m_peakCandidates;
+};
+
+#endif // PEAKPRESERVINGMAP_H
@@ -0,0 +1,181 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "spectrumEngine.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+SpectrumEngine::SpectrumEngine() :
+    m_plans(),
+    m_plan(NULL),
+    m_param(0),
+    m_windowSize(0),
+    m_channels(0)
+{
+}
+
+SpectrumEngine::~SpectrumEngine()
+{
+    QHash<int, Plan *>::iterator i;
+    for (i = m_plans.begin(); i != m_plans.end(); ++i) {
+        kiss_fftr_free((*i)->cfg);
+        delete *i;
+    }
+}
+
+SpectrumEngine::Plan *SpectrumEngine::plan(int windowSize)
+{
+    if (m_plan && windowSize == m_windowSize) {
+        return m_plan;
+    }
+    Plan *p = m_plans.value(windowSize, NULL);
+    if (!p) {
+        p = new Plan;
+        p->cfg = kiss_fftr_alloc(windowSize, false, NULL, NULL);
+        m_plans.insert(windowSize, p);
+    }
+    return p;
+}
+
+const QVector<float> &SpectrumEngine::window(Plan *plan, FFTTools::WindowType windowType, float param)
+{
+    if (param != m_param) {
+        // Windows depend on the parameter, rebuild them for every size
+        m_param = param;
+        foreach (Plan *p, m_plans) {
+            for (int i = 0; i < 3; ++i) {
+                p->windows[i].clear();
+            }
+        }
+    }
+    QVector<float> &w = plan->windows[windowType];
+    if (w.isEmpty()) {
+        const int size = m_windowSize;
+        w = FFTTools::window(windowType, size, param);
+        // FFTTools::window() stores the area of the window after the last factor.
+        // The FFT values are scaled by it, and by N/2, which is compensated in dB.
+        const float area = w.at(size);
+        w.resize(size);
+        for (int i = 0; i < size; ++i) {
+            w[i] /= 32767.0f;
+        }
+        plan->dBOffsets[windowType] = -20 * log10(area * size / 2.0);
+    }
+    return w;
+}
+
+bool SpectrumEngine::process(const audioShortVector &audioFrame, int numChannels, int windowSize,
+                             FFTTools::WindowType windowType, float param)
+{
+    if ((windowSize & 1) || windowSize < 2 || numChannels < 1 || windowType < FFTTools::Window_Rect || windowType > FFTTools::Window_Hamming) {
+        return false;
+    }
+    m_plan = plan(windowSize);
+    m_windowSize = windowSize;
+    m_channels = numChannels;
+    const float *coefficients = window(m_plan, windowType, param).constData();
+    const int bins = windowSize / 2;
+
+    m_samples.resize(numChannels * windowSize);
+    m_freqData.resize(bins + 1);
+    m_power.resize(bins);
+    m_spectra.resize((numChannels + 1) * bins);
+
+    // Split the channels while applying the window, in a single pass over the frame
+    const int numSamples = qMin(audioFrame.size() / numChannels, windowSize);
+    const qint16 *in = audioFrame.constData();
+    float *samples = m_samples.data();
+    for (int i = 0; i < numSamples; ++i) {
+        const float coefficient = coefficients[i];
+        for (int c = 0; c < numChannels; ++c) {
+            samples[c * windowSize + i] = in[c] * coefficient;
+        }
+        in += numChannels;
+    }
+    // Fill what cannot be covered with sample data with silence
+    for (int c = 0; c < numChannels; ++c) {
+        std::fill(samples + c * windowSize + numSamples, samples + (c + 1) * windowSize, 0.0f);
+    }
+
+    const float offset = m_plan->dBOffsets[windowType];
+    float *maxima = m_spectra.data() + numChannels * bins;
+    for (int c = 0; c < numChannels; ++c) {
+        kiss_fftr(m_plan->cfg, samples + c * windowSize, m_freqData.data());
+
+        const kiss_fft_cpx *freq = m_freqData.constData();
+        float *power = m_power.data();
+        for (int i = 0; i < bins; ++i) {
+            power[i] = freq[i].r * freq[i].r + freq[i].i * freq[i].i;
+        }
+        float *spectrum = m_spectra.data() + c * bins;
+        powerToDb(power, spectrum, bins, offset);
+
+        if (c == 0) {
+            memcpy(maxima, spectrum, bins * sizeof(float));
+        } else {
+            for (int i = 0; i < bins; ++i) {
+                maxima[i] = std::max(maxima[i], spectrum[i]);
+            }
+        }
+    }
+    return true;
+}
+
+void SpectrumEngine::powerToDb(const float *in, float *out, int count, float offset)
+{
+    // 10*log10(x) = 10/ln(10) * (e*ln(2) + ln(m)) with x = m * 2^e and m in [1,2).
+    // ln(m) = 2*atanh(t) with t = (m-1)/(m+1) in [0,1/3), four terms of the series
+    // leave an error below 1e-5. Written without branches so that it vectorizes;
+    // powers are never negative, so they can be clamped as integers.
+    const float dBPerNeper = 10 / M_LN10;
+    const float ln2 = M_LN2;
+    const qint32 minBits = 0x0da24260; // 1e-30
+    for (int i = 0; i < count; ++i) {
+        qint32 bits;
+        memcpy(&bits, in + i, sizeof(bits));
+        bits = bits > minBits ? bits : minBits;
+        const float e = (float) ((bits >> 23) - 127);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+        float m;
+        memcpy(&m, &bits, sizeof(m));
+        const float t = (m - 1) / (m + 1);
+        const float t2 = t * t;
+        const float lnM = 2 * t * (1 + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7))));
+        out[i] = dBPerNeper * (e * ln2 + lnM) + offset;
+    }
+}
+
+int SpectrumEngine::windowSize() const
+{
+    return m_windowSize;
+}
+
+int SpectrumEngine::channels() const
+{
+    return m_channels;
+}
+
+int SpectrumEngine::binCount() const
+{
+    return m_windowSize / 2;
+}
+
+const float *SpectrumEngine::spectrum(int channel) const
+{
+    Q_ASSERT(channel >= 0 && channel < m_channels);
+    return m_spectra.constData() + channel * binCount();
+}
+
+const float *SpectrumEngine::maximum() const
+{
+    return m_spectra.constData() + m_channels * binCount();
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SPECTRUMENGINE_H
+#define SPECTRUMENGINE_H
+
+#include <QHash>
+#include <QVector>
+#include "fftTools.h"
+
+/**
+  \brief Spectral power distribution of all channels of an audio frame.
+
+  FFT plans and window functions are built once per window size and kept
+  for the lifetime of the engine, so that switching between sizes does not
+  allocate either. Each call reads the interleaved frame once, applying the
+  window while splitting the channels, transforms every channel and converts
+  the magnitudes to dB with a branch free approximation of log10.
+
+  Results are in relative decibel like FFTTools used to return them: a full
+  scale sine gives 0 dB, lower powers have negative values.
+  An engine is not thread safe, each scope owns its own.
+  */
+class SpectrumEngine
+{
+public:
+    SpectrumEngine();
+    ~SpectrumEngine();
+
+    /** Transforms the first @param windowSize samples of each channel of @param audioFrame.
+        windowSize must be even and at least 2, missing samples are taken as silence.
+        For windowType and param see FFTTools::window().
+        @return false if the window size is invalid */
+    bool process(const audioShortVector &audioFrame, int numChannels, int windowSize,
+                 FFTTools::WindowType windowType, float param = 0);
+
+    int windowSize() const;
+    int channels() const;
+    /** Number of values per spectrum, windowSize/2 */
+    int binCount() const;
+    /** dB values of @param channel, binCount() values */
+    const float *spectrum(int channel) const;
+    /** Loudest channel for each bin, binCount() values */
+    const float *maximum() const;
+
+    /** Converts @param count squared magnitudes of @param in to dB, adding @param offset.
+        Accurate to about 0.001 dB, powers of 0 give around -300 dB instead of -inf. */
+    static void powerToDb(const float *in, float *out, int count, float offset);
+
+private:
+    struct Plan {
+        kiss_fftr_cfg cfg;
+        /** Window per FFTTools::WindowType, scaled to normalize 16 bit samples; built on first use */
+        QVector<float> windows[3];
+        /** dB normalization for each window */
+        float dBOffsets[3];
+    };
+    QHash<int, Plan *> m_plans;
+    Plan *m_plan;
+    float m_param;
+
+    int m_windowSize;
+    int m_channels;
+    /** Windowed samples, one block of windowSize per channel */
+    QVector<float> m_samples;
+    QVector<kiss_fft_cpx> m_freqData;
+    QVector<float> m_power;
+    /** dB values, one block of binCount per channel followed by the maximum */
+    QVector<float> m_spectra;
+
+    Plan *plan(int windowSize);
+    const QVector<float> &window(Plan *plan, FFTTools::WindowType windowType, float param);
+};
+
+#endif // SPECTRUMENGINE_H
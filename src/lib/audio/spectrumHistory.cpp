@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "spectrumHistory.h"
+
+#include <cstring>
+
+SpectrumHistory::SpectrumHistory(int capacity) :
+    m_capacity(qMax(1, capacity)),
+    m_stride(0),
+    m_count(0),
+    m_head(-1),
+    m_rowSizes(m_capacity, 0)
+{
+}
+
+void SpectrumHistory::clear()
+{
+    m_count = 0;
+    m_head = -1;
+}
+
+void SpectrumHistory::prepend(const float *spectrum, int size)
+{
+    if (size > m_stride) {
+        // Widen all rows, keeping what is stored
+        QVector<float> data(m_capacity * size);
+        for (int age = 0; age < m_count; ++age) {
+            const int i = index(age);
+            memcpy(data.data() + i * size, m_data.constData() + i * m_stride, m_rowSizes.at(i) * sizeof(float));
+        }
+        m_data.swap(data);
+        m_stride = size;
+    }
+    m_head = (m_head + 1) % m_capacity;
+    memcpy(m_data.data() + m_head * m_stride, spectrum, size * sizeof(float));
+    m_rowSizes[m_head] = size;
+    if (m_count < m_capacity) {
+        m_count++;
+    }
+}
+
+int SpectrumHistory::capacity() const
+{
+    return m_capacity;
+}
+
+int SpectrumHistory::size() const
+{
+    return m_count;
+}
+
+const float *SpectrumHistory::row(int age) const
+{
+    Q_ASSERT(age >= 0 && age < m_count);
+    return m_data.constData() + index(age) * m_stride;
+}
+
+int SpectrumHistory::rowSize(int age) const
+{
+    Q_ASSERT(age >= 0 && age < m_count);
+    return m_rowSizes.at(index(age));
+}
+
+int SpectrumHistory::storedBytes() const
+{
+    return m_data.size() * sizeof(float);
+}
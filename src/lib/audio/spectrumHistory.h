@@ -0,0 +1,59 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SPECTRUMHISTORY_H
+#define SPECTRUMHISTORY_H
+
+#include <QVector>
+
+/**
+  \brief Ring buffer of the most recent spectra.
+
+  All spectra share a single block of floats with one row per spectrum,
+  adding a spectrum overwrites the oldest row once the history is full
+  and never allocates unless the spectrum is longer than all before it.
+  Rows may have different sizes (the FFT window size can change while
+  the history is kept), each row remembers its own size.
+  */
+class SpectrumHistory
+{
+public:
+    explicit SpectrumHistory(int capacity);
+
+    void clear();
+    /** Adds the @param size values of @param spectrum as the newest row. */
+    void prepend(const float *spectrum, int size);
+
+    int capacity() const;
+    /** Number of rows stored */
+    int size() const;
+    /** Row @param age, 0 being the newest one */
+    const float *row(int age) const;
+    int rowSize(int age) const;
+    /** Memory used by the rows, in bytes */
+    int storedBytes() const;
+
+private:
+    int m_capacity;
+    int m_stride;
+    int m_count;
+    /** Index of the newest row */
+    int m_head;
+    QVector<float> m_data;
+    QVector<int> m_rowSizes;
+
+    inline int index(int age) const
+    {
+        const int i = m_head - age;
+        return i < 0 ? i + m_capacity : i;
+    }
+};
+
+#endif // SPECTRUMHISTORY_H
@@ -0,0 +1,278 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "fileHasher.h"
+
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <QtEndian>
+
+#include <cstring>
+
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#endif
+
+namespace {
+    // Memo layout: magic, version (little endian quint32), then one record per file:
+    // device, inode, size and modification time (little endian 64 bit integers) and the MD5 digest
+    const char memoMagic[4] = { 'K', 'F', 'H', 'M' };
+    const quint32 memoVersion = 1;
+    const int memoHeaderSize = 8;
+    const int digestSize = 16;
+    const int recordSize = 4 * 8 + digestSize;
+    // Bytes hashed at each end of the file
+    const qint64 hashedBlock = 1000000;
+
+    struct FileIdentity
+    {
+        quint64 device;
+        quint64 inode;
+        qint64 size;
+        qint64 modified;
+        bool operator==(const FileIdentity &other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && modified == other.modified;
+        }
+    };
+
+    uint qHash(const FileIdentity &identity, uint seed = 0)
+    {
+        return ::qHash(identity.inode, seed) ^ ::qHash(identity.size) ^ ::qHash(identity.modified) ^ ::qHash(identity.device);
+    }
+
+    struct HashMemo
+    {
+        HashMemo() : loaded(false), records(0) {}
+        QMutex mutex;
+        QHash<FileIdentity, QByteArray> digests;
+        QString path;
+        bool loaded;
+        /** Records in the memo file, including the outdated ones */
+        int records;
+        QAtomicInt hits;
+        QAtomicInt misses;
+
+        /** Called with the mutex locked */
+        void load();
+        void insert(const FileIdentity &identity, const QByteArray &digest);
+        void rewrite();
+    };
+
+    Q_GLOBAL_STATIC(HashMemo, hashMemo)
+
+    void writeRecord(uchar *record, const FileIdentity &identity, const QByteArray &digest)
+    {
+        qToLittleEndian<quint64>(identity.device, record);
+        qToLittleEndian<quint64>(identity.inode, record + 8);
+        qToLittleEndian<qint64>(identity.size, record + 16);
+        qToLittleEndian<qint64>(identity.modified, record + 24);
+        memcpy(record + 32, digest.constData(), digestSize);
+    }
+
+    QByteArray memoHeader()
+    {
+        QByteArray header(memoHeaderSize, 0);
+        memcpy(header.data(), memoMagic, 4);
+        qToLittleEndian<quint32>(memoVersion, (uchar *) header.data() + 4);
+        return header;
+    }
+
+    void HashMemo::load()
+    {
+        if (loaded) {
+            return;
+        }
+        loaded = true;
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (cacheDir.isEmpty()) {
+            return;
+        }
+        path = cacheDir + QStringLiteral("/filehashes");
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+        const QByteArray data = file.readAll();
+        file.close();
+        const uchar *header = (const uchar *) data.constData();
+        if (data.size() < memoHeaderSize || memcmp(header, memoMagic, 4) != 0
+                || qFromLittleEndian<quint32>(header + 4) != memoVersion) {
+            // Written by another version, start again
+            rewrite();
+            return;
+        }
+        // A record cut by a crash is ignored
+        records = (data.size() - memoHeaderSize) / recordSize;
+        for (int i = 0; i < records; ++i) {
+            const uchar *record = header + memoHeaderSize + i * recordSize;
+            FileIdentity identity;
+            identity.device = qFromLittleEndian<quint64>(record);
+            identity.inode = qFromLittleEndian<quint64>(record + 8);
+            identity.size = qFromLittleEndian<qint64>(record + 16);
+            identity.modified = qFromLittleEndian<qint64>(record + 24);
+            digests.insert(identity, QByteArray((const char *) record + 32, digestSize));
+        }
+        if (data.size() != memoHeaderSize + records * recordSize || records > 2 * digests.count() + 1024) {
+            rewrite();
+        }
+    }
+
+    void HashMemo::insert(const FileIdentity &identity, const QByteArray &digest)
+    {
+        load();
+        if (digests.value(identity) == digest) {
+            return;
+        }
+        digests.insert(identity, digest);
+        if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath())) {
+            return;
+        }
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qDebug() << "Cannot write file hashes" << path;
+            return;
+        }
+        QByteArray data;
+        if (file.size() == 0) {
+            data = memoHeader();
+        }
+        QByteArray record(recordSize, 0);
+        writeRecord((uchar *) record.data(), identity, digest);
+        data.append(record);
+        file.write(data);
+        records++;
+    }
+
+    void HashMemo::rewrite()
+    {
+        if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath())) {
+            return;
+        }
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qDebug() << "Cannot write file hashes" << path;
+            return;
+        }
+        QByteArray data = memoHeader();
+        data.resize(memoHeaderSize + digests.count() * recordSize);
+        uchar *record = (uchar *) data.data() + memoHeaderSize;
+        QHash<FileIdentity, QByteArray>::const_iterator i = digests.constBegin();
+        for (; i != digests.constEnd(); ++i) {
+            writeRecord(record, i.key(), i.value());
+            record += recordSize;
+        }
+        file.write(data);
+        if (file.commit()) {
+            records = digests.count();
+        }
+    }
+
+    bool identify(const QString &path, FileIdentity *identity)
+    {
+        const QFileInfo info(path);
+        if (!info.isFile()) {
+            return false;
+        }
+        identity->size = info.size();
+        identity->modified = info.lastModified().toMSecsSinceEpoch();
+#ifndef Q_OS_WIN
+        struct stat buffer;
+        if (stat(QFile::encodeName(path).constData(), &buffer) != 0) {
+            return false;
+        }
+        identity->device = buffer.st_dev;
+        identity->inode = buffer.st_ino;
+#else
+        // No inode here, the path stands for it
+        const QByteArray pathHash = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Md5);
+        identity->device = 0;
+        identity->inode = qFromLittleEndian<quint64>((const uchar *) pathHash.constData());
+#endif
+        return true;
+    }
+
+    QByteArray readDigest(const QString &path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+        QByteArray fileData;
+        if (file.size() > 2 * hashedBlock) {
+            fileData = file.read(hashedBlock);
+            if (file.seek(file.size() - hashedBlock)) {
+                fileData.append(file.readAll());
+            }
+        } else {
+            fileData = file.readAll();
+        }
+        return QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+    }
+}
+
+QString FileHasher::fileHash(const QString &path)
+{
+    HashMemo *memo = hashMemo();
+    FileIdentity identity;
+    const bool identified = identify(path, &identity);
+    if (identified) {
+        QMutexLocker locker(&memo->mutex);
+        memo->load();
+        QHash<FileIdentity, QByteArray>::const_iterator i = memo->digests.constFind(identity);
+        if (i != memo->digests.constEnd()) {
+            memo->hits.ref();
+            return QString::fromLatin1(i.value().toHex());
+        }
+    }
+    const QByteArray digest = readDigest(path);
+    if (digest.isEmpty()) {
+        return QString();
+    }
+    memo->misses.ref();
+    if (identified) {
+        QMutexLocker locker(&memo->mutex);
+        memo->insert(identity, digest);
+    }
+    return QString::fromLatin1(digest.toHex());
+}
+
+QMap <QString, QString> FileHasher::fileHashes(const QStringList &paths)
+{
+    QStringList files = paths;
+    files.removeDuplicates();
+    // Reading is the slow part, the reads of different files overlap
+    const QStringList hashes = QtConcurrent::blockingMapped<QStringList>(files, &FileHasher::fileHash);
+    QMap <QString, QString> result;
+    for (int i = 0; i < files.count(); ++i) {
+        result.insert(files.at(i), hashes.at(i));
+    }
+    return result;
+}
+
+int FileHasher::memoHits()
+{
+    return hashMemo()->hits.load();
+}
+
+int FileHasher::memoMisses()
+{
+    return hashMemo()->misses.load();
+}
@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef FILEHASHER_H
+#define FILEHASHER_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+/**
+  \brief Identity hashes of media files, as stored in kdenlive:file_hash.
+
+  The hash is the MD5 of the first and last megabyte of the file, or of the
+  whole file below 2 MB. Computing it means reading 2 MB, which is slow on
+  network storage, so every hash is remembered together with the identity of
+  the file on disk: device, inode, size and modification time. The memo is
+  kept in the user's cache folder across sessions, and a file is only read
+  again when one of these changed.
+
+  All functions can be called from any thread.
+  */
+class FileHasher
+{
+public:
+    /** @brief Returns the hash of @param path, empty if the file cannot be read. */
+    static QString fileHash(const QString &path);
+    /** @brief Hashes @param paths in parallel, and returns the hashes by path. Blocks until all are known. */
+    static QMap <QString, QString> fileHashes(const QStringList &paths);
+
+    /** Number of hashes taken from the memo, and read from the files, since startup */
+    static int memoHits();
+    static int memoMisses();
+
+private:
+    FileHasher();
+};
+
+#endif // FILEHASHER_H
@@ -0,0 +1,202 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "keyframeIndex.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStringList>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+namespace {
+    // File layout: magic, version, keyframes (little endian quint32), then one little endian qint64 time per keyframe
+    const char indexMagic[4] = { 'K', 'K', 'F', 'I' };
+    const quint32 indexVersion = 1;
+    const int headerSize = 12;
+
+    bool parseTime(const QString &value, double *seconds)
+    {
+        bool ok = false;
+        *seconds = value.toDouble(&ok);
+        return ok;
+    }
+}
+
+KeyframeIndex::KeyframeIndex()
+{
+}
+
+bool KeyframeIndex::isEmpty() const
+{
+    return m_times.isEmpty();
+}
+
+int KeyframeIndex::count() const
+{
+    return m_times.count();
+}
+
+const QVector<qint64> &KeyframeIndex::times() const
+{
+    return m_times;
+}
+
+KeyframeIndex KeyframeIndex::probe(const QString &ffprobePath, const QString &path, int streamIndex, const bool *abort)
+{
+    KeyframeIndex index;
+    if (ffprobePath.isEmpty() || path.isEmpty()) {
+        return index;
+    }
+    QStringList args;
+    // Packet flags only, nothing is decoded. The format start time comes last.
+    args << QStringLiteral("-v") << QStringLiteral("error")
+         << QStringLiteral("-select_streams") << (streamIndex >= 0 ? QString::number(streamIndex) : QStringLiteral("v:0"))
+         << QStringLiteral("-show_entries") << QStringLiteral("packet=pts_time,dts_time,flags:format=start_time")
+         << QStringLiteral("-of") << QStringLiteral("csv=p=0")
+         << path;
+    QProcess process;
+    process.setStandardErrorFile(QProcess::nullDevice());
+    process.start(ffprobePath, args);
+    if (!process.waitForStarted()) {
+        qDebug() << "Cannot start" << ffprobePath;
+        return index;
+    }
+    QVector<double> keyframes;
+    double startTime = 0;
+    QByteArray pending;
+    bool finished = false;
+    while (!finished) {
+        if (abort && *abort) {
+            process.kill();
+            process.waitForFinished();
+            return index;
+        }
+        finished = !process.waitForReadyRead(200) && process.state() == QProcess::NotRunning;
+        pending.append(process.readAllStandardOutput());
+        int lineStart = 0;
+        int lineEnd;
+        while ((lineEnd = pending.indexOf('\n', lineStart)) >= 0) {
+            const QStringList fields = QString::fromLatin1(pending.constData() + lineStart, lineEnd - lineStart).trimmed().split(QLatin1Char(','));
+            lineStart = lineEnd + 1;
+            double seconds;
+            if (fields.count() == 3) {
+                if (fields.at(2).contains(QLatin1Char('K')) && (parseTime(fields.at(0), &seconds) || parseTime(fields.at(1), &seconds))) {
+                    keyframes << seconds;
+                }
+            } else if (fields.count() == 1 && parseTime(fields.at(0), &seconds)) {
+                startTime = seconds;
+            }
+        }
+        pending.remove(0, lineStart);
+    }
+    process.waitForFinished();
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        return index;
+    }
+    // MLT counts frames from the start time of the file
+    index.m_times.reserve(keyframes.count());
+    foreach (double seconds, keyframes) {
+        index.m_times << qMax((qint64) 0, (qint64) floor((seconds - startTime) * 1000000 + 0.5));
+    }
+    std::sort(index.m_times.begin(), index.m_times.end());
+    index.m_times.erase(std::unique(index.m_times.begin(), index.m_times.end()), index.m_times.end());
+    return index;
+}
+
+KeyframeIndex KeyframeIndex::load(const QString &path)
+{
+    KeyframeIndex index;
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return index;
+    }
+    const QByteArray data = file.readAll();
+    const uchar *header = (const uchar *) data.constData();
+    if (data.size() < headerSize || memcmp(header, indexMagic, 4) != 0
+            || qFromLittleEndian<quint32>(header + 4) != indexVersion) {
+        return index;
+    }
+    const int count = (int) qFromLittleEndian<quint32>(header + 8);
+    if (count <= 0 || data.size() != headerSize + count * (int) sizeof(qint64)) {
+        return index;
+    }
+    index.m_times.resize(count);
+    const uchar *values = header + headerSize;
+    for (int i = 0; i < count; ++i) {
+        index.m_times[i] = qFromLittleEndian<qint64>(values + i * sizeof(qint64));
+    }
+    return index;
+}
+
+bool KeyframeIndex::save(const QString &path) const
+{
+    if (path.isEmpty() || m_times.isEmpty()) {
+        return false;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write keyframe index" << path;
+        return false;
+    }
+    QByteArray data(headerSize + m_times.size() * sizeof(qint64), 0);
+    uchar *header = (uchar *) data.data();
+    memcpy(header, indexMagic, 4);
+    qToLittleEndian<quint32>(indexVersion, header + 4);
+    qToLittleEndian<quint32>((quint32) m_times.size(), header + 8);
+    uchar *values = header + headerSize;
+    for (int i = 0; i < m_times.size(); ++i) {
+        qToLittleEndian<qint64>(m_times.at(i), values + i * sizeof(qint64));
+    }
+    file.write(data);
+    return file.commit();
+}
+
+int KeyframeIndex::timeToFrame(qint64 time, double fps)
+{
+    return (int) floor(time * fps / 1000000 + 0.5);
+}
+
+int KeyframeIndex::indexBefore(int frame, double fps) const
+{
+    // A keyframe belongs to the frame its time rounds to
+    const qint64 limit = (qint64) ceil((frame + 0.5) * 1000000 / fps);
+    return (int) (std::lower_bound(m_times.constBegin(), m_times.constEnd(), limit) - m_times.constBegin()) - 1;
+}
+
+int KeyframeIndex::keyframeBefore(int frame, double fps) const
+{
+    const int index = indexBefore(frame, fps);
+    return index < 0 ? 0 : timeToFrame(m_times.at(index), fps);
+}
+
+int KeyframeIndex::keyframeAfter(int frame, double fps) const
+{
+    const int index = indexBefore(frame, fps) + 1;
+    return index < m_times.count() ? timeToFrame(m_times.at(index), fps) : -1;
+}
+
+int KeyframeIndex::nearestKeyframe(int frame, double fps) const
+{
+    if (m_times.isEmpty()) {
+        return frame;
+    }
+    const int before = keyframeBefore(frame, fps);
+    const int after = keyframeAfter(frame, fps);
+    if (after < 0 || frame - before <= after - frame) {
+        return before;
+    }
+    return after;
+}
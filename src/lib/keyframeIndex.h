@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef KEYFRAMEINDEX_H
+#define KEYFRAMEINDEX_H
+
+#include <QString>
+#include <QVector>
+
+/**
+  \brief Keyframe positions of a video stream.
+
+  A decoder can only start at a keyframe, so seeking to any other frame
+  decodes everything from the keyframe before it. With the index, callers
+  can tell whether a frame is in the group of pictures the decoder is
+  already in, and can snap a position to a keyframe when any nearby frame
+  will do.
+
+  Times are stored in microseconds from the start of the file and converted
+  to frames at the caller's frame rate, so one index serves every project
+  profile. ffprobe builds the index from the packet flags, without decoding.
+  The index is saved to a small binary file.
+  */
+class KeyframeIndex
+{
+public:
+    KeyframeIndex();
+
+    bool isEmpty() const;
+    int count() const;
+    /** Keyframe times in microseconds from the start of the file */
+    const QVector<qint64> &times() const;
+
+    /** @brief Lists the keyframes of stream @param streamIndex of @param path, or of the first video stream if it is negative.
+        ffprobe is killed when @param abort becomes true.
+        @return an empty index if ffprobe failed or was aborted */
+    static KeyframeIndex probe(const QString &ffprobePath, const QString &path, int streamIndex = -1, const bool *abort = NULL);
+    /** @brief Reads an index written by save(), an empty index if the file is missing or invalid. */
+    static KeyframeIndex load(const QString &path);
+    bool save(const QString &path) const;
+
+    /** Last keyframe at or before @param frame at @param fps, 0 if there is none */
+    int keyframeBefore(int frame, double fps) const;
+    /** First keyframe after @param frame at @param fps, -1 if there is none */
+    int keyframeAfter(int frame, double fps) const;
+    /** Keyframe closest to @param frame at @param fps */
+    int nearestKeyframe(int frame, double fps) const;
+
+private:
+    /** Sorted keyframe times in microseconds */
+    QVector<qint64> m_times;
+    /** Index of the last keyframe shown at or before @param frame, -1 if there is none */
+    int indexBefore(int frame, double fps) const;
+    static int timeToFrame(qint64 time, double fps);
+};
+
+#endif // KEYFRAMEINDEX_H
@@ -68,6 +68,7 @@
 
 #include "utils/KoIconUtils.h"
 #include "project/dialogs/temporarydata.h"
+#include "lib/audio/audioBlock.h"
 #ifdef USE_JOGSHUTTLE
 #include "jogshuttle/jogmanager.h"
 #endif
@@ -160,6 +161,7 @@ MainWindow::MainWindow(const QString &MltPath, const QUrl &Url, const QString &
     m_isDarkTheme(false)
 {
     qRegisterMetaType<audioShortVector> ("audioShortVector");
+    qRegisterMetaType<AudioBlock> ("AudioBlock");
     qRegisterMetaType< QVector<double> > ("QVector<double>");
     qRegisterMetaType<MessageType> ("MessageType");
     qRegisterMetaType<stringMap> ("stringMap");
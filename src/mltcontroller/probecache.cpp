@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "probecache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+    // File layout: magic and version, then the key and the entry in a QDataStream
+    const quint32 entryMagic = 0x4b505242; // "KPRB"
+    const quint32 entryVersion = 1;
+    // Entries are a few kilobytes, this keeps the folder in the tens of megabytes
+    const int maxEntries = 5000;
+}
+
+ProbeCache::Entry::Entry() :
+    thumbnailFrame(-1),
+    imageHeight(0)
+{
+}
+
+ProbeCache::ProbeCache(const QString &folder) :
+    m_folder(folder)
+{
+    if (m_folder.isEmpty()) {
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!cacheDir.isEmpty()) {
+            m_folder = cacheDir + QStringLiteral("/probe");
+        }
+    }
+}
+
+QString ProbeCache::entryPath(const QString &path) const
+{
+    if (m_folder.isEmpty() || path.isEmpty()) {
+        return QString();
+    }
+    const QByteArray name = QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+    return m_folder + QLatin1Char('/') + QString::fromLatin1(name) + QStringLiteral(".probe");
+}
+
+bool ProbeCache::find(const QString &path, const QString &fileHash, Entry *entry)
+{
+    QFile file(entryPath(path));
+    const QFileInfo info(path);
+    if (file.fileName().isEmpty() || !info.isFile() || !file.open(QIODevice::ReadOnly)) {
+        m_misses.ref();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+    quint32 magic;
+    quint32 version;
+    QString storedPath;
+    qint64 size;
+    qint64 modified;
+    QString storedHash;
+    stream >> magic >> version;
+    if (magic != entryMagic || version != entryVersion) {
+        m_misses.ref();
+        return false;
+    }
+    stream >> storedPath >> size >> modified >> storedHash;
+    bool valid = stream.status() == QDataStream::Ok && storedPath == info.absoluteFilePath()
+            && size == info.size() && modified == info.lastModified().toMSecsSinceEpoch()
+            && (fileHash.isEmpty() || storedHash.isEmpty() || fileHash == storedHash);
+    if (valid) {
+        Entry result;
+        stream >> result.service >> result.thumbnailFrame >> result.imageHeight >> result.thumbnail >> result.properties;
+        valid = stream.status() == QDataStream::Ok && !result.service.isEmpty();
+        if (valid) {
+            *entry = result;
+        }
+    }
+    if (valid) {
+        m_hits.ref();
+    } else {
+        m_misses.ref();
+    }
+    return valid;
+}
+
+bool ProbeCache::store(const QString &path, const QString &fileHash, const Entry &entry)
+{
+    const QString cachePath = entryPath(path);
+    const QFileInfo info(path);
+    if (cachePath.isEmpty() || !info.isFile() || !QDir().mkpath(m_folder)) {
+        return false;
+    }
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write probe cache" << cachePath;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream << entryMagic << entryVersion;
+    stream << info.absoluteFilePath() << (qint64) info.size() << (qint64) info.lastModified().toMSecsSinceEpoch() << fileHash;
+    stream << entry.service << entry.thumbnailFrame << entry.imageHeight << entry.thumbnail << entry.properties;
+    return file.commit();
+}
+
+void ProbeCache::prune()
+{
+    if (m_folder.isEmpty()) {
+        return;
+    }
+    QDir dir(m_folder);
+    const QFileInfoList entries = dir.entryInfoList(QStringList() << QStringLiteral("*.probe"), QDir::Files, QDir::Time);
+    int kept = 0;
+    foreach (const QFileInfo &entryInfo, entries) {
+        QFile file(entryInfo.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_2);
+        quint32 magic;
+        quint32 version;
+        QString storedPath;
+        qint64 size;
+        qint64 modified;
+        stream >> magic >> version >> storedPath >> size >> modified;
+        file.close();
+        bool valid = stream.status() == QDataStream::Ok && magic == entryMagic && version == entryVersion;
+        if (valid) {
+            const QFileInfo info(storedPath);
+            valid = info.isFile() && size == info.size() && modified == info.lastModified().toMSecsSinceEpoch();
+        }
+        // The list is sorted newest first
+        if (!valid || kept >= maxEntries) {
+            file.remove();
+        } else {
+            kept++;
+        }
+    }
+}
+
+int ProbeCache::hits() const
+{
+    return m_hits.load();
+}
+
+int ProbeCache::misses() const
+{
+    return m_misses.load();
+}
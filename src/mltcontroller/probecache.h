@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include "definitions.h"
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QString>
+
+/**
+  \brief Results of probing media files, kept across sessions.
+
+  Probing a new clip opens it with MLT's avformat producer, which validates
+  the file by decoding, then decodes one or two frames to find a thumbnail.
+  The cache stores what was learnt, so a file that was already probed can be
+  opened with the avformat-novalidate service and its thumbnail reused.
+
+  There is one entry per file, in the user's cache folder, so an entry is
+  shared by all projects. An entry is only used while the size and
+  modification time of the file are unchanged, and while its hash matches if
+  both the caller and the entry know it. Entries are written atomically and
+  can be read and written from any thread. prune() removes the entries of
+  files that were moved, deleted or changed, and the oldest ones above a
+  fixed number of entries.
+  */
+class ProbeCache
+{
+public:
+    struct Entry
+    {
+        Entry();
+        /** MLT service opening the file */
+        QString service;
+        /** Frame of the thumbnail, -1 for the first one */
+        int thumbnailFrame;
+        /** Height the thumbnail was created for */
+        int imageHeight;
+        /** Null for clips without video */
+        QImage thumbnail;
+        /** Stream layout, frame rate and profile of the file */
+        stringMap properties;
+    };
+
+    /** @brief Uses @param folder, or the probe folder of the user's cache if it is empty. */
+    explicit ProbeCache(const QString &folder = QString());
+
+    /** @brief Reads the entry of @param path into @param entry if it is still valid.
+        @param fileHash The kdenlive:file_hash of the clip, or empty if unknown */
+    bool find(const QString &path, const QString &fileHash, Entry *entry);
+    bool store(const QString &path, const QString &fileHash, const Entry &entry);
+    /** @brief Deletes the entries that can no longer be used, and the oldest ones if there are too many. */
+    void prune();
+
+    /** Number of lookups that found a valid entry since the cache was created */
+    int hits() const;
+    int misses() const;
+
+private:
+    QString m_folder;
+    QAtomicInt m_hits;
+    QAtomicInt m_misses;
+    QString entryPath(const QString &path) const;
+};
+
+#endif // PROBECACHE_H
@@ -24,9 +24,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PRODUCERQUEUE_H
 
 #include "definitions.h"
+#include "probecache.h"
 
 #include <QMutex>
 #include <QFuture>
+#include <QHash>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 class ClipController;
 class BinController;
@@ -52,20 +56,67 @@ public:
     explicit ProducerQueue(BinController *controller);
     ~ProducerQueue();
 
-    /** @brief Force processing of clip with selected id. */
+    /** @brief Moves the clip with selected id before the other requests and waits until it is loaded. */
     void forceProcessing(const QString &id);
     /** @brief Are we currently processing clip with selected id. */
     bool isProcessing(const QString &id);
     /** @brief Make sure to close running threads before closing document */
     void abortOperations();
+    /** @brief The probe results of known files, with its hit and miss counts. */
+    const ProbeCache &probeCache() const;
 
 private:
+    /** @brief A queued request, with the storage device of its file */
+    struct ProbeRequest {
+        requestClipInfo info;
+        /** Empty if the clip is not read from a file */
+        QString device;
+    };
+    /** @brief The outcome of a request, handed to the bin in the GUI thread */
+    struct ProbeResult {
+        requestClipInfo info;
+        /** The new producer of the clip, NULL if the clip is invalid */
+        Mlt::Producer *producer;
+        /** Why the clip is invalid, may be empty */
+        QString message;
+    };
     QMutex m_infoMutex;
-    QList <requestClipInfo> m_requestList;
+    /** @brief Requests of clips the timeline is waiting for, processed before the others */
+    QList <ProbeRequest> m_urgentList;
+    QList <ProbeRequest> m_requestList;
     /** @brief The ids of the clips that are currently being loaded for info query */
     QStringList m_processingClipId;
-    QFuture <void> m_infoThread;
+    /** @brief Number of requests being processed for each storage device */
+    QHash <QString, int> m_deviceLoad;
+    QList <QFuture <void> > m_infoThreads;
+    /** @brief Threads of the workers, not shared with thumbnails, jobs or previews */
+    QThreadPool m_workerPool;
+    /** @brief Results of the workers waiting for deliverResults() */
+    QList <ProbeResult> m_results;
+    /** @brief Number of running workers, and of those processing a request */
+    int m_workers;
+    int m_busyWorkers;
+    /** @brief A request checking the project profile is running, it runs alone */
+    bool m_exclusiveRequest;
+    /** @brief Woken when a request is done */
+    QWaitCondition m_requestDone;
     BinController *m_binController;
+    ProbeCache m_probeCache;
+    /** @brief Returns an id of the storage device the clip is read from, empty if it is not a file. */
+    QString deviceForClip(const QDomElement &xml) const;
+    /** @brief Whether the request can start now. Called with m_infoMutex locked. */
+    bool canStart(const ProbeRequest &request, const QHash <QString, int> &deviceLoad) const;
+    /** @brief Takes the next request that can start, urgent ones first. Called with m_infoMutex locked. */
+    bool takeRequest(ProbeRequest *request);
+    /** @brief Starts workers for the requests that can start. Called with m_infoMutex locked. */
+    void startWorkers();
+    bool isQueued(const QString &id) const;
+    /** @brief Whether a result for the clip waits for delivery. Called with m_infoMutex locked. */
+    bool hasResult(const QString &id) const;
+    /** @brief Queues the result of a request for the GUI thread, which takes @param producer. */
+    void addResult(const requestClipInfo &info, Mlt::Producer *producer, const QString &message = QString());
+    /** @brief Creates the producer of a clip, or its thumbnail. */
+    void processClip(requestClipInfo info);
     ClipType getTypeForService(const QString &id, const QString &path) const;
     /** @brief Pass xml values to an MLT producer at build time */
     void processProducerProperties(Mlt::Producer *prod, QDomElement xml);
@@ -82,8 +133,10 @@ public slots:
     void slotProcessingDone(const QString &id);
 
 private slots:
-    /** @brief Process the clip info requests (in a separate thread). */
+    /** @brief Process the clip info requests (in one of the worker threads). */
     void processFileProperties();
+    /** @brief Hands the results of the workers to the bin, in the GUI thread. */
+    void deliverResults();
     /** @brief A clip with multiple video streams was found, ask what to do. */
     void slotMultiStreamProducerFound(const QString &path, QList<int> audio_list, QList<int> video_list, stringMap data);
 
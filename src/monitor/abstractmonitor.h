@@ -21,6 +21,8 @@
 #define ABSTRACTMONITOR_H
 
 #include "definitions.h"
+#include "scopes/sharedframe.h"
+#include "lib/audio/audioBlock.h"
 
 #include <stdint.h>
 
@@ -68,9 +70,11 @@ private:
 signals:
     /** @brief The renderer refreshed the current frame. */
     void frameUpdated(const QImage &);
+    /** @brief The renderer refreshed the current frame, which is available as decoded Y'CbCr planes. */
+    void sharedFrameUpdated(const SharedFrame &);
 
     /** @brief This signal contains the audio of the current frame. */
-    void audioSamplesSignal(const audioShortVector&,int,int,int);
+    void audioSamplesSignal(const AudioBlock &);
     /** @brief Scopes are ready to receive a new frame. */
     void scopesClear();
 };
@@ -0,0 +1,272 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "framecache.h"
+
+#include <mlt++/MltFrame.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+#include <QScopedPointer>
+#include <QtConcurrent>
+
+namespace
+{
+qint64 frameSize(const SharedFrame &frame)
+{
+    qint64 size = mlt_image_format_size(frame.get_image_format(), frame.get_image_width(), frame.get_image_height(), NULL);
+    if (frame.get_audio_samples() > 0) {
+        size += mlt_audio_format_size(frame.get_audio_format(), frame.get_audio_samples(), frame.get_audio_channels());
+    }
+    return size;
+}
+}
+
+FrameCache::PrefetchSource::PrefetchSource() :
+    profile(NULL),
+    length(0),
+    width(0),
+    height(0),
+    frequency(48000),
+    channels(2),
+    fps(25),
+    deinterlace(false)
+{
+}
+
+FrameCache::FrameCache() :
+    m_budget(0),
+    m_size(0),
+    m_frameSize(0),
+    m_generation(0),
+    m_playhead(0),
+    m_windowStart(0),
+    m_windowEnd(-1),
+    m_prefetching(false)
+{
+}
+
+FrameCache::~FrameCache()
+{
+    invalidate();
+    waitForPrefetch();
+}
+
+void FrameCache::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = qMax((qint64) 0, bytes);
+    evict();
+}
+
+bool FrameCache::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget > 0;
+}
+
+void FrameCache::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_generation++;
+    m_frames.clear();
+    m_size = 0;
+    m_source = PrefetchSource();
+    // A running worker keeps its own reference until it notices the new generation
+    m_producer.clear();
+    m_windowStart = 0;
+    m_windowEnd = -1;
+}
+
+void FrameCache::waitForPrefetch()
+{
+    m_prefetchJob.waitForFinished();
+}
+
+int FrameCache::generation() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_generation;
+}
+
+void FrameCache::insert(const SharedFrame &frame, int generation)
+{
+    if (!frame.is_valid() || frame.get_image_format() != mlt_image_yuv420p) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (generation != m_generation || m_budget <= 0 || m_frames.contains(frame.get_position())) {
+        return;
+    }
+    insertFrame(frame);
+}
+
+SharedFrame FrameCache::frame(int position) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_frames.value(position);
+}
+
+void FrameCache::setPlayhead(int position)
+{
+    QMutexLocker locker(&m_mutex);
+    m_playhead = position;
+}
+
+bool FrameCache::hasPrefetchSource() const
+{
+    QMutexLocker locker(&m_mutex);
+    return !m_source.xml.isEmpty();
+}
+
+void FrameCache::setPrefetchSource(const PrefetchSource &source)
+{
+    QMutexLocker locker(&m_mutex);
+    m_source = source;
+    m_producer.clear();
+}
+
+void FrameCache::prefetch(int position, int direction, int count)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_source.xml.isEmpty() || m_budget <= 0) {
+        return;
+    }
+    // Leave room for the frames displayed on the other side of the playhead
+    if (m_frameSize > 0) {
+        count = qMin((qint64) count, m_budget / m_frameSize / 2);
+    }
+    if (direction < 0) {
+        m_windowStart = position - count;
+        m_windowEnd = position - 1;
+    } else {
+        m_windowStart = position + 1;
+        m_windowEnd = position + count;
+    }
+    m_windowStart = qMax(0, m_windowStart);
+    m_windowEnd = qMin(m_source.length - 1, m_windowEnd);
+    if (!m_prefetching && nextPrefetchPosition() >= 0) {
+        m_prefetching = true;
+        m_prefetchJob = QtConcurrent::run(this, &FrameCache::prefetchFrames);
+    }
+}
+
+int FrameCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_frames.count();
+}
+
+qint64 FrameCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
+
+void FrameCache::insertFrame(const SharedFrame &frame)
+{
+    const qint64 size = frameSize(frame);
+    m_frames.insert(frame.get_position(), frame);
+    m_size += size;
+    m_frameSize = size;
+    evict();
+}
+
+void FrameCache::evict()
+{
+    while (m_size > m_budget && !m_frames.isEmpty()) {
+        QMap<int, SharedFrame>::iterator first = m_frames.begin();
+        QMap<int, SharedFrame>::iterator last = m_frames.end() - 1;
+        QMap<int, SharedFrame>::iterator farthest = qAbs(last.key() - m_playhead) > qAbs(first.key() - m_playhead) ? last : first;
+        m_size -= frameSize(farthest.value());
+        m_frames.erase(farthest);
+    }
+}
+
+int FrameCache::nextPrefetchPosition() const
+{
+    if (m_source.xml.isEmpty() || m_budget <= 0) {
+        return -1;
+    }
+    for (int i = m_windowStart; i <= m_windowEnd; ++i) {
+        if (!m_frames.contains(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FrameCache::prefetchFrames()
+{
+    QMutexLocker locker(&m_mutex);
+    forever {
+        const int position = nextPrefetchPosition();
+        if (position < 0) {
+            m_prefetching = false;
+            return;
+        }
+        const int generation = m_generation;
+        const PrefetchSource source = m_source;
+        QSharedPointer<Mlt::Producer> producer = m_producer;
+        locker.unlock();
+
+        if (!producer) {
+            producer = QSharedPointer<Mlt::Producer>(new Mlt::Producer(*source.profile, "xml-string", source.xml.toUtf8().constData()));
+            if (!producer->is_valid() || producer->get_length() != source.length) {
+                // The copy would not show the frames of the monitor
+                producer.clear();
+            }
+            locker.relock();
+            if (generation == m_generation) {
+                if (producer) {
+                    m_producer = producer;
+                } else {
+                    m_source.xml.clear();
+                }
+            }
+            continue;
+        }
+
+        SharedFrame shared;
+        producer->seek(position);
+        QScopedPointer<Mlt::Frame> frame(producer->get_frame());
+        if (frame && frame->is_valid()) {
+            // Render the frame like the monitor consumer does
+            frame->set("consumer_deinterlace", source.deinterlace);
+            frame->set("consumer_deinterlace_method", source.deinterlaceMethod.toUtf8().constData());
+            frame->set("rescale.interp", source.rescale.toUtf8().constData());
+            mlt_image_format format = mlt_image_yuv420p;
+            int width = source.width;
+            int height = source.height;
+            if (frame->get_image(format, width, height)) {
+                mlt_audio_format audioFormat = mlt_audio_s16;
+                int frequency = source.frequency;
+                int channels = source.channels;
+                int samples = mlt_sample_calculator(source.fps, frequency, position);
+                frame->get_audio(audioFormat, frequency, channels, samples);
+                shared = SharedFrame(*frame);
+            }
+        }
+
+        locker.relock();
+        if (generation != m_generation) {
+            continue;
+        }
+        if (shared.is_valid() && shared.get_position() == position) {
+            if (!m_frames.contains(position)) {
+                insertFrame(shared);
+            }
+        } else {
+            // Stop rather than retrying the same position
+            m_source.xml.clear();
+            m_producer.clear();
+        }
+    }
+}
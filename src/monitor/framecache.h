@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "scopes/sharedframe.h"
+
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+namespace Mlt {
+class Producer;
+class Profile;
+}
+
+/**
+  \brief Decoded frames around the playhead of a monitor, for scrubbing.
+
+  Frames are stored by position for the current producer generation. The
+  generation changes with invalidate(), which the renderer calls whenever its
+  producer is replaced or edited; frames of an older generation are refused.
+  The cache is bounded by a memory budget, and when it is exceeded the frames
+  farthest from the playhead are dropped first.
+
+  The cache is filled with the frames the monitor displays and by a prefetch
+  worker. The worker decodes a copy of the monitor's producer, parsed from its
+  XML, so the monitor consumer is never touched from another thread. It
+  decodes the frames of the prefetch window in increasing order, also when
+  scrubbing backwards, so a long-GOP decoder only seeks once per window.
+  */
+class FrameCache
+{
+public:
+    /** How the prefetch worker decodes, taken from the monitor consumer */
+    struct PrefetchSource
+    {
+        PrefetchSource();
+        /** XML of the monitor producer, parsed by the worker */
+        QString xml;
+        Mlt::Profile *profile;
+        /** Length of the monitor producer, a copy of another length is not used */
+        int length;
+        int width;
+        int height;
+        int frequency;
+        int channels;
+        double fps;
+        bool deinterlace;
+        QString rescale;
+        QString deinterlaceMethod;
+    };
+
+    FrameCache();
+    /** Waits for the prefetch worker */
+    ~FrameCache();
+
+    /** Maximum size of the cached frames in bytes, 0 disables the cache */
+    void setBudget(qint64 bytes);
+    bool isEnabled() const;
+
+    /** @brief Forgets all frames and the prefetch source, and starts a new generation. */
+    void invalidate();
+    /** @brief Blocks until the prefetch worker has stopped. */
+    void waitForPrefetch();
+    int generation() const;
+
+    /** @brief Stores a yuv420p frame of @param generation, other frames are ignored. */
+    void insert(const SharedFrame &frame, int generation);
+    /** @brief Returns the frame at @param position, an invalid frame if it is not cached. */
+    SharedFrame frame(int position) const;
+    /** Eviction keeps the frames closest to @param position */
+    void setPlayhead(int position);
+
+    bool hasPrefetchSource() const;
+    void setPrefetchSource(const PrefetchSource &source);
+    /** @brief Decodes the @param count frames after @param position that are not cached yet,
+        or before it if @param direction is negative. Replaces the previous prefetch window. */
+    void prefetch(int position, int direction, int count);
+
+    int count() const;
+    qint64 size() const;
+
+private:
+    mutable QMutex m_mutex;
+    QMap<int, SharedFrame> m_frames;
+    qint64 m_budget;
+    qint64 m_size;
+    /** Size of the last stored frame, used to fit the prefetch window in the budget */
+    qint64 m_frameSize;
+    int m_generation;
+    int m_playhead;
+
+    PrefetchSource m_source;
+    /** Copy of the monitor producer, created by the worker from m_source */
+    QSharedPointer<Mlt::Producer> m_producer;
+    int m_windowStart;
+    int m_windowEnd;
+    bool m_prefetching;
+    QFuture<void> m_prefetchJob;
+
+    /** Called with the mutex locked */
+    void insertFrame(const SharedFrame &frame);
+    void evict();
+    int nextPrefetchPosition() const;
+    void prefetchFrames();
+};
+
+#endif // FRAMECACHE_H
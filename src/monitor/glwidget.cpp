@@ -51,11 +51,39 @@
 #define GL_TIMEOUT_IGNORED 0xFFFFFFFFFFFFFFFFull
 #endif
 
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+
 #ifndef Q_OS_WIN
 typedef GLenum (*ClientWaitSync_fp) (GLsync sync, GLbitfield flags, GLuint64 timeout);
 static ClientWaitSync_fp ClientWaitSync = 0;
 #endif
 
+// Entry points of the pixel buffer upload, resolved in GLWidget::initializeGL()
+typedef GLsync (QOPENGLF_APIENTRYP FenceSync_fp) (GLenum condition, GLbitfield flags);
+typedef void (QOPENGLF_APIENTRYP WaitSync_fp) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (QOPENGLF_APIENTRYP DeleteSync_fp) (GLsync sync);
+typedef void *(QOPENGLF_APIENTRYP MapBufferRange_fp) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (QOPENGLF_APIENTRYP UnmapBuffer_fp) (GLenum target);
+static FenceSync_fp FenceSync = 0;
+static WaitSync_fp WaitSync = 0;
+static DeleteSync_fp DeleteSync = 0;
+static MapBufferRange_fp MapBufferRange = 0;
+static UnmapBuffer_fp UnmapBuffer = 0;
+
 using namespace Mlt;
 
 GLWidget::GLWidget(int id, QObject *parent)
@@ -138,8 +166,14 @@ GLWidget::~GLWidget()
 
 void GLWidget::updateAudioForAnalysis()
 {
-    if (m_frameRenderer) 
-	m_frameRenderer->sendAudioForAnalysis = KdenliveSettings::monitor_audio();
+    if (m_frameRenderer) {
+        // Audio scopes, this monitor's audio meter or the audio spectrum
+        const bool analyse = KdenliveSettings::monitor_audio()
+                || (KdenliveSettings::monitoraudio() & m_id) != 0
+                || KdenliveSettings::enableaudiospectrum();
+        // Read by the renderer thread in sendAudio()
+        m_frameRenderer->sendAudioForAnalysis.store(analyse ? 1 : 0);
+    }
 }
 
 void GLWidget::initializeGL()
@@ -186,6 +220,7 @@ void GLWidget::initializeGL()
         }
     }
 #endif
+    const bool pboUpload = !m_glslManager && initPboUpload();
 
     openglContext()->doneCurrent();
     if (m_glslManager) {
@@ -199,7 +234,8 @@ void GLWidget::initializeGL()
         m_shareContext->create();
     }
     m_frameRenderer = new FrameRenderer(openglContext(), &m_offscreenSurface);
-    m_frameRenderer->sendAudioForAnalysis = KdenliveSettings::monitor_audio();
+    m_frameRenderer->pboUpload.store(pboUpload ? 1 : 0);
+    updateAudioForAnalysis();
     openglContext()->makeCurrent(this);
     //openglContext()->blockSignals(false);
     connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), this, SIGNAL(frameDisplayed(const SharedFrame&)), Qt::QueuedConnection);
@@ -212,12 +248,42 @@ void GLWidget::initializeGL()
     connect(m_frameRenderer, SIGNAL(frameDisplayed(const SharedFrame&)), SLOT(onFrameDisplayed(const SharedFrame&)), Qt::QueuedConnection);
 #endif
 
-    connect(m_frameRenderer, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)), this, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)), Qt::QueuedConnection);
+    connect(m_frameRenderer, SIGNAL(audioBlockReady(AudioBlock)), this, SIGNAL(audioBlockReady(AudioBlock)), Qt::QueuedConnection);
     connect(this, &GLWidget::textureUpdated, this, &GLWidget::update, Qt::QueuedConnection);
     m_initSem.release();
     m_isInitialized = true;
 }
 
+bool GLWidget::initPboUpload()
+{
+#if defined(Q_OS_WIN)
+    // getProcAddress is not working for me on Windows.
+    return false;
+#else
+    QOpenGLContext *context = openglContext();
+    if (context->isOpenGLES()) {
+        return false;
+    }
+    // Software rasterizers copy the buffer once more, the direct upload is faster there
+    const QByteArray renderer = QByteArray((const char*) glGetString(GL_RENDERER)).toLower();
+    if (renderer.contains("llvmpipe") || renderer.contains("softpipe") || renderer.contains("swrast") || renderer.contains("software")) {
+        return false;
+    }
+    const QPair<int, int> version = context->format().version();
+    if ((version < qMakePair(2, 1) && !context->hasExtension("GL_ARB_pixel_buffer_object"))
+            || (version < qMakePair(3, 0) && !context->hasExtension("GL_ARB_map_buffer_range"))
+            || (version < qMakePair(3, 2) && !context->hasExtension("GL_ARB_sync"))) {
+        return false;
+    }
+    FenceSync = (FenceSync_fp) context->getProcAddress("glFenceSync");
+    WaitSync = (WaitSync_fp) context->getProcAddress("glWaitSync");
+    DeleteSync = (DeleteSync_fp) context->getProcAddress("glDeleteSync");
+    MapBufferRange = (MapBufferRange_fp) context->getProcAddress("glMapBufferRange");
+    UnmapBuffer = (UnmapBuffer_fp) context->getProcAddress("glUnmapBuffer");
+    return FenceSync && WaitSync && DeleteSync && MapBufferRange && UnmapBuffer;
+#endif
+}
+
 void GLWidget::resizeGL(int width, int height)
 {
     int x, y, w, h;
@@ -422,6 +488,15 @@ void GLWidget::paintGL()
 #endif
     if (!m_texture[0]) return;
 
+    if (m_frameRenderer) {
+        GLsync fence = m_frameRenderer->takeUploadFence();
+        if (fence) {
+            // The GPU waits for the upload of the renderer thread, this thread does not block
+            WaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+            DeleteSync(fence);
+        }
+    }
+
     // Bind textures.
     for (int i = 0; i < 3; ++i) {
         if (m_texture[i]) {
@@ -487,8 +562,8 @@ void GLWidget::paintGL()
     f->glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
     check_error(f);
 
-    if (sendFrameForAnalysis && m_analyseSem.tryAcquire(1)) {
-        // Render RGB frame for analysis
+    if (sendFrameForAnalysis && m_glslManager && m_analyseSem.tryAcquire(1)) {
+        // The frame only exists as a texture in GPU mode, render RGB frame for analysis
         int fullWidth = m_monitorProfile->width();
         int fullHeight = m_monitorProfile->height();
         if (!m_fbo || m_fbo->size() != QSize(fullWidth, fullHeight)) {
@@ -523,6 +598,12 @@ void GLWidget::paintGL()
     }
     f->glActiveTexture(GL_TEXTURE0);
     check_error(f);
+
+    if (m_frameRenderer && m_frameRenderer->pboUpload.load()) {
+        // The renderer thread must not upload into these textures before they are drawn
+        m_frameRenderer->texturesPainted(m_texture[0], FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        f->glFlush();
+    }
 }
 
 void GLWidget::slotZoomScene(double value)
@@ -761,12 +842,22 @@ int GLWidget::setProducer(Mlt::Producer* producer)
 
 int GLWidget::droppedFrames() const
 {
-    return (m_consumer ? m_consumer->get_int("drop_count") : 0);
+    int dropped = m_consumer ? m_consumer->get_int("drop_count") : 0;
+    if (m_frameRenderer) {
+        dropped += m_frameRenderer->droppedFrames();
+    }
+    return dropped;
 }
 
 void GLWidget::resetDrops()
 {
     if (m_consumer) m_consumer->set("drop_count", 0);
+    if (m_frameRenderer) m_frameRenderer->resetDrops();
+}
+
+int GLWidget::uploadTime() const
+{
+    return m_frameRenderer ? m_frameRenderer->uploadTime() : 0;
 }
 
 void GLWidget::createAudioOverlay(bool isAudio)
@@ -1113,6 +1204,10 @@ void GLWidget::onFrameDisplayed(const SharedFrame &frame)
     m_mutex.lock();
     m_sharedFrame = frame;
     m_mutex.unlock();
+    if (sendFrameForAnalysis && !m_glslManager && frame.get_image_format() == mlt_image_yuv420p && m_analyseSem.tryAcquire(1)) {
+        // Scopes read the decoded planes, the frame data is shared and not copied
+        emit analyseSharedFrame(frame);
+    }
     update();
 }
 
@@ -1187,18 +1282,32 @@ void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName)
 }
 
 // MLT consumer-frame-show event handler
-void GLWidget::on_frame_show(mlt_consumer, void* self, mlt_frame frame_ptr)
+void GLWidget::on_frame_show(mlt_consumer consumer, void* self, mlt_frame frame_ptr)
 {
     Mlt::Frame frame(frame_ptr);
     if (frame.get_int("rendered")) {
+        // Tells the renderer's frame cache which consumer run rendered the frame
+        frame.set("kdenlive:run", mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(consumer), "kdenlive:run"));
         GLWidget* widget = static_cast<GLWidget*>(self);
         int timeout = (widget->consumer()->get_int("real_time") > 0)? 0: 1000;
         if (widget->m_frameRenderer && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
             QMetaObject::invokeMethod(widget->m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+        } else if (widget->m_frameRenderer) {
+            widget->m_frameRenderer->frameDropped();
         }
     }
 }
 
+bool GLWidget::showCachedFrame(const SharedFrame &frame)
+{
+    if (m_glslManager || !m_frameRenderer || !m_frameRenderer->semaphore()->tryAcquire(1)) {
+        return false;
+    }
+    // The renderer converts the frame it is given, so it gets its own copy
+    QMetaObject::invokeMethod(m_frameRenderer, "showFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame.clone(true, true)));
+    return true;
+}
+
 void GLWidget::on_gl_nosync_frame_show(mlt_consumer, void* self, mlt_frame frame_ptr)
 {
     Mlt::Frame frame(frame_ptr);
@@ -1207,6 +1316,8 @@ void GLWidget::on_gl_nosync_frame_show(mlt_consumer, void* self, mlt_frame frame
         int timeout = (widget->consumer()->get_int("real_time") > 0)? 0: 1000;
         if (widget->m_frameRenderer && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
             QMetaObject::invokeMethod(widget->m_frameRenderer, "showGLNoSyncFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+        } else if (widget->m_frameRenderer) {
+            widget->m_frameRenderer->frameDropped();
         }
     }
 }
@@ -1219,6 +1330,8 @@ void GLWidget::on_gl_frame_show(mlt_consumer, void* self, mlt_frame frame_ptr)
         int timeout = (widget->consumer()->get_int("real_time") > 0)? 0: 1000;
         if (widget->m_frameRenderer && widget->m_frameRenderer->semaphore()->tryAcquire(1, timeout)) {
             QMetaObject::invokeMethod(widget->m_frameRenderer, "showGLFrame", Qt::QueuedConnection, Q_ARG(Mlt::Frame, frame));
+        } else if (widget->m_frameRenderer) {
+            widget->m_frameRenderer->frameDropped();
         }
     }
 }
@@ -1261,12 +1374,20 @@ FrameRenderer::FrameRenderer(QOpenGLContext* shareContext, QSurface *surface)
      , m_semaphore(3)
      , m_context(0)
      , m_surface(surface)
+     , m_uploadSlot(0)
+     , m_uploadWidth(0)
+     , m_uploadHeight(0)
+     , m_uploadFence(0)
      , m_gl32(0)
-     , sendAudioForAnalysis(false)
+     , sendAudioForAnalysis(0)
+     , pboUpload(0)
 {
     Q_ASSERT(shareContext);
     m_renderTexture[0] = m_renderTexture[1] = m_renderTexture[2] = 0;
     m_displayTexture[0] = m_displayTexture[1] = m_displayTexture[2] = 0;
+    memset(m_pbo, 0, sizeof(m_pbo));
+    memset(m_uploadTexture, 0, sizeof(m_uploadTexture));
+    memset(m_paintFence, 0, sizeof(m_paintFence));
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 5, 0))
     if (KdenliveSettings::gpu_accel() || shareContext->supportsThreadedOpenGL()) {
         m_context = new QOpenGLContext;
@@ -1298,21 +1419,29 @@ void FrameRenderer::showFrame(Mlt::Frame frame)
 
     if (m_context && m_context->isValid()) {
         m_context->makeCurrent(m_surface);
-        // Upload each plane of YUV to a texture.
+        QElapsedTimer timer;
+        timer.start();
         QOpenGLFunctions* f = m_context->functions();
-        uploadTextures(m_context, m_displayFrame, m_renderTexture);
-        f->glBindTexture(GL_TEXTURE_2D, 0);
-        check_error(f);
-        f->glFinish();
+        if (!pboUpload.load() || !uploadPbo(f)) {
+            // Upload each plane of YUV to a texture.
+            uploadTextures(m_context, m_displayFrame, m_renderTexture);
+            f->glBindTexture(GL_TEXTURE_2D, 0);
+            check_error(f);
+            f->glFinish();
 
-        for (int i = 0; i < 3; ++i)
-            std::swap(m_renderTexture[i], m_displayTexture[i]);
+            for (int i = 0; i < 3; ++i)
+                std::swap(m_renderTexture[i], m_displayTexture[i]);
+        }
+        // Average over the last frames
+        const int elapsed = timer.nsecsElapsed() / 1000;
+        m_uploadTime.store((m_uploadTime.load() * 7 + elapsed) / 8);
         emit textureReady(m_displayTexture[0], m_displayTexture[1], m_displayTexture[2]);
         m_context->doneCurrent();
     }
     // The frame is now done being modified and can be shared with the rest
     // of the application.
     emit frameDisplayed(m_displayFrame);
+    sendAudio();
     m_semaphore.release();
 }
 
@@ -1357,6 +1486,7 @@ void FrameRenderer::showGLFrame(Mlt::Frame frame)
     // The frame is now done being modified and can be shared with the rest
     // of the application.
     emit frameDisplayed(m_displayFrame);
+    sendAudio();
     m_semaphore.release();
 }
 
@@ -1383,10 +1513,169 @@ void FrameRenderer::showGLNoSyncFrame(Mlt::Frame frame)
     // The frame is now done being modified and can be shared with the rest
     // of the application.
     emit frameDisplayed(m_displayFrame);
+    sendAudio();
     m_semaphore.release();
 }
 
 
+void FrameRenderer::sendAudio()
+{
+    if (!sendAudioForAnalysis.load() || !m_displayFrame.is_valid()) {
+        return;
+    }
+    const mlt_audio_format format = m_displayFrame.get_audio_format();
+    const int samples = m_displayFrame.get_audio_samples();
+    if (format == mlt_audio_none || samples <= 0) {
+        return;
+    }
+    // The audio was already fetched by the consumer, this reads it in its own format and layout
+    AudioBlock block = AudioBlock::fromData(m_displayFrame.get_audio(), format, m_displayFrame.get_audio_frequency(),
+                                            m_displayFrame.get_audio_channels(), samples, m_displayFrame.get_position());
+    if (!block.isNull()) {
+        emit audioBlockReady(block);
+    }
+}
+
+bool FrameRenderer::uploadPbo(QOpenGLFunctions *f)
+{
+    const int width = m_displayFrame.get_image_width();
+    const int height = m_displayFrame.get_image_height();
+    const uint8_t* image = m_displayFrame.get_image();
+    const int planeWidth[3] = { width, width / 2, width / 2 };
+    const int planeHeight[3] = { height, height / 2, height / 2 };
+    const int size = width * height + 2 * (width / 2) * (height / 2);
+
+    if (!m_pbo[0]) {
+        f->glGenBuffers(UPLOAD_SLOTS, m_pbo);
+        f->glGenTextures(3 * UPLOAD_SLOTS, m_uploadTexture);
+        check_error(f);
+    }
+    if (width != m_uploadWidth || height != m_uploadHeight) {
+        // Allocate the textures once per frame size, frames then only replace their content
+        for (int i = 0; i < UPLOAD_SLOTS; ++i) {
+            waitPainted(i);
+        }
+        for (int i = 0; i < 3 * UPLOAD_SLOTS; ++i) {
+            f->glBindTexture  (GL_TEXTURE_2D, m_uploadTexture[i]);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            f->glTexImage2D   (GL_TEXTURE_2D, 0, GL_LUMINANCE, planeWidth[i % 3], planeHeight[i % 3], 0,
+                            GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+            check_error(f);
+        }
+        m_uploadWidth = width;
+        m_uploadHeight = height;
+    }
+
+    const int slot = m_uploadSlot;
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[slot]);
+    // Detach the previous storage, the driver may still be reading it and writing does not wait
+    f->glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *buffer = MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!buffer) {
+        qDebug() << "Cannot map pixel buffer, uploading without it";
+        f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        // The textures of the slots are released in cleanup()
+        m_displayTexture[0] = m_displayTexture[1] = m_displayTexture[2] = 0;
+        pboUpload.store(0);
+        return false;
+    }
+    memcpy(buffer, image, size);
+    UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // The textures of this slot were displayed UPLOAD_SLOTS - 1 frames ago, but may still be drawn
+    waitPainted(slot);
+    // With a pixel buffer bound, the data pointer is an offset into it
+    GLuint *textures = m_uploadTexture + 3 * slot;
+    size_t offset = 0;
+    for (int i = 0; i < 3; ++i) {
+        f->glBindTexture  (GL_TEXTURE_2D, textures[i]);
+        f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, planeWidth[i], planeHeight[i],
+                           GL_LUMINANCE, GL_UNSIGNED_BYTE, (const void *) offset);
+        check_error(f);
+        offset += planeWidth[i] * planeHeight[i];
+        m_displayTexture[i] = textures[i];
+    }
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    f->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // No glFinish, the display context waits for this fence on the GPU
+    GLsync fence = FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    f->glFlush();
+    m_fenceMutex.lock();
+    if (m_uploadFence) {
+        // The previous frame was never painted
+        DeleteSync(m_uploadFence);
+    }
+    m_uploadFence = fence;
+    m_fenceMutex.unlock();
+    m_uploadSlot = (slot + 1) % UPLOAD_SLOTS;
+    return true;
+}
+
+GLsync FrameRenderer::takeUploadFence()
+{
+    QMutexLocker lock(&m_fenceMutex);
+    GLsync fence = m_uploadFence;
+    m_uploadFence = 0;
+    return fence;
+}
+
+void FrameRenderer::texturesPainted(GLuint yName, GLsync fence)
+{
+    if (!fence) {
+        return;
+    }
+    QMutexLocker lock(&m_fenceMutex);
+    for (int slot = 0; slot < UPLOAD_SLOTS; ++slot) {
+        if (yName && m_uploadTexture[3 * slot] == yName) {
+            // Only the last drawing of the slot matters, it completes after the previous ones
+            if (m_paintFence[slot]) {
+                DeleteSync(m_paintFence[slot]);
+            }
+            m_paintFence[slot] = fence;
+            return;
+        }
+    }
+    // Not a texture of the pixel buffer upload
+    DeleteSync(fence);
+}
+
+void FrameRenderer::waitPainted(int slot)
+{
+    m_fenceMutex.lock();
+    GLsync fence = m_paintFence[slot];
+    m_paintFence[slot] = 0;
+    m_fenceMutex.unlock();
+    if (fence) {
+        // The GPU waits for the display context, this thread does not block
+        WaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+        DeleteSync(fence);
+    }
+}
+
+void FrameRenderer::frameDropped()
+{
+    m_droppedFrames.ref();
+}
+
+int FrameRenderer::droppedFrames() const
+{
+    return m_droppedFrames.load();
+}
+
+void FrameRenderer::resetDrops()
+{
+    m_droppedFrames.store(0);
+}
+
+int FrameRenderer::uploadTime() const
+{
+    return m_uploadTime.load();
+}
+
 void FrameRenderer::clearFrame()
 {
     m_frame = SharedFrame();
@@ -1394,6 +1683,28 @@ void FrameRenderer::clearFrame()
 
 void FrameRenderer::cleanup()
 {
+    if (m_pbo[0]) {
+        m_context->makeCurrent(m_surface);
+        m_context->functions()->glDeleteBuffers(UPLOAD_SLOTS, m_pbo);
+        m_context->functions()->glDeleteTextures(3 * UPLOAD_SLOTS, m_uploadTexture);
+        GLsync fence = takeUploadFence();
+        if (fence) {
+            DeleteSync(fence);
+        }
+        m_fenceMutex.lock();
+        for (int slot = 0; slot < UPLOAD_SLOTS; ++slot) {
+            if (m_paintFence[slot]) {
+                DeleteSync(m_paintFence[slot]);
+                m_paintFence[slot] = 0;
+            }
+        }
+        m_fenceMutex.unlock();
+        m_context->doneCurrent();
+        memset(m_pbo, 0, sizeof(m_pbo));
+        memset(m_uploadTexture, 0, sizeof(m_uploadTexture));
+        m_displayTexture[0] = m_displayTexture[1] = m_displayTexture[2] = 0;
+        m_uploadWidth = m_uploadHeight = 0;
+    }
     if (m_renderTexture[0] && m_renderTexture[1] && m_renderTexture[2]) {
         m_context->makeCurrent(m_surface);
         m_context->functions()->glDeleteTextures(3, m_renderTexture);
@@ -1405,39 +1716,35 @@ void FrameRenderer::cleanup()
     }
 }
 
-void GLWidget::setAudioThumb(int channels, QVariantList audioCache)
+void GLWidget::setAudioThumb(AudioLevelsPtr levels)
 {
     if (rootObject()) {
         QmlAudioThumb *audioThumbDisplay = rootObject()->findChild<QmlAudioThumb *>("audiothumb");
         if (audioThumbDisplay) {
             QImage img(width(), height() / 6, QImage::Format_ARGB32_Premultiplied);
             img.fill(Qt::transparent);
-            if (!audioCache.isEmpty() && channels > 0) {
-                int audioLevelCount = audioCache.count() - 1;
+            if (!levels.isNull() && !levels->isEmpty()) {
+                int frames = levels->frames();
                 // simplified audio
                 QPainter painter(&img);
                 QRectF mappedRect(0, 0, img.width(), img.height());
                 int channelHeight = mappedRect.height();
                 double value;
-                double scale = (double) width() / (audioLevelCount / channels);
+                double scale = (double) width() / frames;
                 if (scale < 1) {
                     painter.setPen(QColor(80, 80, 150, 200));
+                    QVector<QLineF> lines;
+                    lines.reserve(img.width());
                     for (int i = 0; i < img.width(); i++) {
-                        int framePos = i / scale;
-                        value = audioCache.at(qMin(framePos * channels, audioLevelCount)).toDouble() / 256;
-                        for (int channel = 1; channel < channels; channel ++) {
-                            value = qMax(value, audioCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256);
-                        }
-                        painter.drawLine(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
+                        value = levels->maxPeak((int) (i / scale), (int) ((i + 1) / scale)) / 256.0;
+                        lines << QLineF(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
                     }
+                    painter.drawLines(lines);
                 } else {
                     QPainterPath positiveChannelPath;
                     positiveChannelPath.moveTo(0, mappedRect.bottom());
-                    for (int i = 0; i < audioLevelCount / channels; i++) {
-                        value = audioCache.at(qMin(i * channels, audioLevelCount)).toDouble() / 256;
-                        for (int channel = 1; channel < channels; channel ++) {
-                            value = qMax(value, audioCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256);
-                        }
+                    for (int i = 0; i < frames; i++) {
+                        value = levels->maxLevel(i) / 256.0;
                         positiveChannelPath.lineTo(i * scale, mappedRect.bottom() - (value * channelHeight));
                     }
                     positiveChannelPath.lineTo(mappedRect.right(), mappedRect.bottom());
@@ -32,6 +32,8 @@
 
 #include "scopes/sharedframe.h"
 #include "definitions.h"
+#include "lib/audio/audioLevels.h"
+#include "lib/audio/audioBlock.h"
 
 class QOpenGLFunctions_3_2_Core;
 //class QmlFilter;
@@ -92,9 +94,14 @@ public:
     void lockMonitor();
     void releaseMonitor();
     int realTime() const;
-    void setAudioThumb(int channels = 0, QVariantList audioCache = QList<QVariant>());
+    void setAudioThumb(AudioLevelsPtr levels = AudioLevelsPtr());
+    /** @brief Frames dropped by the consumer and frames the renderer was too busy to display. */
     int droppedFrames() const;
     void resetDrops();
+    /** @brief Average time needed to upload a frame to the GPU, in microseconds. */
+    int uploadTime() const;
+    /** @brief Displays a frame decoded before, returns false if the renderer is busy. */
+    bool showCachedFrame(const SharedFrame &frame);
 
 protected:
     void mouseReleaseEvent(QMouseEvent * event);
@@ -127,7 +134,10 @@ signals:
     void mouseSeek(int eventDelta, int modifiers);
     void startDrag();
     void analyseFrame(QImage);
-    void audioSamplesSignal(const audioShortVector&,int,int,int);
+    /** @brief The displayed frame is sent to the scopes as decoded, without reading it back from the GPU. */
+    void analyseSharedFrame(const SharedFrame &);
+    /** @brief The audio of the displayed frame, for the audio meters and scopes. */
+    void audioBlockReady(const AudioBlock &);
     void showContextMenu(const QPoint);
     void lockMonitor(bool);
     void passKeyEvent(QKeyEvent *);
@@ -174,6 +184,8 @@ private:
     void adjustAudioOverlay(bool isAudio);
     QOpenGLFramebufferObject *m_fbo;
     void refreshSceneLayout();
+    /** @brief Resolves the functions of the pixel buffer upload, returns false if it is not available. */
+    bool initPboUpload();
 
 private slots:
     void resizeGL(int width, int height);
@@ -218,6 +230,17 @@ public:
     Q_INVOKABLE void showFrame(Mlt::Frame frame);
     Q_INVOKABLE void showGLFrame(Mlt::Frame frame);
     Q_INVOKABLE void showGLNoSyncFrame(Mlt::Frame frame);
+    /** @brief Returns the fence of the last upload that was not displayed yet, the caller deletes it. */
+    GLsync takeUploadFence();
+    /** @brief Called by the display context after drawing the textures starting with @param yName,
+        the next upload into them waits for @param fence, which is deleted by the renderer. */
+    void texturesPainted(GLuint yName, GLsync fence);
+    /** @brief Counts a frame that arrived while the renderer was busy. */
+    void frameDropped();
+    int droppedFrames() const;
+    void resetDrops();
+    /** @brief Average upload time of the last frames, in microseconds. */
+    int uploadTime() const;
 
 public slots:
     void cleanup();
@@ -225,7 +248,7 @@ public slots:
 signals:
     void textureReady(GLuint yName, GLuint uName = 0, GLuint vName = 0);
     void frameDisplayed(const SharedFrame& frame);
-    void audioSamplesSignal(const audioShortVector&,int,int,int);
+    void audioBlockReady(const AudioBlock &);
 
 private:
     QSemaphore m_semaphore;
@@ -233,12 +256,37 @@ private:
     SharedFrame m_displayFrame;
     QOpenGLContext* m_context;
     QSurface* m_surface;
+    /** @brief Sends the audio of the displayed frame if someone analyses it. */
+    void sendAudio();
+
+    /** Number of texture sets used in turn by the pixel buffer upload */
+    static const int UPLOAD_SLOTS = 3;
+    /** @brief Uploads the frame through a pixel buffer object, returns false if the buffer cannot be used. */
+    bool uploadPbo(QOpenGLFunctions *f);
+    GLuint m_pbo[UPLOAD_SLOTS];
+    /** Y, U and V texture of each slot, allocated once per frame size */
+    GLuint m_uploadTexture[3 * UPLOAD_SLOTS];
+    int m_uploadSlot;
+    int m_uploadWidth;
+    int m_uploadHeight;
+    GLsync m_uploadFence;
+    /** Fence of the last drawing of each slot's textures by the display context */
+    GLsync m_paintFence[UPLOAD_SLOTS];
+    QMutex m_fenceMutex;
+    /** @brief Makes the renderer context wait until the display context has drawn the textures of @param slot. */
+    void waitPainted(int slot);
+    QAtomicInt m_droppedFrames;
+    QAtomicInt m_uploadTime;
 
 public:
     GLuint m_renderTexture[3];
     GLuint m_displayTexture[3];
     QOpenGLFunctions_3_2_Core* m_gl32;
-    bool sendAudioForAnalysis;
+    /** @brief Non zero when an audio meter or scope shows this monitor's audio, set from the GUI thread. */
+    QAtomicInt sendAudioForAnalysis;
+    /** @brief Non zero to upload frames through pixel buffer objects and fences instead of waiting with glFinish.
+     *  Cleared by the renderer thread if mapping a buffer fails, read by the GUI thread when painting. */
+    QAtomicInt pboUpload;
 };
 
 
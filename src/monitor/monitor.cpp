@@ -36,6 +36,7 @@
 #include "timeline/transitionhandler.h"
 #include "core.h"
 #include "bin/bin.h"
+#include "bin/projectclip.h"
 #include "project/projectmanager.h"
 #include "doc/kdenlivedoc.h"
 #include "mainwindow.h"
@@ -299,7 +300,9 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     connect(render, SIGNAL(rendererStopped(int)), this, SLOT(rendererStopped(int)));
     connect(render, &AbstractRender::scopesClear, m_glMonitor, &GLWidget::releaseAnalyse, Qt::DirectConnection);
     connect(m_glMonitor, SIGNAL(analyseFrame(QImage)), render, SIGNAL(frameUpdated(QImage)));
-    connect(m_glMonitor, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)), render, SIGNAL(audioSamplesSignal(const audioShortVector&,int,int,int)));
+    connect(m_glMonitor, SIGNAL(analyseSharedFrame(SharedFrame)), render, SIGNAL(sharedFrameUpdated(SharedFrame)));
+    connect(m_glMonitor, SIGNAL(audioBlockReady(AudioBlock)), render, SIGNAL(audioSamplesSignal(AudioBlock)));
+    connect(m_glMonitor, &GLWidget::audioBlockReady, m_monitorManager, &MonitorManager::audioBlockReady);
 
     if (id != Kdenlive::ClipMonitor) {
         connect(render, SIGNAL(durationChanged(int)), this, SIGNAL(durationChanged(int)));
@@ -336,14 +339,9 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     int tm = 0;
     int bm = 0;
     m_toolbar->getContentsMargins(0, &tm, 0, &bm);
-    m_audioMeterWidget = new MonitorAudioLevel(m_glMonitor->profile(), m_toolbar->height() - tm - bm, this);
+    m_audioMeterWidget = new MonitorAudioLevel(m_toolbar->height() - tm - bm, this);
     m_toolbar->addWidget(m_audioMeterWidget);
-    if (!m_audioMeterWidget->isValid) {
-        KdenliveSettings::setMonitoraudio(0x01);
-        m_audioMeterWidget->setVisibility(false);
-    } else {
-        m_audioMeterWidget->setVisibility((KdenliveSettings::monitoraudio() & m_id) != 0);
-    }
+    m_audioMeterWidget->setVisibility((KdenliveSettings::monitoraudio() & m_id) != 0);
 
     connect(m_timePos, SIGNAL(timeCodeEditingFinished()), this, SLOT(slotSeek()));
     layout->addWidget(m_toolbar);
@@ -552,6 +550,18 @@ double Monitor::fps() const
     return m_monitorManager->timecode().fps();
 }
 
+void Monitor::scrubToFrame(int pos)
+{
+    // Timeline positions mix several clips, only the clip monitor is snapped
+    if (m_id == Kdenlive::ClipMonitor && m_controller && KdenliveSettings::scrubkeyframes()) {
+        ProjectClip *clip = pCore->bin()->getBinClip(m_controller->clipId());
+        if (clip) {
+            pos = clip->keyframeIndex().nearestKeyframe(pos, fps());
+        }
+    }
+    render->seekToFrame(pos);
+}
+
 Timecode Monitor::timecode() const
 {
     return m_monitorManager->timecode();
@@ -1354,6 +1364,12 @@ void Monitor::slotOpenClip(ClipController *controller, int in, int out)
 	}
 	m_audioMeterWidget->audioChannels = controller->audioInfo() ? controller->audioInfo()->channels() : 0;
 	emit requestAudioThumb(controller->clipId());
+        if (!sameClip && KdenliveSettings::scrubkeyframes()) {
+            ProjectClip *clip = pCore->bin()->getBinClip(controller->clipId());
+            if (clip) {
+                clip->requestKeyframeIndex();
+            }
+        }
 	//hasEffects =  controller->hasEffects();
     }
     else {
@@ -2004,9 +2020,9 @@ void Monitor::slotEditInlineMarker()
     }
 }
 
-void Monitor::prepareAudioThumb(int channels, QVariantList &audioCache)
+void Monitor::prepareAudioThumb(AudioLevelsPtr levels)
 {
-    m_glMonitor->setAudioThumb(channels, audioCache);
+    m_glMonitor->setAudioThumb(levels);
 }
 
 void Monitor::slotUpdateQmlTimecode(const QString &tc)
@@ -2017,11 +2033,6 @@ void Monitor::slotUpdateQmlTimecode(const QString &tc)
 
 void Monitor::slotSwitchAudioMonitor()
 {
-    if (!m_audioMeterWidget->isValid) {
-        KdenliveSettings::setMonitoraudio(0x01);
-        m_audioMeterWidget->setVisibility(false);
-        return;
-    }
     int currentOverlay = KdenliveSettings::monitoraudio();
     currentOverlay ^= m_id;
     KdenliveSettings::setMonitoraudio(currentOverlay);
@@ -2036,11 +2047,12 @@ void Monitor::displayAudioMonitor(bool isActive)
 {
     bool enable = isActive && (KdenliveSettings::monitoraudio() & m_id);
     if (enable) {
-        connect(m_monitorManager, SIGNAL(frameDisplayed(const SharedFrame&)), m_audioMeterWidget, SLOT(onNewFrame(const SharedFrame&)), Qt::UniqueConnection);
+        connect(m_monitorManager, &MonitorManager::audioBlockReady, m_audioMeterWidget, &MonitorAudioLevel::setAudioBlock, Qt::UniqueConnection);
     } else {
-        disconnect(m_monitorManager, SIGNAL(frameDisplayed(const SharedFrame&)), m_audioMeterWidget, SLOT(onNewFrame(const SharedFrame&)));
+        disconnect(m_monitorManager, &MonitorManager::audioBlockReady, m_audioMeterWidget, &MonitorAudioLevel::setAudioBlock);
     }
     m_audioMeterWidget->setVisibility((KdenliveSettings::monitoraudio() & m_id) != 0);
+    m_glMonitor->updateAudioForAnalysis();
 }
 
 void Monitor::updateQmlDisplay(int currentOverlay)
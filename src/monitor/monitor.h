@@ -27,6 +27,7 @@
 #include "timecodedisplay.h"
 #include "scopes/sharedframe.h"
 #include "effectslist/effectslist.h"
+#include "lib/audio/audioLevels.h"
 
 #include <QLabel>
 #include <QDomElement>
@@ -112,6 +113,8 @@ public:
     QString getTimecodeFromFrames(int pos);
     /** @brief Returns current project's fps. */
     double fps() const;
+    /** @brief Seeks while dragging the ruler, to the nearest keyframe of the clip if it is indexed. */
+    void scrubToFrame(int pos);
     /** @brief Returns current project's timecode. */
     Timecode timecode() const;
     /** @brief Get url for the clip's thumbnail */
@@ -144,7 +147,7 @@ public:
     QAction *recAction();
     void refreshIcons();
     /** @brief Send audio thumb data to qml for on monitor display */
-    void prepareAudioThumb(int channels, QVariantList &audioCache);
+    void prepareAudioThumb(AudioLevelsPtr levels);
     void refreshMonitorIfActive();
     void connectAudioSpectrum(bool activate);
     /** @brief Set a property on the Qml scene **/
@@ -137,6 +137,8 @@ signals:
     void updateOverlayInfos(int, int);
     /** @brief info is available for audio spectum widget */
     void frameDisplayed(const SharedFrame&);
+    /** @brief The audio of the displayed frame, for the audio meter and spectrum */
+    void audioBlockReady(const AudioBlock &);
 };
 
 #endif
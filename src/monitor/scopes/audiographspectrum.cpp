@@ -31,8 +31,7 @@
 #include <QAction>
 
 #include <math.h>
-
-#include <mlt++/Mlt.h>
+#include <cstring>
 
 
 // Code borrowed from Shotcut's audiospectum by Brian Matherly <code@brianmatherly.com> (GPL)
@@ -256,6 +255,9 @@ void AudioGraphWidget::paintEvent(QPaintEvent *pe)
 
 AudioGraphSpectrum::AudioGraphSpectrum(MonitorManager *manager, QWidget *parent) : ScopeWidget(parent)
   , m_manager(manager)
+  , m_audioQueue(3, DataQueue<AudioBlock>::OverflowModeDiscardOldest)
+  , m_channels(0)
+  , m_frequency(0)
 {
     QVBoxLayout *lay = new QVBoxLayout(this);
     m_graphWidget = new AudioGraphWidget(this);
@@ -266,25 +268,11 @@ AudioGraphSpectrum::AudioGraphSpectrum(MonitorManager *manager, QWidget *parent)
     lay->setStretchFactor(m_graphWidget, 5);
     lay->setStretchFactor(m_equalizer, 3);*/
 
-    m_filter = new Mlt::Filter(*(m_manager->projectMonitor()->profile()), "fft");
-    if (!m_filter->is_valid()) {
-        KdenliveSettings::setEnableaudiospectrum(false);
-        KMessageWidget *mw = new KMessageWidget(this);
-        mw->setCloseButtonVisible(false);
-        mw->setWordWrap(true);
-        mw->setMessageType(KMessageWidget::Information);
-        mw->setText(i18n("MLT must be compiled with libfftw3 to enable Audio Spectrum"));
-        layout()->addWidget(mw);
-        mw->show();
-        setEnabled(false);
-        return;
-    }
-    m_filter->set("window_size", WINDOW_SIZE);
     QAction *a = new QAction(i18n("Enable Audio Spectrum"), this);
     a->setCheckable(true);
     a->setChecked(KdenliveSettings::enableaudiospectrum());
     if (KdenliveSettings::enableaudiospectrum()) {
-        connect(m_manager, &MonitorManager::frameDisplayed, this, &ScopeWidget::onNewFrame, Qt::UniqueConnection);
+        connect(m_manager, &MonitorManager::audioBlockReady, this, &AudioGraphSpectrum::onNewAudio, Qt::UniqueConnection);
     }
     connect(a, &QAction::triggered, this, &AudioGraphSpectrum::activate);
     addAction(a);
@@ -294,17 +282,17 @@ AudioGraphSpectrum::AudioGraphSpectrum(MonitorManager *manager, QWidget *parent)
 AudioGraphSpectrum::~AudioGraphSpectrum()
 {
     delete m_graphWidget;
-    delete m_filter;
 }
 
 void AudioGraphSpectrum::activate(bool enable)
 {
     if (enable) {
-        connect(m_manager, &MonitorManager::frameDisplayed, this, &ScopeWidget::onNewFrame, Qt::UniqueConnection);
+        connect(m_manager, &MonitorManager::audioBlockReady, this, &AudioGraphSpectrum::onNewAudio, Qt::UniqueConnection);
     } else {
-        disconnect(m_manager, &MonitorManager::frameDisplayed, this, &ScopeWidget::onNewFrame);
+        disconnect(m_manager, &MonitorManager::audioBlockReady, this, &AudioGraphSpectrum::onNewAudio);
     }
     KdenliveSettings::setEnableaudiospectrum(enable);
+    m_manager->slotUpdateAudioMonitoring();
 }
 
 void AudioGraphSpectrum::refreshPixmap()
@@ -313,34 +301,45 @@ void AudioGraphSpectrum::refreshPixmap()
         m_graphWidget->drawBackground();
 }
 
+void AudioGraphSpectrum::onNewAudio(const AudioBlock &block)
+{
+    m_audioQueue.push(block);
+    requestRefresh();
+}
+
 void AudioGraphSpectrum::refreshScope(const QSize& /*size*/, bool /*full*/)
 {
-    SharedFrame sFrame;
-    while (m_queue.count() > 0) {
-        sFrame = m_queue.pop();
-        if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
-            mlt_audio_format format = mlt_audio_s16;
-            int channels = sFrame.get_audio_channels();
-            int frequency = sFrame.get_audio_frequency();
-            int samples = sFrame.get_audio_samples();
-            Mlt::Frame mFrame = sFrame.clone(true, false, false);
-            m_filter->process(mFrame);
-            mFrame.get_audio( format, frequency, channels, samples );
-            if (samples == 0 || format == 0) {
-                // There was an error processing audio from frame
-                continue;
-            }
-            processSpectrum();
+    AudioBlock block;
+    bool received = false;
+    while (m_audioQueue.tryPop(block)) {
+        if (block.isNull()) {
+            continue;
         }
+        const int channels = block.channels();
+        if (channels != m_channels || block.frequency() != m_frequency) {
+            m_channels = channels;
+            m_frequency = block.frequency();
+            m_window.fill(0, WINDOW_SIZE * channels);
+        }
+        // Slide the window: drop the oldest samples, append the new ones
+        const int count = qMin(block.sampleCount(), WINDOW_SIZE) * channels;
+        const qint16 *samples = block.samples().constData() + block.samples().size() - count;
+        qint16 *window = m_window.data();
+        memmove(window, window + count, (m_window.size() - count) * sizeof(qint16));
+        memcpy(window + m_window.size() - count, samples, count * sizeof(qint16));
+        received = true;
+    }
+    if (received && m_spectrumEngine.process(m_window, m_channels, WINDOW_SIZE, FFTTools::Window_Hamming)) {
+        processSpectrum();
     }
 }
 
 void AudioGraphSpectrum::processSpectrum()
 {
     QVector<double> bands(AUDIBLE_BAND_COUNT);
-    float* bins = (float*)m_filter->get_data("bins");
-    int bin_count = m_filter->get_int("bin_count");
-    double bin_width = m_filter->get_double("bin_width");
+    const float* bins = m_spectrumEngine.maximum();
+    int bin_count = m_spectrumEngine.binCount();
+    double bin_width = (double) m_frequency / WINDOW_SIZE;
 
     int band = 0;
     bool firstBandFound = false;
@@ -372,11 +371,12 @@ void AudioGraphSpectrum::processSpectrum()
         }
     }
 
-    // At this point, bands contains the magnitude of the signal for each
-    // band. Convert to dB.
+    // At this point, bands contains the relative power of the signal for
+    // each band in dB. Convert to the scale of the graph.
     for (band = 0; band < bands.size(); band++) {
-        double mag = bands[band];
-        double dB = mag > 0.0 ? levelToDB(mag) : -100.0;
+        double power = bands[band];
+        // Silence gives about -300 dB
+        double dB = power > -200.0 ? levelToDB(pow(10.0, power / 20)) : -100.0;
         bands[band] = dB;
     }
 
@@ -29,17 +29,14 @@
 #define AUDIOGRAPHSPECTRUM_H
 
 #include "scopewidget.h"
-#include "sharedframe.h"
+#include "dataqueue.h"
+#include "lib/audio/audioBlock.h"
+#include "lib/audio/spectrumEngine.h"
 
 #include <QWidget>
 #include <QVector>
 #include <QPixmap>
 
-namespace Mlt {
-class Filter;
-class Consumer;
-}
-
 class MonitorManager;
 
 /*class EqualizerWidget : public QWidget
@@ -85,14 +82,22 @@ public:
 
 private:
     MonitorManager *m_manager;
-    Mlt::Filter* m_filter;
     AudioGraphWidget *m_graphWidget;
     //EqualizerWidget *m_equalizer;
+    /** Audio received from the monitors, analysed in refreshScope() */
+    DataQueue<AudioBlock> m_audioQueue;
+    /** The most recent samples of all channels, interleaved, the FFT window slides over them */
+    audioShortVector m_window;
+    int m_channels;
+    int m_frequency;
+    SpectrumEngine m_spectrumEngine;
     void processSpectrum();
     void refreshScope(const QSize& size, bool full) Q_DECL_OVERRIDE;
 
 public slots:
     void refreshPixmap();
+    /** @brief Queues the audio of a new frame for analysis. */
+    void onNewAudio(const AudioBlock &block);
 
 private slots:
     void activate(bool enable);
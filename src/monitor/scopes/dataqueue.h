@@ -19,10 +19,11 @@
 #ifndef DATAQUEUE_H
 #define DATAQUEUE_H
 
-#include <QList>
+#include <QAtomicInt>
 #include <QMutex>
 #include <QWaitCondition>
 #include <QMutexLocker>
+#include <QThread>
 
 /*!
   \class DataQueue
@@ -33,14 +34,22 @@
 
   DataQueue provides a limited size container for passing data between objects.
   One object can add data to the queue by calling push() while another object
-  can remove items from the queue by calling pop().
+  can remove items from the queue by calling pop() or tryPop().
 
   DataQueue provides configurable behavior for handling overflows. It can
   discard the oldest, discard the newest or block the object calling push()
   until room has been freed in the queue by another object calling pop().
 
-  DataQueue is threadsafe and is therefore most appropriate when passing data
-  between objects operating in different thread contexts.
+  DataQueue is a lock-free ring for a single producer and a single consumer:
+  push() and tryPop() never take a lock, so the thread delivering frames is
+  never held up by the thread analysing them. Each slot carries a sequence
+  number telling whether it is free for the producer, holds a published item or
+  is being read. An item is taken by whoever advances the tail first, which lets
+  the producer discard the oldest item while the consumer is reading, and the
+  producer only reuses a slot once its reader has released it, so items always
+  come out in the order they were pushed. A lock is only used to put a thread to
+  sleep when pop() is called on an empty queue or push() is called on a full
+  queue in OverflowModeWait.
 */
 
 template <class T>
@@ -66,7 +75,7 @@ public:
     virtual ~DataQueue();
 
     /*!
-      Pushes an item into the queue.
+      Pushes an item into the queue. Must only be called from one thread at a time.
 
       If the queue is full and overflow mode is OverflowModeWait then this
       function will block until pop() is called.
@@ -74,89 +83,169 @@ public:
     void push(const T& item);
 
     /*!
-      Pops an item from the queue.
+      Pops an item from the queue. Must only be called from one thread at a time.
 
       If the queue is empty then this  function will block. If blocking is
-      undesired, then check the return of count() before calling pop().
+      undesired, use tryPop().
     */
     T pop();
 
+    /*!
+      Pops an item from the queue into \a item if there is one, without blocking.
+      Returns false if the queue was empty.
+    */
+    bool tryPop(T& item);
+
     //! Returns the number of items in the queue.
     int count() const;
 
 private:
-    QList<T> m_queue;
+    Q_DISABLE_COPY(DataQueue)
+
+    struct Slot {
+        //! Equals the push count when free, push count + 1 once the item is published
+        QAtomicInt sequence;
+        T item;
+    };
+
+    Slot *m_slots;
     int m_maxSize;
     OverflowMode m_mode;
-    mutable QMutex m_mutex;
-    QWaitCondition m_notEmptyCondition;
-    QWaitCondition m_notFullCondition;
+    //! Number of items pushed, only written by the producer
+    QAtomicInt m_head;
+    //! Number of items taken, by the consumer or discarded by the producer
+    QAtomicInt m_tail;
+
+    // Only used to sleep when waiting is required
+    QAtomicInt m_waiting;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+
+    void release(Slot &slot, uint position);
+    void wakeWaiting();
 };
 
 template <class T>
 DataQueue<T>::DataQueue(int maxSize, OverflowMode mode)
-  : m_queue()
-  , m_maxSize(maxSize)
+  : m_slots(new Slot[qMax(1, maxSize)])
+  , m_maxSize(qMax(1, maxSize))
   , m_mode(mode)
+  , m_head(0)
+  , m_tail(0)
+  , m_waiting(0)
   , m_mutex(QMutex::NonRecursive)
-  , m_notEmptyCondition()
-  , m_notFullCondition()
+  , m_condition()
 {
+    for (int i = 0; i < m_maxSize; ++i) {
+        m_slots[i].sequence.store(i);
+    }
 }
 
 template <class T>
 DataQueue<T>::~DataQueue()
 {
+    delete[] m_slots;
 }
 
 template <class T>
 void DataQueue<T>::push(const T& item)
 {
-    m_mutex.lock();
-    if (m_queue.size() == m_maxSize) {
+    const uint head = m_head.loadAcquire();
+    forever {
+        const uint tail = m_tail.loadAcquire();
+        if (head - tail < (uint) m_maxSize) {
+            break;
+        }
         switch(m_mode) {
             case OverflowModeDiscardOldest:
-                m_queue.removeFirst();
-                m_queue.append(item);
+                // Take the oldest item unless the consumer was faster
+                if (m_tail.testAndSetOrdered(tail, tail + 1)) {
+                    release(m_slots[tail % m_maxSize], tail);
+                }
                 break;
             case OverflowModeDiscardNewest:
                 // This item is the newest so discard it and exit
+                return;
+            case OverflowModeWait: {
+                QMutexLocker locker(&m_mutex);
+                m_waiting.fetchAndAddOrdered(1);
+                while (head - (uint) m_tail.fetchAndAddOrdered(0) >= (uint) m_maxSize) {
+                    m_condition.wait(&m_mutex);
+                }
+                m_waiting.fetchAndAddOrdered(-1);
                 break;
-            case OverflowModeWait:
-                m_notFullCondition.wait(&m_mutex);
-                m_queue.append(item);
-                break;
+            }
         }
-    } else {
-        m_queue.append(item);
-        if (m_queue.size() == 1) {
-            m_notEmptyCondition.wakeOne();
+    }
+    Slot &slot = m_slots[head % m_maxSize];
+    // The consumer may have claimed the previous item of this slot and still be copying it
+    while ((uint) slot.sequence.loadAcquire() != head) {
+        QThread::yieldCurrentThread();
+    }
+    slot.item = item;
+    slot.sequence.storeRelease(head + 1);
+    m_head.storeRelease(head + 1);
+    wakeWaiting();
+}
+
+template <class T>
+bool DataQueue<T>::tryPop(T& item)
+{
+    forever {
+        const uint tail = m_tail.loadAcquire();
+        if (tail == (uint) m_head.loadAcquire()) {
+            return false;
         }
+        if (!m_tail.testAndSetOrdered(tail, tail + 1)) {
+            // The producer discarded this item, try the next one
+            continue;
+        }
+        Slot &slot = m_slots[tail % m_maxSize];
+        item = slot.item;
+        release(slot, tail);
+        if (m_mode == OverflowModeWait) {
+            wakeWaiting();
+        }
+        return true;
     }
-    m_mutex.unlock();
 }
 
 template <class T>
 T DataQueue<T>::pop()
 {
     T retVal;
-    m_mutex.lock();
-    if (m_queue.size() == 0) {
-        m_notEmptyCondition.wait(&m_mutex);
-    }
-    retVal = m_queue.takeFirst();
-    if (m_mode == OverflowModeWait && m_queue.size() == m_maxSize - 1) {
-        m_notFullCondition.wakeOne();
+    while (!tryPop(retVal)) {
+        QMutexLocker locker(&m_mutex);
+        m_waiting.fetchAndAddOrdered(1);
+        if ((uint) m_tail.fetchAndAddOrdered(0) == (uint) m_head.fetchAndAddOrdered(0)) {
+            m_condition.wait(&m_mutex);
+        }
+        m_waiting.fetchAndAddOrdered(-1);
     }
-    m_mutex.unlock();
     return retVal;
 }
 
 template <class T>
 int DataQueue<T>::count() const
 {
-    QMutexLocker locker(&m_mutex);
-    return m_queue.size();
+    return (uint) m_head.loadAcquire() - (uint) m_tail.loadAcquire();
+}
+
+template <class T>
+void DataQueue<T>::release(Slot &slot, uint position)
+{
+    // Drop our reference to the data and hand the slot back for the next round
+    slot.item = T();
+    slot.sequence.storeRelease(position + m_maxSize);
+}
+
+template <class T>
+void DataQueue<T>::wakeWaiting()
+{
+    if (m_waiting.fetchAndAddOrdered(0) > 0) {
+        QMutexLocker locker(&m_mutex);
+        m_condition.wakeAll();
+    }
 }
 
 #endif // DATAQUEUE_H
@@ -21,8 +21,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "monitoraudiolevel.h"
 
-#include "mlt++/Mlt.h"
-
 #include <math.h>
 
 #include <QPainter>
@@ -31,7 +29,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVBoxLayout>
 #include <QFont>
 #include <QDebug>
-#include <math.h>
 
 const double log_factor = 1.0 / log10(1.0/127);
 
@@ -41,7 +38,7 @@ static inline double levelToDB(double dB)
     return 100 * (1.0 - log10(dB) * log_factor);
 }
 
-MonitorAudioLevel::MonitorAudioLevel(Mlt::Profile *profile, int height, QWidget *parent) : ScopeWidget(parent)
+MonitorAudioLevel::MonitorAudioLevel(int height, QWidget *parent) : QWidget(parent)
   , audioChannels(2)
   , m_height(height)
   , m_channelHeight(height/2)
@@ -49,56 +46,35 @@ MonitorAudioLevel::MonitorAudioLevel(Mlt::Profile *profile, int height, QWidget
   , m_channelFillHeight(m_channelHeight)
 {
     setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
-    m_filter = new Mlt::Filter(*profile, "audiolevel");
-    if (!m_filter->is_valid()) {
-        isValid = false;
-        return;
-    }
-    m_filter->set("iec_scale", 0);
-    isValid = true;
 }
 
 MonitorAudioLevel::~MonitorAudioLevel()
 {
-    delete m_filter;
 }
 
-void MonitorAudioLevel::refreshScope(const QSize& /*size*/, bool /*full*/)
+void MonitorAudioLevel::setAudioBlock(const AudioBlock &block)
 {
-    SharedFrame sFrame;
-    while (m_queue.count() > 0) {
-        sFrame = m_queue.pop();
-        if (sFrame.is_valid() && sFrame.get_audio_samples() > 0) {
-            mlt_audio_format format = mlt_audio_s16;
-            int channels = sFrame.get_audio_channels();
-            int frequency = sFrame.get_audio_frequency();
-            int samples = sFrame.get_audio_samples();
-            Mlt::Frame mFrame = sFrame.clone(true, false, false);
-            m_filter->process(mFrame);
-            mFrame.get_audio( format, frequency, channels, samples );
-            if (samples == 0) {
-                // There was an error processing audio from frame
-                continue;
-            }
-            QVector<int> levels;
-            for (int i = 0; i < audioChannels; i++) {
-                QString s = QString("meta.media.audio_level.%1").arg(i);
-                double audioLevel = mFrame.get_double(s.toLatin1().constData());
-                if (audioLevel == 0.0) {
-                    levels << -100;
-                } else {
-                    levels << (int) levelToDB(audioLevel);
-                }
-            }
-            QMetaObject::invokeMethod(this, "setAudioValues", Qt::QueuedConnection, Q_ARG(const QVector<int>&, levels));
+    if (block.isNull()) {
+        return;
+    }
+    // Peaks on the scale of the levels once read from the MLT audiolevel filter
+    QVector<int> levels;
+    const int channels = qMin(audioChannels, block.channels());
+    for (int i = 0; i < channels; i++) {
+        double audioLevel = block.peak(i);
+        if (audioLevel == 0.0) {
+            levels << -100;
+        } else {
+            levels << (int) levelToDB(audioLevel);
         }
     }
+    setAudioValues(levels);
 }
 
 void MonitorAudioLevel::resizeEvent ( QResizeEvent * event )
 {
     drawBackground(m_peaks.size());
-    ScopeWidget::resizeEvent(event);
+    QWidget::resizeEvent(event);
 }
 
 void MonitorAudioLevel::refreshPixmap()
@@ -187,7 +163,6 @@ void MonitorAudioLevel::drawBackground(int channels)
     p.end();
 }
 
-// cppcheck-suppress unusedFunction
 void MonitorAudioLevel::setAudioValues(const QVector <int>& values)
 {
     m_values = values;
@@ -23,31 +23,29 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MONITORAUDIOLEVEL_H
 #define MONITORAUDIOLEVEL_H
 
-#include "scopewidget.h"
-#include <QWidget>
+#include "lib/audio/audioBlock.h"
 
-namespace Mlt {
-    class Profile;
-    class Filter;
-};
+#include <QWidget>
 
-class MonitorAudioLevel : public ScopeWidget
+class MonitorAudioLevel : public QWidget
 {
     Q_OBJECT
 public:
-    explicit MonitorAudioLevel(Mlt::Profile *profile, int height, QWidget *parent = 0);
+    explicit MonitorAudioLevel(int height, QWidget *parent = 0);
     virtual ~MonitorAudioLevel();
     void refreshPixmap();
     int audioChannels;
-    bool isValid;
     void setVisibility(bool enable);
 
+public slots:
+    /** @brief Shows the levels of a new frame, read from the peaks measured in the block. */
+    void setAudioBlock(const AudioBlock &block);
+
 protected:
     void paintEvent(QPaintEvent*) Q_DECL_OVERRIDE;
     void resizeEvent ( QResizeEvent * event ) Q_DECL_OVERRIDE;
 
 private:
-    Mlt::Filter* m_filter;
     int m_height;
     QPixmap m_pixmap;
     QVector <int> m_peaks;
@@ -56,9 +54,6 @@ private:
     int m_channelDistance;
     int m_channelFillHeight;
     void drawBackground(int channels = 2);
-    void refreshScope(const QSize& size, bool full) Q_DECL_OVERRIDE;
-
-private slots:
     void setAudioValues(const QVector <int>& values);
 };
 
@@ -39,7 +39,8 @@
 
   Frames are received by the onNewFrame() slot. The ScopeWidget automatically
   places new frames in the DataQueue (m_queue). Subclasses shall implement the
-  refreshScope() function and can check for new frames in m_queue.
+  refreshScope() function and can take new frames from m_queue with tryPop().
+  m_queue is lock-free, so delivering a frame never waits for a refresh in progress.
 
   refreshScope() is run from a separate thread. Therefore, any members that are
   accessed by both the worker thread (refreshScope) and the GUI thread
@@ -162,6 +162,9 @@ void SmallRuler::mouseReleaseEvent(QMouseEvent * event)
     if (m_activeControl == CONTROL_IN || m_activeControl == CONTROL_OUT) {
         prepareZoneUpdate();
     }
+    else if (m_activeControl == CONTROL_HEAD && m_lastSeekPosition != SEEK_INACTIVE) {
+        m_render->seekToFrame(m_lastSeekPosition);
+    }
 }
 
 void SmallRuler::prepareZoneUpdate()
@@ -192,7 +195,8 @@ void SmallRuler::mouseMoveEvent(QMouseEvent * event)
             m_lastSeekPosition = pos;
         }
 	else if (pos != m_lastSeekPosition && pos != m_cursorFramePosition) {
-	    m_render->seekToFrame(pos);
+	    // Keyframes decode fastest, the exact frame is shown on release
+	    m_monitor->scrubToFrame(pos);
 	    m_lastSeekPosition = pos;
 	}
 	update();
@@ -41,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDesktopServices>
 #include <QTreeWidget>
 #include <QPushButton>
+#include <QDirIterator>
 
 static QList <QColor> chartColors;
 
@@ -217,10 +218,22 @@ void TemporaryData::updateDataInfo()
         m_currentPage->setEnabled(false);
         return;
     }
+    // The project folder only holds the preview scene, the rendered chunks are in a folder shared by all projects
+    m_projectPreviewSize = 0;
     preview = m_doc->getCacheDir(CachePreview, &ok);
+    if (ok) {
+        QDirIterator it(preview.absolutePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            m_projectPreviewSize += it.fileInfo().size();
+        }
+    }
+    preview = m_doc->getCacheDir(CachePreviewChunks, &ok);
     if (ok) {
         KIO::DirectorySizeJob *job = KIO::directorySize(QUrl::fromLocalFile(preview.absolutePath()));
         connect(job, &KIO::DirectorySizeJob::result, this, &TemporaryData::gotPreviewSize);
+    } else {
+        gotPreviewSize(NULL);
     }
 
     preview = m_doc->getCacheDir(CacheProxy, &ok);
@@ -250,10 +263,10 @@ void TemporaryData::updateDataInfo()
 
 void TemporaryData::gotPreviewSize(KJob *job)
 {
+    qulonglong total = m_projectPreviewSize;
     KIO::DirectorySizeJob *sourceJob = static_cast<KIO::DirectorySizeJob *> (job);
-    qulonglong total = sourceJob->totalSize();
-    if (sourceJob->totalFiles() == 0) {
-        total = 0;
+    if (sourceJob && sourceJob->totalFiles() > 0) {
+        total += sourceJob->totalSize();
     }
     QLayoutItem *button = m_grid->itemAtPosition(0, 4);
     if (button && button->widget()) {
@@ -336,13 +349,23 @@ void TemporaryData::deletePreview()
     if (!ok) {
         return;
     }
-    if (KMessageBox::warningContinueCancel(this, i18n("Delete all data in the cache folder:\n%1", dir.absolutePath())) != KMessageBox::Continue) {
+    bool chunksOk = false;
+    QDir chunkDir = m_doc->getCacheDir(CachePreviewChunks, &chunksOk);
+    QString message = i18n("Delete all data in the cache folder:\n%1", dir.absolutePath());
+    if (chunksOk) {
+        message = i18n("Delete all data in the cache folder:\n%1\nand the timeline preview chunks of all projects in:\n%2", dir.absolutePath(), chunkDir.absolutePath());
+    }
+    if (KMessageBox::warningContinueCancel(this, message) != KMessageBox::Continue) {
             return;
     }
     if (dir.dirName() == QLatin1String("preview")) {
+        emit disablePreview();
         dir.removeRecursively();
         dir.mkpath(".");
-        emit disablePreview();
+        if (chunksOk && chunkDir.dirName() == QLatin1String("timelinepreview")) {
+            chunkDir.removeRecursively();
+            chunkDir.mkpath(".");
+        }
         updateDataInfo();
     }
 }
@@ -492,6 +515,10 @@ void TemporaryData::updateGlobalInfo()
     m_globalDirectories.clear();
     m_processingDirectory.clear();
     m_globalDirectories = m_globalDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    // Shared preview chunks are managed from the current project page, they do not belong to a project
+    m_globalDirectories.removeAll(QStringLiteral("timelinepreview"));
+    // Media probe results are shared by all projects and pruned when they are no longer valid
+    m_globalDirectories.removeAll(QStringLiteral("probe"));
     processglobalDirectories();
     m_listWidget->blockSignals(false);
 }
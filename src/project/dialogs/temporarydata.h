@@ -106,6 +106,8 @@ private:
     QTreeWidget *m_listWidget;
     QGridLayout *m_grid;
     qulonglong m_totalCurrent;
+    /** @brief Size of the project's preview folder, added to the size of the shared preview chunks. */
+    qulonglong m_projectPreviewSize;
     qulonglong m_totalGlobal;
     QList <qulonglong> mCurrentSizes;
     QList <qulonglong> mGlobalSizes;
@@ -30,6 +30,7 @@ AbstractClipJob::AbstractClipJob(JOBTYPE type, ClipType cType, const QString &id
         clipType(cType),
         jobType(type),
         replaceClip(false),
+        priority(0),
         m_jobStatus(NoJob),
         m_clipId(id),
         m_addClipToProject(-100),
@@ -105,6 +106,12 @@ bool AbstractClipJob::isExclusive()
     return true;
 }
 
+AbstractClipJob::JOBRESOURCE AbstractClipJob::resource() const
+{
+    return ENCODERESOURCE;
+}
 
-
-
+QList <AbstractClipJob::JOBTYPE> AbstractClipJob::dependencies() const
+{
+    return QList <JOBTYPE>();
+}
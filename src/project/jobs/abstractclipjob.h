@@ -47,12 +47,20 @@ public:
         THUMBJOB = 5,
         ANALYSECLIPJOB = 6
     };
+    /** @brief What a job mostly uses. The job manager limits the running jobs of each resource separately. */
+    enum JOBRESOURCE {
+        ENCODERESOURCE = 0,
+        COPYRESOURCE = 1,
+        ANALYSISRESOURCE = 2
+    };
     AbstractClipJob(JOBTYPE type, ClipType cType, const QString &id);
     virtual ~ AbstractClipJob();
     ClipType clipType;
     JOBTYPE jobType;
     QString description;
     bool replaceClip;
+    /** @brief Waiting jobs with a higher priority start first. */
+    int priority;
     const QString clipId() const;
     const QString errorMessage() const;
     const QString logDetails() const;
@@ -65,6 +73,10 @@ public:
     virtual const QString statusMessage();
     /** @brief Returns true if only one instance of this job can be run on a clip. */
     virtual bool isExclusive();
+    /** @brief Returns the resource this job is limited by, encoding by default. */
+    virtual JOBRESOURCE resource() const;
+    /** @brief Returns the job types that must be finished on the same clip before this job starts. */
+    virtual QList <JOBTYPE> dependencies() const;
     int addClipToProject() const;
     void setAddClipToProject(int add);
     
@@ -219,6 +219,29 @@ bool CutClipJob::isExclusive()
     return false;
 }
 
+AbstractClipJob::JOBRESOURCE CutClipJob::resource() const
+{
+    switch (jobType) {
+        case AbstractClipJob::CUTJOB:
+            // Cuts copy the streams by default
+            return COPYRESOURCE;
+        case AbstractClipJob::ANALYSECLIPJOB:
+            return ANALYSISRESOURCE;
+        default:
+            return ENCODERESOURCE;
+    }
+}
+
+QList <AbstractClipJob::JOBTYPE> CutClipJob::dependencies() const
+{
+    QList <JOBTYPE> jobs;
+    if (jobType == AbstractClipJob::ANALYSECLIPJOB) {
+        // Analyse the clip once it is cut
+        jobs << AbstractClipJob::CUTJOB;
+    }
+    return jobs;
+}
+
 // static 
 QList <ProjectClip *> CutClipJob::filterClips(QList <ProjectClip *>clips, const QStringList &params)
 {
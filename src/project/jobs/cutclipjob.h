@@ -51,6 +51,8 @@ public:
     stringMap cancelProperties();
     const QString statusMessage();
     bool isExclusive();
+    JOBRESOURCE resource() const;
+    QList <JOBTYPE> dependencies() const;
     static QHash <ProjectClip *, AbstractClipJob *> prepareTranscodeJob(double fps, QList <ProjectClip *> ids,  QStringList parameters);
     static QHash <ProjectClip *, AbstractClipJob *> prepareCutClipJob(double fps, double originalFps, ProjectClip *clip);
     static QHash <ProjectClip *, AbstractClipJob *> prepareAnalyseJob(double fps, QList <ProjectClip*> clips, QStringList parameters);
@@ -90,6 +90,7 @@ void JobManager::discardJobs(const QString &id, AbstractClipJob::JOBTYPE type)
             m_jobList.at(i)->setStatus(JobAborted);
         }
     }
+    lock.unlock();
     emit updateJobStatus(id, type, JobAborted);
     updateJobCount();
 }
@@ -118,72 +119,144 @@ void JobManager::slotCheckJobProcess()
                 m_jobThreads.addFuture(futures.at(i));
             }
     }
-    if (m_jobList.isEmpty()) return;
+    if (m_jobList.isEmpty() || m_abortAllJobs) return;
 
+    QList <AbstractClipJob *> started;
     m_jobMutex.lock();
-    int count = 0;
     for (int i = 0; i < m_jobList.count(); ++i) {
-        if (m_jobList.at(i)->status() == JobWorking || m_jobList.at(i)->status() == JobWaiting) {
-            count ++;
-        } else {
+        AbstractClipJob *job = m_jobList.at(i);
+        if (job->status() != JobWorking && job->status() != JobWaiting && !m_runningJobs.contains(job)) {
             // remove finished jobs
-            AbstractClipJob *job = m_jobList.takeAt(i);
+            m_jobList.removeAt(i);
             job->deleteLater();
             --i;
         }
     }
+    // Jobs still holding a thread, even if they were aborted
+    QHash <int, int> running;
+    foreach (AbstractClipJob *job, m_runningJobs) {
+        running[job->resource()]++;
+    }
+    const QList <AbstractClipJob *> jobs = sortedJobs();
+    for (int i = 0; i < jobs.count(); ++i) {
+        AbstractClipJob *job = jobs.at(i);
+        if (job->status() != JobWaiting) {
+            continue;
+        }
+        const AbstractClipJob::JOBRESOURCE resource = job->resource();
+        if (running.value(resource) >= resourceLimit(resource) || isBlocked(job)) {
+            continue;
+        }
+        job->setStatus(JobWorking);
+        m_runningJobs.insert(job);
+        running[resource]++;
+        started << job;
+    }
     m_jobMutex.unlock();
-    emit jobCount(count);
-    if (m_jobThreads.futures().isEmpty() || m_jobThreads.futures().count() < KdenliveSettings::proxythreads()) m_jobThreads.addFuture(QtConcurrent::run(this, &JobManager::slotProcessJobs));
+    updateJobCount();
+    // The limits may have changed in the settings, one thread per job that may run
+    m_threadPool.setMaxThreadCount(resourceLimit(AbstractClipJob::ENCODERESOURCE) + resourceLimit(AbstractClipJob::COPYRESOURCE)
+                                   + resourceLimit(AbstractClipJob::ANALYSISRESOURCE));
+    foreach (AbstractClipJob *job, started) {
+        m_jobThreads.addFuture(QtConcurrent::run(&m_threadPool, this, &JobManager::processJob, job));
+    }
+}
+
+QList <AbstractClipJob *> JobManager::sortedJobs() const
+{
+    QList <AbstractClipJob *> jobs;
+    for (int i = 0; i < m_jobList.count(); ++i) {
+        AbstractClipJob *job = m_jobList.at(i);
+        if (job->status() != JobWaiting && job->status() != JobWorking) {
+            continue;
+        }
+        // Keep the queue order among jobs of the same priority
+        int pos = jobs.count();
+        while (pos > 0 && jobs.at(pos - 1)->priority < job->priority) {
+            --pos;
+        }
+        jobs.insert(pos, job);
+    }
+    return jobs;
+}
+
+bool JobManager::isBlocked(AbstractClipJob *job) const
+{
+    const QList <AbstractClipJob::JOBTYPE> dependencies = job->dependencies();
+    if (dependencies.isEmpty()) {
+        return false;
+    }
+    for (int i = 0; i < m_jobList.count(); ++i) {
+        AbstractClipJob *other = m_jobList.at(i);
+        if (other != job && other->clipId() == job->clipId() && dependencies.contains(other->jobType)
+                && (other->status() == JobWaiting || other->status() == JobWorking)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int JobManager::resourceLimit(AbstractClipJob::JOBRESOURCE resource)
+{
+    switch (resource) {
+        case AbstractClipJob::COPYRESOURCE:
+            return qMax(1, KdenliveSettings::copyjobthreads());
+        case AbstractClipJob::ANALYSISRESOURCE:
+            return qMax(1, KdenliveSettings::analysisjobthreads());
+        default:
+            return qMax(1, KdenliveSettings::proxythreads());
+    }
+}
+
+QList <JobManager::JobState> JobManager::queueState()
+{
+    QList <JobState> result;
+    QMutexLocker lock(&m_jobMutex);
+    const QList <AbstractClipJob *> jobs = sortedJobs();
+    for (int i = 0; i < jobs.count(); ++i) {
+        AbstractClipJob *job = jobs.at(i);
+        JobState state;
+        state.clipId = job->clipId();
+        state.type = job->jobType;
+        state.resource = job->resource();
+        state.status = job->status();
+        state.priority = job->priority;
+        state.description = job->description;
+        state.blocked = job->status() == JobWaiting && isBlocked(job);
+        result << state;
+    }
+    return result;
 }
 
 void JobManager::updateJobCount()
 {
     int count = 0;
+    m_jobMutex.lock();
     for (int i = 0; i < m_jobList.count(); ++i) {
         if (m_jobList.at(i)->status() == JobWaiting || m_jobList.at(i)->status() == JobWorking)
             count ++;
     }
+    m_jobMutex.unlock();
     // Set jobs count
     emit jobCount(count);
+    emit queueChanged();
 }
 
-void JobManager::slotProcessJobs()
+void JobManager::processJob(AbstractClipJob *job)
 {
-    bool firstPass = true;
-    while (!m_jobList.isEmpty() && !m_abortAllJobs) {
-        AbstractClipJob *job = NULL;
-        m_jobMutex.lock();
-        for (int i = 0; i < m_jobList.count(); ++i) {
-            if (m_jobList.at(i)->status() == JobWaiting) {
-                job = m_jobList.at(i);
-                job->setStatus(JobWorking);
-                break;
-            }
-        }
-        if (!firstPass) {
-            updateJobCount();
-        }
-        m_jobMutex.unlock();
-
-        if (job == NULL) {
-            break;
-        }
-        firstPass = false;
-        QString destination = job->destination();
-        // Check if the clip is still here
-        ProjectClip *currentClip = m_bin->getBinClip(job->clipId());
-        if (currentClip == NULL) {
-            job->setStatus(JobDone);
-            continue;
-        }
+    QString destination = job->destination();
+    // Check if the clip is still here
+    ProjectClip *currentClip = m_abortAllJobs ? NULL : m_bin->getBinClip(job->clipId());
+    if (currentClip == NULL) {
+        job->setStatus(JobDone);
+    } else {
         // Set clip status to started
         currentClip->setJobStatus(job->jobType, job->status());
-
         // Make sure destination path is writable
+        bool writable = true;
         if (!destination.isEmpty()) {
             QFileInfo file(destination);
-            bool writable = false;
+            writable = false;
             if (file.exists()) {
                 if (file.isWritable())
                     writable = true;
@@ -196,34 +269,37 @@ void JobManager::slotProcessJobs()
                     writable = dinfo.isWritable();
                 }
             }
-            if (!writable) {
-                emit updateJobStatus(job->clipId(), job->jobType, JobCrashed, i18n("Cannot write to path: %1", destination));
-                job->setStatus(JobCrashed);
-                continue;
-            }
         }
-        connect(job, SIGNAL(jobProgress(QString,int,int)), this, SIGNAL(processLog(QString,int,int)));
-        connect(job, SIGNAL(cancelRunningJob(QString,QMap<QString, QString>)), m_bin, SLOT(slotCancelRunningJob(QString,QMap<QString, QString>)));
+        if (!writable) {
+            emit updateJobStatus(job->clipId(), job->jobType, JobCrashed, i18n("Cannot write to path: %1", destination));
+            job->setStatus(JobCrashed);
+        } else if (job->status() == JobWorking) {
+            connect(job, SIGNAL(jobProgress(QString,int,int)), this, SIGNAL(processLog(QString,int,int)));
+            connect(job, SIGNAL(cancelRunningJob(QString,QMap<QString, QString>)), m_bin, SLOT(slotCancelRunningJob(QString,QMap<QString, QString>)));
 
-        if (job->jobType == AbstractClipJob::MLTJOB || job->jobType == AbstractClipJob::ANALYSECLIPJOB) {
-            connect(job, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)), this, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)));
-        }
-        job->startJob();
-        if (job->status() == JobDone) {
-            emit updateJobStatus(job->clipId(), job->jobType, JobDone);
-            //TODO: replace with more generic clip replacement framework
-            if (job->jobType == AbstractClipJob::PROXYJOB) {
-                m_bin->gotProxy(job->clipId(), destination);
+            if (job->jobType == AbstractClipJob::MLTJOB || job->jobType == AbstractClipJob::ANALYSECLIPJOB) {
+                connect(job, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)), this, SIGNAL(gotFilterJobResults(QString,int,int,stringMap,stringMap)));
             }
-            else if (job->addClipToProject() > -100) {
-                emit addClip(destination, job->addClipToProject());
+            job->startJob();
+            if (job->status() == JobDone) {
+                emit updateJobStatus(job->clipId(), job->jobType, JobDone);
+                //TODO: replace with more generic clip replacement framework
+                if (job->jobType == AbstractClipJob::PROXYJOB) {
+                    m_bin->gotProxy(job->clipId(), destination);
+                }
+                else if (job->addClipToProject() > -100) {
+                    emit addClip(destination, job->addClipToProject());
+                }
+            } else if (job->status() == JobCrashed || job->status() == JobAborted) {
+                emit updateJobStatus(job->clipId(), job->jobType, job->status(), job->errorMessage(), QString(), job->logDetails());
             }
-        } else if (job->status() == JobCrashed || job->status() == JobAborted) {
-            emit updateJobStatus(job->clipId(), job->jobType, job->status(), job->errorMessage(), QString(), job->logDetails());
         }
     }
-    // Thread finished, cleanup & update count
-    QTimer::singleShot(200, this, SIGNAL(checkJobProcess()));
+    m_jobMutex.lock();
+    m_runningJobs.remove(job);
+    m_jobMutex.unlock();
+    // Queued to the manager's thread, cleans up and starts the next jobs
+    emit checkJobProcess();
 }
 
 QList <ProjectClip *> JobManager::filterClips(QList <ProjectClip *>clips, AbstractClipJob::JOBTYPE jobType, const QStringList &params)
@@ -243,6 +319,8 @@ void JobManager::prepareJobFromTimeline(ProjectClip *clip, const QMap<QString,QS
 {
     MeltJob *job = new MeltJob(clip->clipType(), clip->clipId(), producerParams, filterParams, consumerParams, extraParams);
     job->description = i18n("Filter %1", extraParams.value("finalfilter"));
+    // Requested from the timeline, the user is waiting for it
+    job->priority = 1;
     launchJob(clip, job);
 }
 
@@ -274,7 +352,7 @@ void JobManager::prepareJobs(QList <ProjectClip *>clips, double fps, AbstractCli
             i.next();
             launchJob(i.key(), i.value(), false);
         }
-        slotCheckJobProcess();
+        emit checkJobProcess();
     }
 }
 
@@ -286,10 +364,12 @@ void JobManager::launchJob(ProjectClip *clip, AbstractClipJob *job, bool runQueu
         return;
     }
 
+    m_jobMutex.lock();
     m_jobList.append(job);
+    m_jobMutex.unlock();
     clip->setJobStatus(job->jobType, JobWaiting, 0, job->statusMessage());
     if (runQueue) {
-        slotCheckJobProcess();
+        emit checkJobProcess();
     }
 }
 
@@ -316,6 +396,7 @@ void JobManager::slotCancelPendingJobs()
             emit updateJobStatus(m_jobList.at(i)->clipId(), m_jobList.at(i)->jobType, JobAborted);
         }
     }
+    lock.unlock();
     updateJobCount();
 }
 
@@ -349,7 +430,9 @@ void JobManager::slotCancelJobs()
     */
     if (!m_jobList.isEmpty()) qDeleteAll(m_jobList);
     m_jobList.clear();
+    m_runningJobs.clear();
     m_abortAllJobs = false;
     emit jobCount(0);
+    emit queueChanged();
 }
 
@@ -27,7 +27,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QObject>
 #include <QMutex>
+#include <QSet>
 #include <QFutureSynchronizer>
+#include <QThreadPool>
 
 class AbstractClipJob;
 class Bin;
@@ -37,6 +39,13 @@ class ProjectClip;
  * @class JobManager
  * @brief This class is responsible for clip jobs management.
  *
+ * Each job is limited by a resource (encoding, stream copy or analysis), and
+ * each resource has its own count of concurrent jobs. Among the waiting jobs
+ * whose resource is free, the one with the highest priority starts first, in
+ * the order they were queued. A job does not start while a job it depends on
+ * is pending on the same clip, so filter jobs wait for the clip's proxy and a
+ * clip is cut before being analysed. The queue is checked again whenever a
+ * job is added or a job thread returns.
  */
 
 class JobManager : public QObject
@@ -93,9 +102,24 @@ public:
     /** @brief Get the list of job names for current clip. */
     QStringList getPendingJobs(const QString &id);
 
+    /** @brief State of a queued or running job, for a job monitor. */
+    struct JobState
+    {
+        QString clipId;
+        AbstractClipJob::JOBTYPE type;
+        AbstractClipJob::JOBRESOURCE resource;
+        ClipJobStatus status;
+        int priority;
+        QString description;
+        /** True if the job waits for another job on the same clip */
+        bool blocked;
+    };
+    /** @brief Returns the pending and running jobs, in the order they will start. */
+    QList <JobState> queueState();
+
 private slots:
+    /** @brief Removes finished jobs and starts the waiting jobs that can run. */
     void slotCheckJobProcess();
-    void slotProcessJobs();
     void slotProcessLog(const QString &id, int progress, int type, const QString &message);
 
 public slots:
@@ -115,12 +139,24 @@ private:
     QList <AbstractClipJob *> m_jobList;
     /** @brief Holds the threads running a job. */
     QFutureSynchronizer<void> m_jobThreads;
+    /** @brief Threads of the jobs, so that long jobs never wait for or hold up the global pool. */
+    QThreadPool m_threadPool;
+    /** @brief Jobs whose thread has not returned yet, they cannot be deleted. */
+    QSet <AbstractClipJob *> m_runningJobs;
     /** @brief Set to true to trigger abortion of all jobs. */
     bool m_abortAllJobs;
     /** @brief Create a proxy for a clip. */
     void createProxy(const QString &id);
-    /** @brief Update job count in info widget. */
+    /** @brief Update job count in info widget, call without the mutex locked. */
     void updateJobCount();
+    /** @brief Runs a job in a worker thread. */
+    void processJob(AbstractClipJob *job);
+    /** @brief Returns the waiting and running jobs sorted by priority, call with the mutex locked. */
+    QList <AbstractClipJob *> sortedJobs() const;
+    /** @brief Returns true if a job that @param job depends on is pending, call with the mutex locked. */
+    bool isBlocked(AbstractClipJob *job) const;
+    /** @brief Returns the number of jobs of a resource that can run at once. */
+    static int resourceLimit(AbstractClipJob::JOBRESOURCE resource);
 
 signals:
     void addClip(const QString, int folderId);
@@ -129,6 +165,8 @@ signals:
     void gotFilterJobResults(QString,int,int,stringMap,stringMap);
     void jobCount(int);
     void checkJobProcess();
+    /** @brief Emitted when a job was queued, started, finished or discarded. */
+    void queueChanged();
 };
 
 #endif
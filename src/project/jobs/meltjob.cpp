@@ -274,5 +274,12 @@ void MeltJob::setStatus(ClipJobStatus status)
     if (status == JobAborted && m_consumer) m_consumer->stop();
 }
 
+AbstractClipJob::JOBRESOURCE MeltJob::resource() const
+{
+    return ANALYSISRESOURCE;
+}
 
-
+QList <AbstractClipJob::JOBTYPE> MeltJob::dependencies() const
+{
+    return QList <JOBTYPE>() << AbstractClipJob::PROXYJOB;
+}
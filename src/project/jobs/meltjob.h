@@ -70,6 +70,10 @@ public:
     void setStatus(ClipJobStatus status);
     /** @brief Here we will send the current progress info to anyone interested. */
     void emitFrameNumber(int pos);
+    /** @brief MLT filter jobs are limited as analysis jobs. */
+    JOBRESOURCE resource() const;
+    /** @brief A filter job waits for the proxy of its clip. */
+    QList <JOBTYPE> dependencies() const;
     
 private:
     Mlt::Consumer *m_consumer;
@@ -24,15 +24,50 @@
 #include "bin/projectclip.h"
 #include "bin/bin.h"
 #include <QProcess>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
+#include <QTextStream>
+#include <QThread>
 
 #include <QDebug>
 #include <klocalizedstring.h>
 
+namespace {
+    // Shortest segment worth its own encoding process, in seconds
+    const double minimumSegment = 60;
+
+    /** Number of segments encoded at once, sharing the cores with the other proxy jobs */
+    int segmentProcesses()
+    {
+        return QThread::idealThreadCount() / qMax(1, KdenliveSettings::proxythreads());
+    }
+
+    /** Seconds in the last time= field of an FFmpeg log, -1 if there is none */
+    double lastEncodedTime(const QString &log)
+    {
+        if (!log.contains(QLatin1String("time="))) {
+            return -1;
+        }
+        const QString time = log.section(QStringLiteral("time="), -1).simplified().section(QLatin1Char(' '), 0, 0);
+        if (time.contains(QLatin1Char(':'))) {
+            const QStringList numbers = time.split(QLatin1Char(':'));
+            if (numbers.count() == 3) {
+                return numbers.at(0).toInt() * 3600 + numbers.at(1).toInt() * 60 + numbers.at(2).toDouble();
+            }
+            return -1;
+        }
+        return time.toDouble();
+    }
+}
+
 ProxyJob::ProxyJob(ClipType cType, const QString &id, const QStringList& parameters, QTemporaryFile *playlist)
     : AbstractClipJob(PROXYJOB, cType, id),
       m_jobDuration(0),
-      m_isFfmpegJob(true)
+      m_isFfmpegJob(true),
+      m_sourceDuration(0),
+      m_videoIndex(-1),
+      m_hasAudio(true),
+      m_abortProbe(false)
 {
     m_jobStatus = JobWaiting;
     description = i18n("proxy");
@@ -152,22 +187,10 @@ void ProxyJob::startJob()
         return;
     } else {
         m_isFfmpegJob = true;
-        QStringList parameters;
-        if (m_proxyParams.contains(QStringLiteral("-noautorotate"))) {
-            // The noautorotate flag must be passed before input source
-            parameters << QStringLiteral("-noautorotate");
-        }
-        parameters << QStringLiteral("-i") << m_src;
-        QString params = m_proxyParams;
-        foreach(const QString &s, params.split(QLatin1Char(' '))) {
-            if (s != QLatin1String("-noautorotate")) {
-                parameters << s;
-            }
+        if (startSegmentedJob()) {
+            return;
         }
-
-        // Make sure we don't block when proxy file already exists
-        parameters << QStringLiteral("-y");
-        parameters << m_dest;
+        QStringList parameters = encodeParameters(QStringList(), QStringList(), m_dest);
         m_jobProcess = new QProcess;
         m_jobProcess->setProcessChannelMode(QProcess::MergedChannels);
         m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
@@ -206,9 +229,284 @@ void ProxyJob::startJob()
     return;
 }
 
+QStringList ProxyJob::encodeParameters(const QStringList &inputOptions, const QStringList &outputOptions, const QString &output) const
+{
+    QStringList parameters;
+    if (m_proxyParams.contains(QStringLiteral("-noautorotate"))) {
+        // The noautorotate flag must be passed before input source
+        parameters << QStringLiteral("-noautorotate");
+    }
+    parameters << inputOptions;
+    parameters << QStringLiteral("-i") << m_src;
+    foreach(const QString &s, m_proxyParams.split(QLatin1Char(' '))) {
+        if (s != QLatin1String("-noautorotate")) {
+            parameters << s;
+        }
+    }
+    parameters << outputOptions;
+
+    // Make sure we don't block when proxy file already exists
+    parameters << QStringLiteral("-y");
+    parameters << output;
+    return parameters;
+}
+
+QString ProxyJob::segmentFormat() const
+{
+    const QStringList params = m_proxyParams.split(QLatin1Char(' '), QString::SkipEmptyParts);
+    // Options working on the whole stream cannot be applied to each segment
+    const QStringList wholeStream = QStringList() << QStringLiteral("-pass") << QStringLiteral("-passlogfile") << QStringLiteral("-filter_complex")
+                                                  << QStringLiteral("-ss") << QStringLiteral("-t") << QStringLiteral("-to")
+                                                  << QStringLiteral("-itsoffset") << QStringLiteral("-shortest") << QStringLiteral("-map");
+    foreach(const QString &option, wholeStream) {
+        if (params.contains(option)) {
+            return QString();
+        }
+    }
+    QString format;
+    const int formatIndex = params.indexOf(QStringLiteral("-f"));
+    if (formatIndex >= 0 && formatIndex + 1 < params.count()) {
+        format = params.at(formatIndex + 1);
+    } else {
+        const QString suffix = QFileInfo(m_dest).suffix().toLower();
+        if (suffix == QLatin1String("mkv")) {
+            format = QStringLiteral("matroska");
+        } else if (suffix == QLatin1String("ts")) {
+            format = QStringLiteral("mpegts");
+        } else if (suffix == QLatin1String("mpg")) {
+            format = QStringLiteral("mpeg");
+        } else {
+            format = suffix;
+        }
+    }
+    // Containers the concat demuxer joins without re-encoding
+    const QStringList joinable = QStringList() << QStringLiteral("matroska") << QStringLiteral("webm") << QStringLiteral("mp4")
+                                               << QStringLiteral("mov") << QStringLiteral("mpegts") << QStringLiteral("mpeg");
+    return joinable.contains(format) ? format : QString();
+}
+
+QList <double> ProxyJob::segmentStarts()
+{
+    QList <double> starts;
+    const int minDuration = KdenliveSettings::proxysegmentduration();
+    if (minDuration <= 0 || m_sourceDuration < minDuration || m_sourceDuration < 2 * minimumSegment
+            || segmentProcesses() < 2 || segmentFormat().isEmpty()) {
+        return starts;
+    }
+    if (m_keyframes.isEmpty()) {
+        m_keyframes = KeyframeIndex::probe(KdenliveSettings::ffprobepath(), m_src, m_videoIndex, &m_abortProbe);
+    }
+    const QVector<qint64> &times = m_keyframes.times();
+    // Two segments per process even out their encoding speeds
+    const int segments = qMin(2 * segmentProcesses(), (int) (m_sourceDuration / minimumSegment));
+    if (times.count() < 2 || segments < 2) {
+        return starts;
+    }
+    // Segments start on the first keyframe after an even split of the clip
+    starts << 0;
+    int keyframe = 0;
+    for (int i = 1; i < segments; ++i) {
+        const double target = m_sourceDuration * i / segments;
+        while (keyframe < times.count() && times.at(keyframe) / 1000000.0 < target) {
+            ++keyframe;
+        }
+        if (keyframe == times.count()) {
+            break;
+        }
+        const double start = times.at(keyframe) / 1000000.0;
+        if (start - starts.last() >= minimumSegment / 2 && m_sourceDuration - start >= minimumSegment / 2) {
+            starts << start;
+        }
+    }
+    if (starts.count() < 2) {
+        starts.clear();
+    }
+    return starts;
+}
+
+bool ProxyJob::startSegmentedJob()
+{
+    const QList <double> starts = segmentStarts();
+    if (m_jobStatus == JobAborted) {
+        emit cancelRunningJob(m_clipId, cancelProperties());
+        return true;
+    }
+    if (starts.isEmpty()) {
+        return false;
+    }
+    QTemporaryDir folder(QFileInfo(m_dest).absolutePath() + QStringLiteral("/segments-XXXXXX"));
+    if (!folder.isValid()) {
+        return false;
+    }
+    const QString suffix = QFileInfo(m_dest).suffix();
+    QList <QStringList> arguments;
+    QStringList segments;
+    m_segmentLengths.clear();
+    for (int i = 0; i < starts.count(); ++i) {
+        const bool last = i + 1 == starts.count();
+        const double length = (last ? m_sourceDuration : starts.at(i + 1)) - starts.at(i);
+        QStringList inputOptions;
+        if (i > 0) {
+            // Seeking to a keyframe, nothing is decoded twice
+            inputOptions << QStringLiteral("-ss") << QString::number(starts.at(i), 'f', 6);
+        }
+        QStringList outputOptions;
+        if (!last) {
+            outputOptions << QStringLiteral("-t") << QString::number(length, 'f', 6);
+        }
+        outputOptions << QStringLiteral("-an");
+        const QString path = folder.path() + QStringLiteral("/segment-%1.").arg(i) + suffix;
+        arguments << encodeParameters(inputOptions, outputOptions, path);
+        segments << path;
+        m_segmentLengths << length;
+    }
+    QString audioPath;
+    if (m_hasAudio) {
+        // Audio is encoded in one piece, so that no encoder delay is inserted at the joins
+        audioPath = folder.path() + QStringLiteral("/audio.") + suffix;
+        arguments << encodeParameters(QStringList(), QStringList() << QStringLiteral("-vn"), audioPath);
+        m_segmentLengths << m_sourceDuration;
+    }
+    m_segmentProgress.fill(0, m_segmentLengths.count());
+
+    const int processes = segmentProcesses();
+    int next = 0;
+    bool failed = false;
+    while (!failed && m_jobStatus != JobAborted) {
+        int running = 0;
+        for (int i = 0; i < m_segmentProcesses.count(); ++i) {
+            QProcess *process = m_segmentProcesses.at(i);
+            if (process->state() != QProcess::NotRunning) {
+                running++;
+            } else if (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0) {
+                failed = true;
+            }
+        }
+        if (failed || (running == 0 && next == arguments.count())) {
+            break;
+        }
+        while (running < processes && next < arguments.count()) {
+            QProcess *process = new QProcess;
+            process->setProcessChannelMode(QProcess::MergedChannels);
+            process->start(KdenliveSettings::ffmpegpath(), arguments.at(next), QIODevice::ReadOnly);
+            if (!process->waitForStarted()) {
+                failed = true;
+            }
+            m_segmentProcesses << process;
+            next++;
+            running++;
+        }
+        processLogInfo();
+        for (int i = 0; i < m_segmentProcesses.count(); ++i) {
+            if (m_segmentProcesses.at(i)->state() != QProcess::NotRunning) {
+                m_segmentProcesses.at(i)->waitForFinished(400);
+                break;
+            }
+        }
+    }
+    processLogInfo();
+    foreach(QProcess *process, m_segmentProcesses) {
+        if (process->state() != QProcess::NotRunning) {
+            process->kill();
+            process->waitForFinished();
+        }
+    }
+    qDeleteAll(m_segmentProcesses);
+    m_segmentProcesses.clear();
+    if (m_jobStatus == JobAborted) {
+        emit cancelRunningJob(m_clipId, cancelProperties());
+        return true;
+    }
+    QStringList outputs = segments;
+    if (!audioPath.isEmpty()) {
+        outputs << audioPath;
+    }
+    foreach(const QString &path, outputs) {
+        if (QFileInfo(path).size() == 0) {
+            failed = true;
+        }
+    }
+    if (failed) {
+        qDebug() << "Encoding proxy in segments failed, encoding" << m_src << "in one process";
+        return false;
+    }
+
+    // Join the segments without re-encoding
+    QFile list(folder.path() + QStringLiteral("/segments.txt"));
+    if (!list.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QTextStream out(&list);
+    out.setCodec("UTF-8");
+    foreach(QString path, segments) {
+        out << "file '" << path.replace(QLatin1Char('\''), QLatin1String("'\\''")) << "'\n";
+    }
+    out.flush();
+    list.close();
+    QStringList parameters;
+    parameters << QStringLiteral("-f") << QStringLiteral("concat") << QStringLiteral("-safe") << QStringLiteral("0") << QStringLiteral("-i") << list.fileName();
+    if (!audioPath.isEmpty()) {
+        parameters << QStringLiteral("-i") << audioPath << QStringLiteral("-map") << QStringLiteral("0:v") << QStringLiteral("-map") << QStringLiteral("1:a");
+    }
+    parameters << QStringLiteral("-c") << QStringLiteral("copy") << QStringLiteral("-f") << segmentFormat() << QStringLiteral("-y") << m_dest;
+    m_jobProcess = new QProcess;
+    m_jobProcess->setProcessChannelMode(QProcess::MergedChannels);
+    m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
+    m_jobProcess->waitForStarted();
+    while (m_jobProcess->state() != QProcess::NotRunning) {
+        m_logDetails.append(QString::fromUtf8(m_jobProcess->readAll()));
+        if (m_jobStatus == JobAborted) {
+            emit cancelRunningJob(m_clipId, cancelProperties());
+            m_jobProcess->close();
+            m_jobProcess->waitForFinished();
+        }
+        m_jobProcess->waitForFinished(400);
+    }
+    m_logDetails.append(QString::fromUtf8(m_jobProcess->readAll()));
+    const bool joined = m_jobProcess->exitStatus() == QProcess::NormalExit && m_jobProcess->exitCode() == 0;
+    delete m_jobProcess;
+    m_jobProcess = NULL;
+    if (m_jobStatus == JobAborted) {
+        QFile::remove(m_dest);
+        return true;
+    }
+    if (!joined || QFileInfo(m_dest).size() == 0) {
+        QFile::remove(m_dest);
+        qDebug() << "Joining proxy segments failed, encoding" << m_src << "in one process";
+        return false;
+    }
+    emit jobProgress(m_clipId, 100, jobType);
+    setStatus(JobDone);
+    return true;
+}
+
 void ProxyJob::processLogInfo()
 {
-    if (!m_jobProcess || m_jobStatus == JobAborted) return;
+    if (m_jobStatus == JobAborted) return;
+    if (!m_segmentProcesses.isEmpty()) {
+        // Each segment and the audio pass report the time they reached
+        double total = 0;
+        double done = 0;
+        for (int i = 0; i < m_segmentProcesses.count(); ++i) {
+            const QString log = QString::fromUtf8(m_segmentProcesses.at(i)->readAll());
+            if (!log.isEmpty()) {
+                m_logDetails.append(log + QLatin1Char('\n'));
+            }
+            const double time = lastEncodedTime(log);
+            if (time >= 0) {
+                m_segmentProgress[i] = qMin(time, m_segmentLengths.at(i));
+            }
+        }
+        for (int i = 0; i < m_segmentLengths.count(); ++i) {
+            total += m_segmentLengths.at(i);
+            done += m_segmentProgress.at(i);
+        }
+        if (total > 0) {
+            emit jobProgress(m_clipId, (int) (100.0 * done / total), jobType);
+        }
+        return;
+    }
+    if (!m_jobProcess) return;
     QString log = QString::fromUtf8(m_jobProcess->readAll());
     if (!log.isEmpty())
         m_logDetails.append(log + QLatin1Char('\n'));
@@ -248,6 +546,15 @@ ProxyJob::~ProxyJob()
 {
 }
 
+void ProxyJob::setStatus(ClipJobStatus status)
+{
+    m_jobStatus = status;
+    if (status == JobAborted) {
+        // Stops listing the keyframes
+        m_abortProbe = true;
+    }
+}
+
 const QString ProxyJob::destination() const
 {
     return m_dest;
@@ -336,6 +643,16 @@ QHash <ProjectClip *, AbstractClipJob *> ProxyJob::prepareJob(Bin *bin, QList <P
         }
         parameters << path << sourcePath << item->getProducerProperty(QStringLiteral("_exif_orientation")) << params << QString::number(renderSize.width()) << QString::number(renderSize.height());
         ProxyJob *job = new ProxyJob(item->clipType(), id, parameters, playlist);
+        if (item->clipType() == AV || item->clipType() == Video) {
+            // Long clips are encoded in segments, at the source keyframes if they were already listed
+            job->m_sourceDuration = item->duration().seconds();
+            job->m_videoIndex = item->getProducerIntProperty(QStringLiteral("video_index"));
+            job->m_hasAudio = item->clipType() == AV;
+            const int minDuration = KdenliveSettings::proxysegmentduration();
+            if (minDuration > 0 && job->m_sourceDuration >= minDuration) {
+                job->m_keyframes = item->sourceKeyframeIndex();
+            }
+        }
         jobs.insert(item, job);
     }
     return jobs;
@@ -22,6 +22,9 @@
 #define PROXYCLIPJOB
 
 #include "abstractclipjob.h"
+#include "lib/keyframeIndex.h"
+
+#include <QVector>
 
 class QTemporaryFile;
 class Bin;
@@ -39,6 +42,7 @@ public:
     stringMap cancelProperties();
     const QString statusMessage();
     void processLogInfo();
+    void setStatus(ClipJobStatus status);
     static QList <ProjectClip *> filterClips(QList <ProjectClip *>clips);
     static QHash <ProjectClip *, AbstractClipJob *> prepareJob(Bin *bin, QList <ProjectClip *>clips);
 
@@ -52,6 +56,26 @@ private:
     int m_jobDuration;
     bool m_isFfmpegJob;
     QTemporaryFile *m_playlist;
+    /** @brief Duration of the source in seconds, 0 if unknown. */
+    double m_sourceDuration;
+    int m_videoIndex;
+    bool m_hasAudio;
+    /** @brief Keyframes of the source, listed with ffprobe if they were not cached. */
+    KeyframeIndex m_keyframes;
+    bool m_abortProbe;
+    /** @brief Encoding processes of the segments, and the seconds each one has to encode and has encoded. */
+    QList <QProcess *> m_segmentProcesses;
+    QVector <double> m_segmentLengths;
+    QVector <double> m_segmentProgress;
+    /** @brief Returns the FFmpeg arguments encoding the source to @param output with the proxy parameters. */
+    QStringList encodeParameters(const QStringList &inputOptions, const QStringList &outputOptions, const QString &output) const;
+    /** @brief Returns the container of the proxy if it can be joined from segments, empty otherwise. */
+    QString segmentFormat() const;
+    /** @brief Returns the start times of the segments in seconds, empty if the clip should not be split. */
+    QList <double> segmentStarts();
+    /** @brief Encodes the video in segments, the audio on its own, and joins them into the proxy.
+     *  @return false if the proxy must be created by a single process instead */
+    bool startSegmentedJob();
 };
 
 #endif
@@ -33,8 +33,10 @@
 #include "bin/projectclip.h"
 #include "timeline/clip.h"
 #include "monitor/glwidget.h"
+#include "monitor/framecache.h"
 #include "mltcontroller/clipcontroller.h"
 #include "timeline/transitionhandler.h"
+#include "lib/fileHasher.h"
 #include <mlt++/Mlt.h>
 
 #include <QDebug>
@@ -74,10 +76,16 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
     m_isLoopMode(false),
     m_blackClip(NULL),
     m_isActive(false),
-    m_isRefreshing(false)
+    m_isRefreshing(false),
+    m_frameCache(new FrameCache),
+    m_consumerRun(0),
+    m_cacheRun(0),
+    m_cachedPosition(SEEK_INACTIVE),
+    m_lastSeekPosition(0)
 {
     qRegisterMetaType<stringMap> ("stringMap");
     analyseAudio = KdenliveSettings::monitor_audio();
+    m_frameCache->setBudget((qint64) KdenliveSettings::monitorcachesize() * 1024 * 1024);
     //buildConsumer();
     if (m_qmlView) {
         m_blackClip = new Mlt::Producer(*m_qmlView->profile(), "colour:black");
@@ -88,6 +96,7 @@ Render::Render(Kdenlive::MonitorId rendererName, BinController *binController, G
         m_mltProducer = m_blackClip->cut(0, 1);
         m_qmlView->setProducer(m_mltProducer);
         m_mltConsumer = qmlView->consumer();
+        connect(m_qmlView, SIGNAL(frameDisplayed(const SharedFrame&)), this, SLOT(slotCacheFrame(const SharedFrame&)));
     }
     /*m_mltConsumer->connect(*m_mltProducer);
     m_mltProducer->set_speed(0.0);*/
@@ -110,6 +119,8 @@ Render::~Render()
 
 void Render::closeMlt()
 {
+    // Waits for the prefetch worker
+    delete m_frameCache;
     delete m_showFrameEvent;
     delete m_pauseEvent;
     delete m_mltConsumer;
@@ -127,6 +138,9 @@ void Render::prepareProfileReset(double fps)
 {
     m_refreshTimer.stop();
     m_fps = fps;
+    // The prefetch worker must not use the profile while it changes
+    invalidateFrameCache();
+    m_frameCache->waitForPrefetch();
 }
 
 void Render::finishProfileReset()
@@ -161,7 +175,11 @@ void Render::seek(int time)
 {
     resetZoneMode();
     time = qBound(0, time, m_mltProducer->get_length() - 1);
+    prefetchFrames(time);
     if (requestedSeekPosition == SEEK_INACTIVE) {
+        if (showCachedFrame(time)) {
+            return;
+        }
         requestedSeekPosition = time;
         if (m_mltProducer->get_speed() != 0) {
             m_mltConsumer->purge();
@@ -170,7 +188,7 @@ void Render::seek(int time)
         if (!externalConsumer) {
             m_isRefreshing = true;
             if (m_mltConsumer->is_stopped()) {
-                m_mltConsumer->start();
+                startMltConsumer();
             }
             m_mltConsumer->set("refresh", 1);
         }
@@ -315,6 +333,7 @@ void Render::loadUrl(const QString &url)
 
 bool Render::updateProducer(Mlt::Producer *producer)
 {
+    invalidateFrameCache();
     if (m_mltProducer) {
         if (strcmp(m_mltProducer->get("resource"), "<tractor>") == 0) {
             // We need to make some cleanup
@@ -348,6 +367,7 @@ bool Render::setProducer(Mlt::Producer *producer, int position, bool isActive)
     m_refreshTimer.stop();
     requestedSeekPosition = SEEK_INACTIVE;
     QMutexLocker locker(&m_mutex);
+    invalidateFrameCache();
     QString currentId;
     int consumerPosition = 0;
     if (!producer && m_mltProducer && m_mltProducer->parent().get("id") == QLatin1String("black")) {
@@ -403,7 +423,7 @@ bool Render::setProducer(Mlt::Producer *producer, int position, bool isActive)
 }
 
 void Render::startConsumer() {
-    if (m_mltConsumer->is_stopped() && m_mltConsumer->start() == -1) {
+    if (m_mltConsumer->is_stopped() && startMltConsumer() == -1) {
         // ARGH CONSUMER BROKEN!!!!
         KMessageBox::error(qApp->activeWindow(), i18n("Could not create the video preview window.\nThere is something wrong with your Kdenlive install or your driver settings, please fix it."));
         if (m_showFrameEvent) delete m_showFrameEvent;
@@ -429,6 +449,7 @@ int Render::setSceneList(QString playlist, int position)
     requestedSeekPosition = SEEK_INACTIVE;
     m_refreshTimer.stop();
     QMutexLocker locker(&m_mutex);
+    invalidateFrameCache();
     //if (m_winid == -1) return -1;
     int error = 0;
 
@@ -516,6 +537,20 @@ int Render::setSceneList(QString playlist, int position)
 
     // Fill bin
     QStringList ids = m_binController->getClipIds();
+    // Bin clips hash their file when it has no hash yet, read these files in parallel first
+    QStringList unhashed;
+    foreach(const QString &id, ids) {
+        ClipController *controller = m_binController->getController(id);
+        if (controller && controller->getClipHash().isEmpty() && controller->clipUrl().isLocalFile()) {
+            ClipType type = controller->clipType();
+            if (type == AV || type == Audio || type == Video || type == Image || type == Playlist) {
+                unhashed << controller->clipUrl().toLocalFile();
+            }
+        }
+    }
+    if (unhashed.count() > 1) {
+        FileHasher::fileHashes(unhashed);
+    }
     foreach(const QString &id, ids) {
         if (id == QLatin1String("black"))
             continue;
@@ -657,7 +692,7 @@ void Render::start()
         return;
     }
     if (m_mltConsumer->is_stopped()) {
-        if (m_mltConsumer->start() == -1) {
+        if (startMltConsumer() == -1) {
             //KMessageBox::error(qApp->activeWindow(), i18n("Could not create the video preview window.\nThere is something wrong with your Kdenlive install or your driver settings, please fix it."));
             qWarning() << "/ / / / CANNOT START MONITOR";
         } else {
@@ -739,7 +774,7 @@ void Render::switchPlay(bool play, double speed)
             }
         }
         if (currentSpeed == 0) {
-            m_mltConsumer->start();
+            startMltConsumer();
             m_isRefreshing = true;
             m_mltConsumer->set("refresh", 1);
         } else {
@@ -775,7 +810,7 @@ void Render::play(double speed)
         }
     }
     if (current_speed == 0) {
-        m_mltConsumer->start();
+        startMltConsumer();
         m_isRefreshing = true;
         m_mltConsumer->set("refresh", 1);
     }
@@ -814,7 +849,7 @@ bool Render::playZone(const GenTime & startTime, const GenTime & stopTime)
     m_mltConsumer->purge();
     m_mltProducer->set("out", (int)(stopTime.frames(m_fps)));
     m_mltProducer->set_speed(1.0);
-    if (m_mltConsumer->is_stopped()) m_mltConsumer->start();
+    if (m_mltConsumer->is_stopped()) startMltConsumer();
     m_isRefreshing = true;
     m_mltConsumer->set("refresh", 1);
     m_isZoneMode = true;
@@ -855,6 +890,7 @@ void Render::seekToFrameDiff(int diff)
 
 void Render::doRefresh()
 {
+    invalidateFrameCache();
     if (m_mltProducer && (playSpeed() == 0) && m_isActive) {
         if (m_isRefreshing) m_refreshTimer.start();
         else refresh();
@@ -867,9 +903,10 @@ void Render::refresh()
     if (!m_mltProducer || !m_isActive)
         return;
     QMutexLocker locker(&m_mutex);
+    invalidateFrameCache();
     if (m_mltConsumer) {
         m_isRefreshing = true;
-        if (m_mltConsumer->is_stopped()) m_mltConsumer->start();
+        if (m_mltConsumer->is_stopped()) startMltConsumer();
         m_mltConsumer->purge();
         m_mltConsumer->set("refresh", 1);
     }
@@ -883,7 +920,7 @@ void Render::setDropFrames(bool drop)
         if (drop == false) dropFrames = -dropFrames;
         //m_mltConsumer->stop();
         m_mltConsumer->set("real_time", dropFrames);
-        if (m_mltConsumer->start() == -1) {
+        if (startMltConsumer() == -1) {
             qWarning() << "ERROR, Cannot start monitor";
         }
 
@@ -896,7 +933,8 @@ void Render::setConsumerProperty(const QString &name, const QString &value)
     if (m_mltConsumer) {
         //m_mltConsumer->stop();
         m_mltConsumer->set(name.toUtf8().constData(), value.toUtf8().constData());
-        if (m_isActive && m_mltConsumer->start() == -1) {
+        invalidateFrameCache();
+        if (m_isActive && startMltConsumer() == -1) {
             qWarning() << "ERROR, Cannot start monitor";
         }
 
@@ -917,6 +955,7 @@ double Render::playSpeed() const
 
 GenTime Render::seekPosition() const
 {
+    if (m_cachedPosition != SEEK_INACTIVE) return GenTime(m_cachedPosition, m_fps);
     if (m_mltConsumer) return GenTime((int) m_mltConsumer->position(), m_fps);
     else return GenTime();
 }
@@ -950,6 +989,7 @@ void Render::emitFrameUpdated(Mlt::Frame& frame)
 int Render::getCurrentSeekPosition() const
 {
     if (requestedSeekPosition != SEEK_INACTIVE) return requestedSeekPosition;
+    if (m_cachedPosition != SEEK_INACTIVE) return m_cachedPosition;
     return (int) m_mltConsumer->position();
 }
 
@@ -987,38 +1027,87 @@ bool Render::checkFrameNumber(int pos)
     return true;
 }
 
-void Render::slotCheckSeeking()
+int Render::startMltConsumer()
 {
-    if (requestedSeekPosition != SEEK_INACTIVE) {
-        m_mltProducer->seek(requestedSeekPosition);
-        requestedSeekPosition = SEEK_INACTIVE;
+    if (m_mltConsumer->is_stopped()) {
+        m_mltConsumer->set("kdenlive:run", ++m_consumerRun);
+        m_cachedPosition = SEEK_INACTIVE;
     }
+    return m_mltConsumer->start();
 }
 
-void Render::showAudio(Mlt::Frame& frame)
+void Render::invalidateFrameCache()
 {
-    if (!frame.is_valid() || frame.get_int("test_audio") != 0) {
-        return;
-    }
+    m_frameCache->invalidate();
+    m_frameCache->setBudget((qint64) KdenliveSettings::monitorcachesize() * 1024 * 1024);
+    // Frames of the current run may have been rendered before the change, only the next run is cached
+    m_cacheRun = m_consumerRun;
+}
 
-    mlt_audio_format audio_format = mlt_audio_s16;
-    //FIXME: should not be hardcoded..
-    int freq = 48000;
-    int num_channels = 2;
-    int samples = 0;
-    qint16* data = (qint16*)frame.get_audio(audio_format, freq, num_channels, samples);
+bool Render::showCachedFrame(int position)
+{
+    if (externalConsumer || !m_qmlView || !m_mltConsumer || !m_mltConsumer->is_stopped() || m_mltProducer->get_speed() != 0) {
+        return false;
+    }
+    SharedFrame frame = m_frameCache->frame(position);
+    if (!frame.is_valid() || !m_qmlView->showCachedFrame(frame)) {
+        return false;
+    }
+    // Play and the next seek continue from here
+    m_mltProducer->seek(position);
+    m_cachedPosition = position;
+    return true;
+}
 
-    if (!data) {
+void Render::prefetchFrames(int position)
+{
+    const int direction = position < m_lastSeekPosition ? -1 : 1;
+    m_lastSeekPosition = position;
+    m_frameCache->setPlayhead(position);
+    if (externalConsumer || !m_qmlView || m_qmlView->glslManager() || !m_mltConsumer || !m_frameCache->isEnabled() || m_mltProducer->get_speed() != 0) {
         return;
     }
+    // The worker needs the producer as XML. Serializing the whole timeline after each edit
+    // would stall the GUI thread, so the project monitor only caches the frames it displays.
+    if (m_name != Kdenlive::ClipMonitor) {
+        return;
+    }
+    if (!m_frameCache->hasPrefetchSource()) {
+        FrameCache::PrefetchSource source;
+        source.xml = m_binController->getProducerXML(*m_mltProducer);
+        source.profile = m_qmlView->profile();
+        source.length = m_mltProducer->get_length();
+        source.width = m_qmlView->profile()->width();
+        source.height = m_qmlView->profile()->height();
+        source.fps = m_fps;
+        if (m_mltConsumer->get_int("frequency") > 0) {
+            source.frequency = m_mltConsumer->get_int("frequency");
+        }
+        if (m_mltConsumer->get_int("channels") > 0) {
+            source.channels = m_mltConsumer->get_int("channels");
+        }
+        source.deinterlace = m_mltConsumer->get_int("progressive") || m_mltConsumer->get_int("deinterlace");
+        source.rescale = m_mltConsumer->get("rescale");
+        source.deinterlaceMethod = m_mltConsumer->get("deinterlace_method");
+        m_frameCache->setPrefetchSource(source);
+    }
+    // One second ahead covers frame stepping and jog without waiting for the decoder
+    m_frameCache->prefetch(position, direction, qMax(1, qRound(m_fps)));
+}
 
-    // Data format: [ c00 c10 c01 c11 c02 c12 c03 c13 ... c0{samples-1} c1{samples-1} for 2 channels.
-    // So the vector is of size samples*channels.
-    audioShortVector sampleVector(samples*num_channels);
-    memcpy(sampleVector.data(), data, samples*num_channels*sizeof(qint16));
+void Render::slotCacheFrame(const SharedFrame &frame)
+{
+    if (frame.get_int("kdenlive:run") > m_cacheRun) {
+        m_frameCache->setPlayhead(frame.get_position());
+        m_frameCache->insert(frame, m_frameCache->generation());
+    }
+}
 
-    if (samples > 0) {
-        emit audioSamplesSignal(sampleVector, freq, num_channels, samples);
+void Render::slotCheckSeeking()
+{
+    if (requestedSeekPosition != SEEK_INACTIVE) {
+        m_mltProducer->seek(requestedSeekPosition);
+        requestedSeekPosition = SEEK_INACTIVE;
     }
 }
 
@@ -1277,6 +1366,7 @@ void Render::mltInsertSpace(QMap <int, int> trackClipStartList, QMap <int, int>
     }
     service.unlock();
     mltCheckLength(&tractor);
+    invalidateFrameCache();
     m_isRefreshing = true;
     m_mltConsumer->set("refresh", 1);
 }
@@ -1310,6 +1400,7 @@ bool Render::mltResizeClipCrop(ItemInfo info, GenTime newCropStart)
     int frameOffset = newCropFrame - previousStart;
     trackPlaylist.resize_clip(clipIndex, newCropFrame, previousOut + frameOffset);
     service.unlock();
+    invalidateFrameCache();
     m_isRefreshing = true;
     m_mltConsumer->set("refresh", 1);
     return true;
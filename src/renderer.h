@@ -57,6 +57,8 @@ class KComboBox;
 class BinController;
 class ClipController;
 class GLWidget;
+class FrameCache;
+class SharedFrame;
 
 namespace Mlt
 {
@@ -203,8 +205,6 @@ class Render: public AbstractRender
     /** @brief Sets an MLT consumer property. */
     void setConsumerProperty(const QString &name, const QString &value);
 
-    void showAudio(Mlt::Frame&);
-
     QList <int> checkTrackSequence(int);
     void sendFrameUpdate();
 
@@ -307,11 +307,29 @@ private:
     /** @brief Get a track producer from a clip's id */
     Mlt::Producer *getProducerForTrack(Mlt::Playlist &trackPlaylist, const QString &clipId);
 
+    /** @brief Decoded frames around the playhead, shown without the consumer while paused. */
+    FrameCache *m_frameCache;
+    /** @brief Number of times the consumer was started, stamped on the frames it displays. */
+    int m_consumerRun;
+    /** @brief Frames of this consumer run or an earlier one may show the producer before the last change. */
+    int m_cacheRun;
+    /** @brief Position of the frame shown from the cache, SEEK_INACTIVE if the consumer showed the last frame. */
+    int m_cachedPosition;
+    int m_lastSeekPosition;
+    /** @brief Starts the consumer, numbering the run if it was stopped. */
+    int startMltConsumer();
+    /** @brief Shows the frame at @param position from the cache, returns false on a miss. */
+    bool showCachedFrame(int position);
+    /** @brief Lets the cache decode the frames following @param position in the seek direction, clip monitor only. */
+    void prefetchFrames(int position);
+
 private slots:
 
     /** @brief Refreshes the monitor display. */
     void refresh();
     void slotCheckSeeking();
+    /** @brief Stores a displayed frame in the cache. */
+    void slotCacheFrame(const SharedFrame &frame);
 
 signals:
     /** @brief The renderer stopped, either playing or rendering. */
@@ -367,6 +385,8 @@ public slots:
     void seekToFrame(int pos);
     /** @brief Starts a timer to query for a refresh. */
     void doRefresh();
+    /** @brief Drops the cached frames after the producer was replaced or edited. */
+    void invalidateFrameCache();
 
     /** @brief Save a part of current timeline to an xml file. */
      void saveZone(QPoint zone);
@@ -26,20 +26,18 @@ AbstractAudioScopeWidget::AbstractAudioScopeWidget(bool trackMouse, QWidget *par
     m_freq(0),
     m_nChannels(0),
     m_nSamples(0),
-    m_audioFrame(),
     m_newData(0)
 {
 }
 
-void AbstractAudioScopeWidget::slotReceiveAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples)
+void AbstractAudioScopeWidget::slotReceiveAudio(const AudioBlock &audioBlock)
 {
 #ifdef DEBUG_AASW
     qDebug() << "Received audio for " << widgetName() << '.';
 #endif
-    m_audioFrame = sampleData;
-    m_freq = freq;
-    m_nChannels = num_channels;
-    m_nSamples = num_samples;
+    m_audioMutex.lock();
+    m_audioBlock = audioBlock;
+    m_audioMutex.unlock();
 
     m_newData.fetchAndAddAcquire(1);
 
@@ -54,7 +52,14 @@ QImage AbstractAudioScopeWidget::renderScope(uint accelerationFactor)
 {
     const int newData = m_newData.fetchAndStoreAcquire(0);
 
-    return renderAudioScope(accelerationFactor, m_audioFrame, m_freq, m_nChannels, m_nSamples, newData);
+    m_audioMutex.lock();
+    const AudioBlock audioBlock = m_audioBlock;
+    m_audioMutex.unlock();
+    m_freq = audioBlock.frequency();
+    m_nChannels = audioBlock.channels();
+    m_nSamples = audioBlock.sampleCount();
+
+    return renderAudioScope(accelerationFactor, audioBlock, newData);
 }
 
 #ifdef DEBUG_AASW
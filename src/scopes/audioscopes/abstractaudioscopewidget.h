@@ -13,11 +13,13 @@
 
 
 #include <QWidget>
+#include <QMutex>
 
 #include <stdint.h>
 
 #include "../../definitions.h"
 #include "../abstractscopewidget.h"
+#include "lib/audio/audioBlock.h"
 
 class Render;
 
@@ -32,7 +34,7 @@ public:
     virtual ~AbstractAudioScopeWidget();
 
 public slots:
-    void slotReceiveAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples);
+    void slotReceiveAudio(const AudioBlock &audioBlock);
 
 protected:
     /** @brief This is just a wrapper function, subclasses can use renderAudioScope. */
@@ -42,16 +44,16 @@ protected:
     /** @brief Scope renderer. Must emit signalScopeRenderingFinished()
         when calculation has finished, to allow multi-threading.
         accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible. */
-    virtual QImage renderAudioScope(uint accelerationFactor,
-                                    const audioShortVector &audioFrame, const int freq, const int num_channels, const int num_samples,
-                                    const int newData) = 0;
+    virtual QImage renderAudioScope(uint accelerationFactor, const AudioBlock &audioBlock, const int newData) = 0;
 
     int m_freq;
     int m_nChannels;
     int m_nSamples;
 
 private:
-    audioShortVector m_audioFrame;
+    /** The block is shared with the other scopes, only the handle is guarded */
+    AudioBlock m_audioBlock;
+    QMutex m_audioMutex;
     QAtomicInt m_newData;
 
 };
@@ -40,20 +40,14 @@ AudioSignal::~AudioSignal()
 {
 }
 
-QImage AudioSignal::renderAudioScope(uint, const audioShortVector &audioFrame,
-                                     const int, const int num_channels, const int samples, const int)
+QImage AudioSignal::renderAudioScope(uint, const AudioBlock &audioBlock, const int)
 {
     QTime start = QTime::currentTime();
 
-    int num_samples = samples > 200 ? 200 : samples;
-
+    // Channel peaks were measured with the block, scaled to 0-127 here
     QByteArray channels;
-    for (int i = 0; i < num_channels; ++i) {
-        long val = 0;
-        for (int s = 0; s < num_samples; s ++) {
-            val += abs(audioFrame[i+s*num_channels] / 128);
-        }
-        channels.append(val / num_samples);
+    for (int i = 0; i < audioBlock.channels(); ++i) {
+        channels.append((char) (audioBlock.peak(i) * 127));
     }
 
     if (peeks.count()!=channels.count()){
@@ -151,49 +145,6 @@ QRect AudioSignal::scopeRect() { return QRect(0, 0, width(), height()); }
 QImage AudioSignal::renderHUD(uint) { return QImage(); }
 QImage AudioSignal::renderBackground(uint) { return QImage(); }
 
-void AudioSignal::slotReceiveAudio(audioShortVector data, int, int num_channels, int samples)
-{
-
-    int num_samples = samples > 200 ? 200 : samples;
-
-    QByteArray channels;
-    int num_oversample=0;
-    for (int i = 0; i < num_channels; ++i) {
-        long val = 0;
-        double over1=0.0;
-        double over2=0.0;
-        for (int s = 0; s < num_samples; s ++) {
-            int sample=abs(data[i+s*num_channels] / 128);
-            val += sample;
-            if (sample==128){
-                num_oversample++;
-            }else{
-                num_oversample=0;
-            }
-            //if 3 samples over max => 1 peak over 0 db (0db=40.0)
-            if (num_oversample>3){
-                over1=41.0/42.0*127;
-            }
-            // 10 samples @max => show max signal
-            if (num_oversample>10){
-                over2=127;
-            }
-
-
-
-        }
-        //max amplitude = 40/42, 3to10  oversamples=41, more then 10 oversamples=42
-        if (over2>0.0){
-            channels.append(over2);
-        } else if (over1>0.0){
-            channels.append(over1);
-        }else
-            channels.append(val / num_samples*40.0/42.0);
-    }
-    showAudio(channels);
-    m_timer.start(1000);
-}
-
 void AudioSignal::slotNoAudioTimeout(){
     peeks.fill(0);
     showAudio(QByteArray(2,0));
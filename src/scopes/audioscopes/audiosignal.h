@@ -42,7 +42,7 @@ public:
     QRect scopeRect();
     QImage renderHUD(uint accelerationFactor);
     QImage renderBackground(uint accelerationFactor);
-    QImage renderAudioScope(uint accelerationFactor, const audioShortVector &audioFrame, const int, const int num_channels, const int samples, const int);
+    QImage renderAudioScope(uint accelerationFactor, const AudioBlock &audioBlock, const int);
 
     QString widgetName() const { return QStringLiteral("audioSignal"); }
     bool isHUDDependingOnInput() const { return false; }
@@ -57,7 +57,6 @@ private:
 
 public slots:
     void showAudio(const QByteArray &);
-    void slotReceiveAudio(audioShortVector,int,int,int);
 private slots:
      void slotNoAudioTimeout();
 
@@ -46,7 +46,7 @@
 
 AudioSpectrum::AudioSpectrum(QWidget *parent) :
     AbstractAudioScopeWidget(true, parent)
-  , m_fftTools()
+  , m_spectrumEngine()
   , m_lastFFT()
   , m_lastFFTLock(1)
   , m_peaks()
@@ -161,9 +161,12 @@ QImage AudioSpectrum::renderBackground(uint)
     return QImage();
 }
 
-QImage AudioSpectrum::renderAudioScope(uint, const audioShortVector &audioFrame, const int freq, const int num_channels,
-                                       const int num_samples, const int)
+QImage AudioSpectrum::renderAudioScope(uint, const AudioBlock &audioBlock, const int)
 {
+    const audioShortVector &audioFrame = audioBlock.samples();
+    const int freq = audioBlock.frequency();
+    const int num_channels = audioBlock.channels();
+    const int num_samples = audioBlock.sampleCount();
     if (
             audioFrame.size() > 63
             && m_innerScopeRect.width() > 0 && m_innerScopeRect.height() > 0    // <= 0 if widget is too small (resized by user)
@@ -222,17 +225,19 @@ QImage AudioSpectrum::renderAudioScope(uint, const audioShortVector &audioFrame,
 
         // Get the spectral power distribution of the input samples,
         // using the given window size and function
-        float freqSpectrum[fftWindow/2];
         FFTTools::WindowType windowType = (FFTTools::WindowType) ui->windowFunction->itemData(ui->windowFunction->currentIndex()).toInt();
-        m_fftTools.fftNormalized(audioFrame, 0, num_channels, freqSpectrum, windowType, fftWindow, 0);
+        if (!m_spectrumEngine.process(audioFrame, num_channels, fftWindow, windowType, 0)) {
+            emit signalScopeRenderingFinished(0, 1);
+            return QImage();
+        }
 
 
         // Store the current FFT window (for the HUD) and run the interpolation
         // for easy pixel-based dB value access
         QVector<float> dbMap;
         m_lastFFTLock.acquire();
-        m_lastFFT = QVector<float>(fftWindow/2);
-        memcpy(m_lastFFT.data(), &(freqSpectrum[0]), fftWindow/2 * sizeof(float));
+        m_lastFFT.resize(fftWindow/2);
+        memcpy(m_lastFFT.data(), m_spectrumEngine.maximum(), fftWindow/2 * sizeof(float));
 
         uint right = ((float) m_freqMax)/(m_freq/2) * (m_lastFFT.size() - 1);
         dbMap = FFTTools::interpolatePeakPreserving(m_lastFFT, m_innerScopeRect.width(), 0, right, -180);
@@ -15,6 +15,7 @@
 #include "abstractaudioscopewidget.h"
 #include "lib/external/kiss_fft/tools/kiss_fftr.h"
 #include "lib/audio/fftTools.h"
+#include "lib/audio/spectrumEngine.h"
 #include "ui_audiospectrum_ui.h"
 
 // Enables debugging
@@ -32,8 +33,7 @@ class AudioSpectrum_UI;
    \brief Displays a spectral power distribution of audio samples.
    The frequency distribution is calculated by means of a Fast Fourier Transformation.
    For more information see Wikipedia:FFT and the code comments.
-
-   \todo Currently only supports one channel. Add support for multiple channels.
+   All channels are transformed, the loudest one is shown for each frequency.
 */
 class AudioSpectrum : public AbstractAudioScopeWidget {
     Q_OBJECT
@@ -50,7 +50,7 @@ protected:
     ///// Implemented methods /////
     QRect scopeRect();
     QImage renderHUD(uint accelerationFactor);
-    QImage renderAudioScope(uint accelerationFactor, const audioShortVector &audioFrame, const int freq, const int num_channels, const int num_samples, const int newData);
+    QImage renderAudioScope(uint accelerationFactor, const AudioBlock &audioBlock, const int newData);
     QImage renderBackground(uint accelerationFactor);
     virtual void readConfig();
     void writeConfig();
@@ -64,7 +64,7 @@ private:
     QAction *m_aTrackMouse;
     QAction *m_aShowMax;
 
-    FFTTools m_fftTools;
+    SpectrumEngine m_spectrumEngine;
     QVector<float> m_lastFFT;
     QSemaphore m_lastFFTLock;
 
@@ -36,9 +36,10 @@
 
 Spectrogram::Spectrogram(QWidget *parent) :
     AbstractAudioScopeWidget(true, parent)
-  , m_fftTools()
-  , m_fftHistory()
-  , m_fftHistoryImg()
+  , m_spectrumEngine()
+  , m_fftHistory(SPECTROGRAM_HISTORY_SIZE)
+  , m_ringImage()
+  , m_ringNewest(0)
   , m_dBmin(-70)
   , m_dBmax(0)
   , m_freqMax(0)
@@ -313,8 +314,11 @@ QImage Spectrogram::renderHUD(uint)
         return QImage();
     }
 }
-QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, const int freq,
-                                     const int num_channels, const int num_samples, const int newData) {
+QImage Spectrogram::renderAudioScope(uint, const AudioBlock &audioBlock, const int newData) {
+    const audioShortVector &audioFrame = audioBlock.samples();
+    const int freq = audioBlock.frequency();
+    const int num_channels = audioBlock.channels();
+    const int num_samples = audioBlock.sampleCount();
     if (
             audioFrame.size() > 63
             && m_innerScopeRect.width() > 0 && m_innerScopeRect.height() > 0
@@ -341,20 +345,20 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         // Show the window size used, for information
         ui->labelFFTSizeNumber->setText(QVariant(fftWindow).toString());
 
+        bool appended = false;
         if (newDataAvailable) {
 
-            float freqSpectrum[fftWindow/2];
-
             // Get the spectral power distribution of the input samples,
             // using the given window size and function
             FFTTools::WindowType windowType = (FFTTools::WindowType) ui->windowFunction->itemData(ui->windowFunction->currentIndex()).toInt();
-            m_fftTools.fftNormalized(audioFrame, 0, num_channels, freqSpectrum, windowType, fftWindow, 0);
 
-            // This methid might be called also when a simple refresh is required.
+            // This method might be called also when a simple refresh is required.
             // In this case there is no data to append to the history. Only append new data.
-            QVector<float> spectrumVector(fftWindow/2);
-            memcpy(spectrumVector.data(), &freqSpectrum[0], fftWindow/2 * sizeof(float));
-            m_fftHistory.prepend(spectrumVector);
+            // The history is a ring buffer, the oldest spectrum is dropped once it is full.
+            if (m_spectrumEngine.process(audioFrame, num_channels, fftWindow, windowType, 0)) {
+                m_fftHistory.prepend(m_spectrumEngine.maximum(), m_spectrumEngine.binCount());
+                appended = true;
+            }
         }
 #ifdef DEBUG_SPECTROGRAM
         else {
@@ -362,91 +366,50 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         }
 #endif
 
-        // Limit the maximum history size to avoid wasting space
-        while (m_fftHistory.size() > SPECTROGRAM_HISTORY_SIZE) {
-            m_fftHistory.removeLast();
+        // The spectrogram is kept in a ring of image lines, the newest spectrum at m_ringNewest.
+        // Usually only the newest spectrum needs to be rasterized; everything is rasterized again
+        // from the history if the size or the parameters (like min/max dB) have changed.
+        const int w = m_innerScopeRect.width();
+        const int h = m_innerScopeRect.height();
+        const bool completeRedraw = m_parameterChanged || m_ringImage.size() != m_innerScopeRect.size();
+        int rasterized = 0;
+        if (completeRedraw) {
+            m_parameterChanged = false;
+            m_ringImage = QImage(w, h, QImage::Format_ARGB32);
+            m_ringImage.fill(qRgba(0,0,0,0));
+            rasterized = qMin(m_fftHistory.size(), h);
+            for (int age = 0; age < rasterized; ++age) {
+                rasterizeLine(age, rasterized-1 - age);
+            }
+            m_ringNewest = (rasterized-1 + h) % h;
+        } else if (appended) {
+            m_ringNewest = (m_ringNewest + 1) % h;
+            rasterizeLine(0, m_ringNewest);
+            rasterized = 1;
         }
 
-        // Draw the spectrum
+        // Unroll the ring: the line after the newest one is the oldest, at the top
         QImage spectrum(m_scopeRect.size(), QImage::Format_ARGB32);
         spectrum.fill(qRgba(0,0,0,0));
         QPainter davinci(&spectrum);
-        const uint h = m_innerScopeRect.height();
-        const uint leftDist = m_innerScopeRect.left() - m_scopeRect.left();
-        const uint topDist = m_innerScopeRect.top() - m_scopeRect.top();
-        uint windowSize;
-        uint y;
-        bool completeRedraw = true;
-
-        if (m_fftHistoryImg.size() == m_scopeRect.size() && !m_parameterChanged) {
-            // The size of the widget and the parameters (like min/max dB) have not changed since last time,
-            // so we can re-use it, shift it by one pixel, and render the single remaining line. Usually about
-            // 10 times faster for a widget height of around 400 px.
-            if (newDataAvailable) {
-                davinci.drawImage(0, -1, m_fftHistoryImg);
-            } else {
-                // spectrum = m_fftHistoryImg does NOT work, leads to segfaults (anyone knows why, please tell me)
-                davinci.drawImage(0, 0, m_fftHistoryImg);
-            }
-            completeRedraw = false;
-        }
-
-        y = 0;
-        if (newData || m_parameterChanged) {
-            m_parameterChanged = false;
-            bool peak = false;
-
-            QVector<float> dbMap;
-            uint right;
-            ////////////////FIXME
-            for (QList<QVector<float> >::iterator it = m_fftHistory.begin(); it != m_fftHistory.end(); ++it) {
-
-                windowSize = (*it).size();
-
-                // Interpolate the frequency data to match the pixel coordinates
-                right = ((float) m_freqMax)/(m_freq/2) * (windowSize - 1);
-                dbMap = FFTTools::interpolatePeakPreserving((*it), m_innerScopeRect.width(), 0, right, -180);
-
-                for (int i = 0; i < dbMap.size(); ++i) {
-                    float val;
-                    val = dbMap[i];
-                    peak = val > m_dBmax;
-
-                    // Normalize dB value to [0 1], 1 corresponding to dbMax dB and 0 to dbMin dB
-                    val = (val-m_dBmax)/(m_dBmax-m_dBmin) + 1;
-                    if (val < 0) {
-                        val = 0;
-                    } else if (val > 1) {
-                        val = 1;
-                    }
-                    if (!peak || !m_aHighlightPeaks->isChecked()) {
-                        spectrum.setPixel(leftDist + i, topDist + h-1 - y, m_colorMap[(int)(val * 255)]);
-                    } else {
-                        spectrum.setPixel(leftDist + i, topDist + h-1 - y, AbstractScopeWidget::colHighlightDark.rgba());
-                    }
-                }
-
-                y++;
-                if (y >= topDist + m_innerScopeRect.height()) {
-                    break;
-                }
-                if (!completeRedraw) {
-                    break;
-                }
-            }
+        davinci.setCompositionMode(QPainter::CompositionMode_Source);
+        const int leftDist = m_innerScopeRect.left() - m_scopeRect.left();
+        const int topDist = m_innerScopeRect.top() - m_scopeRect.top();
+        const int olderLines = h-1 - m_ringNewest;
+        if (olderLines > 0) {
+            davinci.drawImage(QPoint(leftDist, topDist), m_ringImage, QRect(0, m_ringNewest+1, w, olderLines));
         }
+        davinci.drawImage(QPoint(leftDist, topDist + olderLines), m_ringImage, QRect(0, 0, w, m_ringNewest+1));
+        davinci.end();
 
 #ifdef DEBUG_SPECTROGRAM
-        qDebug() << "Rendered " << y-topDist << "lines from " << m_fftHistory.size() << " available samples in " << start.elapsed() << " ms"
+        qDebug() << "Rendered " << rasterized << "lines from " << m_fftHistory.size() << " available samples in " << start.elapsed() << " ms"
                  << (completeRedraw ? "" : " (re-used old image)");
-        uint storedBytes = 0;
-        for (QList< QVector<float> >::iterator it = m_fftHistory.begin(); it != m_fftHistory.end(); ++it) {
-            storedBytes += (*it).size() * sizeof((*it)[0]);
-        }
-        qDebug() << QString("Total storage used: %1 kB").arg((double)storedBytes/1000, 0, 'f', 2);
+        qDebug() << QString("Total storage used: %1 kB").arg((double)m_fftHistory.storedBytes()/1000, 0, 'f', 2);
+#else
+        Q_UNUSED(rasterized)
 #endif
 
-        m_fftHistoryImg = spectrum;
 
         emit signalScopeRenderingFinished(start.elapsed(), 1);
         return spectrum;
@@ -455,6 +418,34 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         return QImage();
     }
 }
+void Spectrogram::rasterizeLine(int age, int line)
+{
+    const int w = m_ringImage.width();
+    const uint windowSize = m_fftHistory.rowSize(age);
+
+    // The mapping from frequency bins to pixels only changes with the size, the window
+    // size or the maximum frequency, and is computed once for all lines
+    const uint right = ((float) m_freqMax)/(m_freq/2) * (windowSize - 1);
+    m_pixelMap.prepare(windowSize, w, 0, right);
+    m_dbLine.resize(w);
+    m_pixelMap.apply(m_fftHistory.row(age), m_dbLine.data(), -180);
+
+    const bool highlightPeaks = m_aHighlightPeaks->isChecked();
+    const QRgb highlight = AbstractScopeWidget::colHighlightDark.rgba();
+    const float dBRange = m_dBmax - m_dBmin;
+    QRgb *pixels = (QRgb *) m_ringImage.scanLine(line);
+    const float *db = m_dbLine.constData();
+    for (int i = 0; i < w; ++i) {
+        if (highlightPeaks && db[i] > m_dBmax) {
+            pixels[i] = highlight;
+        } else {
+            // Normalize dB value to [0 1], 1 corresponding to dbMax dB and 0 to dbMin dB
+            const float val = qBound(0.0f, (db[i]-m_dBmax)/dBRange + 1, 1.0f);
+            pixels[i] = m_colorMap[(int)(val * 255)];
+        }
+    }
+}
+
 QImage Spectrogram::renderBackground(uint) { return QImage(); }
 
 bool Spectrogram::isHUDDependingOnInput() const { return false; }
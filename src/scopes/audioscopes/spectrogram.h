@@ -12,8 +12,10 @@
     over time. See http://en.wikipedia.org/wiki/Spectrogram.
 
     The Spectrogram makes use of two caches:
-    * A cached image where only the most recent line needs to be appended instead of
-      having to recalculate the whole image. A typical speedup factor is 10x.
+    * A ring of image lines where only the most recent spectrum needs to be rasterized
+      instead of having to recalculate or shift the whole image, so the cost per frame
+      only depends on the width. The mapping from frequency bins to pixels is computed
+      once per size and zoom.
     * A FFT cache storing a history of previous spectral power distributions (i.e.
       the Fourier-transformed audio signals). This is used if the user adjusts parameters
       like the maximum frequency to display or minimum/maximum signal strength in dB.
@@ -29,6 +31,9 @@
 #include "abstractaudioscopewidget.h"
 #include "ui_spectrogram_ui.h"
 #include "lib/audio/fftTools.h"
+#include "lib/audio/peakPreservingMap.h"
+#include "lib/audio/spectrumEngine.h"
+#include "lib/audio/spectrumHistory.h"
 
 class Spectrogram_UI;
 class Spectrogram : public AbstractAudioScopeWidget {
@@ -44,7 +49,7 @@ protected:
     ///// Implemented methods /////
     QRect scopeRect();
     QImage renderHUD(uint accelerationFactor);
-    QImage renderAudioScope(uint accelerationFactor, const audioShortVector &audioFrame, const int freq, const int num_channels, const int num_samples, const int newData);
+    QImage renderAudioScope(uint accelerationFactor, const AudioBlock &audioBlock, const int newData);
     QImage renderBackground(uint accelerationFactor);
     bool isHUDDependingOnInput() const;
     bool isScopeDependingOnInput() const;
@@ -56,14 +61,18 @@ protected:
 
 private:
     Ui::Spectrogram_UI *ui;
-    FFTTools m_fftTools;
+    SpectrumEngine m_spectrumEngine;
     QAction *m_aResetHz;
     QAction *m_aGrid;
     QAction *m_aTrackMouse;
     QAction *m_aHighlightPeaks;
 
-    QList<QVector<float> > m_fftHistory;
-    QImage m_fftHistoryImg;
+    SpectrumHistory m_fftHistory;
+    /** Rasterized history, one line per spectrum; used as a ring with the newest line at m_ringNewest */
+    QImage m_ringImage;
+    int m_ringNewest;
+    PeakPreservingMap m_pixelMap;
+    QVector<float> m_dbLine;
 
     int m_dBmin;
     int m_dBmax;
@@ -76,6 +85,9 @@ private:
     QRect m_innerScopeRect;
     QRgb m_colorMap[256];
 
+    /** Rasterizes the spectrum of age @param age of the history into @param line of m_ringImage */
+    void rasterizeLine(int age, int line);
+
 private slots:
     void slotResetMaxFreq();
 
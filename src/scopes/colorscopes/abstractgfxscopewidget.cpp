@@ -11,6 +11,7 @@
 #include "abstractgfxscopewidget.h"
 #include "renderer.h"
 #include "monitor/monitormanager.h"
+#include "kdenlivesettings.h"
 
 #include <QMouseEvent>
 
@@ -27,10 +28,22 @@ AbstractGfxScopeWidget::AbstractGfxScopeWidget(bool trackMouse, QWidget *parent)
 
 AbstractGfxScopeWidget::~AbstractGfxScopeWidget() { }
 
+uint AbstractGfxScopeWidget::sampleBudget(const ScopeFrame &frame, uint accelerationFactor) const
+{
+    const uint pixels = qMax(0, frame.width()) * qMax(0, frame.height());
+    uint budget = pixels;
+    if (KdenliveSettings::scopesamplebudget() > 0) {
+        budget = qMin(budget, (uint) KdenliveSettings::scopesamplebudget());
+    }
+    // The acceleration factor lowers the budget instead of skipping lines
+    budget /= qMax(1u, accelerationFactor);
+    return budget >= pixels ? 0 : qMax(1u, budget);
+}
+
 QImage AbstractGfxScopeWidget::renderScope(uint accelerationFactor)
 {
     QMutexLocker lock(&m_mutex);
-    return renderGfxScope(accelerationFactor, m_scopeImage);
+    return renderGfxScope(accelerationFactor, m_scopeFrame);
 }
 
 void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -44,9 +57,14 @@ void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
 
 
 void AbstractGfxScopeWidget::slotRenderZoneUpdated(const QImage &frame)
+{
+    slotRenderZoneUpdated(ScopeFrame(frame));
+}
+
+void AbstractGfxScopeWidget::slotRenderZoneUpdated(const ScopeFrame &frame)
 {
     QMutexLocker lock(&m_mutex);
-    m_scopeImage = frame;
+    m_scopeFrame = frame;
     AbstractScopeWidget::slotRenderZoneUpdated();
 }
 
@@ -16,6 +16,7 @@
 #include <QWidget>
 
 #include "../abstractscopewidget.h"
+#include "scopeframe.h"
 
 
 
@@ -30,20 +31,29 @@ public:
     explicit AbstractGfxScopeWidget(bool trackMouse = false, QWidget *parent = 0);
     virtual ~AbstractGfxScopeWidget(); // Must be virtual because of inheritance, to avoid memory leaks
 
+    /** @brief The ScopeBins::Component flags the scope paints, so that they are counted
+        for all visible scopes in a single pass over the frame. */
+    virtual int binComponents() const = 0;
+
 protected:
     ///// Variables /////
 
     /** @brief Scope renderer. Must emit signalScopeRenderingFinished()
         when calculation has finished, to allow multi-threading.
-        accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible. */
-    virtual QImage renderGfxScope(uint accelerationFactor, const QImage &) = 0;
+        accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible.
+        The frame gives access to the Y'CbCr planes when available, scopes should only call
+        ScopeFrame::image() if they really need RGB data. */
+    virtual QImage renderGfxScope(uint accelerationFactor, const ScopeFrame &) = 0;
 
     virtual QImage renderScope(uint accelerationFactor);
 
+    /** @brief Number of pixels of @param frame to analyse for @param accelerationFactor, 0 for all, see ScopeFrame::bins(). */
+    uint sampleBudget(const ScopeFrame &frame, uint accelerationFactor) const;
+
     void mouseReleaseEvent(QMouseEvent *);
 
 private:
-    QImage m_scopeImage;
+    ScopeFrame m_scopeFrame;
     QMutex m_mutex;
 
 public slots:
@@ -51,6 +61,8 @@ public slots:
       This slot must be connected in the implementing class, it is *not*
       done in this abstract class. */
     void slotRenderZoneUpdated(const QImage &);
+    /** @brief Same as slotRenderZoneUpdated(const QImage &), the frame's planes are shared, not copied. */
+    void slotRenderZoneUpdated(const ScopeFrame &);
 
 protected slots:
     virtual void slotAutoRefreshToggled(bool autoRefresh);
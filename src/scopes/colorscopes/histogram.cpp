@@ -10,6 +10,7 @@
 
 #include "histogram.h"
 #include "histogramgenerator.h"
+#include "scopebins.h"
 #include <QTime>
 
 #include <KSharedConfig>
@@ -113,7 +114,19 @@ QImage Histogram::renderHUD(uint)
     emit signalHUDRenderingFinished(0, 1);
     return QImage();
 }
-QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
+int Histogram::binComponents() const
+{
+    int components = 0;
+    if (ui->cbY->isChecked()) {
+        components |= ScopeBins::LumaHistogram;
+    }
+    if (ui->cbS->isChecked() || ui->cbR->isChecked() || ui->cbG->isChecked() || ui->cbB->isChecked()) {
+        components |= ScopeBins::RgbHistogram;
+    }
+    return components;
+}
+
+QImage Histogram::renderGfxScope(uint accelFactor, const ScopeFrame &frame)
 {
     QTime start = QTime::currentTime();
     start.start();
@@ -125,8 +138,9 @@ QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
 
     HistogramGenerator::Rec rec = m_aRec601->isChecked() ? HistogramGenerator::Rec_601 : HistogramGenerator::Rec_709;
 
-    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), qimage, componentFlags,
-                                                                rec, m_aUnscaled->isChecked(), accelFactor);
+    QSharedPointer<const ScopeBins> bins = frame.bins(binComponents(), rec == HistogramGenerator::Rec_709, sampleBudget(frame, accelFactor));
+    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), *bins, componentFlags,
+                                                                m_aUnscaled->isChecked());
 
     emit signalScopeRenderingFinished(start.elapsed(), accelFactor);
     return histogram;
@@ -9,8 +9,8 @@
  ***************************************************************************/
 
 #include "histogramgenerator.h"
+#include "scopebins.h"
 
-#include <algorithm>
 #include <math.h>
 #include <QImage>
 #include <QPainter>
@@ -20,56 +20,37 @@ HistogramGenerator::HistogramGenerator()
 {
 }
 
-QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components,
-                                              HistogramGenerator::Rec rec, bool unscaled, uint accelFactor) const
+QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const ScopeBins &bins, const int &components,
+                                              bool unscaled) const
 {
-    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || bins.sampleCount() == 0) {
         return QImage();
     }
 
-    bool drawY = (components & HistogramGenerator::ComponentY) != 0;
-    bool drawR = (components & HistogramGenerator::ComponentR) != 0;
-    bool drawG = (components & HistogramGenerator::ComponentG) != 0;
-    bool drawB = (components & HistogramGenerator::ComponentB) != 0;
-    bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
-
-    int r[256], g[256], b[256], y[256], s[766];
-    // Initialize the values to zero
-    std::fill(r, r+256, 0);
-    std::fill(g, g+256, 0);
-    std::fill(b, b+256, 0);
-    std::fill(y, y+256, 0);
-    std::fill(s, s+766, 0);
-
-    const uint iw = image.bytesPerLine();
-    const uint ih = image.height();
+    bool drawY = (components & HistogramGenerator::ComponentY) != 0 && (bins.components() & ScopeBins::LumaHistogram) != 0;
+    const bool hasRgb = (bins.components() & ScopeBins::RgbHistogram) != 0;
+    bool drawR = (components & HistogramGenerator::ComponentR) != 0 && hasRgb;
+    bool drawG = (components & HistogramGenerator::ComponentG) != 0 && hasRgb;
+    bool drawB = (components & HistogramGenerator::ComponentB) != 0 && hasRgb;
+    bool drawSum = (components & HistogramGenerator::ComponentSum) != 0 && hasRgb;
+
+    int r[256], g[256], b[256], y[256], s[256];
+    const uint *binsY = bins.lumaHistogram();
+    const uint *binsR = bins.redHistogram();
+    const uint *binsG = bins.greenHistogram();
+    const uint *binsB = bins.blueHistogram();
+    for (int i = 0; i < 256; ++i) {
+        y[i] = binsY[i];
+        r[i] = binsR[i];
+        g[i] = binsG[i];
+        b[i] = binsB[i];
+        s[i] = r[i] + g[i] + b[i];
+    }
+
     const uint ww = paradeSize.width();
     const uint wh = paradeSize.height();
-    const uint byteCount = iw*ih;
-
-    // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += accelFactor) {
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-            if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == HistogramGenerator::Rec_601) {
-                    y[(int)floor(.299*qRed(col) + .587*qGreen(col) + .114*qBlue(col))]++;
-                } else {
-                    y[(int)floor(.2125*qRed(col) + .7154*qGreen(col) + .0721*qBlue(col))]++;
-                }
-            }
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
-            }
-        }
-    }
+    // Size of the counted pixels in ARGB32, on which the scaling is based
+    const uint byteCount = 4*bins.sampleCount();
 
     const int nParts = (drawY ? 1 : 0) + (drawR ? 1 : 0) + (drawG ? 1 : 0) + (drawB ? 1 : 0) + (drawSum ? 1 : 0);
     if (nParts == 0) {
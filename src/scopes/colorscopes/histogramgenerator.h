@@ -18,6 +18,7 @@ class QImage;
 class QPainter;
 class QRect;
 class QSize;
+class ScopeBins;
 
 class HistogramGenerator : public QObject
 {
@@ -30,11 +31,12 @@ public:
     enum Rec { Rec_601, Rec_709 };
 
     /**
-        Calculates a histogram display from the input image.
+        Calculates a histogram display from the counts of a frame.
         components are OR-ed HistogramGenerator::Components flags and decide with components (Y, R, G, B) to paint.
-        unscaled = true leaves the width at 256 if the widget is wider (to avoid scaling). */
-    QImage calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, const HistogramGenerator::Rec rec,
-                              bool unscaled, uint accelFactor = 1) const;
+        unscaled = true leaves the width at 256 if the widget is wider (to avoid scaling).
+        Components are painted from the ScopeBins::LumaHistogram and ScopeBins::RgbHistogram counts of bins. */
+    QImage calculateHistogram(const QSize &paradeSize, const ScopeBins &bins, const int &components,
+                              bool unscaled) const;
 
     QImage drawComponent(const int *y, const QSize &size, const float &scaling, const QColor &color, bool unscaled, uint max) const;
 
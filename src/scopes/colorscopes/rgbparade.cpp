@@ -10,6 +10,7 @@
 
 #include "rgbparade.h"
 #include "rgbparadegenerator.h"
+#include "scopebins.h"
 #include <QPainter>
 #include <QRect>
 #include <QTime>
@@ -124,14 +125,20 @@ QImage RGBParade::renderHUD(uint)
     return hud;
 }
 
-QImage RGBParade::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+int RGBParade::binComponents() const
+{
+    return ScopeBins::RgbColumns;
+}
+
+QImage RGBParade::renderGfxScope(uint accelerationFactor, const ScopeFrame &frame)
 {
     QTime start = QTime::currentTime();
     start.start();
 
     int paintmode = ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt();
-    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), qimage, (RGBParadeGenerator::PaintMode) paintmode,
-                                                    m_aAxis->isChecked(), m_aGradRef->isChecked(), accelerationFactor);
+    QSharedPointer<const ScopeBins> bins = frame.bins(ScopeBins::RgbColumns, false, sampleBudget(frame, accelerationFactor));
+    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), *bins, (RGBParadeGenerator::PaintMode) paintmode,
+                                                    m_aAxis->isChecked(), m_aGradRef->isChecked());
     emit signalScopeRenderingFinished(start.elapsed(), accelerationFactor);
     return parade;
 }
@@ -9,9 +9,13 @@
  ***************************************************************************/
 
 #include "rgbparadegenerator.h"
+#include "scopebins.h"
 #include "klocalizedstring.h"
 #include <QColor>
 #include <QPainter>
+#include <QVector>
+#include <cmath>
+#include <string.h>
 
 #define CHOP255(a) ((255) < (a) ? (255) : (a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -34,13 +38,13 @@ RGBParadeGenerator::RGBParadeGenerator()
 {
 }
 
-QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QImage &image,
+QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const ScopeBins &bins,
                                               const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
-                                              bool drawGradientRef, uint accelFactor)
+                                              bool drawGradientRef)
 {
-    Q_ASSERT(accelFactor >= 1);
-
-    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    // Parts need at least one pixel
+    if (paradeSize.width() < 20 + distRight + 3 || paradeSize.height() <= distBottom || bins.columns() <= 0 || bins.sampleCount() == 0
+            || (bins.components() & ScopeBins::RgbColumns) == 0) {
         return QImage();
 
     } else {
@@ -51,88 +55,65 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
         const uint ww = paradeSize.width();
         const uint wh = paradeSize.height();
-        const uint iw = image.bytesPerLine();
-        const uint ih = image.height();
-        const uint byteCount = iw*ih;   // Note that 1 px = 4 B
 
         const uchar offset = 10;
         const uint partW = (ww - 2*offset - distRight) / 3;
         const uint partH = wh - distBottom;
 
         // Statistics
-        uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0, r, g, b;
+        uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0;
 
 
         // Number of input pixels that will fall on one scope pixel.
         // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-        const float pixelDepth = (float)((byteCount>>2) / accelFactor)/(partW*255);
+        const float pixelDepth = (float)bins.sampleCount()/(partW*255);
         const float gain = 255/(8*pixelDepth);
 //        qDebug() << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
         QImage unscaled(ww-distRight, 256, QImage::Format_ARGB32);
         unscaled.fill(qRgba(0, 0, 0, 0));
 
-        const float wPrediv = (float)(partW-1)/(iw-1);
-
-        StructRGB paradeVals[partW][256];
-        for (uint i = 0; i < partW; ++i) {
-            for (uint j = 0; j < 256; ++j) {
-                paradeVals[i][j].r = 0;
-                paradeVals[i][j].g = 0;
-                paradeVals[i][j].b = 0;
+        const float wPrediv = bins.columns() > 1 ? (float)(partW-1)/(bins.columns()-1) : 0;
+
+        QVector<StructRGB> paradeVals(partW*256);
+        memset(paradeVals.data(), 0, paradeVals.size()*sizeof(StructRGB));
+
+        for (int col = 0; col < bins.columns(); ++col) {
+            const uint *r = bins.redColumn(col);
+            const uint *g = bins.greenColumn(col);
+            const uint *b = bins.blueColumn(col);
+            StructRGB *vals = paradeVals.data() + (uint)(col*wPrediv)*256;
+            for (int j = 0; j < 256; ++j) {
+                vals[j].r += r[j];
+                vals[j].g += g[j];
+                vals[j].b += b[j];
+                if (r[j] > 0) { minR = qMin<uchar>(minR, j); maxR = qMax<uchar>(maxR, j); }
+                if (g[j] > 0) { minG = qMin<uchar>(minG, j); maxG = qMax<uchar>(maxG, j); }
+                if (b[j] > 0) { minB = qMin<uchar>(minB, j); maxB = qMax<uchar>(maxB, j); }
             }
         }
 
-        const uchar *bits = image.bits();
-        const uint stepsize = image.depth() / 8 *accelFactor;
-
-        for (uint i = 0, x = 0; i < byteCount; i += stepsize) {
-            QRgb *col = (QRgb *)bits;
-            r = qRed(*col);
-            g = qGreen(*col);
-            b = qBlue(*col);
-
-            double dx = x*wPrediv;
-
-            paradeVals[(int)dx][r].r++;
-            paradeVals[(int)dx][g].g++;
-            paradeVals[(int)dx][b].b++;
-
-
-            if (r < minR) { minR = r; }
-            if (g < minG) { minG = g; }
-            if (b < minB) { minB = b; }
-            if (r > maxR) { maxR = r; }
-            if (g > maxG) { maxG = g; }
-            if (b > maxB) { maxB = b; }
-
-            bits += stepsize;
-            x += stepsize;
-            x %= iw; // Modulo image width, to represent the current x position in the image
-        }
-
 
         const uint offset1 = partW + offset;
         const uint offset2 = 2*partW + 2*offset;
-        switch(paintMode) {
-        case PaintMode_RGB:
-            for (uint i = 0; i < partW; ++i) {
-                for (uint j = 0; j < 256; ++j) {
-                    unscaled.setPixel(i,         j, qRgba(255,10,10, CHOP255(gain*paradeVals[i][j].r)));
-                    unscaled.setPixel(i+offset1, j, qRgba(10,255,10, CHOP255(gain*paradeVals[i][j].g)));
-                    unscaled.setPixel(i+offset2, j, qRgba(10,10,255, CHOP255(gain*paradeVals[i][j].b)));
-                }
-            }
-            break;
-        default:
+        const bool white = paintMode != PaintMode_RGB;
+        const QRgb red = white ? qRgb(255,255,255) : qRgb(255,10,10);
+        const QRgb green = white ? qRgb(255,255,255) : qRgb(10,255,10);
+        const QRgb blue = white ? qRgb(255,255,255) : qRgb(10,10,255);
+        // Only the alpha channel depends on the count, which saturates quickly
+        const uint lutSize = qMin<float>(65536, ceil(255/gain)) + 1;
+        QVector<uint> alpha(lutSize);
+        for (uint n = 0; n < lutSize; ++n) {
+            alpha[n] = (uint) CHOP255(gain*n) << 24;
+        }
+        for (uint j = 0; j < 256; ++j) {
+            QRgb *line = (QRgb *) unscaled.scanLine(j);
             for (uint i = 0; i < partW; ++i) {
-                for (uint j = 0; j < 256; ++j) {
-                    unscaled.setPixel(i,         j, qRgba(255,255,255, CHOP255(gain*paradeVals[i][j].r)));
-                    unscaled.setPixel(i+offset1, j, qRgba(255,255,255, CHOP255(gain*paradeVals[i][j].g)));
-                    unscaled.setPixel(i+offset2, j, qRgba(255,255,255, CHOP255(gain*paradeVals[i][j].b)));
-                }
+                const StructRGB &val = paradeVals.at(i*256 + j);
+                line[i]         = (red & 0xffffff)   | alpha.at(qMin(val.r, lutSize-1));
+                line[i+offset1] = (green & 0xffffff) | alpha.at(qMin(val.g, lutSize-1));
+                line[i+offset2] = (blue & 0xffffff)  | alpha.at(qMin(val.b, lutSize-1));
             }
-            break;
         }
 
         // Scale the image to the target height. Scaling is not accomplished before because
@@ -16,6 +16,7 @@
 class QColor;
 class QImage;
 class QSize;
+class ScopeBins;
 class RGBParadeGenerator : public QObject
 {
     Q_OBJECT
@@ -23,8 +24,9 @@ public:
     enum PaintMode { PaintMode_RGB, PaintMode_White };
 
     RGBParadeGenerator();
-    QImage calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode,
-                              bool drawAxis, bool drawGradientRef, uint accelFactor = 1);
+    /** Paints the ScopeBins::RgbColumns counts of \c bins. */
+    QImage calculateRGBParade(const QSize &paradeSize, const ScopeBins &bins, const RGBParadeGenerator::PaintMode paintMode,
+                              bool drawAxis, bool drawGradientRef);
 
     static const QColor colHighlight;
     static const QColor colLight;
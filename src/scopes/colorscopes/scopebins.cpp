@@ -0,0 +1,454 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "scopebins.h"
+#include "scopeframe.h"
+#include "scopesampler.h"
+
+#include <QImage>
+#include <QThread>
+#include <QtConcurrent>
+
+const int ScopeBins::maxColumns = 1024;
+
+namespace {
+
+// Histogram offsets in BinBand::histograms and ScopeBins::m_histograms
+enum { HistLuma = 0, HistRed = 256, HistGreen = 512, HistBlue = 768, HistSize = 1024 };
+
+/** A vertical band of the frame, binned by one thread.
+    Column counts go straight to the shared arrays since bands do not share columns,
+    histograms and chroma are merged afterwards. */
+struct BinBand
+{
+    const ScopeFrame *frame;
+    QImage image;
+    int components;
+    bool rec709;
+    const ScopeSampler *sampler;
+    const ScopeSampler *chromaSampler;
+    const int *columnOf;
+    int x0;
+    int x1;
+    uint *lumaColumns;
+    uint *redColumns;
+    uint *greenColumns;
+    uint *blueColumns;
+    QVector<uint> histograms;
+    QVector<uint> chroma;
+    // Last luma seen for a Cb/Cr value (planes) or last colour (RGB frames)
+    QVector<uchar> chromaLuma;
+    QVector<QRgb> chromaColors;
+    uint samples;
+    uint chromaSamples;
+};
+
+/** Sample positions of a row of sampler cells falling into the band */
+struct SampleRow
+{
+    explicit SampleRow(int size) : x(size), y(size), column(size), count(0) {}
+    void collect(const BinBand &band, const ScopeSampler &sampler, int row, int scale)
+    {
+        const int cell0 = band.x0 / scale / sampler.cellWidth();
+        const int cell1 = qMin(sampler.columns(), (band.x1 - 1) / scale / sampler.cellWidth() + 1);
+        count = 0;
+        for (int c = cell0; c < cell1; ++c) {
+            const int sx = sampler.x(c, row);
+            if (sx * scale < band.x0 || sx * scale >= band.x1) {
+                // Jittered into the neighbour band
+                continue;
+            }
+            x[count] = sx;
+            y[count] = sampler.y(c, row);
+            column[count] = band.columnOf[sx * scale];
+            ++count;
+        }
+    }
+    QVector<int> x;
+    QVector<int> y;
+    QVector<int> column;
+    int count;
+};
+
+/** Counts a row of samples, the values having been converted to plain arrays before
+    so that the conversion loops stay free of branches and memory scattering. */
+void countSamples(BinBand &band, const SampleRow &samples, const uchar *luma, const uchar *red, const uchar *green, const uchar *blue)
+{
+    const int n = samples.count;
+    const int *columnOf = samples.column.constData();
+    if (band.lumaColumns) {
+        for (int i = 0; i < n; ++i) {
+            band.lumaColumns[(columnOf[i] << 8) + luma[i]]++;
+        }
+    }
+    if (band.redColumns) {
+        for (int i = 0; i < n; ++i) {
+            const int base = columnOf[i] << 8;
+            band.redColumns[base + red[i]]++;
+            band.greenColumns[base + green[i]]++;
+            band.blueColumns[base + blue[i]]++;
+        }
+    }
+    uint *hist = band.histograms.data();
+    if (band.components & ScopeBins::LumaHistogram) {
+        for (int i = 0; i < n; ++i) {
+            hist[HistLuma + luma[i]]++;
+        }
+    }
+    if (band.components & ScopeBins::RgbHistogram) {
+        for (int i = 0; i < n; ++i) {
+            hist[HistRed + red[i]]++;
+            hist[HistGreen + green[i]]++;
+            hist[HistBlue + blue[i]]++;
+        }
+    }
+    band.samples += n;
+}
+
+void binPlanes(BinBand &band)
+{
+    const ScopeFrame &frame = *band.frame;
+    const int w = frame.width();
+    const int cw = frame.chromaWidth();
+    const int ch = frame.chromaHeight();
+    const bool wantLuma = (band.components & (ScopeBins::LumaColumns | ScopeBins::LumaHistogram)) != 0;
+    const bool wantRgb = cw > 0 && ch > 0 && (band.components & (ScopeBins::RgbColumns | ScopeBins::RgbHistogram)) != 0;
+    const ScopeFrame::YuvMatrix matrix(frame.isRec709());
+    const uchar *yPlane = frame.yPlane();
+    const uchar *uPlane = frame.uPlane();
+    const uchar *vPlane = frame.vPlane();
+
+    // Studio range to [0,255]
+    uchar expand[256];
+    for (int i = 0; i < 256; ++i) {
+        expand[i] = ScopeFrame::YuvMatrix::clampByte((i - 16) * 255 / 219);
+    }
+
+    if (wantLuma || wantRgb) {
+        const ScopeSampler &sampler = *band.sampler;
+        SampleRow samples(sampler.columns());
+        QVector<uchar> values(4 * sampler.columns());
+        uchar *luma = values.data();
+        uchar *red = luma + sampler.columns();
+        uchar *green = red + sampler.columns();
+        uchar *blue = green + sampler.columns();
+        QVector<uchar> rawLuma(sampler.columns());
+        for (int row = 0; row < sampler.rows(); ++row) {
+            samples.collect(band, sampler, row, 1);
+            const int n = samples.count;
+            for (int i = 0; i < n; ++i) {
+                rawLuma[i] = yPlane[samples.y.at(i) * w + samples.x.at(i)];
+            }
+            if (wantLuma) {
+                for (int i = 0; i < n; ++i) {
+                    luma[i] = expand[rawLuma.at(i)];
+                }
+            }
+            if (wantRgb) {
+                for (int i = 0; i < n; ++i) {
+                    const int c = qMin(samples.y.at(i) / 2, ch - 1) * cw + qMin(samples.x.at(i) / 2, cw - 1);
+                    const QRgb rgb = matrix.toRgb(rawLuma.at(i), uPlane[c], vPlane[c]);
+                    red[i] = qRed(rgb);
+                    green[i] = qGreen(rgb);
+                    blue[i] = qBlue(rgb);
+                }
+            }
+            countSamples(band, samples, luma, red, green, blue);
+        }
+    }
+
+    if (band.components & ScopeBins::Chroma) {
+        // Chroma has its own sampling since there is one sample per 2x2 pixels
+        const ScopeSampler &sampler = *band.chromaSampler;
+        SampleRow samples(sampler.columns());
+        uint *chroma = band.chroma.data();
+        uchar *chromaLuma = band.chromaLuma.data();
+        for (int row = 0; row < sampler.rows(); ++row) {
+            samples.collect(band, sampler, row, 2);
+            for (int i = 0; i < samples.count; ++i) {
+                const int cx = samples.x.at(i);
+                const int cy = samples.y.at(i);
+                const int index = uPlane[cy * cw + cx] | (vPlane[cy * cw + cx] << 8);
+                chroma[index]++;
+                chromaLuma[index] = yPlane[2 * cy * w + 2 * cx];
+            }
+            band.chromaSamples += samples.count;
+        }
+    }
+}
+
+void binImage(BinBand &band)
+{
+    const QImage &image = band.image;
+    const ScopeSampler &sampler = *band.sampler;
+    // 16.16 fixed point luma coefficients, see http://www.poynton.com/ColorFAQ.html
+    const int kr = band.rec709 ? 13926 : 19595;
+    const int kg = band.rec709 ? 46885 : 38470;
+    const int kb = band.rec709 ? 4725 : 7471;
+
+    SampleRow samples(sampler.columns());
+    QVector<QRgb> pixels(sampler.columns());
+    QVector<uchar> values(4 * sampler.columns());
+    uchar *luma = values.data();
+    uchar *red = luma + sampler.columns();
+    uchar *green = red + sampler.columns();
+    uchar *blue = green + sampler.columns();
+    uint *chroma = band.chroma.data();
+    QRgb *chromaColors = band.chromaColors.data();
+    const bool wantChroma = (band.components & ScopeBins::Chroma) != 0;
+
+    for (int row = 0; row < sampler.rows(); ++row) {
+        samples.collect(band, sampler, row, 1);
+        const int n = samples.count;
+        for (int i = 0; i < n; ++i) {
+            pixels[i] = ((const QRgb *) image.constScanLine(samples.y.at(i)))[samples.x.at(i)];
+        }
+        for (int i = 0; i < n; ++i) {
+            red[i] = qRed(pixels.at(i));
+            green[i] = qGreen(pixels.at(i));
+            blue[i] = qBlue(pixels.at(i));
+        }
+        for (int i = 0; i < n; ++i) {
+            luma[i] = (kr * red[i] + kg * green[i] + kb * blue[i] + 32768) >> 16;
+        }
+        countSamples(band, samples, luma, red, green, blue);
+        if (wantChroma) {
+            // Rec. 601 Cb/Cr in studio range, coefficients scaled by 224/255
+            for (int i = 0; i < n; ++i) {
+                const int cb = ScopeFrame::YuvMatrix::clampByte((-9714 * red[i] - 19071 * green[i] + 28785 * blue[i] + (128 << 16) + 32768) >> 16);
+                const int cr = ScopeFrame::YuvMatrix::clampByte((28785 * red[i] - 24103 * green[i] - 4681 * blue[i] + (128 << 16) + 32768) >> 16);
+                const int index = cb | (cr << 8);
+                chroma[index]++;
+                chromaColors[index] = pixels.at(i);
+            }
+            band.chromaSamples += n;
+        }
+    }
+}
+
+void binBand(BinBand &band)
+{
+    if (band.frame->hasYuv()) {
+        binPlanes(band);
+    } else {
+        binImage(band);
+    }
+}
+
+}
+
+ScopeBins::ScopeBins() :
+    m_components(0),
+    m_rec709(false),
+    m_sampleBudget(0),
+    m_columns(0),
+    m_sampleCount(0),
+    m_chromaSampleCount(0)
+{
+}
+
+void ScopeBins::compute(const ScopeFrame &frame, int components, bool rec709, uint sampleBudget)
+{
+    m_components = components;
+    m_rec709 = rec709;
+    m_sampleBudget = sampleBudget;
+    m_sampleCount = 0;
+    m_chromaSampleCount = 0;
+    m_columns = 0;
+    const int w = frame.width();
+    const int h = frame.height();
+    if (w <= 0 || h <= 0 || components == 0) {
+        return;
+    }
+    const ScopeSampler sampler(w, h, sampleBudget);
+    const ScopeSampler chromaSampler(frame.chromaWidth(), frame.chromaHeight(), sampleBudget);
+
+    QImage image;
+    if (!frame.hasYuv()) {
+        image = frame.image();
+        if (image.depth() != 32) {
+            image = image.convertToFormat(QImage::Format_RGB32);
+        }
+    }
+
+    m_columns = qMin(w, maxColumns);
+    QVector<int> columnOf(w);
+    for (int x = 0; x < w; ++x) {
+        columnOf[x] = x * m_columns / w;
+    }
+    if (components & LumaColumns) {
+        m_lumaColumns.fill(0, m_columns * 256);
+    }
+    if (components & RgbColumns) {
+        m_redColumns.fill(0, m_columns * 256);
+        m_greenColumns.fill(0, m_columns * 256);
+        m_blueColumns.fill(0, m_columns * 256);
+    }
+
+    // Split the columns into one band per core
+    const int bandCount = qBound(1, QThread::idealThreadCount(), m_columns);
+    QVector<BinBand> bands(bandCount);
+    for (int i = 0; i < bandCount; ++i) {
+        BinBand &band = bands[i];
+        const int c0 = i * m_columns / bandCount;
+        const int c1 = (i + 1) * m_columns / bandCount;
+        band.frame = &frame;
+        band.image = image;
+        band.components = components;
+        band.rec709 = rec709;
+        band.sampler = &sampler;
+        band.chromaSampler = &chromaSampler;
+        band.columnOf = columnOf.constData();
+        // First image column falling into column c0 (resp. c1)
+        band.x0 = (c0 * w + m_columns - 1) / m_columns;
+        band.x1 = (c1 * w + m_columns - 1) / m_columns;
+        band.lumaColumns = (components & LumaColumns) ? m_lumaColumns.data() : NULL;
+        band.redColumns = (components & RgbColumns) ? m_redColumns.data() : NULL;
+        band.greenColumns = (components & RgbColumns) ? m_greenColumns.data() : NULL;
+        band.blueColumns = (components & RgbColumns) ? m_blueColumns.data() : NULL;
+        band.histograms.fill(0, HistSize);
+        if (components & Chroma) {
+            band.chroma.fill(0, 65536);
+            if (frame.hasYuv()) {
+                band.chromaLuma.resize(65536);
+            } else {
+                band.chromaColors.resize(65536);
+            }
+        }
+        band.samples = 0;
+        band.chromaSamples = 0;
+    }
+
+    if (bandCount == 1) {
+        binBand(bands[0]);
+    } else {
+        QtConcurrent::blockingMap(bands, binBand);
+    }
+
+    // Merge the band results
+    m_histograms.fill(0, HistSize);
+    if (components & Chroma) {
+        m_chroma.fill(0, 65536);
+        m_chromaColors.fill(0, 65536);
+    }
+    QVector<uchar> chromaLuma;
+    if ((components & Chroma) && frame.hasYuv()) {
+        chromaLuma.fill(0, 65536);
+    }
+    for (int i = 0; i < bandCount; ++i) {
+        const BinBand &band = bands.at(i);
+        m_sampleCount += band.samples;
+        m_chromaSampleCount += band.chromaSamples;
+        for (int j = 0; j < HistSize; ++j) {
+            m_histograms[j] += band.histograms.at(j);
+        }
+        if (components & Chroma) {
+            for (int j = 0; j < 65536; ++j) {
+                const uint count = band.chroma.at(j);
+                if (count > 0) {
+                    m_chroma[j] += count;
+                    if (frame.hasYuv()) {
+                        chromaLuma[j] = band.chromaLuma.at(j);
+                    } else {
+                        m_chromaColors[j] = band.chromaColors.at(j);
+                    }
+                }
+            }
+        }
+    }
+    if (!chromaLuma.isEmpty()) {
+        const ScopeFrame::YuvMatrix matrix(frame.isRec709());
+        for (int j = 0; j < 65536; ++j) {
+            if (m_chroma.at(j) > 0) {
+                m_chromaColors[j] = matrix.toRgb(chromaLuma.at(j), j & 0xff, j >> 8);
+            }
+        }
+    }
+}
+
+int ScopeBins::components() const
+{
+    return m_components;
+}
+
+bool ScopeBins::rec709() const
+{
+    return m_rec709;
+}
+
+uint ScopeBins::sampleBudget() const
+{
+    return m_sampleBudget;
+}
+
+int ScopeBins::columns() const
+{
+    return m_columns;
+}
+
+uint ScopeBins::sampleCount() const
+{
+    return m_sampleCount;
+}
+
+uint ScopeBins::chromaSampleCount() const
+{
+    return m_chromaSampleCount;
+}
+
+const uint *ScopeBins::lumaColumn(int column) const
+{
+    return m_lumaColumns.constData() + (column << 8);
+}
+
+const uint *ScopeBins::redColumn(int column) const
+{
+    return m_redColumns.constData() + (column << 8);
+}
+
+const uint *ScopeBins::greenColumn(int column) const
+{
+    return m_greenColumns.constData() + (column << 8);
+}
+
+const uint *ScopeBins::blueColumn(int column) const
+{
+    return m_blueColumns.constData() + (column << 8);
+}
+
+const uint *ScopeBins::lumaHistogram() const
+{
+    return m_histograms.constData() + HistLuma;
+}
+
+const uint *ScopeBins::redHistogram() const
+{
+    return m_histograms.constData() + HistRed;
+}
+
+const uint *ScopeBins::greenHistogram() const
+{
+    return m_histograms.constData() + HistGreen;
+}
+
+const uint *ScopeBins::blueHistogram() const
+{
+    return m_histograms.constData() + HistBlue;
+}
+
+const uint *ScopeBins::chroma() const
+{
+    return m_chroma.constData();
+}
+
+const QRgb *ScopeBins::chromaColors() const
+{
+    return m_chromaColors.constData();
+}
@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SCOPEBINS_H
+#define SCOPEBINS_H
+
+#include <QRgb>
+#include <QVector>
+
+class ScopeFrame;
+
+/**
+  \brief Value counts of a frame, as needed by the colour scopes.
+
+  All requested counts are gathered in a single pass over the frame.
+  The frame is cut into vertical bands which are processed in parallel,
+  so that the per-column counts of different bands never overlap.
+  Image columns are grouped into at most maxColumns columns, which is
+  more than a scope is ever wide.
+
+  Luma is on [0,255] (studio range expanded), chroma is stored as
+  studio range Cb/Cr so that (value-128)/224 gives Pb/Pr.
+  */
+class ScopeBins
+{
+public:
+    enum Component {
+        LumaColumns = 1 << 0,   ///< 256 luma counts per column (waveform)
+        RgbColumns = 1 << 1,    ///< 256 counts per column and channel (RGB parade)
+        LumaHistogram = 1 << 2,
+        RgbHistogram = 1 << 3,
+        Chroma = 1 << 4         ///< 256x256 Cb/Cr counts (vectorscope)
+    };
+    static const int maxColumns;
+
+    ScopeBins();
+
+    /** Counts the values of @param frame for the OR-ed Component flags @param components.
+        At most @param sampleBudget pixels are read, chosen by a ScopeSampler (0 reads all).
+        @param rec709 selects the luma coefficients for RGB frames, frames with planes
+        use their encoded luma. */
+    void compute(const ScopeFrame &frame, int components, bool rec709, uint sampleBudget = 0);
+
+    int components() const;
+    bool rec709() const;
+    uint sampleBudget() const;
+    /** Number of columns the image columns are grouped into. */
+    int columns() const;
+    /** Number of pixels counted in the luma and RGB bins. */
+    uint sampleCount() const;
+    /** Number of samples counted in the chroma bins. */
+    uint chromaSampleCount() const;
+
+    /** 256 counts for @param column */
+    const uint *lumaColumn(int column) const;
+    const uint *redColumn(int column) const;
+    const uint *greenColumn(int column) const;
+    const uint *blueColumn(int column) const;
+
+    const uint *lumaHistogram() const;
+    const uint *redHistogram() const;
+    const uint *greenHistogram() const;
+    const uint *blueHistogram() const;
+
+    /** 256x256 counts, indexed by Cb + 256*Cr */
+    const uint *chroma() const;
+    /** Colour of a pixel that had this Cb/Cr value, same indexing as chroma() */
+    const QRgb *chromaColors() const;
+
+private:
+    int m_components;
+    bool m_rec709;
+    uint m_sampleBudget;
+    int m_columns;
+    uint m_sampleCount;
+    uint m_chromaSampleCount;
+    QVector<uint> m_lumaColumns;
+    QVector<uint> m_redColumns;
+    QVector<uint> m_greenColumns;
+    QVector<uint> m_blueColumns;
+    QVector<uint> m_histograms;
+    QVector<uint> m_chroma;
+    QVector<QRgb> m_chromaColors;
+};
+
+#endif // SCOPEBINS_H
@@ -0,0 +1,167 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "scopeframe.h"
+
+#include "scopebins.h"
+
+#include <QMutex>
+
+struct ScopeFrame::BinCache
+{
+    BinCache() : components(0) {}
+    QMutex mutex;
+    int components;
+    QSharedPointer<const ScopeBins> bins;
+};
+
+ScopeFrame::YuvMatrix::YuvMatrix(bool rec709) :
+    cy(76309),
+    crv(rec709 ? 117506 : 104595),
+    cgu(rec709 ? 13959 : 25624),
+    cgv(rec709 ? 34931 : 53281),
+    cbu(rec709 ? 138412 : 132252)
+{
+}
+
+ScopeFrame::ScopeFrame() :
+    m_cache(new BinCache)
+{
+}
+
+ScopeFrame::ScopeFrame(const SharedFrame &frame) :
+    m_cache(new BinCache)
+{
+    if (frame.is_valid() && frame.get_image_format() == mlt_image_yuv420p && frame.get_image()) {
+        m_frame = frame;
+    }
+}
+
+ScopeFrame::ScopeFrame(const QImage &image) :
+    m_image(image),
+    m_cache(new BinCache)
+{
+}
+
+bool ScopeFrame::isValid() const
+{
+    return hasYuv() || !m_image.isNull();
+}
+
+bool ScopeFrame::hasYuv() const
+{
+    return m_frame.is_valid();
+}
+
+int ScopeFrame::width() const
+{
+    return hasYuv() ? m_frame.get_image_width() : m_image.width();
+}
+
+int ScopeFrame::height() const
+{
+    return hasYuv() ? m_frame.get_image_height() : m_image.height();
+}
+
+const uchar *ScopeFrame::yPlane() const
+{
+    return hasYuv() ? m_frame.get_image() : NULL;
+}
+
+const uchar *ScopeFrame::uPlane() const
+{
+    return hasYuv() ? m_frame.get_image() + width() * height() : NULL;
+}
+
+const uchar *ScopeFrame::vPlane() const
+{
+    return hasYuv() ? uPlane() + chromaWidth() * chromaHeight() : NULL;
+}
+
+int ScopeFrame::chromaWidth() const
+{
+    return width() / 2;
+}
+
+int ScopeFrame::chromaHeight() const
+{
+    return height() / 2;
+}
+
+bool ScopeFrame::isRec709() const
+{
+    return hasYuv() && m_frame.get_int("colorspace") == 709;
+}
+
+QImage ScopeFrame::image() const
+{
+    if (!m_image.isNull() || !hasYuv()) {
+        return m_image;
+    }
+    const int w = width();
+    const int h = height();
+    const int cw = chromaWidth();
+    const int ch = chromaHeight();
+    if (w <= 0 || h <= 0 || cw <= 0 || ch <= 0) {
+        return m_image;
+    }
+    const YuvMatrix matrix(isRec709());
+    QImage rgb(w, h, QImage::Format_RGB32);
+    for (int y = 0; y < h; ++y) {
+        const uchar *lumaLine = yPlane() + y * w;
+        const int chromaLine = qMin(y / 2, ch - 1) * cw;
+        const uchar *uLine = uPlane() + chromaLine;
+        const uchar *vLine = vPlane() + chromaLine;
+        QRgb *out = (QRgb *) rgb.scanLine(y);
+        for (int x = 0; x < w; ++x) {
+            const int c = qMin(x / 2, cw - 1);
+            out[x] = matrix.toRgb(lumaLine[x], uLine[c], vLine[c]);
+        }
+    }
+    m_image = rgb;
+    return m_image;
+}
+
+QRgb ScopeFrame::pixel(int x, int y) const
+{
+    if (!hasYuv()) {
+        return m_image.pixel(x, y);
+    }
+    const int c = qMin(y / 2, chromaHeight() - 1) * chromaWidth() + qMin(x / 2, chromaWidth() - 1);
+    return YuvMatrix(isRec709()).toRgb(yPlane()[y * width() + x], uPlane()[c], vPlane()[c]);
+}
+
+void ScopeFrame::setBinComponents(int components)
+{
+    QMutexLocker lock(&m_cache->mutex);
+    m_cache->components = components;
+}
+
+QSharedPointer<const ScopeBins> ScopeFrame::bins(int components, bool rec709, uint sampleBudget) const
+{
+    QMutexLocker lock(&m_cache->mutex);
+    const QSharedPointer<const ScopeBins> &cached = m_cache->bins;
+    // The luma of RGB frames depends on the chosen recommendation
+    const bool recMatters = !hasYuv() && (components & (ScopeBins::LumaColumns | ScopeBins::LumaHistogram)) != 0;
+    // Bins counted with more samples than asked for are fine
+    const bool enoughSamples = cached && (cached->sampleBudget() == 0 || (sampleBudget > 0 && cached->sampleBudget() >= sampleBudget));
+    if (enoughSamples && (cached->components() & components) == components && (!recMatters || cached->rec709() == rec709)) {
+        return cached;
+    }
+    // Bin everything the other scopes will ask for in the same pass
+    int all = components | m_cache->components;
+    if (cached && (!recMatters || cached->rec709() == rec709)) {
+        all |= cached->components();
+    }
+    ScopeBins *bins = new ScopeBins;
+    bins->compute(*this, all, rec709, enoughSamples ? cached->sampleBudget() : sampleBudget);
+    m_cache->bins = QSharedPointer<const ScopeBins>(bins);
+    return m_cache->bins;
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SCOPEFRAME_H
+#define SCOPEFRAME_H
+
+#include "monitor/scopes/sharedframe.h"
+
+#include <QImage>
+#include <QSharedPointer>
+
+class ScopeBins;
+
+/**
+  \brief A frame analysed by the colour scopes.
+
+  It either references the decoded Y'CbCr 4:2:0 planes of a SharedFrame,
+  without copying them, or holds an RGB image when the monitor only has
+  the frame on the GPU.
+  Scopes working on luma or chroma read the planes directly, the RGB
+  image is only converted from the planes when a scope asks for it.
+  */
+class ScopeFrame
+{
+public:
+    ScopeFrame();
+    explicit ScopeFrame(const SharedFrame &frame);
+    explicit ScopeFrame(const QImage &image);
+
+    bool isValid() const;
+    /** @brief True if the Y'CbCr planes are available. */
+    bool hasYuv() const;
+    int width() const;
+    int height() const;
+
+    /** @brief Luma plane, width() bytes per line, studio range. */
+    const uchar *yPlane() const;
+    /** @brief Chroma planes, chromaWidth() bytes per line. */
+    const uchar *uPlane() const;
+    const uchar *vPlane() const;
+    int chromaWidth() const;
+    int chromaHeight() const;
+    /** @brief True if the planes use the Rec. 709 matrix, Rec. 601 otherwise. */
+    bool isRec709() const;
+
+    /** @brief The frame as RGB, converted from the planes on first use. */
+    QImage image() const;
+    /** @brief RGB value of a single pixel, without converting the whole frame. */
+    QRgb pixel(int x, int y) const;
+
+    /** @brief Counts of the frame values covering @param components (ScopeBins::Component flags).
+        They are computed on first use and shared by all copies of the frame, so scopes showing the
+        same frame are served by a single pass. @param rec709 is only used for the luma of RGB frames,
+        @param sampleBudget is the maximum number of pixels read (0 for all). */
+    QSharedPointer<const ScopeBins> bins(int components, bool rec709, uint sampleBudget = 0) const;
+    /** @brief Components computed along with the first bins() request. */
+    void setBinComponents(int components);
+
+    /** @brief Studio range Y'CbCr to full range R'G'B', 16.16 fixed point. */
+    struct YuvMatrix {
+        explicit YuvMatrix(bool rec709);
+        inline QRgb toRgb(int y, int u, int v) const
+        {
+            const int luma = (y - 16) * cy + 32768;
+            const int d = u - 128;
+            const int e = v - 128;
+            return qRgb(clampByte((luma + crv * e) >> 16),
+                        clampByte((luma - cgu * d - cgv * e) >> 16),
+                        clampByte((luma + cbu * d) >> 16));
+        }
+        static inline int clampByte(int value)
+        {
+            return value < 0 ? 0 : (value > 255 ? 255 : value);
+        }
+        const int cy, crv, cgu, cgv, cbu;
+    };
+
+private:
+    struct BinCache;
+    SharedFrame m_frame;
+    mutable QImage m_image;
+    QSharedPointer<BinCache> m_cache;
+};
+
+#endif // SCOPEFRAME_H
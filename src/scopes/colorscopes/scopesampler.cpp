@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "scopesampler.h"
+
+#include <cmath>
+
+ScopeSampler::ScopeSampler(int width, int height, uint budget) :
+    m_width(qMax(0, width)),
+    m_height(qMax(0, height)),
+    m_cellWidth(1),
+    m_cellHeight(1),
+    m_complete(true)
+{
+    const double pixels = (double) m_width * m_height;
+    if (budget > 0 && pixels > budget) {
+        // Pixels per cell, the cells being as square as possible
+        const double area = pixels / budget;
+        m_cellWidth = qBound(1, (int) floor(sqrt(area)), qMax(1, m_width));
+        m_cellHeight = qBound(1, (int) ceil(area / m_cellWidth), qMax(1, m_height));
+        m_complete = false;
+    }
+    m_columns = (m_width + m_cellWidth - 1) / m_cellWidth;
+    m_rows = (m_height + m_cellHeight - 1) / m_cellHeight;
+}
+
+bool ScopeSampler::isComplete() const
+{
+    return m_complete;
+}
+
+int ScopeSampler::cellWidth() const
+{
+    return m_cellWidth;
+}
+
+int ScopeSampler::cellHeight() const
+{
+    return m_cellHeight;
+}
+
+int ScopeSampler::columns() const
+{
+    return m_columns;
+}
+
+int ScopeSampler::rows() const
+{
+    return m_rows;
+}
+
+uint ScopeSampler::sampleCount() const
+{
+    return (uint) m_columns * m_rows;
+}
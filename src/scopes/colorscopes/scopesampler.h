@@ -0,0 +1,74 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SCOPESAMPLER_H
+#define SCOPESAMPLER_H
+
+#include <QtGlobal>
+
+/**
+  \brief Chooses the pixels analysed by the colour scopes when a frame has more pixels than the budget.
+
+  The image is cut into a grid of cells of the same size, close to square,
+  with one pixel taken per cell at a pseudo random position inside it.
+  Every part of the image is represented in proportion to its area, unlike
+  skipping whole lines which drops horizontal structures like titles or
+  letterboxing, and the positions only depend on the image size so that
+  the scopes stay stable from frame to frame.
+  */
+class ScopeSampler
+{
+public:
+    /** @param budget maximum number of samples, 0 to take every pixel */
+    ScopeSampler(int width, int height, uint budget);
+
+    /** True if every pixel is sampled. */
+    bool isComplete() const;
+    int cellWidth() const;
+    int cellHeight() const;
+    /** Number of cells in a row (resp. column) of the grid. */
+    int columns() const;
+    int rows() const;
+    /** Number of samples, one per cell. */
+    uint sampleCount() const;
+
+    /** Position of the sample in cell (@param column, @param row). */
+    inline int x(int column, int row) const
+    {
+        const int x0 = column * m_cellWidth;
+        return x0 + (m_complete ? 0 : jitter(column, row) % qMin(m_cellWidth, m_width - x0));
+    }
+    inline int y(int column, int row) const
+    {
+        const int y0 = row * m_cellHeight;
+        return y0 + (m_complete ? 0 : (jitter(column, row) >> 16) % qMin(m_cellHeight, m_height - y0));
+    }
+
+private:
+    int m_width;
+    int m_height;
+    int m_cellWidth;
+    int m_cellHeight;
+    int m_columns;
+    int m_rows;
+    bool m_complete;
+
+    /** Deterministic hash of a cell, the same cell always gives the same position */
+    static inline uint jitter(int column, int row)
+    {
+        uint h = (uint) column * 73856093u ^ (uint) row * 19349663u;
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        return h;
+    }
+};
+
+#endif // SCOPESAMPLER_H
@@ -11,6 +11,7 @@
 #include "vectorscope.h"
 #include "colorplaneexport.h"
 #include "vectorscopegenerator.h"
+#include "scopebins.h"
 #include "colortools.h"
 
 #include "klocalizedstring.h"
@@ -257,7 +258,12 @@ QImage Vectorscope::renderHUD(uint)
     return hud;
 }
 
-QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+int Vectorscope::binComponents() const
+{
+    return ScopeBins::Chroma;
+}
+
+QImage Vectorscope::renderGfxScope(uint accelerationFactor, const ScopeFrame &frame)
 {
     QTime start = QTime::currentTime();
     QImage scope;
@@ -269,10 +275,11 @@ QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage
         VectorscopeGenerator::ColorSpace colorSpace = m_aColorSpace_YPbPr->isChecked() ?
                                                       VectorscopeGenerator::ColorSpace_YPbPr : VectorscopeGenerator::ColorSpace_YUV;
         VectorscopeGenerator::PaintMode paintMode = (VectorscopeGenerator::PaintMode) ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt();
+        QSharedPointer<const ScopeBins> bins = frame.bins(ScopeBins::Chroma, false, sampleBudget(frame, accelerationFactor));
         scope = m_vectorscopeGenerator->calculateVectorscope(m_scopeRect.size(),
-                                                             qimage,
+                                                             *bins,
                                                              m_gain, paintMode, colorSpace,
-                                                             m_aAxisEnabled->isChecked(), accelerationFactor);
+                                                             m_aAxisEnabled->isChecked());
 
     }
 
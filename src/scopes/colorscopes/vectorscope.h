@@ -35,12 +35,13 @@ public:
     ~Vectorscope();
 
     QString widgetName() const;
+    int binComponents() const;
 
 protected:
     ///// Implemented methods /////
     QRect scopeRect();
     QImage renderHUD(uint accelerationFactor);
-    QImage renderGfxScope(uint accelerationFactor, const QImage &);
+    QImage renderGfxScope(uint accelerationFactor, const ScopeFrame &frame);
     QImage renderBackground(uint accelerationFactor);
     bool isHUDDependingOnInput() const;
     bool isScopeDependingOnInput() const;
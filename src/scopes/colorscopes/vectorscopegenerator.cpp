@@ -70,6 +70,7 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "scopebins.h"
 #include <math.h>
 #include <QImage>
 
@@ -115,12 +116,13 @@ QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF
                    (targetSize.height()-1) * (1 - (point.y()+1)/2) );
 }
 
-QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain,
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const ScopeBins &bins, const float &gain,
                                                   const VectorscopeGenerator::PaintMode &paintMode,
                                                   const VectorscopeGenerator::ColorSpace &colorSpace,
-                                                  bool, uint accelFactor) const
+                                                  bool) const
 {
-    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || bins.chromaSampleCount() == 0
+            || (bins.components() & ScopeBins::Chroma) == 0) {
         // Invalid size
         return QImage();
     }
@@ -130,134 +132,132 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
     scope.fill(qRgba(0,0,0,0));
 
-    const uchar *bits = image.bits();
+    // Studio range Cb/Cr (16-240) gives Pb/Pr on [-0.5,0.5], U and V are scaled versions of them.
+    const double uScale = colorSpace == VectorscopeGenerator::ColorSpace_YUV ? .872 : 1;
+    const double vScale = colorSpace == VectorscopeGenerator::ColorSpace_YUV ? 1.2296 : 1;
+
+    // Just an average for the number of chroma samples per scope pixel.
+    const double avgPxPerPx = (double) bins.chromaSampleCount()/scope.size().width()/scope.size().height();
+
+    const uint *chroma = bins.chroma();
+    const QRgb *colors = bins.chromaColors();
+    for (int cr = 0; cr < 256; ++cr) {
+        const double v = vScale * (cr - 128) / 224;
+        for (int cb = 0; cb < 256; ++cb) {
+            const int index = cb | (cr << 8);
+            if (chroma[index] > 0) {
+                const double u = uScale * (cb - 128) / 224;
+                plotPoint(scope, vectorscopeSize, u, v, gain, paintMode, colorSpace, colors[index], avgPxPerPx, chroma[index]);
+            }
+        }
+    }
+    return scope;
+}
 
+/** Result of approaching 255 from @param value by @param rate of the remaining distance, @param hits times. */
+static inline int approach255(int value, double rate, uint hits)
+{
+    const double remaining = (255 - value) * pow(qMax(0., 1 - rate), (double) hits);
+    return qBound(0, (int) (255 - remaining), 255);
+}
+
+void VectorscopeGenerator::plotPoint(QImage &scope, const QSize &vectorscopeSize, double u, double v, const float &gain,
+                                     const VectorscopeGenerator::PaintMode &paintMode,
+                                     const VectorscopeGenerator::ColorSpace &colorSpace,
+                                     QRgb col, double avgPxPerPx, uint hits) const
+{
     double dy, dr, dg, db, dmax;
-    double /*y,*/ u, v;
     QPoint pt;
     QRgb px;
 
-    const int stepsize = image.depth() / 8 * accelFactor;
+    pt = mapToCircle(vectorscopeSize, QPointF(SCALING*gain*u, SCALING*gain*v));
 
-    // Just an average for the number of image pixels per scope pixel.
-    // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see: http://doc.trolltech.org/4.6/qimage.html#bytesPerLine
-    double avgPxPerPx = (double) image.depth() / 8 *(image.bytesPerLine()*image.height())/scope.size().width()/scope.size().height()/accelFactor;
+    if (pt.x() >= scope.width() || pt.x() < 0
+        || pt.y() >= scope.height() || pt.y() < 0) {
+        // Point lies outside (because of scaling), don't plot it
 
-    for (int i = 0; i < (image.bytesPerLine()*image.height()); i+= stepsize) {
-        QRgb *col = (QRgb *) bits;
+    } else {
 
-        int r = qRed(*col);
-        int g = qGreen(*col);
-        int b = qBlue(*col);
+        // Draw the pixel using the chosen draw mode.
+        switch (paintMode) {
+        case PaintMode_YUV:
+            // see yuvColorWheel
+            dy = 128; // Default Y value. Lower = darker.
 
-        switch (colorSpace) {
-        case VectorscopeGenerator::ColorSpace_YUV:
-//             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double) -0.0005781* r -0.001135 * g +0.001713 * b;
-            v = (double)  0.002411 * r -0.002019 * g -0.0003921* b;
-            break;
-        case VectorscopeGenerator::ColorSpace_YPbPr:
-        default:
-//             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double) -0.0006671* r -0.001299 * g +0.0019608* b;
-            v = (double)  0.001961 * r -0.001642 * g -0.0003189* b;
-            break;
-        }
+            // Calculate the RGB values from YUV/YPbPr
+            switch (colorSpace) {
+            case VectorscopeGenerator::ColorSpace_YUV:
+                dr = dy + 290.8*v;
+                dg = dy - 100.6*u - 148*v;
+                db = dy + 517.2*u;
+                break;
+            case VectorscopeGenerator::ColorSpace_YPbPr:
+            default:
+                dr = dy + 357.5*v;
+                dg = dy - 87.75*u - 182*v;
+                db = dy + 451.9*u;
+                break;
+            }
 
 
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING*gain*u, SCALING*gain*v));
-
-        if (pt.x() >= scope.width() || pt.x() < 0
-            || pt.y() >= scope.height() || pt.y() < 0) {
-            // Point lies outside (because of scaling), don't plot it
-
-        } else {
-
-            // Draw the pixel using the chosen draw mode.
-            switch (paintMode) {
-            case PaintMode_YUV:
-                // see yuvColorWheel
-                dy = 128; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8*v;
-                    dg = dy - 100.6*u - 148*v;
-                    db = dy + 517.2*u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5*v;
-                    dg = dy - 87.75*u - 182*v;
-                    db = dy + 451.9*u;
-                    break;
-                }
-
-
-                if (dr < 0) dr = 0;
-                if (dg < 0) dg = 0;
-                if (db < 0) db = 0;
-                if (dr > 255) dr = 255;
-                if (dg > 255) dg = 255;
-                if (db > 255) db = 255;
-
-                scope.setPixel(pt, qRgba(dr, dg, db, 255));
-                break;
+            if (dr < 0) dr = 0;
+            if (dg < 0) dg = 0;
+            if (db < 0) db = 0;
+            if (dr > 255) dr = 255;
+            if (dg > 255) dg = 255;
+            if (db > 255) db = 255;
 
-            case PaintMode_Chroma:
-                dy = 200; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8*v;
-                    dg = dy - 100.6*u - 148*v;
-                    db = dy + 517.2*u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5*v;
-                    dg = dy - 87.75*u - 182*v;
-                    db = dy + 451.9*u;
-                    break;
-                }
-
-                // Scale the RGB values back to max 255
-                dmax = dr;
-                if (dg > dmax) dmax = dg;
-                if (db > dmax) dmax = db;
-                dmax = 255/dmax;
-
-                dr *= dmax;
-                dg *= dmax;
-                db *= dmax;
-
-                scope.setPixel(pt, qRgba(dr, dg, db, 255));
-                break;
-            case PaintMode_Original:
-                scope.setPixel(pt, *col);
-                break;
-            case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px)+(255-qRed(px))/(3*avgPxPerPx), qGreen(px)+20*(255-qGreen(px))/(avgPxPerPx),
-                                         qBlue(px)+(255-qBlue(px))/(avgPxPerPx), qAlpha(px)+(255-qAlpha(px))/(avgPxPerPx)));
-                break;
-            case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px)+ceil((255-(float)qRed(px))/(4*avgPxPerPx)), 255,
-                                         qBlue(px)+ceil((255-(float)qBlue(px))/(avgPxPerPx)), qAlpha(px)+ceil((255-(float)qAlpha(px))/(avgPxPerPx))));
+            scope.setPixel(pt, qRgba(dr, dg, db, 255));
+            break;
+
+        case PaintMode_Chroma:
+            dy = 200; // Default Y value. Lower = darker.
+
+            // Calculate the RGB values from YUV/YPbPr
+            switch (colorSpace) {
+            case VectorscopeGenerator::ColorSpace_YUV:
+                dr = dy + 290.8*v;
+                dg = dy - 100.6*u - 148*v;
+                db = dy + 517.2*u;
                 break;
-            case PaintMode_Black:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0,0,0, qAlpha(px)+(255-qAlpha(px))/20));
+            case VectorscopeGenerator::ColorSpace_YPbPr:
+            default:
+                dr = dy + 357.5*v;
+                dg = dy - 87.75*u - 182*v;
+                db = dy + 451.9*u;
                 break;
             }
-        }
 
-        bits += stepsize;
-    }
-    return scope;
-}
+            // Scale the RGB values back to max 255
+            dmax = dr;
+            if (dg > dmax) dmax = dg;
+            if (db > dmax) dmax = db;
+            dmax = 255/dmax;
 
+            dr *= dmax;
+            dg *= dmax;
+            db *= dmax;
 
+            scope.setPixel(pt, qRgba(dr, dg, db, 255));
+            break;
+        case PaintMode_Original:
+            scope.setPixel(pt, col);
+            break;
+        case PaintMode_Green:
+            // Each hit brightens the pixel by a part of the remaining distance to white
+            px = scope.pixel(pt);
+            scope.setPixel(pt, qRgba(approach255(qRed(px), 1/(3*avgPxPerPx), hits), approach255(qGreen(px), 20/avgPxPerPx, hits),
+                                     approach255(qBlue(px), 1/avgPxPerPx, hits), approach255(qAlpha(px), 1/avgPxPerPx, hits)));
+            break;
+        case PaintMode_Green2:
+            px = scope.pixel(pt);
+            scope.setPixel(pt, qRgba(approach255(qRed(px), 1/(4*avgPxPerPx), hits), 255,
+                                     approach255(qBlue(px), 1/avgPxPerPx, hits), approach255(qAlpha(px), 1/avgPxPerPx, hits)));
+            break;
+        case PaintMode_Black:
+            px = scope.pixel(pt);
+            scope.setPixel(pt, qRgba(0,0,0, approach255(qAlpha(px), 1./20, hits)));
+            break;
+        }
+    }
+}
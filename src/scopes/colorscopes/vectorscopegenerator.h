@@ -18,6 +18,7 @@ class QImage;
 class QPoint;
 class QPointF;
 class QSize;
+class ScopeBins;
 
 class VectorscopeGenerator : public QObject
 {
@@ -27,14 +28,22 @@ public:
     enum ColorSpace { ColorSpace_YUV, ColorSpace_YPbPr };
     enum PaintMode { PaintMode_Green, PaintMode_Green2, PaintMode_Original, PaintMode_Chroma, PaintMode_YUV, PaintMode_Black };
 
-    QImage calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain,
+    /** Paints the ScopeBins::Chroma counts of \c bins. */
+    QImage calculateVectorscope(const QSize &vectorscopeSize, const ScopeBins &bins, const float &gain,
                                 const VectorscopeGenerator::PaintMode &paintMode,
                                 const VectorscopeGenerator::ColorSpace &colorSpace,
-                                bool, uint accelFactor = 1) const;
+                                bool) const;
 
     QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
     static const float scaling;
 
+private:
+    /** Paint the point for a u/v value (on [-0.5,0.5] for YPbPr) found @param hits times, col being its original colour. */
+    void plotPoint(QImage &scope, const QSize &vectorscopeSize, double u, double v, const float &gain,
+                   const VectorscopeGenerator::PaintMode &paintMode,
+                   const VectorscopeGenerator::ColorSpace &colorSpace,
+                   QRgb col, double avgPxPerPx, uint hits) const;
+
 signals:
     void signalCalculationFinished(const QImage &image, uint ms);
 
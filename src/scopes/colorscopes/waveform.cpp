@@ -10,6 +10,7 @@
 
 #include "waveform.h"
 #include "waveformgenerator.h"
+#include "scopebins.h"
 // For reading out the project resolution
 #include "kdenlivesettings.h"
 #include "dialogs/profilesdialog.h"
@@ -166,15 +167,21 @@ QImage Waveform::renderHUD(uint)
     return hud;
 }
 
-QImage Waveform::renderGfxScope(uint accelFactor, const QImage &qimage)
+int Waveform::binComponents() const
+{
+    return ScopeBins::LumaColumns;
+}
+
+QImage Waveform::renderGfxScope(uint accelFactor, const ScopeFrame &frame)
 {
     QTime start = QTime::currentTime();
     start.start();
 
     const int paintmode = ui->paintMode->itemData(ui->paintMode->currentIndex()).toInt();
     WaveformGenerator::Rec rec = m_aRec601->isChecked() ? WaveformGenerator::Rec_601 : WaveformGenerator::Rec_709;
-    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0,m_paddingBottom), qimage,
-                                                         (WaveformGenerator::PaintMode) paintmode, true, rec, accelFactor);
+    QSharedPointer<const ScopeBins> bins = frame.bins(ScopeBins::LumaColumns, rec == WaveformGenerator::Rec_709, sampleBudget(frame, accelFactor));
+    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0,m_paddingBottom), *bins,
+                                                         (WaveformGenerator::PaintMode) paintmode, true);
 
     emit signalScopeRenderingFinished(start.elapsed(), 1);
     return wave;
@@ -31,6 +31,7 @@ public:
     ~Waveform();
 
     QString widgetName() const;
+    int binComponents() const;
 
 protected:
     virtual void readConfig();
@@ -52,7 +53,7 @@ private:
     /// Implemented methods ///
     QRect scopeRect();
     QImage renderHUD(uint);
-    QImage renderGfxScope(uint, const QImage &);
+    QImage renderGfxScope(uint, const ScopeFrame &frame);
     QImage renderBackground(uint);
     bool isHUDDependingOnInput() const;
     bool isScopeDependingOnInput() const;
@@ -9,6 +9,7 @@
  ***************************************************************************/
 
 #include "waveformgenerator.h"
+#include "scopebins.h"
 
 #include <cmath>
 
@@ -16,8 +17,10 @@
 #include <QPainter>
 #include <QSize>
 #include <QTime>
+#include <QVector>
 
 #define CHOP255(a) ((255) < (a) ? (255) : (a))
+#define CHOP0255(a) ((a) < (0) ? (0) : ((a) > (255) ? (255) : (a)))
 
 WaveformGenerator::WaveformGenerator()
 {
@@ -27,110 +30,93 @@ WaveformGenerator::~WaveformGenerator()
 {
 }
 
-QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode,
-                                            bool drawAxis, WaveformGenerator::Rec rec, uint accelFactor)
+QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const ScopeBins &bins, WaveformGenerator::PaintMode paintMode,
+                                            bool drawAxis)
 {
-    Q_ASSERT(accelFactor >= 1);
-
     //QTime time;
     //time.start();
 
     QImage wave(waveformSize, QImage::Format_ARGB32);
 
-    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || bins.columns() <= 0 || bins.sampleCount() == 0
+            || (bins.components() & ScopeBins::LumaColumns) == 0) {
         return QImage();
 
     } else {
 
-        // Fill with transparent color
-        wave.fill(qRgba(0,0,0,0));
-
         const uint ww = waveformSize.width();
         const uint wh = waveformSize.height();
-        const uint iw = image.bytesPerLine();
-        const uint ih = image.height();
-        const uint byteCount = iw*ih;
-
-        uint waveValues[waveformSize.width()][waveformSize.height()];
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                waveValues[i][j] = 0;
-            }
-        }
-
-        // Number of input pixels that will fall on one scope pixel.
-        // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-        const float pixelDepth = (float)((byteCount>>2) / accelFactor)/(ww*wh);
-        const float gain = 255/(8*pixelDepth);
-        //qDebug() << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
+        // Hits per scope pixel, column after column
+        QVector<uint> waveValues(ww*wh, 0);
 
         // Subtract 1 from sizes because we start counting from 0.
         // Not doing it would result in attempts to paint outside of the image.
         const float hPrediv = (float)(wh-1)/255;
-        const float wPrediv = (float)(ww-1)/(iw-1);
-
-        const uchar *bits = image.bits();
-	const int bpp = image.depth() / 8;
-
-        for (uint i = 0, x = 0; i < byteCount; i += bpp) {
-
-            Q_ASSERT(bits < image.bits() + byteCount);
-
-            double dY, dx, dy;
-            QRgb *col = (QRgb *)bits;
-
-            if (rec == WaveformGenerator::Rec_601) {
-                // CIE 601 Luminance
-                dY = .299*qRed(*col) + .587*qGreen(*col) + .114*qBlue(*col);
-            } else {
-                // CIE 709 Luminance
-                dY = .2125*qRed(*col) + .7154*qGreen(*col) + .0721*qBlue(*col);
-            }
-            // dY is on [0,255] now.
-
-            dy = dY*hPrediv;
-            dx = x*wPrediv;
-            waveValues[(int)dx][(int)dy]++;
-
-            bits += bpp;
-            x += bpp;
-            if (x > iw) {
-                x -= iw;
-                if (accelFactor > 1) {
-                    bits += bpp*iw*(accelFactor-1);
-                    i += bpp*iw*(accelFactor-1);
-                }
+        const float wPrediv = bins.columns() > 1 ? (float)(ww-1)/(bins.columns()-1) : 0;
+        uint rows[256];
+        for (int i = 0; i < 256; ++i) {
+            rows[i] = i*hPrediv;
+        }
+        uint maxValue = 0;
+        for (int col = 0; col < bins.columns(); ++col) {
+            const uint *counts = bins.lumaColumn(col);
+            uint *column = waveValues.data() + (uint)(col*wPrediv)*wh;
+            for (int i = 0; i < 256; ++i) {
+                column[rows[i]] += counts[i];
             }
         }
+        for (int i = 0; i < waveValues.size(); ++i) {
+            maxValue = qMax(maxValue, waveValues.at(i));
+        }
 
+        // Number of input pixels that will fall on one scope pixel.
+        // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
+        const float pixelDepth = (float)bins.sampleCount()/(ww*wh);
+        const float gain = 255/(8*pixelDepth);
+        //qDebug() << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
+
+        // The colour only depends on the hit count and every channel is saturated above a few thousands hits
+        // at most, so a lookup table replaces the per pixel logarithms.
+        float saturation;
         switch (paintMode) {
         case PaintMode_Green:
-            for (int i = 0; i < waveformSize.width(); ++i) {
-                for (int j = 0; j < waveformSize.height(); ++j) {
-                    // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                    wave.setPixel(i, waveformSize.height()-j-1, qRgba(CHOP255(52*log(0.1*gain*waveValues[i][j])),
-                                                                      CHOP255(52*log(gain*waveValues[i][j])),
-                                                                      CHOP255(52*log(.25*gain*waveValues[i][j])),
-                                                                      CHOP255(64*log(gain*waveValues[i][j]))));
-                }
-            }
+            saturation = exp(255./52)/(0.1*gain);
             break;
         case PaintMode_Yellow:
-            for (int i = 0; i < waveformSize.width(); ++i) {
-                for (int j = 0; j < waveformSize.height(); ++j) {
-                    wave.setPixel(i, waveformSize.height()-j-1, qRgba(255,242,0,   CHOP255(gain*waveValues[i][j])));
-                }
-            }
+            saturation = 255/gain;
             break;
         default:
-            for (int i = 0; i < waveformSize.width(); ++i) {
-                for (int j = 0; j < waveformSize.height(); ++j) {
-                    wave.setPixel(i, waveformSize.height()-j-1, qRgba(255,255,255, CHOP255(2*gain*waveValues[i][j])));
-                }
-            }
+            saturation = 255/(2*gain);
             break;
         }
+        const uint lutSize = qMin((float)maxValue, ceil(saturation)) + 1;
+        QVector<QRgb> lut(lutSize);
+        for (uint n = 0; n < lutSize; ++n) {
+            switch (paintMode) {
+            case PaintMode_Green:
+                // Logarithmic scale. Needs fine tuning by hand, but looks great.
+                lut[n] = n == 0 ? qRgba(0,0,0,0) : qRgba(CHOP0255(52*log(0.1*gain*n)),
+                                                         CHOP0255(52*log(gain*n)),
+                                                         CHOP0255(52*log(.25*gain*n)),
+                                                         CHOP0255(64*log(gain*n)));
+                break;
+            case PaintMode_Yellow:
+                lut[n] = qRgba(255,242,0, CHOP0255(gain*n));
+                break;
+            default:
+                lut[n] = qRgba(255,255,255, CHOP0255(2*gain*n));
+                break;
+            }
+        }
+
+        // Fill the scan lines, bottom line being luma 0
+        for (uint j = 0; j < wh; ++j) {
+            QRgb *line = (QRgb *) wave.scanLine(wh-j-1);
+            for (uint i = 0; i < ww; ++i) {
+                line[i] = lut.at(qMin(waveValues.at(i*wh + j), lutSize-1));
+            }
+        }
 
         if (drawAxis) {
             QPainter davinci(&wave);
@@ -155,5 +141,6 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
     return wave;
 }
 #undef CHOP255
+#undef CHOP0255
 
 
@@ -14,6 +14,7 @@
 #include <QObject>
 class QImage;
 class QSize;
+class ScopeBins;
 
 class WaveformGenerator : public QObject
 {
@@ -26,8 +27,9 @@ public:
     WaveformGenerator();
     ~WaveformGenerator();
 
-    QImage calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode,
-                             bool drawAxis, const WaveformGenerator::Rec rec, uint accelFactor = 1);
+    /** Paints the ScopeBins::LumaColumns counts of \c bins. */
+    QImage calculateWaveform(const QSize &waveformSize, const ScopeBins &bins, WaveformGenerator::PaintMode paintMode,
+                             bool drawAxis);
 
 //signals:
     //void signalCalculationFinished(QImage image, const uint &ms);
@@ -115,7 +115,7 @@ bool ScopeManager::addScope(AbstractGfxScopeWidget *colorScope, QDockWidget *col
 }
 
 
-void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples)
+void ScopeManager::slotDistributeAudio(const AudioBlock &audioBlock)
 {
 #ifdef DEBUG_SM
     qDebug() << "ScopeManager: Starting to distribute audio.";
@@ -124,7 +124,7 @@ void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int f
         // Distribute audio to all scopes that are visible and want to be refreshed
         if (!m_audioScopes[i].scope->visibleRegion().isEmpty()) {
             if (m_audioScopes[i].scope->autoRefreshEnabled()) {
-                m_audioScopes[i].scope->slotReceiveAudio(sampleData, freq, num_channels, num_samples);
+                m_audioScopes[i].scope->slotReceiveAudio(audioBlock);
 #ifdef DEBUG_SM
                 qDebug() << "ScopeManager: Distributed audio to " << m_audioScopes[i].scope->widgetName();
 #endif
@@ -134,13 +134,33 @@ void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int f
 }
 void ScopeManager::slotDistributeFrame(const QImage &image)
 {
+    distributeFrame(ScopeFrame(image));
+}
+
+void ScopeManager::slotDistributeSharedFrame(const SharedFrame &frame)
+{
+    distributeFrame(ScopeFrame(frame));
+}
+
+void ScopeManager::distributeFrame(ScopeFrame frame)
+{
+    // Let the first scope rendering the frame count the values for all of them
+    int components = 0;
+    for (int i = 0; i < m_colorScopes.size(); ++i) {
+        if (!m_colorScopes[i].scope->visibleRegion().isEmpty()
+                && (m_colorScopes[i].scope->autoRefreshEnabled() || m_colorScopes[i].singleFrameRequested)) {
+            components |= m_colorScopes[i].scope->binComponents();
+        }
+    }
+    frame.setBinComponents(components);
+    m_lastFrame = frame;
 #ifdef DEBUG_SM
     qDebug() << "ScopeManager: Starting to distribute frame.";
 #endif
     for (int i = 0; i < m_colorScopes.size(); ++i) {
         if (!m_colorScopes[i].scope->visibleRegion().isEmpty()) {
             if (m_colorScopes[i].scope->autoRefreshEnabled()) {
-                m_colorScopes[i].scope->slotRenderZoneUpdated(image);
+                m_colorScopes[i].scope->slotRenderZoneUpdated(frame);
 #ifdef DEBUG_SM
                 qDebug() << "ScopeManager: Distributed frame to " << m_colorScopes[i].scope->widgetName();
 #endif
@@ -148,7 +168,7 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
                 // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
                 // Force the scope to update.
                 m_colorScopes[i].singleFrameRequested = false;
-                m_colorScopes[i].scope->slotRenderZoneUpdated(image);
+                m_colorScopes[i].scope->slotRenderZoneUpdated(frame);
                 m_colorScopes[i].scope->forceUpdateScope();
 #ifdef DEBUG_SM
                 qDebug() << "ScopeManager: Distributed forced frame to " << m_colorScopes[i].scope->widgetName();
@@ -176,6 +196,12 @@ void ScopeManager::slotRequestFrame(const QString &widgetName)
     // in the distribution slots
     for (int i = 0; i < m_colorScopes.size(); ++i) {
         if (m_colorScopes[i].scope->widgetName() == widgetName) {
+            if (m_lastFrame.isValid()) {
+                // The current frame is already known, no need to render it again
+                m_colorScopes[i].scope->slotRenderZoneUpdated(m_lastFrame);
+                m_colorScopes[i].scope->forceUpdateScope();
+                return;
+            }
             m_colorScopes[i].singleFrameRequested = true;
             break;
         }
@@ -193,6 +219,7 @@ void ScopeManager::slotRequestFrame(const QString &widgetName)
 void ScopeManager::slotClearColorScopes()
 {
     m_lastConnectedRenderer = NULL;
+    m_lastFrame = ScopeFrame();
 }
 
 
@@ -206,6 +233,7 @@ void ScopeManager::slotUpdateActiveRenderer()
         m_lastConnectedRenderer->disconnect(this);
     }
 
+    m_lastFrame = ScopeFrame();
     m_lastConnectedRenderer = pCore->monitorManager()->activeRenderer();
     // DVD monitor shouldn't be monitored or will cause crash on deletion
     if (pCore->monitorManager()->isActive(Kdenlive::DvdMonitor)) m_lastConnectedRenderer = NULL;
@@ -214,6 +242,8 @@ void ScopeManager::slotUpdateActiveRenderer()
     if (m_lastConnectedRenderer != NULL) {
         connect(m_lastConnectedRenderer, SIGNAL(frameUpdated(QImage)),
                 this, SLOT(slotDistributeFrame(QImage)), Qt::UniqueConnection);
+        connect(m_lastConnectedRenderer, SIGNAL(sharedFrameUpdated(SharedFrame)),
+                this, SLOT(slotDistributeSharedFrame(SharedFrame)), Qt::UniqueConnection);
         connect(m_lastConnectedRenderer, &AbstractRender::audioSamplesSignal,
                 this, &ScopeManager::slotDistributeAudio, Qt::UniqueConnection);
 
@@ -288,6 +318,10 @@ void ScopeManager::checkActiveAudioScopes()
 void ScopeManager::checkActiveColourScopes()
 {
     bool imageStillRequested = imagesAcceptedByScopes();
+    if (!imageStillRequested) {
+        // Frames are not sent anymore, the last one will get outdated
+        m_lastFrame = ScopeFrame();
+    }
 
 #ifdef DEBUG_SM
     qDebug() << "ScopeManager: New frames still requested? " << imageStillRequested;
@@ -68,6 +68,8 @@ private:
     QList<GfxScopeData> m_colorScopes;
 
     AbstractRender *m_lastConnectedRenderer;
+    /** The last distributed frame, given to scopes requesting a frame without asking the renderer again. */
+    ScopeFrame m_lastFrame;
 
     QSignalMapper *m_signalMapper;
 
@@ -81,6 +83,8 @@ private:
       \see audioAcceptedByScopes()
       */
     bool imagesAcceptedByScopes() const;
+    /** Gives @param frame to the visible colour scopes. */
+    void distributeFrame(ScopeFrame frame);
 
     /**
       Creates all the scopes in audioscopes/ and colorscopes/.
@@ -124,7 +128,9 @@ private slots:
     void checkActiveColourScopes();
 
     void slotDistributeFrame(const QImage &image);
-    void slotDistributeAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples);
+    /** Distributes the decoded planes of a frame, RGB is only computed by the scopes that need it. */
+    void slotDistributeSharedFrame(const SharedFrame &frame);
+    void slotDistributeAudio(const AudioBlock &audioBlock);
     /**
       Allows a scope to explicitly request a new frame, even if the scope's autoRefresh is disabled.
       */
@@ -22,6 +22,10 @@
 #include "customtrackscene.h"
 #include "kdenlivesettings.h"
 #include "customtrackview.h"
+#include "timeline.h"
+#include "track.h"
+#include "trackitemindex.h"
+#include "snapindex.h"
 
 #include "mlt++/Mlt.h"
 
@@ -43,9 +47,13 @@ AbstractClipItem::AbstractClipItem(const ItemInfo &info, const QRectF& rect, dou
         , m_fps(fps)
         , m_isMainSelectedClip(false)
 	, m_keyframeView(QFontInfo(QApplication::font()).pixelSize() * 0.7, this)
+        , m_itemIndex(NULL)
+        , m_snapIndex(NULL)
 {
     setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges, true);
+    // Also get notified when a parent group moves us, to keep the track index up to date
+    setFlag(QGraphicsItem::ItemSendsScenePositionChanges, true);
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
     setPen(Qt::NoPen);
     connect(&m_keyframeView, SIGNAL(updateKeyframes(const QRectF&)), this, SLOT(doUpdate(const QRectF&)));
@@ -56,6 +64,8 @@ AbstractClipItem::AbstractClipItem(const ItemInfo &info, const QRectF& rect, dou
 
 AbstractClipItem::~AbstractClipItem()
 {
+    if (m_itemIndex) m_itemIndex->remove(this);
+    if (m_snapIndex) m_snapIndex->removeSource(this);
 }
 
 void AbstractClipItem::doUpdate(const QRectF &r)
@@ -179,11 +189,57 @@ void AbstractClipItem::updateItem(int track)
     m_info.startPos = GenTime((int) scenePos().x(), m_fps);
     if (m_info.cropDuration > GenTime())
 	m_info.endPos = m_info.startPos + m_info.cropDuration;
+    updateItemIndex();
 }
 
 void AbstractClipItem::updateRectGeometry()
 {
     setRect(0, 0, cropDuration().frames(m_fps) - 0.02, rect().height());
+    updateItemIndex();
+}
+
+void AbstractClipItem::updateItemIndex()
+{
+    TrackItemIndex *index = NULL;
+    CustomTrackScene *scene = projectScene();
+    if (scene && scene->timeline()) {
+        Track *tk = scene->timeline()->track(trackForPos((int) scenePos().y()));
+        if (tk) index = tk->itemIndex();
+    }
+    if (m_itemIndex && m_itemIndex != index) {
+        m_itemIndex->remove(this);
+    }
+    m_itemIndex = index;
+    if (m_itemIndex) {
+        const qreal start = scenePos().x() + rect().x();
+        m_itemIndex->update(this, start, start + rect().width());
+    }
+    SnapIndex *snaps = scene ? scene->snapIndex() : NULL;
+    if (m_snapIndex && m_snapIndex != snaps) {
+        m_snapIndex->removeSource(this);
+    }
+    m_snapIndex = snaps;
+    if (m_snapIndex) {
+        m_snapIndex->setSource(this, snapFrames());
+    }
+}
+
+QVector<int> AbstractClipItem::snapFrames() const
+{
+    QVector<int> frames;
+    const qreal start = scenePos().x() + rect().x();
+    // Item width is 0.02 frame shorter than its duration
+    frames << qRound(start) << qRound(start + rect().width());
+    return frames;
+}
+
+//virtual
+QVariant AbstractClipItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    if (change == ItemScenePositionHasChanged || change == ItemSceneHasChanged) {
+        updateItemIndex();
+    }
+    return QGraphicsRectItem::itemChange(change, value);
 }
 
 void AbstractClipItem::resizeStart(int posx, bool hasSizeLimit, bool /*emitChange*/)
@@ -224,6 +280,7 @@ void AbstractClipItem::resizeStart(int posx, bool hasSizeLimit, bool /*emitChang
     // set crop from start to 0 (isn't relevant as this only happens for color clips, images)
     if (negCropStart)
         m_info.cropStart = GenTime();
+    updateItemIndex();
 }
 
 void AbstractClipItem::resizeEnd(int posx, bool /*emitChange*/)
@@ -254,6 +311,7 @@ void AbstractClipItem::resizeEnd(int posx, bool /*emitChange*/)
         }
         if (fixItem) setRect(0, 0, cropDuration().frames(m_fps) - 0.02, rect().height());
     }
+    updateItemIndex();
 }
 
 GenTime AbstractClipItem::startPos() const
@@ -29,10 +29,13 @@
 #include "mlt++/MltAnimation.h"
 
 #include <QGraphicsRectItem>
+#include <QVector>
 #include <QGraphicsWidget>
 #include <QTimer>
 
 class CustomTrackScene;
+class TrackItemIndex;
+class SnapIndex;
 class QGraphicsSceneMouseEvent;
 
 
@@ -51,6 +54,10 @@ public:
     CustomTrackScene* projectScene();
     void updateRectGeometry();
     void updateItem(int track);
+    /** @brief Update this item's entries in its track's item index and in the snap index after a change. */
+    void updateItemIndex();
+    /** @brief Frames this item registers as snap points (edges, markers). */
+    virtual QVector<int> snapFrames() const;
     void setItemLocked(bool locked);
     bool isItemLocked() const;
     void closeAnimation();
@@ -115,7 +122,12 @@ protected:
     /** @brief True if this is the last clip the user selected */
     bool m_isMainSelectedClip;
     KeyframeView m_keyframeView;
+    /** @brief The track index this item is currently registered in */
+    TrackItemIndex *m_itemIndex;
+    /** @brief The snap index this item registered its snap points in */
+    SnapIndex *m_snapIndex;
 
+    virtual QVariant itemChange(GraphicsItemChange change, const QVariant &value);
     void mousePressEvent(QGraphicsSceneMouseEvent * event);
     void mouseReleaseEvent(QGraphicsSceneMouseEvent * event);
     void mouseMoveEvent(QGraphicsSceneMouseEvent * event);
@@ -648,7 +648,9 @@ void ClipItem::paint(QPainter *painter,
         }
     }
     // draw audio thumbnails
-    if (KdenliveSettings::audiothumbnails() && m_speed == 1.0 && m_clipState != PlaylistState::VideoOnly && m_originalClipState != PlaylistState::VideoOnly && (((m_clipType == AV || m_clipType == Playlist) && (exposed.bottom() > (rect().height() / 2) || m_originalClipState == PlaylistState::AudioOnly || m_clipState == PlaylistState::AudioOnly)) || m_clipType == Audio) && m_audioThumbReady && !m_binClip->audioFrameCache.isEmpty()) {
+    AudioLevelsPtr audioLevels;
+    if (m_audioThumbReady) audioLevels = m_binClip->audioLevels();
+    if (KdenliveSettings::audiothumbnails() && m_speed == 1.0 && m_clipState != PlaylistState::VideoOnly && m_originalClipState != PlaylistState::VideoOnly && (((m_clipType == AV || m_clipType == Playlist) && (exposed.bottom() > (rect().height() / 2) || m_originalClipState == PlaylistState::AudioOnly || m_clipState == PlaylistState::AudioOnly)) || m_clipType == Audio) && !audioLevels.isNull() && !audioLevels->isEmpty()) {
         int startpixel = qMax(0, (int) exposed.left());
         int endpixel = qMax(0, (int) (exposed.right() + 0.5) + 1);
         QRectF mappedRect = mapped;
@@ -657,7 +659,7 @@ void ClipItem::paint(QPainter *painter,
         }
 
         double scale = transformation.m11();
-        int channels = m_binClip->audioChannels();
+        int channels = audioLevels->channels();
         int cropLeft = m_info.cropStart.frames(m_fps);
         double startx = transformation.map(QPoint(startpixel, 0)).x();
         double endx = transformation.map(QPoint(endpixel, 0)).x();
@@ -665,7 +667,9 @@ void ClipItem::paint(QPainter *painter,
         if (scale < 1) {
             offset = (int) (1.0 / scale);
         }
-        int audioLevelCount = m_binClip->audioFrameCache.count() - 1;
+        // When zoomed in, draw the sub-frame peaks, grouped so that a point is not narrower than a pixel
+        const int subFrames = audioLevels->subFrames();
+        const int subStep = qMax(1, (int) (subFrames / scale));
         if (!KdenliveSettings::displayallchannels()) {
             // simplified audio
             int channelHeight = mappedRect.height();
@@ -676,10 +680,14 @@ void ClipItem::paint(QPainter *painter,
                 QPainterPath positiveChannelPath;
                 positiveChannelPath.moveTo(startx, mappedRect.bottom());
                 for (; i < endpixel + cropLeft + offset; i += offset) {
-                    double value = m_binClip->audioFrameCache.at(qMin(i * channels, audioLevelCount)).toDouble() / 256;
-                    for (int channel = 1; channel < channels; channel ++) {
-                        value = qMax(value, m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256);
+                    if (subFrames > 0) {
+                        for (int j = 0; j < subFrames; j += subStep) {
+                            double value = audioLevels->subFramePeak(-1, i * subFrames + j, i * subFrames + j + subStep) / 256.0;
+                            positiveChannelPath.lineTo(startx + (i - startOffset + (j + subStep / 2.0) / subFrames) * scale, mappedRect.bottom() - (value * channelHeight));
+                        }
+                        continue;
                     }
+                    double value = audioLevels->maxLevel(i) / 256.0;
                     positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - (value * channelHeight));
                 }
                 positiveChannelPath.lineTo(startx + (i - startOffset) * scale, mappedRect.bottom());
@@ -687,17 +695,19 @@ void ClipItem::paint(QPainter *painter,
                 painter->setBrush(QBrush(QColor(80, 80, 150, 200)));
                 painter->drawPath(positiveChannelPath);
             } else {
-                // Pixels are larger than frames, draw simple lines
-                painter->setPen(QColor(80, 80, 150, 200));
+                // Pixels are larger than frames, draw the peak of the frames covered by each pixel
+                QVector<QLineF> lines;
+                lines.reserve((int) (endx - startx) + 1);
                 i = startx;
+                int framePos = startOffset;
                 for (; i < endx; i++) {
-                    int framePos = startOffset + ((i - startx) / scale);
-                    double value = m_binClip->audioFrameCache.at(qMin(framePos * channels, audioLevelCount)).toDouble() / 256;
-                    for (int channel = 1; channel < channels; channel ++) {
-                        value = qMax(value, m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256);
-                    }
-                    painter->drawLine(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
+                    int nextPos = startOffset + ((i + 1 - startx) / scale);
+                    double value = audioLevels->maxPeak(framePos, nextPos) / 256.0;
+                    lines << QLineF(i, mappedRect.bottom() - (value * channelHeight), i, mappedRect.bottom());
+                    framePos = nextPos;
                 }
+                painter->setPen(QColor(80, 80, 150, 200));
+                painter->drawLines(lines);
             }
         } else if (channels >= 0) {
             int channelHeight = (int) (mappedRect.height() + 0.5) / channels;
@@ -717,7 +727,16 @@ void ClipItem::paint(QPainter *painter,
                     i = startOffset;
                     painter->drawLine(startx, mappedRect.bottom() - y, endx, mappedRect.bottom() - y);
                     for (; i < endpixel + cropLeft + offset; i += offset) {
-                        value = m_binClip->audioFrameCache.at(qMin(i * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
+                        if (subFrames > 0) {
+                            for (int j = 0; j < subFrames; j += subStep) {
+                                value = audioLevels->subFramePeak(channel, i * subFrames + j, i * subFrames + j + subStep) / 256.0 * channelHeight / 2;
+                                double x = startx + (i - startOffset + (j + subStep / 2.0) / subFrames) * scale;
+                                positiveChannelPaths[channel].lineTo(x, mappedRect.bottom() - y - value);
+                                negativeChannelPaths[channel].lineTo(x, mappedRect.bottom() - y + value);
+                            }
+                            continue;
+                        }
+                        value = audioLevels->level(channel, i) / 256.0 * channelHeight / 2;
                         positiveChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y - value);
                         negativeChannelPaths[channel].lineTo(startx + (i - startOffset) * scale, mappedRect.bottom() - y + value);
                     }
@@ -738,16 +757,30 @@ void ClipItem::paint(QPainter *painter,
                     // Draw channel median line
                     painter->drawLine(startx, mappedRect.bottom() - (channelHeight * channel + channelHeight / 2), endx, mappedRect.bottom() - (channelHeight * channel + channelHeight / 2));
                 }
+                // Draw the peak of the frames covered by each pixel, and the quietest level inside it
+                QVector<QLineF> peakLines;
+                QVector<QLineF> floorLines;
+                peakLines.reserve(((int) (endx - startx) + 1) * channels);
+                floorLines.reserve(((int) (endx - startx) + 1) * channels);
                 int i = startx;
-                painter->setPen(QColor(80, 80, 150, 200));
+                int framePos = startOffset;
                 for (; i < endx; i++) {
-                    int framePos = startOffset + ((i - startx) / scale);
+                    int nextPos = startOffset + ((i + 1 - startx) / scale);
                     for (int channel = 0; channel < channels; channel ++) {
                         int y = channelHeight * channel + channelHeight / 2;
-                        value = m_binClip->audioFrameCache.at(qMin(framePos * channels + channel, audioLevelCount)).toDouble() / 256 * channelHeight / 2;
-                        painter->drawLine(i, mappedRect.bottom() - value - y, i, mappedRect.bottom() - y + value);
+                        quint8 min, max;
+                        audioLevels->peakRange(channel, framePos, nextPos, &min, &max);
+                        value = max / 256.0 * channelHeight / 2;
+                        peakLines << QLineF(i, mappedRect.bottom() - value - y, i, mappedRect.bottom() - y + value);
+                        value = min / 256.0 * channelHeight / 2;
+                        if (value >= 1) floorLines << QLineF(i, mappedRect.bottom() - value - y, i, mappedRect.bottom() - y + value);
                     }
+                    framePos = nextPos;
                 }
+                painter->setPen(QColor(80, 80, 150, 200));
+                painter->drawLines(peakLines);
+                painter->setPen(QColor(60, 60, 130));
+                painter->drawLines(floorLines);
             }
         }
         painter->setPen(QPen());
@@ -1031,6 +1064,22 @@ QList <GenTime> ClipItem::snapMarkers(const QList < GenTime > markers ) const
     return snaps;
 }
 
+QVector<int> ClipItem::snapFrames() const
+{
+    QVector<int> frames = AbstractClipItem::snapFrames();
+    if (!m_binClip) return frames;
+    QList <GenTime> markers;
+    QList <CommentedTime> commented = m_binClip->commentedSnapMarkers();
+    for (int i = 0; i < commented.count(); ++i) {
+        markers.append(commented.at(i).time());
+    }
+    markers = snapMarkers(markers);
+    for (int i = 0; i < markers.count(); ++i) {
+        frames.append((int) markers.at(i).frames(m_fps));
+    }
+    return frames;
+}
+
 QList <CommentedTime> ClipItem::commentedSnapMarkers() const
 {
     QList < CommentedTime > snaps;
@@ -1265,7 +1314,7 @@ QVariant ClipItem::itemChange(GraphicsItemChange change, const QVariant &value)
         if (parent) m_paintColor = m_baseColor.lighter(135);
         else m_paintColor = m_baseColor;
     }
-    return QGraphicsItem::itemChange(change, value);
+    return AbstractClipItem::itemChange(change, value);
 }
 
 int ClipItem::effectsCounter()
@@ -1577,7 +1626,8 @@ void ClipItem::setSpeed(const double speed, const int strobe)
     m_strobe = strobe;
     m_info.cropStart = GenTime((int)(m_speedIndependantInfo.cropStart.frames(m_fps) / qAbs(m_speed) + 0.5), m_fps);
     m_info.cropDuration = GenTime((int)(m_speedIndependantInfo.cropDuration.frames(m_fps) / qAbs(m_speed) + 0.5), m_fps);
-    //update();
+    // Markers positions depend on speed
+    updateItemIndex();
 }
 
 GenTime ClipItem::maxDuration() const
@@ -1910,6 +1960,8 @@ bool ClipItem::updateNormalKeyframes(QDomElement parameter, ItemInfo oldInfo)
 
 void ClipItem::slotRefreshClip()
 {
+    // Markers may have changed
+    updateItemIndex();
     update();
 }
 
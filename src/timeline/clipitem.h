@@ -127,6 +127,8 @@ public:
     /** @brief Gets clip's marker times.
     * @return A list of the times. */
     QList <GenTime> snapMarkers(const QList < GenTime > markers ) const;
+    /** @brief Clip edges and visible bin clip markers, as snap points. */
+    QVector<int> snapFrames() const;
     QList <CommentedTime> commentedSnapMarkers() const;
 
     /** @brief Gets the position of the fade in effect. */
@@ -507,6 +507,17 @@ void CustomRuler::paintEvent(QPaintEvent *e)
             QRectF rec(xPos, MAX_HEIGHT + 1, chunkWidth, PREVIEW_SIZE - 1);
             p.fillRect(rec, preview);
         }
+        // Chunks being rendered fill up with their progress
+        preview = QColor(240, 160, 0);
+        preview.setAlpha(160);
+        QMap<int, int>::const_iterator it = m_workingPreviews.constBegin();
+        for (; it != m_workingPreviews.constEnd(); ++it) {
+            double xPos = it.key() * m_factor  - m_offset;
+            if (xPos + chunkWidth < paintRect.x() || xPos > paintRect.right())
+                continue;
+            QRectF rec(xPos, MAX_HEIGHT + 1, chunkWidth * it.value() / 100, PREVIEW_SIZE - 1);
+            p.fillRect(rec, preview);
+        }
         preview = palette().dark().color();
         preview.setAlpha(70);
         p.fillRect(paintRect.left(), MAX_HEIGHT + 1, paintRect.width(), 2, preview);
@@ -551,6 +562,7 @@ bool CustomRuler::isUnderPreview(int start, int end)
 bool CustomRuler::updatePreview(int frame, bool rendered, bool refresh)
 {
     bool result = false;
+    m_workingPreviews.remove(frame);
     if (rendered) {
         m_renderingPreviews << frame;
         m_dirtyRenderingPreviews.removeAll(frame);
@@ -623,9 +635,21 @@ void CustomRuler::clearChunks()
 {
     m_renderingPreviews.clear();
     m_dirtyRenderingPreviews.clear();
+    m_workingPreviews.clear();
     update();
 }
 
+void CustomRuler::updateChunkProgress(int frame, int progress)
+{
+    if (progress < 0) {
+        m_workingPreviews.remove(frame);
+    } else {
+        m_workingPreviews.insert(frame, qMin(progress, 100));
+    }
+    if (!m_hidePreview)
+        update(frame * m_factor - offset(), MAX_HEIGHT, KdenliveSettings::timelinechunks() * m_factor + 1, PREVIEW_SIZE);
+}
+
 QList <int> CustomRuler::addChunks(QList <int> chunks, bool add)
 {
     qSort(chunks);
@@ -28,6 +28,7 @@
 
 #include <QWidget>
 #include <QPair>
+#include <QMap>
 
 #include "timeline/customtrackview.h"
 #include "timecode.h"
@@ -101,11 +102,15 @@ private:
     QMenu *m_goMenu;
     QList <int> m_renderingPreviews;
     QList <int> m_dirtyRenderingPreviews;
+    /** @brief Chunks currently being rendered, with their progress (0-100) */
+    QMap <int, int> m_workingPreviews;
 
 public slots:
     void slotMoveRuler(int newPos);
     void slotCursorMoved(int oldpos, int newpos);
     void updateRuler(int pos);
+    /** @brief A preview worker reported progress for a chunk, a negative progress removes it. */
+    void updateChunkProgress(int frame, int progress);
 
 private slots:
     void slotEditGuide();
@@ -32,6 +32,8 @@ CustomTrackScene::CustomTrackScene(Timeline *timeline, QObject *parent) :
 
 CustomTrackScene::~CustomTrackScene()
 {
+    // Delete items while our snap index is still alive, they unregister from it
+    clear();
 }
 
 double CustomTrackScene::getSnapPointForPos(double pos, bool doSnap)
@@ -40,41 +42,30 @@ double CustomTrackScene::getSnapPointForPos(double pos, bool doSnap)
         double maximumOffset;
         if (m_scale.x() > 3) maximumOffset = 10 / m_scale.x();
         else maximumOffset = 6 / m_scale.x();
-        for (int i = 0; i < m_snapPoints.size(); ++i) {
-            if (qAbs((int)(pos - m_snapPoints.at(i).frames(m_timeline->fps()))) < maximumOffset) {
-                return m_snapPoints.at(i).frames(m_timeline->fps());
-            }
-            if (m_snapPoints.at(i).frames(m_timeline->fps()) > pos)
-                break;
+        int snapped;
+        if (m_snapIndex.snap(pos, maximumOffset, &snapped)) {
+            return snapped;
         }
     }
     return GenTime(pos, m_timeline->fps()).frames(m_timeline->fps());
 }
 
-void CustomTrackScene::setSnapList(const QList <GenTime>& snaps)
+SnapIndex *CustomTrackScene::snapIndex()
 {
-    m_snapPoints = snaps;
+    return &m_snapIndex;
 }
 
 GenTime CustomTrackScene::previousSnapPoint(const GenTime &pos) const
 {
-    for (int i = 0; i < m_snapPoints.size(); ++i) {
-        if (m_snapPoints.at(i) >= pos) {
-            if (i == 0) return GenTime();
-            return m_snapPoints.at(i - 1);
-        }
-    }
-    return GenTime();
+    return GenTime(m_snapIndex.previousPoint((int) pos.frames(m_timeline->fps())), m_timeline->fps());
 }
 
 GenTime CustomTrackScene::nextSnapPoint(const GenTime &pos) const
 {
-    foreach (const GenTime &seekPoint, m_snapPoints) {
-        if (seekPoint > pos) {
-            return seekPoint;
-        }
-    }
-    return pos;
+    int frame = (int) pos.frames(m_timeline->fps());
+    int next = m_snapIndex.nextPoint(frame);
+    if (next == frame) return pos;
+    return GenTime(next, m_timeline->fps());
 }
 
 void CustomTrackScene::setScale(double scale, double vscale)
@@ -94,6 +85,11 @@ int CustomTrackScene::tracksCount() const
     return m_timeline->visibleTracksCount();
 }
 
+Timeline *CustomTrackScene::timeline() const
+{
+    return m_timeline;
+}
+
 MltVideoProfile CustomTrackScene::profile() const
 {
     return m_timeline->mltProfile();
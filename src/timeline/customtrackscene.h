@@ -31,6 +31,7 @@
 
 #include "gentime.h"
 #include "definitions.h"
+#include "snapindex.h"
 
 class Timeline;
 class MltVideoProfile;
@@ -44,13 +45,15 @@ class CustomTrackScene : public QGraphicsScene
 public:
     explicit CustomTrackScene(Timeline *timeline, QObject *parent = 0);
     ~CustomTrackScene();
-    void setSnapList(const QList <GenTime>& snaps);
+    /** @brief The incrementally maintained snap points of this timeline. */
+    SnapIndex *snapIndex();
     GenTime previousSnapPoint(const GenTime &pos) const;
     GenTime nextSnapPoint(const GenTime &pos) const;
     double getSnapPointForPos(double pos, bool doSnap = true);
     void setScale(double scale, double vscale);
     QPointF scale() const;
     int tracksCount() const;
+    Timeline *timeline() const;
     MltVideoProfile profile() const;
     void setEditMode(TimelineMode::EditMode mode);
     TimelineMode::EditMode editMode() const;
@@ -60,7 +63,7 @@ private:
     Timeline *m_timeline;
     QPointF m_scale;
     TimelineMode::EditMode m_editMode;
-    QList <GenTime> m_snapPoints;
+    SnapIndex m_snapIndex;
 };
 
 #endif
@@ -1080,7 +1080,8 @@ void CustomTrackView::mousePressEvent(QMouseEvent * event)
     // Update snap points
     if (m_selectionGroup == NULL) {
         if (m_operationMode == ResizeEnd || m_operationMode == ResizeStart) {
-            updateSnapPoints(NULL);
+            // Resized items move their own edges, skip them
+            updateSnapPoints(NULL, QList <GenTime>(), true);
         } else {
             updateSnapPoints(m_dragItem);
         }
@@ -4657,83 +4658,71 @@ void CustomTrackView::slotUpdateClip(const QString &clipId, bool reload)
     m_document->renderer()->unlockService(tractor);
 }
 
+QList<QGraphicsItem *> CustomTrackView::indexedItemsAt(int track, double pos, int type) const
+{
+    Track *tk = m_timeline->track(track);
+    if (!tk) return QList<QGraphicsItem *>();
+    return tk->itemIndex()->itemsAt(pos, type);
+}
+
 ClipItem *CustomTrackView::getClipItemAtEnd(GenTime pos, int track)
 {
     int framepos = (int)(pos.frames(m_document->fps()));
-    QList<QGraphicsItem *> list = scene()->items(QPointF(framepos - 1, getPositionFromTrack(track) + m_tracksHeight / 2));
+    QList<QGraphicsItem *> list = indexedItemsAt(track, framepos - 1, AVWidget);
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == AVWidget) {
-            ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            if (test->endPos() == pos) clip = test;
-            break;
-        }
+        ClipItem *test = static_cast <ClipItem *>(list.at(i));
+        if (test->endPos() == pos) clip = test;
+        break;
     }
     return clip;
 }
 
 ClipItem *CustomTrackView::getClipItemAtStart(GenTime pos, int track, GenTime end)
 {
-    QList<QGraphicsItem *> list = scene()->items(QPointF(pos.frames(m_document->fps()), getPositionFromTrack(track) + m_tracksHeight / 2));
+    QList<QGraphicsItem *> list = indexedItemsAt(track, pos.frames(m_document->fps()), AVWidget);
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) {
-            /*ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            qDebug()<<" * * *DISABLED CLIP: "<<i<<", "<<test->startPos().frames(25);*/
             continue;
         }
-        if (list.at(i)->type() == AVWidget) {
-            ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            //qDebug()<<" * * *ENABLED CLIP: "<<i<<", "<<test->startPos().frames(25)<<" = "<<pos.frames(25);
-            if (test->startPos() == pos) {
-              if (end > GenTime()) {
-                  if (test->endPos() != end) {
-                      //qDebug()<<" - - - -- - -NO END MATCH: "<<test->endPos().frames(25)<<" = "<< end.frames(25);
-                      continue;
-                  }
-              }
-	      clip = test;
-	      break;
-	    }
-	}
+        ClipItem *test = static_cast <ClipItem *>(list.at(i));
+        if (test->startPos() == pos) {
+            if (end > GenTime() && test->endPos() != end) {
+                continue;
+            }
+            clip = test;
+            break;
+        }
     }
     return clip;
 }
 
 ClipItem *CustomTrackView::getMovedClipItem(ItemInfo info, GenTime offset, int trackOffset)
 {
-    QList<QGraphicsItem *> list = scene()->items(QPointF((info.startPos + offset).frames(m_document->fps()), getPositionFromTrack(info.track + trackOffset) + m_tracksHeight / 2));
+    QList<QGraphicsItem *> list = indexedItemsAt(info.track + trackOffset, (info.startPos + offset).frames(m_document->fps()), AVWidget);
     ClipItem *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
-        //if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == AVWidget) {
-            ClipItem *test = static_cast <ClipItem *>(list.at(i));
-            if (test->startPos() == info.startPos) {
-		if (test->endPos() != info.endPos) {
-		    continue;
-                }
-            }
-	    clip = test;
-	    break;
-	}
+        ClipItem *test = static_cast <ClipItem *>(list.at(i));
+        if (test->startPos() == info.startPos && test->endPos() != info.endPos) {
+            continue;
+        }
+        clip = test;
+        break;
     }
     return clip;
 }
 
 ClipItem *CustomTrackView::getClipItemAtMiddlePoint(int pos, int track)
 {
-    const QPointF p(pos, getPositionFromTrack(track) + m_tracksHeight / 2);
-    QList<QGraphicsItem *> list = scene()->items(p);
-    ClipItem *clip = NULL;
+    QList<QGraphicsItem *> list = indexedItemsAt(track, pos, AVWidget);
     for (int i = 0; i < list.size(); ++i) {
-        if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == AVWidget) {
-            clip = static_cast <ClipItem *>(list.at(i));
-            break;
+        if (list.at(i)->isEnabled()) {
+            return static_cast <ClipItem *>(list.at(i));
         }
     }
-    return clip;
+    return NULL;
 }
 
 ClipItem *CustomTrackView::getUpperClipItemAt(int pos)
@@ -4749,19 +4738,13 @@ ClipItem *CustomTrackView::getUpperClipItemAt(int pos)
 
 Transition *CustomTrackView::getTransitionItemAt(int pos, int track, bool alreadyMoved)
 {
-    const QPointF p(pos, getPositionFromTrack(track) + Transition::itemOffset() + 1);
-    QList<QGraphicsItem *> list = scene()->items(p);
-    Transition *clip = NULL;
+    QList<QGraphicsItem *> list = indexedItemsAt(track, pos, TransitionWidget);
     for (int i = 0; i < list.size(); ++i) {
-        if (!alreadyMoved && !list.at(i)->isEnabled()) {
-            continue;
-        }
-        if (list.at(i)->type() == TransitionWidget) {
-            clip = static_cast <Transition *>(list.at(i));
-            break;
+        if (alreadyMoved || list.at(i)->isEnabled()) {
+            return static_cast <Transition *>(list.at(i));
         }
     }
-    return clip;
+    return NULL;
 }
 
 Transition *CustomTrackView::getTransitionItemAt(GenTime pos, int track, bool alreadyMoved)
@@ -4772,32 +4755,26 @@ Transition *CustomTrackView::getTransitionItemAt(GenTime pos, int track, bool al
 Transition *CustomTrackView::getTransitionItemAtEnd(GenTime pos, int track)
 {
     int framepos = (int)(pos.frames(m_document->fps()));
-    const QPointF p(framepos - 1, getPositionFromTrack(track) + Transition::itemOffset() + 1);
-    QList<QGraphicsItem *> list = scene()->items(p);
+    QList<QGraphicsItem *> list = indexedItemsAt(track, framepos - 1, TransitionWidget);
     Transition *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == TransitionWidget) {
-            Transition *test = static_cast <Transition *>(list.at(i));
-            if (test->endPos() == pos) clip = test;
-            break;
-        }
+        Transition *test = static_cast <Transition *>(list.at(i));
+        if (test->endPos() == pos) clip = test;
+        break;
     }
     return clip;
 }
 
 Transition *CustomTrackView::getTransitionItemAtStart(GenTime pos, int track)
 {
-    const QPointF p(pos.frames(m_document->fps()), getPositionFromTrack(track) + Transition::itemOffset() + 1);
-    QList<QGraphicsItem *> list = scene()->items(p);
+    QList<QGraphicsItem *> list = indexedItemsAt(track, pos.frames(m_document->fps()), TransitionWidget);
     Transition *clip = NULL;
     for (int i = 0; i < list.size(); ++i) {
         if (!list.at(i)->isEnabled()) continue;
-        if (list.at(i)->type() == TransitionWidget) {
-            Transition *test = static_cast <Transition *>(list.at(i));
-            if (test->startPos() == pos) clip = test;
-            break;
-        }
+        Transition *test = static_cast <Transition *>(list.at(i));
+        if (test->startPos() == pos) clip = test;
+        break;
     }
     return clip;
 }
@@ -5485,120 +5462,38 @@ double CustomTrackView::getSnapPointForPos(double pos)
 
 void CustomTrackView::updateSnapPoints(AbstractClipItem *selected, QList <GenTime> offsetList, bool skipSelectedItems)
 {
-    QList <GenTime> snaps;
+    // Clip, transition and guide points are kept up to date by the items themselves,
+    // we only need to refresh cursor and zone, and set up the current operation
+    SnapIndex *snaps = m_scene->snapIndex();
+    double fps = m_document->fps();
     if (selected && offsetList.isEmpty()) offsetList.append(selected->cropDuration());
-    QList<QGraphicsItem *> itemList = items();
-    for (int i = 0; i < itemList.count(); ++i) {
-        if (itemList.at(i) == selected) continue;
-        if (skipSelectedItems && itemList.at(i)->isSelected()) continue;
-        if (itemList.at(i)->type() == AVWidget) {
-            ClipItem *item = static_cast <ClipItem *>(itemList.at(i));
-            if (!item) continue;
-            GenTime start = item->startPos();
-            GenTime end = item->endPos();
-            if (!snaps.contains(start))
-                snaps.append(start);
-            if (!snaps.contains(end))
-                snaps.append(end);
-            if (!offsetList.isEmpty()) {
-                for (int j = 0; j < offsetList.size(); ++j) {
-                    GenTime offset = end - offsetList.at(j);
-                    if (offset > GenTime()) {
-                        if (!snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                        offset = start - offsetList.at(j);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
-            }
-            // Add clip markers
-            QList<GenTime> markers;
-            ClipController *controller = m_document->getClipController(item->getBinId());
-            if (controller) {
-                markers = item->snapMarkers(controller->snapMarkers());
-            } else {
-                qWarning("No controller!");
-            }
-            for (int j = 0; j < markers.size(); ++j) {
-                GenTime t = markers.at(j);
-                if (!snaps.contains(t))
-                    snaps.append(t);
-                if (!offsetList.isEmpty()) {
-                    for (int k = 0; k < offsetList.size(); ++k) {
-                        GenTime offset = t - offsetList.at(k);
-                        if (offset > GenTime() && !snaps.contains(offset))
-                            snaps.append(offset);
-                    }
-                }
-            }
-        } else if (itemList.at(i)->type() == TransitionWidget) {
-            Transition *transition = static_cast <Transition*>(itemList.at(i));
-            if (!transition) continue;
-            GenTime start = transition->startPos();
-            GenTime end = transition->endPos();
-            if (!snaps.contains(start))
-                snaps.append(start);
-            if (!snaps.contains(end))
-                snaps.append(end);
-            if (!offsetList.isEmpty()) {
-                for (int j = 0; j < offsetList.size(); ++j) {
-                    GenTime offset = end - offsetList.at(j);
-                    if (offset > GenTime()) {
-                        if (!snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                        offset = start - offsetList.at(j);
-                        if (offset > GenTime() && !snaps.contains(offset)) {
-                            snaps.append(offset);
-                        }
-                    }
-                }
+
+    // Moved items should not snap to themselves
+    QList <const void *> excluded;
+    if (selected) excluded << selected;
+    if (skipSelectedItems) {
+        QList<QGraphicsItem *> selection = m_scene->selectedItems();
+        for (int i = 0; i < selection.count(); ++i) {
+            if (selection.at(i)->type() == AVWidget || selection.at(i)->type() == TransitionWidget) {
+                excluded << static_cast <AbstractClipItem *>(selection.at(i));
             }
         }
     }
+    snaps->setExcludedSources(excluded);
 
-    // add cursor position
-    GenTime pos = GenTime(m_cursorPos, m_document->fps());
-    if (!snaps.contains(pos))
-        snaps.append(pos);
-    if (!offsetList.isEmpty()) {
-        for (int j = 0; j < offsetList.size(); ++j) {
-            GenTime offset = pos - offsetList.at(j);
-            if (!snaps.contains(offset))
-                snaps.append(offset);
-        }
+    QList <int> offsets;
+    for (int i = 0; i < offsetList.count(); ++i) {
+        int offset = (int) offsetList.at(i).frames(fps);
+        if (!offsets.contains(offset)) offsets << offset;
     }
+    snaps->setOffsets(offsets);
 
-    // add guides
-    for (int i = 0; i < m_guides.count(); ++i) {
-        GenTime pos = m_guides.at(i)->position();
-        if (!snaps.contains(pos))
-            snaps.append(pos);
-        if (!offsetList.isEmpty()) {
-            for (int j = 0; j < offsetList.size(); ++j) {
-                GenTime offset = pos - offsetList.at(j);
-                if (!snaps.contains(offset))
-                    snaps.append(offset);
-            }
-        }
-    }
+    // add cursor position
+    snaps->setSource(m_cursorLine, QVector<int>() << m_cursorPos);
 
-    // add render zone
+    // add render zone, not used for offset snapping
     QPoint z = m_document->zone();
-    pos = GenTime(z.x(), m_document->fps());
-    if (!snaps.contains(pos))
-        snaps.append(pos);
-    pos = GenTime(z.y(), m_document->fps());
-    if (!snaps.contains(pos))
-        snaps.append(pos);
-
-    qSort(snaps);
-    m_scene->setSnapList(snaps);
-    //for (int i = 0; i < m_snapPoints.size(); ++i)
-    //    //qDebug() << "SNAP POINT: " << m_snapPoints.at(i).frames(25);
+    snaps->setSource(this, QVector<int>() << z.x() << z.y(), false);
 }
 
 void CustomTrackView::slotSeekToPreviousSnap()
@@ -6871,6 +6766,7 @@ void CustomTrackView::setAudioAlignReference()
                 return;
             }
             AudioEnvelope *envelope = new AudioEnvelope(clip->binClip()->url().path(), prod);
+            envelope->setCacheFile(clip->binClip()->getAudioEnvelopePath());
             m_audioCorrelator = new AudioCorrelation(envelope);
             connect(m_audioCorrelator, SIGNAL(gotAudioAlignData(int,int,int)), this, SLOT(slotAlignClip(int,int,int)));
             connect(m_audioCorrelator, SIGNAL(displayMessage(QString,MessageType)), this, SIGNAL(displayMessage(QString,MessageType)));
@@ -6898,6 +6794,7 @@ void CustomTrackView::alignAudio()
         return;
     }
 
+    // Each clip's envelope and correlation are computed on worker threads, all clips in parallel
     QList<QGraphicsItem *> selection = scene()->selectedItems();
     foreach (QGraphicsItem *item, selection) {
         if (item->type() == AVWidget) {
@@ -6912,13 +6809,14 @@ void CustomTrackView::alignAudio()
                 Mlt::Producer *prod = m_timeline->track(clip->track())->clipProducer(m_document->renderer()->getBinProducer(clip->getBinId()), clip->clipState());
                 if (!prod) {
                     qWarning() << "couldn't load producer for clip " << clip->getBinId() << " on track " << clip->track();
-                    return;
+                    continue;
                 }
                 AudioEnvelope *envelope = new AudioEnvelope(clip->binClip()->url().path(), prod,
                         info.cropStart.frames(m_document->fps()),
                         info.cropDuration.frames(m_document->fps()),
                         clip->track(),
                         info.startPos.frames(m_document->fps()));
+                envelope->setCacheFile(clip->binClip()->getAudioEnvelopePath());
                 m_audioCorrelator->addChild(envelope);
             }
         }
@@ -7180,12 +7078,18 @@ void CustomTrackView::monitorRefresh(QList <ItemInfo> range, bool invalidateRang
     }
     if (refreshMonitor)
         m_document->renderer()->doRefresh();
+    else
+        // Frames of the edited range may be cached, even away from the cursor
+        m_document->renderer()->invalidateFrameCache();
 }
 
 void CustomTrackView::monitorRefresh(ItemInfo range, bool invalidateRange)
 {
     if (range.contains(GenTime(m_cursorPos, m_document->fps())))
         m_document->renderer()->doRefresh();
+    else
+        // Frames of the edited range may be cached, even away from the cursor
+        m_document->renderer()->invalidateFrameCache();
     if (invalidateRange)
         m_timeline->invalidateRange(range);
 }
@@ -7692,8 +7596,9 @@ void CustomTrackView::removeTipAnimation()
 
 bool CustomTrackView::hasAudio(int track) const
 {
-    QRectF rect(0, (double)(getPositionFromTrack(track) + 1), (double) sceneRect().width(), (double)(m_tracksHeight - 1));
-    QList<QGraphicsItem *> collisions = scene()->items(rect, Qt::IntersectsItemBoundingRect);
+    Track *tk = m_timeline->track(track);
+    if (!tk) return false;
+    QList<QGraphicsItem *> collisions = tk->itemIndex()->itemsInRange(0, sceneRect().width(), AVWidget);
     for (int i = 0; i < collisions.count(); ++i) {
         QGraphicsItem *item = collisions.at(i);
         if (!item->isEnabled()) continue;
@@ -467,6 +467,10 @@ private:
     QMap <AbstractToolManager::ToolManagerType, AbstractToolManager*> m_toolManagers;
     AbstractToolManager *m_currentToolManager;
 
+    /** @brief Returns the items of a graphics type covering a frame on a track, in descending stacking order
+     *  Uses the track's item index instead of a scene point query.
+     *  @param track the track in MLT coordinates */
+    QList<QGraphicsItem *> indexedItemsAt(int track, double pos, int type) const;
     /** @brief Returns a clip from timeline
      *  @param pos a time value that is inside the clip
      *  @param track the track where the clip is in MLT coordinates */
@@ -19,6 +19,7 @@
 
 #include "guide.h"
 #include "customtrackview.h"
+#include "customtrackscene.h"
 
 #include "kdenlivesettings.h"
 
@@ -53,6 +54,19 @@ Guide::Guide(CustomTrackView *view, const GenTime &pos, const QString &label, do
     const QFontMetrics metric = m_view->fontMetrics();
     m_width = metric.width(' ' + m_label + ' ') + 2;
     prepareGeometryChange();
+    updateSnapPoint();
+}
+
+Guide::~Guide()
+{
+    CustomTrackScene *scene = static_cast<CustomTrackScene *>(m_view->scene());
+    if (scene) scene->snapIndex()->removeSource(this);
+}
+
+void Guide::updateSnapPoint()
+{
+    CustomTrackScene *scene = static_cast<CustomTrackScene *>(m_view->scene());
+    if (scene) scene->snapIndex()->setSource(this, QVector<int>() << (int) m_position.frames(m_view->fps()));
 }
 
 QString Guide::label() const
@@ -74,6 +88,7 @@ void Guide::updateGuide(const GenTime &newPos, const QString &comment)
 {
     m_position = newPos;
     setPos(m_position.frames(m_view->fps()), 0);
+    updateSnapPoint();
     if (!comment.isEmpty()) {
         m_label = comment;
         setToolTip(m_label);
@@ -86,6 +101,7 @@ void Guide::updateGuide(const GenTime &newPos, const QString &comment)
 void Guide::updatePos()
 {
     setPos(m_position.frames(m_view->fps()), 0);
+    updateSnapPoint();
 }
 
 //virtual
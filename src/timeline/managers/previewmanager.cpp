@@ -19,6 +19,7 @@
 
 
 #include "previewmanager.h"
+#include "previewrenderer.h"
 #include "../customruler.h"
 #include "kdenlivesettings.h"
 #include "doc/kdenlivedoc.h"
@@ -27,6 +28,16 @@
 #include <QtConcurrent>
 #include <QStandardPaths>
 #include <QProcess>
+#include <QThread>
+#include <QThreadPool>
+#include <QCryptographicHash>
+#include <QSet>
+
+#ifdef Q_OS_WIN
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
 
 
 
@@ -36,7 +47,10 @@ PreviewManager::PreviewManager(KdenliveDoc *doc, CustomRuler *ruler, Mlt::Tracto
     , m_tractor(tractor)
     , m_previewTrack(NULL)
     , m_initialized(false)
-    , m_abortPreview(false)
+    , m_abortPreview(0)
+    , m_processedChunks(0)
+    , m_activeChunks(0)
+    , m_playhead(0)
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
@@ -46,13 +60,12 @@ PreviewManager::~PreviewManager()
 {
     if (m_initialized) {
         abortRendering();
-        if (m_undoDir.dirName() == QLatin1String("undo"))
-            m_undoDir.removeRecursively();
         if ((m_doc->url().isEmpty() && m_cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).count() == 0) || m_cacheDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).count() == 0) {
             if (m_cacheDir.dirName() == QLatin1String("preview"))
                 m_cacheDir.removeRecursively();
         }
     }
+    qDeleteAll(m_renderers);
     delete m_previewTrack;
 }
 
@@ -75,7 +88,7 @@ bool PreviewManager::initialize()
         m_doc->displayMessage(i18n("Cannot create folder %1", m_cacheDir.absolutePath()), ErrorMessage);
         return false;
     }
-    if (kdenliveCacheDir.isEmpty() || m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir() || (!m_cacheDir.exists("undo") && !m_cacheDir.mkdir("undo"))) {
+    if (kdenliveCacheDir.isEmpty() || m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir()) {
         m_doc->displayMessage(i18n("Something is wrong with cache folder %1", m_cacheDir.absoluteFilePath(documentId)), ErrorMessage);
         return false;
     }
@@ -83,20 +96,32 @@ bool PreviewManager::initialize()
         m_doc->displayMessage(i18n("Invalid timeline preview parameters"), ErrorMessage);
         return false;
     }
-    m_undoDir = QDir(m_cacheDir.absoluteFilePath("undo"));
+    // Chunks are shared by all projects, named after their content
+    m_chunkDir = QDir(kdenliveCacheDir);
+    if (!m_chunkDir.exists(QStringLiteral("timelinepreview")) && !m_chunkDir.mkdir(QStringLiteral("timelinepreview"))) {
+        m_doc->displayMessage(i18n("Cannot create folder %1", m_chunkDir.absoluteFilePath(QStringLiteral("timelinepreview"))), ErrorMessage);
+        return false;
+    }
+    m_chunkDir.cd(QStringLiteral("timelinepreview"));
 
     // Make sure our cache dirs are inside the temporary folder
-    if (!m_cacheDir.makeAbsolute() || !m_undoDir.makeAbsolute() || !m_cacheDir.absolutePath().startsWith(kdenliveCacheDir) || !m_undoDir.absolutePath().startsWith(kdenliveCacheDir)) {
+    if (!m_cacheDir.makeAbsolute() || !m_chunkDir.makeAbsolute() || !m_cacheDir.absolutePath().startsWith(kdenliveCacheDir) || !m_chunkDir.absolutePath().startsWith(kdenliveCacheDir)) {
         m_doc->displayMessage(i18n("Something is wrong with cache folders"), ErrorMessage);
         return false;
     }
 
-    connect(this, &PreviewManager::cleanupOldPreviews, this, &PreviewManager::doCleanupOldPreviews);
-    connect(m_doc, &KdenliveDoc::removeInvalidUndo, this, &PreviewManager::slotRemoveInvalidUndo, Qt::DirectConnection);
+    // Chunks of closed projects may have been left over the size limit
+    enforceCacheLimit();
+    if (m_doc->getDocumentProperty(QStringLiteral("previewchunks")).isEmpty()) {
+        // No chunk to move to the shared folder, loadChunks() will not be called
+        removeLegacyChunks();
+    }
+
     m_previewTimer.setSingleShot(true);
     m_previewTimer.setInterval(3000);
     connect(&m_previewTimer, &QTimer::timeout, this, &PreviewManager::startPreviewRender);
     connect(this, &PreviewManager::previewRender, this, &PreviewManager::gotPreviewRender);
+    connect(this, &PreviewManager::previewChunkProgress, m_ruler, &CustomRuler::updateChunkProgress);
     connect(&m_previewGatherTimer, &QTimer::timeout, this, &PreviewManager::slotProcessDirtyChunks);
     m_initialized = true;
     return true;
@@ -114,23 +139,32 @@ bool PreviewManager::buildPreviewTrack()
     return true;
 }
 
-void PreviewManager::loadChunks(QStringList previewChunks, QStringList dirtyChunks, QDateTime documentDate)
+void PreviewManager::loadChunks(QStringList previewChunks, QStringList dirtyChunks)
 {
-    foreach (const QString frame, previewChunks) {
-        const QString fileName = m_cacheDir.absoluteFilePath(QString("%1.%2").arg(frame).arg(m_extension));
-        QFile file(fileName);
-        if (file.exists()) {
-            if (!documentDate.isNull() && QFileInfo(file).lastModified() > documentDate) {
-                // Timeline preview file was created after document, invalidate
-                file.remove();
-                dirtyChunks << frame;
-            } else {
-                gotPreviewRender(frame.toInt(), fileName, 1000);
-            }
+    QList <int> frames;
+    foreach (const QString &frame, previewChunks) {
+        frames << frame.toInt();
+    }
+    // Chunk files are named after their content, so an existing file always matches the timeline
+    QMap <int, QString> keys = computeChunkKeys(frames);
+    foreach (int frame, frames) {
+        const QString fileName = chunkFile(keys.value(frame));
+        // Projects saved by previous versions have their chunks in the project folder, named after their position
+        const QString legacyName = m_cacheDir.absoluteFilePath(QString("%1.%2").arg(frame).arg(m_extension));
+        if (!fileName.isEmpty() && !QFile::exists(fileName) && QFile::exists(legacyName)) {
+            QFile::rename(legacyName, fileName);
+        }
+        if (QFile::exists(fileName)) {
+            m_queueMutex.lock();
+            m_chunkKeys.insert(frame, keys.value(frame));
+            m_queueMutex.unlock();
+            touchChunk(fileName);
+            gotPreviewRender(frame, fileName, 1000);
         } else {
-            dirtyChunks << frame;
+            dirtyChunks << QString::number(frame);
         }
     }
+    removeLegacyChunks();
     if (!dirtyChunks.isEmpty()) {
         QList <int> list;
         foreach(const QString i, dirtyChunks) {
@@ -141,6 +175,21 @@ void PreviewManager::loadChunks(QStringList previewChunks, QStringList dirtyChun
     }
 }
 
+void PreviewManager::removeLegacyChunks()
+{
+    // Chunks and chunk history of previous versions, the valid chunks were moved to the shared chunk folder
+    QDir undoDir = m_cacheDir;
+    if (undoDir.cd(QStringLiteral("undo")))
+        undoDir.removeRecursively();
+    const QStringList files = m_cacheDir.entryList(QStringList() << QStringLiteral("*.") + m_extension, QDir::Files);
+    foreach(const QString &file, files) {
+        bool isFrame = false;
+        file.section(QLatin1Char('.'), 0, 0).toInt(&isFrame);
+        if (isFrame)
+            m_cacheDir.remove(file);
+    }
+}
+
 void PreviewManager::deletePreviewTrack()
 {
     m_tractor->lock();
@@ -214,94 +263,207 @@ void PreviewManager::invalidatePreviews(QList <int> chunks)
         m_previewTimer.stop();
         timer = true;
     }
-    int stackIx = m_doc->commandStack()->index();
-    int stackMax = m_doc->commandStack()->count();
-    if (stackIx == stackMax && !m_undoDir.exists(QString::number(stackIx - 1))) {
-        // We just added a new command in stack, archive existing chunks
-        int ix = stackIx - 1;
-        m_undoDir.mkdir(QString::number(ix));
-        bool foundPreviews = false;
-        foreach(int i, chunks) {
-            QString current = QString("%1.%2").arg(i).arg(m_extension);
-            if (m_cacheDir.rename(current, QString("undo/%1/%2").arg(ix).arg(current))) {
-                foundPreviews = true;
-            }
-        }
-        if (!foundPreviews) {
-            // No preview files found, remove undo folder
-            m_undoDir.rmdir(QString::number(ix));
+    // If the new content of a chunk was already rendered (undo, redo, copy...), reuse it
+    QMap <int, QString> keys = computeChunkKeys(chunks);
+    QList <int> foundChunks;
+    m_queueMutex.lock();
+    foreach(int i, chunks) {
+        if (QFile::exists(chunkFile(keys.value(i)))) {
+            m_chunkKeys.insert(i, keys.value(i));
+            foundChunks << i;
         } else {
-            // new chunks archived, cleanup old ones
-            emit cleanupOldPreviews();
+            m_chunkKeys.remove(i);
         }
-    } else {
-        // Restore existing chunks, delete others
-        // Check if we just undo the last stack action, then backup, otherwise delete
-        bool lastUndo = false;
-        if (stackIx == stackMax - 1) {
-            if (!m_undoDir.exists(QString::number(stackMax))) {
-                lastUndo = true;
-                bool foundPreviews = false;
-                m_undoDir.mkdir(QString::number(stackMax));
-                foreach(int i, chunks) {
-                    QString current = QString("%1.%2").arg(i).arg(m_extension);
-                    if (m_cacheDir.rename(current, QString("undo/%1/%2").arg(stackMax).arg(current))) {
-                        foundPreviews = true;
-                    }
+    }
+    m_queueMutex.unlock();
+    if (foundChunks.isEmpty()) {
+        m_doc->setModified(true);
+        if (timer)
+            m_previewTimer.start();
+        return;
+    }
+    qSort(foundChunks);
+    reloadChunks(foundChunks);
+    m_doc->setModified(true);
+    if (timer)
+        m_previewTimer.start();
+}
+
+QString PreviewManager::chunkFile(const QString &key) const
+{
+    if (key.isEmpty())
+        return QString();
+    return m_chunkDir.absoluteFilePath(QString("%1.%2").arg(key).arg(m_extension));
+}
+
+static bool isVolatileProperty(const char *name)
+{
+    // Bin and timeline bookkeeping, it changes between projects without affecting the rendering.
+    // File identity properties like kdenlive:file_hash are kept, so that a file replaced at the same path gets new chunks.
+    static const char *names[] = { "id", "kdenlive:id", "kdenlive:binid", "kdenlive:clipname", "kdenlive:folderid", "kdenlive:description",
+                                   "kdenlive:zone_in", "kdenlive:zone_out", "kdenlive:thumbnailFrame", "kdenlive:proxy", "kdenlive:originalurl",
+                                   "kdenlive:clipstate", "kdenlive:track_name", "kdenlive:locked_track", "kdenlive:documentnotes",
+                                   "kdenlive:customeffects", "kdenlive:clipgroups", "kdenlive:exiftool", "kdenlive:magiclantern", NULL };
+    static const char *prefixes[] = { "kdenlive:marker.", "kdenlive:guide.", "kdenlive:clipzone.", "kdenlive:clipanalysis", "kdenlive:folder.",
+                                      "kdenlive:docproperties.", "kdenlive:docmetadata.", "kdenlive:meta.", NULL };
+    for (int i = 0; names[i]; i++) {
+        if (strcmp(name, names[i]) == 0)
+            return true;
+    }
+    for (int i = 0; prefixes[i]; i++) {
+        if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void hashProperties(QCryptographicHash &hash, Mlt::Properties &properties, bool skipPosition = false)
+{
+    // Sort the properties so that the same content always gives the same hash.
+    QMap <QByteArray, QByteArray> values;
+    for (int i = 0; i < properties.count(); i++) {
+        const char *name = properties.get_name(i);
+        const char *value = properties.get(i);
+        if (!name || !value || name[0] == '_' || isVolatileProperty(name))
+            continue;
+        if (skipPosition && (strcmp(name, "in") == 0 || strcmp(name, "out") == 0))
+            continue;
+        values.insert(name, value);
+    }
+    QMap <QByteArray, QByteArray>::const_iterator it = values.constBegin();
+    for (; it != values.constEnd(); ++it) {
+        hash.addData(it.key());
+        hash.addData("=", 1);
+        hash.addData(it.value());
+        hash.addData("\n", 1);
+    }
+}
+
+QByteArray PreviewManager::serviceHash(Mlt::Service &service, bool skipPosition)
+{
+    void *key = service.get_service();
+    QHash <void *, QByteArray>::const_iterator cached = m_serviceHashes.constFind(key);
+    if (cached != m_serviceHashes.constEnd())
+        return cached.value();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    Mlt::Properties properties(service.get_properties());
+    hashProperties(hash, properties, skipPosition);
+    for (int i = 0; i < service.filter_count(); i++) {
+        Mlt::Filter *filter = service.filter(i);
+        if (filter && filter->is_valid()) {
+            hash.addData("filter\n", 7);
+            hash.addData(serviceHash(*filter));
+        }
+        delete filter;
+    }
+    const QByteArray result = hash.result();
+    m_serviceHashes.insert(key, result);
+    return result;
+}
+
+QMap <int, QString> PreviewManager::computeChunkKeys(const QList <int> &chunks)
+{
+    QMap <int, QString> keys;
+    if (chunks.isEmpty())
+        return keys;
+    int chunkSize = KdenliveSettings::timelinechunks();
+    // What the chunk looks like also depends on the profile and the encoding parameters
+    Mlt::Profile *profile = m_tractor->profile();
+    QByteArray common = QString("%1x%2 %3/%4 %5/%6 %7 %8|%9|%10").arg(profile->width()).arg(profile->height())
+            .arg(profile->frame_rate_num()).arg(profile->frame_rate_den()).arg(profile->sample_aspect_num())
+            .arg(profile->sample_aspect_den()).arg(profile->progressive()).arg(profile->colorspace())
+            .arg(m_consumerParams.join(QLatin1Char(' '))).arg(m_extension).toUtf8();
+    m_tractor->lock();
+    foreach(int frame, chunks) {
+        const int end = frame + chunkSize - 1;
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(common);
+        hash.addData(QByteArray::number(chunkSize));
+        for (int i = 0; i < m_tractor->count(); i++) {
+            Mlt::Producer *track = m_tractor->track(i);
+            if (!track)
+                continue;
+            if (track->get("id") && strcmp(track->get("id"), "timeline_preview") == 0) {
+                delete track;
+                continue;
+            }
+            hash.addData("track\n", 6);
+            hash.addData(serviceHash(*track));
+            // Only the clips visible in the chunk, with positions relative to the chunk start
+            Mlt::Playlist playlist(*track);
+            for (int ix = playlist.get_clip_index_at(frame); ix >= 0 && ix < playlist.count(); ix++) {
+                Mlt::ClipInfo *info = playlist.clip_info(ix);
+                if (!info)
+                    break;
+                if (info->start > end) {
+                    delete info;
+                    break;
                 }
-                if (!foundPreviews) {
-                    m_undoDir.rmdir(QString::number(stackMax));
+                if (!playlist.is_blank(ix) && info->cut) {
+                    hash.addData(QString("clip %1 %2 %3\n").arg(info->start - frame).arg(info->frame_in).arg(info->frame_count).toUtf8());
+                    hash.addData(serviceHash(*info->cut));
+                    Mlt::Producer &parent = info->cut->parent();
+                    if (parent.is_valid())
+                        hash.addData(serviceHash(parent));
                 }
+                delete info;
             }
+            delete track;
         }
-        bool moveFile = true;
-        QDir tmpDir = m_undoDir;
-        if (!tmpDir.cd(QString::number(stackIx))) {
-            moveFile = false;
-        }
-        QList <int> foundChunks;
-        foreach(int i, chunks) {
-            QString cacheFileName = QString("%1.%2").arg(i).arg(m_extension);
-            if (!lastUndo) {
-                m_cacheDir.remove(cacheFileName);
-            }
-            if (moveFile) {
-                if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
-                    foundChunks << i;
-                }
+        // Transitions overlapping the chunk
+        Mlt::Field *field = m_tractor->field();
+        mlt_service nextservice = mlt_service_get_producer(field->get_service());
+        while (nextservice && mlt_service_identify(nextservice) == transition_type) {
+            Mlt::Transition transition((mlt_transition) nextservice);
+            nextservice = mlt_service_producer(nextservice);
+            int in = transition.get_in();
+            int out = transition.get_out();
+            if (in > end || (out < frame && out >= 0)) {
+                continue;
             }
+            hash.addData(QString("transition %1 %2\n").arg(in - frame).arg(out - frame).toUtf8());
+            hash.addData(serviceHash(transition, true));
         }
-        qSort(foundChunks);
-        reloadChunks(foundChunks);
+        delete field;
+        keys.insert(frame, QString(hash.result().toHex()));
     }
-    m_doc->setModified(true);
-    if (timer)
-        m_previewTimer.start();
+    m_tractor->unlock();
+    return keys;
+}
+
+void PreviewManager::touchChunk(const QString &file)
+{
+    // The modification time is used as last access time for the cache size limit
+#ifdef Q_OS_WIN
+    _wutime(reinterpret_cast<const wchar_t *>(file.utf16()), NULL);
+#else
+    utime(QFile::encodeName(file).constData(), NULL);
+#endif
 }
 
-void PreviewManager::doCleanupOldPreviews()
+void PreviewManager::enforceCacheLimit()
 {
-    if (m_undoDir.dirName() != QLatin1String("undo"))
+    qint64 limit = (qint64) KdenliveSettings::previewcachesize() * 1024 * 1024;
+    if (limit <= 0)
         return;
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-
-    // Use QCollator to do a natural sorting so that 10 is after 2
-    QCollator collator;
-    collator.setNumericMode(true);
-    std::sort(
-    dirs.begin(),
-    dirs.end(),
-    [&collator](const QString &file1, const QString &file2)
-    {
-        return collator.compare(file1, file2) < 0;
-    });
-    bool ok;
-    while (dirs.count() > 5) {
-        QDir tmp = m_undoDir;
-        QString dirName = dirs.takeFirst();
-        dirName.toInt(&ok);
-        if (ok && tmp.cd(dirName)) {
-            tmp.removeRecursively();
+    QSet <QString> used;
+    m_queueMutex.lock();
+    foreach(const QString &key, m_chunkKeys) {
+        used.insert(QString("%1.%2").arg(key).arg(m_extension));
+    }
+    m_queueMutex.unlock();
+    // Most recently used first
+    QFileInfoList files = m_chunkDir.entryInfoList(QDir::Files, QDir::Time);
+    qint64 total = 0;
+    foreach(const QFileInfo &info, files) {
+        total += info.size();
+    }
+    for (int i = files.count() - 1; i >= 0 && total > limit; i--) {
+        const QFileInfo &info = files.at(i);
+        if (used.contains(info.fileName()))
+            continue;
+        if (QFile::remove(info.absoluteFilePath())) {
+            total -= info.size();
         }
     }
 }
@@ -311,10 +473,12 @@ void PreviewManager::clearPreviewRange()
         m_previewGatherTimer.stop();
         abortPreview();
         QList <int> toProcess = m_ruler->getProcessedChunks();
+        m_queueMutex.lock();
+        m_chunkKeys.clear();
+        m_queueMutex.unlock();
         m_tractor->lock();
         bool hasPreview = m_previewTrack != NULL;
         foreach(int ix, toProcess) {
-            m_cacheDir.remove(QString("%1.%2").arg(ix).arg(m_extension));
             if (!hasPreview)
                 continue;
             int trackIx = m_previewTrack->get_clip_index_at(ix);
@@ -345,7 +509,10 @@ void PreviewManager::addPreviewRange(bool add)
     if (add) {
         if (m_previewThread.isRunning()) {
             // just add required frames to current rendering job
+            QMap <int, QString> keys = computeChunkKeys(toProcess);
+            QMutexLocker lock(&m_queueMutex);
             m_waitingThumbs << toProcess;
+            m_renderKeys.unite(keys);
         } else if (KdenliveSettings::autopreview())
             m_previewTimer.start();
     } else {
@@ -356,7 +523,9 @@ void PreviewManager::addPreviewRange(bool add)
         m_tractor->lock();
         bool hasPreview = m_previewTrack != NULL;
         foreach(int ix, toProcess) {
-            m_cacheDir.remove(QString("%1.%2").arg(ix).arg(m_extension));
+            m_queueMutex.lock();
+            m_chunkKeys.remove(ix);
+            m_queueMutex.unlock();
             if (!hasPreview)
                 continue;
             int trackIx = m_previewTrack->get_clip_index_at(ix);
@@ -377,7 +546,7 @@ void PreviewManager::abortRendering()
 {
     if (!m_previewThread.isRunning())
         return;
-    m_abortPreview = true;
+    m_abortPreview.store(1);
     emit abortPreview();
     m_previewThread.waitForFinished();
     // Re-init time estimation
@@ -393,67 +562,217 @@ void PreviewManager::startPreviewRender()
     if (!chunks.isEmpty()) {
         // Abort any rendering
         abortRendering();
-        m_waitingThumbs.clear();
         const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
         m_doc->saveMltPlaylist(sceneList);
+        // Saving optimises the timeline, which can replace some of its services
+        m_serviceHashes.clear();
+        QMap <int, QString> keys = computeChunkKeys(chunks);
+        m_queueMutex.lock();
         m_waitingThumbs = chunks;
+        m_renderKeys = keys;
+        m_processedChunks = 0;
+        m_activeChunks = 0;
+        m_queueMutex.unlock();
+        // GPU processing needs its own OpenGL context, only available in a separate renderer process
+        if (!KdenliveSettings::gpu_accel()) {
+            // Renderers of another project profile would store chunks of the wrong size or frame rate
+            const QString profile = KdenliveSettings::current_profile();
+            for (int i = m_renderers.count() - 1; i >= 0; --i) {
+                if (m_renderers.at(i)->profilePath() != profile) {
+                    delete m_renderers.takeAt(i);
+                }
+            }
+            // Created here so that they live in the manager's thread
+            while (m_renderers.count() < workerCount()) {
+                PreviewRenderer *renderer = new PreviewRenderer(profile);
+                connect(this, &PreviewManager::abortPreview, renderer, &PreviewRenderer::abort, Qt::DirectConnection);
+                connect(renderer, &PreviewRenderer::chunkProgress, this, &PreviewManager::previewChunkProgress);
+                m_renderers << renderer;
+            }
+        }
         m_previewThread = QtConcurrent::run(this, &PreviewManager::doPreviewRender, sceneList);
     }
 }
 
-void PreviewManager::doPreviewRender(QString scene)
+int PreviewManager::workerCount() const
 {
-    int progress;
+    if (KdenliveSettings::previewthreads() > 0) {
+        return KdenliveSettings::previewthreads();
+    }
+    // The renderer and its encoder use several threads too, so don't take all cores
+    return qMax(1, QThread::idealThreadCount() / 2);
+}
+
+void PreviewManager::slotCursorMoved(int, int newPos)
+{
+    m_playhead = newPos;
+}
+
+bool PreviewManager::takeNextChunk(int *frame)
+{
+    QMutexLocker lock(&m_queueMutex);
+    if (m_abortPreview.load() || m_waitingThumbs.isEmpty())
+        return false;
     int chunkSize = KdenliveSettings::timelinechunks();
+    int playhead = m_playhead.load();
+    int best = 0;
+    int bestDistance = -1;
+    for (int i = 0; i < m_waitingThumbs.count(); i++) {
+        int chunk = m_waitingThumbs.at(i);
+        // Distance is 0 for the chunk containing the playhead
+        int distance = chunk + chunkSize <= playhead ? playhead - chunk : qMax(0, chunk - playhead);
+        if (bestDistance < 0 || distance < bestDistance || (distance == bestDistance && chunk < m_waitingThumbs.at(best))) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    *frame = m_waitingThumbs.takeAt(best);
+    m_activeChunks++;
+    return true;
+}
+
+int PreviewManager::chunkDone()
+{
+    QMutexLocker lock(&m_queueMutex);
+    m_activeChunks--;
+    m_processedChunks++;
+    if (m_waitingThumbs.isEmpty() && m_activeChunks == 0) {
+        return 1000;
+    }
+    return (double) m_processedChunks / (m_processedChunks + m_activeChunks + m_waitingThumbs.count()) * 1000;
+}
+
+void PreviewManager::doPreviewRender(QString scene)
+{
     // initialize progress bar
     emit previewRender(0, QString(), 0);
-    int ct = 0;
-    qSort(m_waitingThumbs);
-    while (!m_waitingThumbs.isEmpty()) {
-        int i = m_waitingThumbs.takeFirst();
-        ct++;
-        QString fileName = QString("%1.%2").arg(i).arg(m_extension);
-        if (m_waitingThumbs.isEmpty()) {
-            progress = 1000;
-        } else {
-            progress = (double) (ct) / (ct + m_waitingThumbs.count()) * 1000;
+    int workers = workerCount();
+    // Read the scene once, the in-process renderers load it from memory
+    QFile file(scene);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_sceneXml = file.readAll();
+        file.close();
+    } else {
+        m_sceneXml.clear();
+    }
+    m_sceneHash = QCryptographicHash::hash(m_sceneXml, QCryptographicHash::Md5);
+    foreach(PreviewRenderer *renderer, m_renderers) {
+        renderer->startRender();
+    }
+    // Use our own pool so that other concurrent jobs cannot starve the preview workers
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
+    for (int i = 0; i < workers; i++) {
+        QtConcurrent::run(&pool, this, &PreviewManager::doPreviewWorker, scene, i);
+    }
+    pool.waitForDone();
+    //QFile::remove(scene);
+    m_abortPreview.store(0);
+    enforceCacheLimit();
+}
+
+bool PreviewManager::renderChunkProcess(const QString &scene, int frame, const QString &file, QString *errorLog)
+{
+    QStringList args;
+    args << scene;
+    args << "in=" + QString::number(frame);
+    args << "out=" + QString::number(frame + KdenliveSettings::timelinechunks() - 1);
+    args << "-progress";
+    args << "-consumer" << "avformat:" + file;
+    args << m_consumerParams;
+    QProcess previewProcess;
+    connect(this, SIGNAL(abortPreview()), &previewProcess, SLOT(kill()), Qt::DirectConnection);
+    previewProcess.start(KdenliveSettings::rendererpath(), args);
+    if (!previewProcess.waitForStarted()) {
+        return false;
+    }
+    // Follow the renderer's progress, keep the other messages in case of error
+    int chunkProgress = 0;
+    bool running = true;
+    while (running) {
+        running = !previewProcess.waitForFinished(500) && previewProcess.state() != QProcess::NotRunning;
+        const QStringList lines = QString::fromUtf8(previewProcess.readAllStandardError()).split(QRegExp("[\\r\\n]"), QString::SkipEmptyParts);
+        foreach(const QString &line, lines) {
+            if (line.startsWith(QLatin1String("Current Frame"))) {
+                int p = line.section(QLatin1Char(':'), -1).simplified().toInt();
+                if (p != chunkProgress) {
+                    chunkProgress = p;
+                    emit previewChunkProgress(frame, chunkProgress);
+                }
+            } else {
+                errorLog->append(line + QLatin1Char('\n'));
+            }
+        }
+    }
+    return previewProcess.exitStatus() == QProcess::NormalExit && previewProcess.exitCode() == 0;
+}
+
+void PreviewManager::doPreviewWorker(const QString &scene, int worker)
+{
+    int chunkSize = KdenliveSettings::timelinechunks();
+    PreviewRenderer *renderer = worker < m_renderers.count() && !KdenliveSettings::gpu_accel() && !m_sceneXml.isEmpty() ? m_renderers.at(worker) : NULL;
+    bool sceneLoaded = false;
+    int i;
+    while (takeNextChunk(&i)) {
+        if (renderer && !sceneLoaded) {
+            // Only workers that get a chunk parse the scene
+            sceneLoaded = true;
+            if (!renderer->loadScene(m_sceneXml, m_sceneHash)) {
+                // Fall back to a renderer process, it will report the error if the scene is really broken
+                renderer = NULL;
+            }
         }
-        if (m_cacheDir.exists(fileName)) {
-            // This chunk already exists
-            emit previewRender(i, m_cacheDir.absoluteFilePath(fileName), progress);
+        m_queueMutex.lock();
+        const QString key = m_renderKeys.value(i);
+        m_queueMutex.unlock();
+        if (key.isEmpty()) {
+            // Chunk queued without content hash, cannot be cached
+            emit previewChunkProgress(i, -1);
+            chunkDone();
             continue;
         }
-        // Build rendering process
-        QStringList args;
-        args << scene;
-        args << "in=" + QString::number(i);
-        args << "out=" + QString::number(i + chunkSize - 1);
-        args << "-consumer" << "avformat:" + m_cacheDir.absoluteFilePath(fileName);
-        args << m_consumerParams;
-        QProcess previewProcess;
-        connect(this, SIGNAL(abortPreview()), &previewProcess, SLOT(kill()), Qt::DirectConnection);
-        previewProcess.start(KdenliveSettings::rendererpath(), args);
-        if (previewProcess.waitForStarted()) {
-            previewProcess.waitForFinished(-1);
-            if (previewProcess.exitStatus() != QProcess::NormalExit || previewProcess.exitCode() != 0) {
-                // Something went wrong
-                if (m_abortPreview) {
-                    emit previewRender(0, QString(), 1000);
-                } else {
-                    emit previewRender(i, previewProcess.readAllStandardError(), -1);
-                }
-                QFile::remove(m_cacheDir.absoluteFilePath(fileName));
-                break;
+        const QString fileName = chunkFile(key);
+        if (QFile::exists(fileName)) {
+            // A chunk with the same content was already rendered
+            touchChunk(fileName);
+            m_queueMutex.lock();
+            m_chunkKeys.insert(i, key);
+            m_queueMutex.unlock();
+            emit previewRender(i, fileName, chunkDone());
+            continue;
+        }
+        // Render to a temporary name so that an interrupted chunk is never picked from the cache
+        const QString renderName = fileName + QStringLiteral(".part");
+        emit previewChunkProgress(i, 0);
+        QString errorLog;
+        bool success;
+        if (renderer) {
+            success = renderer->renderChunk(i, i + chunkSize - 1, renderName, m_consumerParams, &errorLog);
+        } else {
+            success = renderChunkProcess(scene, i, renderName, &errorLog);
+        }
+        if (success) {
+            QFile::remove(fileName);
+            success = QFile::rename(renderName, fileName);
+        }
+        int progress = chunkDone();
+        if (!success) {
+            // Something went wrong
+            emit previewChunkProgress(i, -1);
+            if (m_abortPreview.testAndSetOrdered(0, 1)) {
+                // First failure, stop the other workers after their current chunk
+                emit previewRender(i, errorLog, -1);
             } else {
-                emit previewRender(i, m_cacheDir.absoluteFilePath(fileName), progress);
+                emit previewRender(0, QString(), 1000);
             }
-        } else {
-            emit previewRender(i, QString(), -1);
+            QFile::remove(renderName);
             break;
         }
+        m_queueMutex.lock();
+        m_chunkKeys.insert(i, key);
+        m_queueMutex.unlock();
+        emit previewRender(i, fileName, progress);
     }
-    //QFile::remove(scene);
-    m_abortPreview = false;
 }
 
 void PreviewManager::slotProcessDirtyChunks()
@@ -467,27 +786,10 @@ void PreviewManager::slotProcessDirtyChunks()
         m_previewTimer.start();
 }
 
-void PreviewManager::slotRemoveInvalidUndo(int ix)
-{
-    QMutexLocker lock(&m_previewMutex);
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
-        // Make sure we delete correct folder
-        return;
-    }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    bool ok;
-    foreach(const QString dir, dirs) {
-        if (dir.toInt(&ok) >= ix && ok == true) {
-            QDir tmp = m_undoDir;
-            if (tmp.cd(dir)) {
-                tmp.removeRecursively();
-            }
-        }
-    }
-}
-
 void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 {
+    // The timeline was edited, service hashes must be computed again
+    m_serviceHashes.clear();
     int chunkSize = KdenliveSettings::timelinechunks();
     int start = startFrame / chunkSize;
     int end = lrintf(endFrame / chunkSize);
@@ -519,10 +821,15 @@ void PreviewManager::reloadChunks(QList <int> chunks)
 {
     if (m_previewTrack == NULL)
         return;
+    QMap <int, QString> keys;
+    m_queueMutex.lock();
+    keys = m_chunkKeys;
+    m_queueMutex.unlock();
     m_tractor->lock();
     foreach(int ix, chunks) {
         if (m_previewTrack->is_blank_at(ix)) {
-            const QString fileName = m_cacheDir.absoluteFilePath(QString("%1.%2").arg(ix).arg(m_extension));
+            const QString fileName = chunkFile(keys.value(ix));
+            touchChunk(fileName);
             Mlt::Producer prod(*m_tractor->profile(), 0, fileName.toUtf8().constData());
             if (prod.is_valid()) {
                 m_ruler->updatePreview(ix, true);
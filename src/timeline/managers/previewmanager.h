@@ -26,13 +26,18 @@
 #include <QMutex>
 #include <QTimer>
 #include <QFuture>
+#include <QAtomicInt>
+#include <QMap>
+#include <QHash>
 
 class KdenliveDoc;
 class CustomRuler;
+class PreviewRenderer;
 
 namespace Mlt {
     class Tractor;
     class Playlist;
+    class Service;
 }
 
 /**
@@ -76,8 +81,8 @@ public:
     void disconnectTrack();
     /** @brief: Returns directory currently used to store the preview files. */
     const QDir getCacheDir() const;
-    /** @brief: Load existing ruler chunks. */
-    void loadChunks(QStringList previewChunks, QStringList dirtyChunks, QDateTime documentDate);
+    /** @brief: Load existing ruler chunks, the ones without a matching file in the chunk cache are marked dirty. */
+    void loadChunks(QStringList previewChunks, QStringList dirtyChunks);
 
 private:
     KdenliveDoc *m_doc;
@@ -86,8 +91,12 @@ private:
     Mlt::Playlist *m_previewTrack;
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
-    /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
-    QDir m_undoDir;
+    /** @brief: The directory of rendered chunks shared by all projects, files are named after a hash of their content. */
+    QDir m_chunkDir;
+    /** @brief: Content hash of the chunks currently on the preview track (by start frame). */
+    QMap <int, QString> m_chunkKeys;
+    /** @brief: Content hash of the chunks queued for rendering, computed when the scene was saved. */
+    QMap <int, QString> m_renderKeys;
     QMutex m_previewMutex;
     QStringList m_consumerParams;
     QString m_extension;
@@ -96,19 +105,53 @@ private:
     /** @brief: Since some timeline operations generate several invalidate calls, use a timer to get them all. */
     QTimer m_previewGatherTimer;
     bool m_initialized;
-    bool m_abortPreview;
+    /** @brief: Set by the GUI thread and the render workers to stop rendering. */
+    QAtomicInt m_abortPreview;
+    /** @brief: Protects the render queue and counters shared by the render workers. */
+    QMutex m_queueMutex;
     QList <int> m_waitingThumbs;
+    /** @brief: Number of chunks processed and currently rendering in this run, for the progress. */
+    int m_processedChunks;
+    int m_activeChunks;
+    /** @brief: Timeline cursor position, rendering starts with the closest chunks. */
+    QAtomicInt m_playhead;
     QFuture <void> m_previewThread;
-    /** @brief: After an undo/redo, if we have preview history, use it. */
+    /** @brief: After an undo/redo or paste, put back the chunks found in cache. */
     void reloadChunks(QList <int> chunks);
+    /** @brief: Hash the part of the timeline rendered in each chunk (clips, filters, transitions, profile and encoding). */
+    QMap <int, QString> computeChunkKeys(const QList <int> &chunks);
+    /** @brief: Hash of the properties and filters of each timeline service (by MLT service), kept until the next timeline edit.
+     *  Only used from the GUI thread. */
+    QHash <void *, QByteArray> m_serviceHashes;
+    /** @brief: Cached hash of a service's properties and filters, @param skipPosition leaves out its in and out points. */
+    QByteArray serviceHash(Mlt::Service &service, bool skipPosition = false);
+    /** @brief: Path of the cached chunk file for a content hash. */
+    QString chunkFile(const QString &key) const;
+    /** @brief: Remove the chunks that previous versions stored in the project folder. */
+    void removeLegacyChunks();
+    /** @brief: Mark a cached chunk as recently used. */
+    void touchChunk(const QString &file);
+    /** @brief: Remove the least recently used chunks while the cache is over its size limit. */
+    void enforceCacheLimit();
+    /** @brief: Number of chunks rendered in parallel. */
+    int workerCount() const;
+    /** @brief: Take the waiting chunk closest to the playhead, returns false when there is nothing left to do. */
+    bool takeNextChunk(int *frame);
+    /** @brief: Mark a taken chunk as processed and return the overall progress (0-1000). */
+    int chunkDone();
+    /** @brief: In-process renderers, one per worker, kept between renders so that the scene is only reloaded on change. */
+    QList <PreviewRenderer *> m_renderers;
+    /** @brief: Content and hash of the scene being rendered, read once for all workers. */
+    QByteArray m_sceneXml;
+    QByteArray m_sceneHash;
+    /** @brief: Render waiting chunks until the queue is empty or rendering is aborted. */
+    void doPreviewWorker(const QString &scene, int worker);
+    /** @brief: Render a chunk with an external renderer process. */
+    bool renderChunkProcess(const QString &scene, int frame, const QString &file, QString *errorLog);
 
 private slots:
-    /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
-    void doCleanupOldPreviews();
     /** @brief: Start the real rendering process. */
     void doPreviewRender(QString scene);
-    /** @brief: If user does an undo, then makes a new timeline operation, delete undo history of more recent stack . */
-    void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
 
@@ -117,11 +160,14 @@ public slots:
     void startPreviewRender();
     /** @brief: A chunk has been created, notify ruler. */
     void gotPreviewRender(int frame, const QString &file, int progress);
+    /** @brief: Timeline cursor moved, used to prioritize chunks. */
+    void slotCursorMoved(int oldPos, int newPos);
 
 signals:
     void abortPreview();
-    void cleanupOldPreviews();
     void previewRender(int frame, const QString &file, int progress);
+    /** @brief: Rendering progress (0-100) of a single chunk, -1 when it stopped. */
+    void previewChunkProgress(int frame, int progress);
 };
 
 #endif
@@ -0,0 +1,158 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "previewrenderer.h"
+
+#include <mlt++/Mlt.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+static void consumer_frame_render(mlt_consumer, PreviewRenderer *self, mlt_frame frame_ptr)
+{
+    Mlt::Frame frame(frame_ptr);
+    self->frameRendered((int) frame.get_position());
+}
+
+PreviewRenderer::PreviewRenderer(const QString &profilePath, QObject *parent) : QObject(parent)
+    , m_profilePath(profilePath)
+    , m_profile(new Mlt::Profile(profilePath.toUtf8().constData()))
+    , m_producer(NULL)
+    , m_reloaded(false)
+    , m_consumer(NULL)
+    , m_aborted(false)
+    , m_chunkStart(0)
+    , m_chunkLength(1)
+    , m_progress(0)
+{
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+    delete m_producer;
+    delete m_profile;
+}
+
+const QString &PreviewRenderer::profilePath() const
+{
+    return m_profilePath;
+}
+
+bool PreviewRenderer::loadScene(const QByteArray &scene, const QByteArray &hash)
+{
+    m_reloaded = false;
+    if (m_producer && hash == m_sceneHash) {
+        // Scene did not change since last render
+        return true;
+    }
+    delete m_producer;
+    m_producer = new Mlt::Producer(*m_profile, "xml-string", scene.constData());
+    if (!m_producer->is_valid()) {
+        qDebug() << "* * * Cannot load preview scene";
+        delete m_producer;
+        m_producer = NULL;
+        m_sceneHash.clear();
+        return false;
+    }
+    m_sceneHash = hash;
+    m_reloaded = true;
+    return true;
+}
+
+bool PreviewRenderer::sceneReloaded() const
+{
+    return m_reloaded;
+}
+
+bool PreviewRenderer::renderChunk(int in, int out, const QString &file, const QStringList &params, QString *errorMessage)
+{
+    if (!m_producer) {
+        if (errorMessage) *errorMessage = QStringLiteral("No scene loaded");
+        return false;
+    }
+    Mlt::Consumer consumer(*m_profile, "avformat", file.toUtf8().constData());
+    if (!consumer.is_valid()) {
+        if (errorMessage) *errorMessage = QStringLiteral("Cannot create avformat consumer");
+        return false;
+    }
+    // Never drop frames, stop at the end of the chunk
+    consumer.set("real_time", -1);
+    consumer.set("terminate_on_pause", 1);
+    foreach(const QString &param, params) {
+        const QString key = param.section(QLatin1Char('='), 0, 0);
+        if (key.isEmpty() || key.endsWith(QLatin1Char('.')))
+            continue;
+        consumer.set(key.toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
+    }
+    Mlt::Producer *chunk = m_producer->cut(in, out);
+    consumer.connect(*chunk);
+    Mlt::Event *event = consumer.listen("consumer-frame-render", this, (mlt_listener) consumer_frame_render);
+    m_chunkStart = in;
+    m_chunkLength = qMax(1, out - in + 1);
+    m_progress = 0;
+    m_consumerMutex.lock();
+    if (m_aborted) {
+        // Aborted between two chunks
+        m_consumerMutex.unlock();
+        delete event;
+        delete chunk;
+        return false;
+    }
+    m_consumer = &consumer;
+    m_consumerMutex.unlock();
+    consumer.run();
+    m_consumerMutex.lock();
+    m_consumer = NULL;
+    bool aborted = m_aborted;
+    m_consumerMutex.unlock();
+    delete event;
+    consumer.purge();
+    delete chunk;
+    if (aborted || QFileInfo(file).size() == 0) {
+        if (errorMessage && !aborted) *errorMessage = QStringLiteral("Rendering of frames %1 to %2 failed").arg(in).arg(out);
+        QFile::remove(file);
+        return false;
+    }
+    return true;
+}
+
+void PreviewRenderer::frameRendered(int position)
+{
+    int progress = qBound(0, position * 100 / m_chunkLength, 100);
+    if (progress != m_progress) {
+        m_progress = progress;
+        emit chunkProgress(m_chunkStart, progress);
+    }
+}
+
+void PreviewRenderer::startRender()
+{
+    QMutexLocker lock(&m_consumerMutex);
+    m_aborted = false;
+}
+
+void PreviewRenderer::abort()
+{
+    QMutexLocker lock(&m_consumerMutex);
+    m_aborted = true;
+    if (m_consumer) {
+        m_consumer->stop();
+    }
+}
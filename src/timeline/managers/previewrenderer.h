@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QByteArray>
+#include <QStringList>
+
+namespace Mlt {
+    class Profile;
+    class Producer;
+    class Consumer;
+}
+
+/**
+ * @class PreviewRenderer
+ * @brief Renders timeline preview chunks inside the Kdenlive process.
+ * The preview scene is loaded once and kept while its content does not change, so rendering a chunk
+ * only costs the encoding of its frames instead of starting a renderer process that parses the
+ * whole scene and reopens every clip. MLT services cannot be shared between threads, so each render
+ * worker owns its own renderer, and only loads the scene once it has a chunk to render.
+ */
+
+class PreviewRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @param profilePath the MLT profile used for rendering */
+    explicit PreviewRenderer(const QString &profilePath, QObject *parent = 0);
+    virtual ~PreviewRenderer();
+    /** @brief Load a scene from its xml, nothing is done if the content with @param hash is already loaded. Returns false on error. */
+    bool loadScene(const QByteArray &scene, const QByteArray &hash);
+    /** @brief True if the last loadScene call had to (re)load the scene. */
+    bool sceneReloaded() const;
+    /** @brief Render frames @param in to @param out (included) of the scene to @param file. Blocks until done.
+     *  @param params the avformat consumer parameters (key=value)
+     *  @param errorMessage set on failure */
+    bool renderChunk(int in, int out, const QString &file, const QStringList &params, QString *errorMessage = 0);
+    /** @brief Called by MLT for each rendered frame. */
+    void frameRendered(int position);
+    /** @brief Clear the abort flag before a new render, chunks are refused once abort() was called. */
+    void startRender();
+    /** @brief The MLT profile this renderer was created with. */
+    const QString &profilePath() const;
+
+public slots:
+    /** @brief Stop the chunk being rendered, can be called from any thread. */
+    void abort();
+
+private:
+    QString m_profilePath;
+    Mlt::Profile *m_profile;
+    Mlt::Producer *m_producer;
+    QByteArray m_sceneHash;
+    bool m_reloaded;
+    /** @brief Protects m_consumer, which is stopped from other threads on abort */
+    QMutex m_consumerMutex;
+    Mlt::Consumer *m_consumer;
+    bool m_aborted;
+    int m_chunkStart;
+    int m_chunkLength;
+    int m_progress;
+
+signals:
+    /** @brief Rendering progress (0-100) of the chunk starting at @param frame. */
+    void chunkProgress(int frame, int progress);
+};
+
+#endif
@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "snapindex.h"
+
+#include <qmath.h>
+
+SnapIndex::SnapIndex()
+{
+}
+
+void SnapIndex::ref(QMap<int, int> &map, int point)
+{
+    map[point]++;
+}
+
+void SnapIndex::unref(QMap<int, int> &map, int point)
+{
+    QMap<int, int>::iterator it = map.find(point);
+    if (it == map.end()) return;
+    if (--it.value() <= 0) {
+        map.erase(it);
+    }
+}
+
+void SnapIndex::addPoints(const Source &source)
+{
+    for (int i = 0; i < source.points.count(); ++i) {
+        ref(m_points, source.points.at(i));
+        if (source.anchor) ref(m_anchors, source.points.at(i));
+    }
+}
+
+void SnapIndex::removePoints(const Source &source)
+{
+    for (int i = 0; i < source.points.count(); ++i) {
+        unref(m_points, source.points.at(i));
+        if (source.anchor) unref(m_anchors, source.points.at(i));
+    }
+}
+
+void SnapIndex::setSource(const void *source, const QVector<int> &points, bool anchor)
+{
+    const bool active = !m_excluded.contains(source);
+    QHash<const void *, Source>::iterator it = m_sources.find(source);
+    if (it != m_sources.end()) {
+        if (it.value().points == points && it.value().anchor == anchor) return;
+        if (active) removePoints(it.value());
+    } else {
+        it = m_sources.insert(source, Source());
+    }
+    it.value().points = points;
+    it.value().anchor = anchor;
+    if (active) addPoints(it.value());
+}
+
+void SnapIndex::removeSource(const void *source)
+{
+    QHash<const void *, Source>::iterator it = m_sources.find(source);
+    if (it == m_sources.end()) return;
+    if (!m_excluded.remove(source)) {
+        removePoints(it.value());
+    }
+    m_sources.erase(it);
+}
+
+void SnapIndex::setExcludedSources(const QList<const void *> &sources)
+{
+    QSet<const void *> excluded;
+    for (int i = 0; i < sources.count(); ++i) {
+        if (m_sources.contains(sources.at(i))) excluded.insert(sources.at(i));
+    }
+    // Restore previously excluded sources that are not excluded anymore
+    QSet<const void *>::const_iterator it = m_excluded.constBegin();
+    for (; it != m_excluded.constEnd(); ++it) {
+        if (!excluded.contains(*it)) addPoints(m_sources.value(*it));
+    }
+    for (it = excluded.constBegin(); it != excluded.constEnd(); ++it) {
+        if (!m_excluded.contains(*it)) removePoints(m_sources.value(*it));
+    }
+    m_excluded = excluded;
+}
+
+void SnapIndex::setOffsets(const QList<int> &offsets)
+{
+    m_offsets = offsets;
+}
+
+void SnapIndex::clear()
+{
+    m_sources.clear();
+    m_points.clear();
+    m_anchors.clear();
+    m_excluded.clear();
+    m_offsets.clear();
+}
+
+bool SnapIndex::snap(double pos, double maxDistance, int *result) const
+{
+    bool found = false;
+    int snapped = 0;
+    const int window = qCeil(maxDistance) + 1;
+    // Plain snap points
+    QMap<int, int>::const_iterator it = m_points.lowerBound(qFloor(pos) - window);
+    for (; it != m_points.constEnd() && it.key() <= pos + window; ++it) {
+        if (qAbs((int)(pos - it.key())) < maxDistance) {
+            snapped = it.key();
+            found = true;
+            break;
+        }
+    }
+    // Points shifted by the offsets of the other dragged items
+    for (int i = 0; i < m_offsets.count(); ++i) {
+        const int offset = m_offsets.at(i);
+        const double target = pos + offset;
+        it = m_anchors.lowerBound(qFloor(target) - window);
+        for (; it != m_anchors.constEnd() && it.key() <= target + window; ++it) {
+            const int candidate = it.key() - offset;
+            if (candidate <= 0) continue;
+            if (found && candidate >= snapped) break;
+            if (qAbs((int)(pos - candidate)) < maxDistance) {
+                snapped = candidate;
+                found = true;
+                break;
+            }
+        }
+    }
+    if (found) *result = snapped;
+    return found;
+}
+
+int SnapIndex::previousPoint(int pos) const
+{
+    QMap<int, int>::const_iterator it = m_points.lowerBound(pos);
+    if (it == m_points.constBegin()) return 0;
+    --it;
+    return it.key();
+}
+
+int SnapIndex::nextPoint(int pos) const
+{
+    QMap<int, int>::const_iterator it = m_points.upperBound(pos);
+    if (it == m_points.constEnd()) return pos;
+    return it.key();
+}
+
+QList<int> SnapIndex::points() const
+{
+    return m_points.keys();
+}
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef SNAPINDEX_H
+#define SNAPINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+/**
+ * @class SnapIndex
+ * @brief Sorted, reference counted set of timeline snap points (in frames).
+ * Each snap source (a clip item with its markers, a transition, a guide, the cursor, the zone)
+ * registers its own points and replaces them when it changes, so the set never needs a full rebuild.
+ * Sources being dragged are excluded for the duration of the operation, and multi-item drags
+ * are answered by looking up pos + offset for each offset instead of storing every shifted point.
+ */
+
+class SnapIndex
+{
+public:
+    SnapIndex();
+
+    /** @brief Replace the points of a source.
+     *  @param anchor if false, the points are not used for offset snapping (render zone) */
+    void setSource(const void *source, const QVector<int> &points, bool anchor = true);
+    void removeSource(const void *source);
+    /** @brief Remove the points of these sources from the active set until the next call. */
+    void setExcludedSources(const QList<const void *> &sources);
+    /** @brief Offsets (in frames) of the dragged items relative to the dragged position. */
+    void setOffsets(const QList<int> &offsets);
+    void clear();
+
+    /** @brief Look for the first snap position (lowest frame) closer than @param maxDistance to @param pos.
+     *  @return true and set @param result if one was found */
+    bool snap(double pos, double maxDistance, int *result) const;
+    /** @brief Closest snap point strictly before pos, 0 if none. */
+    int previousPoint(int pos) const;
+    /** @brief Closest snap point strictly after pos, pos if none. */
+    int nextPoint(int pos) const;
+    /** @brief Sorted list of all active snap points, without offsets. */
+    QList<int> points() const;
+
+private:
+    struct Source {
+        QVector<int> points;
+        bool anchor;
+    };
+    QHash<const void *, Source> m_sources;
+    /** @brief All active points, with their reference count */
+    QMap<int, int> m_points;
+    /** @brief Active points that are also used with the drag offsets */
+    QMap<int, int> m_anchors;
+    QSet<const void *> m_excluded;
+    QList<int> m_offsets;
+    void addPoints(const Source &source);
+    void removePoints(const Source &source);
+    static void ref(QMap<int, int> &map, int point);
+    static void unref(QMap<int, int> &map, int point);
+};
+
+#endif
@@ -1871,7 +1871,6 @@ void Timeline::loadPreviewRender()
     m_disablePreview->blockSignals(true);
     m_disablePreview->setChecked(m_doc->getDocumentProperty(QStringLiteral("disablepreview")).toInt());
     m_disablePreview->blockSignals(false);
-    QDateTime documentDate = QFileInfo(m_doc->url().path()).lastModified();
     if (!chunks.isEmpty() || !dirty.isEmpty()) {
         if (!m_timelinePreview) {
             initializePreview();
@@ -1879,7 +1878,7 @@ void Timeline::loadPreviewRender()
         if (!m_timelinePreview || m_disablePreview->isChecked())
             return;
         m_timelinePreview->buildPreviewTrack();
-        m_timelinePreview->loadChunks(chunks.split(",", QString::SkipEmptyParts), dirty.split(",", QString::SkipEmptyParts), documentDate);
+        m_timelinePreview->loadChunks(chunks.split(",", QString::SkipEmptyParts), dirty.split(",", QString::SkipEmptyParts));
         m_usePreview = true;
     } else {
         m_ruler->hidePreview(true);
@@ -1935,6 +1934,8 @@ void Timeline::initializePreview()
             qDebug()<<" * * * *TL PREVIEW NOT INITIALIZED!!!";
         } else {
             m_ruler->hidePreview(false);
+            connect(m_trackview, SIGNAL(cursorMoved(int,int)), m_timelinePreview, SLOT(slotCursorMoved(int,int)));
+            m_timelinePreview->slotCursorMoved(0, m_trackview->cursorPos());
         }
     }
     QAction *previewRender = m_doc->getAction(QStringLiteral("prerender_timeline_zone"));
@@ -1980,7 +1981,7 @@ void Timeline::disablePreview(bool disable)
                 m_tractor->unlock();
             }
             QPair <QStringList, QStringList> chunks = m_ruler->previewChunks();
-            m_timelinePreview->loadChunks(chunks.first, chunks.second, QDateTime());
+            m_timelinePreview->loadChunks(chunks.first, chunks.second);
             m_ruler->hidePreview(false);
             m_usePreview = true;
         }
@@ -56,6 +56,11 @@ Mlt::Playlist & Track::playlist()
     return m_playlist;
 }
 
+TrackItemIndex *Track::itemIndex()
+{
+    return &m_itemIndex;
+}
+
 qreal Track::fps()
 {
     return m_playlist.get_fps();
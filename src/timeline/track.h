@@ -26,6 +26,7 @@
 
 #include "definitions.h"
 #include "mltcontroller/effectscontroller.h"
+#include "timeline/trackitemindex.h"
 #include <QObject>
 
 #include <mlt++/MltPlaylist.h>
@@ -207,6 +208,8 @@ public:
     bool moveTrackEffect(int oldPos, int newPos);
     QList <QPoint> visibleClips();
     bool resize_in_out(int pos, int in, int out);
+    /** @brief Returns the index of timeline items (clips, transitions) displayed on this track. */
+    TrackItemIndex *itemIndex();
 
 signals:
     /** @brief notify track length change to update background
@@ -219,6 +222,8 @@ private:
     int m_index;
     /** MLT playlist behind the scene */
     Mlt::Playlist m_playlist;
+    /** @brief Sorted index of the clip and transition items drawn on this track */
+    TrackItemIndex m_itemIndex;
     /** @brief Returns true is this MLT service needs duplication to work on multiple tracks */
     bool needsDuplicate(const QString &service) const;
     void checkEffect(const QString effectName, int pos, int duration);
@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#include "trackitemindex.h"
+
+#include <QGraphicsItem>
+#include <qmath.h>
+
+static bool stackingOrderGreaterThan(const QGraphicsItem *a, const QGraphicsItem *b)
+{
+    return a->zValue() > b->zValue();
+}
+
+TrackItemIndex::TrackItemIndex() :
+    m_maxLength(0)
+{
+}
+
+TrackItemIndex::~TrackItemIndex()
+{
+}
+
+void TrackItemIndex::update(QGraphicsItem *item, qreal start, qreal end)
+{
+    const int key = qFloor(start);
+    QHash<QGraphicsItem *, int>::const_iterator previous = m_keys.constFind(item);
+    if (previous != m_keys.constEnd()) {
+        removeEntry(item, previous.value());
+    }
+    Entry entry;
+    entry.item = item;
+    entry.start = start;
+    entry.end = qMax(start, end);
+    m_entries.insert(key, entry);
+    m_keys.insert(item, key);
+    addLength(entry.end - entry.start);
+}
+
+void TrackItemIndex::remove(QGraphicsItem *item)
+{
+    QHash<QGraphicsItem *, int>::iterator it = m_keys.find(item);
+    if (it == m_keys.end()) return;
+    removeEntry(item, it.value());
+    m_keys.erase(it);
+}
+
+void TrackItemIndex::removeEntry(QGraphicsItem *item, int key)
+{
+    QMultiMap<int, Entry>::iterator it = m_entries.find(key);
+    while (it != m_entries.end() && it.key() == key) {
+        if (it.value().item == item) {
+            removeLength(it.value().end - it.value().start);
+            m_entries.erase(it);
+            return;
+        }
+        ++it;
+    }
+}
+
+void TrackItemIndex::addLength(qreal length)
+{
+    m_lengths[length]++;
+    m_maxLength = m_lengths.lastKey();
+}
+
+void TrackItemIndex::removeLength(qreal length)
+{
+    QMap<qreal, int>::iterator it = m_lengths.find(length);
+    if (it == m_lengths.end()) return;
+    if (--it.value() == 0) {
+        m_lengths.erase(it);
+    }
+    m_maxLength = m_lengths.isEmpty() ? 0 : m_lengths.lastKey();
+}
+
+bool TrackItemIndex::contains(QGraphicsItem *item) const
+{
+    return m_keys.contains(item);
+}
+
+void TrackItemIndex::clear()
+{
+    m_entries.clear();
+    m_keys.clear();
+    m_lengths.clear();
+    m_maxLength = 0;
+}
+
+int TrackItemIndex::count() const
+{
+    return m_keys.count();
+}
+
+QList<QGraphicsItem *> TrackItemIndex::itemsAt(qreal pos, int type) const
+{
+    QList<QGraphicsItem *> result;
+    if (m_entries.isEmpty()) return result;
+    // First entry starting after pos, then walk back while an item could still reach pos
+    QMultiMap<int, Entry>::const_iterator it = m_entries.upperBound(qFloor(pos));
+    const qreal limit = pos - m_maxLength - 1;
+    while (it != m_entries.constBegin()) {
+        --it;
+        const Entry &entry = it.value();
+        if (entry.start < limit) break;
+        if (entry.start <= pos && entry.end >= pos && entry.item->type() == type) {
+            result.append(entry.item);
+        }
+    }
+    if (result.count() > 1) {
+        qStableSort(result.begin(), result.end(), stackingOrderGreaterThan);
+    }
+    return result;
+}
+
+QList<QGraphicsItem *> TrackItemIndex::itemsInRange(qreal start, qreal end, int type) const
+{
+    QList<QGraphicsItem *> result;
+    if (m_entries.isEmpty()) return result;
+    QMultiMap<int, Entry>::const_iterator it = m_entries.lowerBound(qFloor(start - m_maxLength) - 1);
+    QMultiMap<int, Entry>::const_iterator last = m_entries.upperBound(qFloor(end));
+    for (; it != last; ++it) {
+        const Entry &entry = it.value();
+        if (entry.end < start || entry.start > end) continue;
+        if (type == -1 || entry.item->type() == type) {
+            result.append(entry.item);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2016 by the Kdenlive developers                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+#ifndef TRACKITEMINDEX_H
+#define TRACKITEMINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMultiMap>
+
+class QGraphicsItem;
+
+/**
+ * @class TrackItemIndex
+ * @brief Sorted interval index of the graphics items (clips, transitions) living on one track.
+ * Answers "item at frame X" and "items in range" without going through QGraphicsScene
+ * point queries. Entries are keyed by their start frame; as items on a track may temporarily
+ * overlap (during a drag), the length of the longest item currently indexed bounds the backward scan.
+ */
+
+class TrackItemIndex
+{
+public:
+    TrackItemIndex();
+    ~TrackItemIndex();
+
+    /** @brief Adds an item or updates its range if it is already indexed.
+     *  @param start first frame covered by the item (scene coordinates)
+     *  @param end last position covered by the item (scene coordinates, inclusive) */
+    void update(QGraphicsItem *item, qreal start, qreal end);
+    /** @brief Removes an item from the index. */
+    void remove(QGraphicsItem *item);
+    /** @brief Returns true if the item is indexed in this track. */
+    bool contains(QGraphicsItem *item) const;
+    /** @brief Drop all entries. */
+    void clear();
+    int count() const;
+
+    /** @brief Items of graphics type @param type covering position @param pos, in descending stacking order
+     *  (same order as QGraphicsScene::items(QPointF)). */
+    QList<QGraphicsItem *> itemsAt(qreal pos, int type) const;
+    /** @brief Items of graphics type @param type intersecting [start, end], sorted by start position.
+     *  A type of -1 returns all indexed items. */
+    QList<QGraphicsItem *> itemsInRange(qreal start, qreal end, int type = -1) const;
+
+private:
+    struct Entry {
+        QGraphicsItem *item;
+        qreal start;
+        qreal end;
+    };
+    QMultiMap<int, Entry> m_entries;
+    QHash<QGraphicsItem *, int> m_keys;
+    /** @brief Number of indexed items of each length, so the longest is known after it shrinks or leaves. */
+    QMap<qreal, int> m_lengths;
+    /** @brief Length of the longest indexed item. */
+    qreal m_maxLength;
+    void removeEntry(QGraphicsItem *item, int key);
+    void addLength(qreal length);
+    void removeLength(qreal length);
+};
+
+#endif
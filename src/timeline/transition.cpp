@@ -323,7 +323,7 @@ QVariant Transition::itemChange(GraphicsItemChange change, const QVariant &value
         ////qDebug()<<"// ITEM NEW POS: "<<newPos.x()<<", mapped: "<<mapToScene(newPos.x(), 0).x();
         return newPos;
     }
-    return QGraphicsItem::itemChange(change, value);
+    return AbstractClipItem::itemChange(change, value);
 }
 
 
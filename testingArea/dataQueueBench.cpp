@@ -0,0 +1,157 @@
+/*
+Copyright (C) 2016  Kdenlive developers
+This file is part of kdenlive. See www.kdenlive.org.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <iostream>
+
+#include "../src/monitor/scopes/dataqueue.h"
+
+/*
+ * One producer hands frames to 8 subscribers, each with its own queue and thread,
+ * like the frame displayed signal feeding the audio meter and the scopes.
+ * The subscribers drain their queue continuously, so the producer competes with
+ * them for every queue. Measured is how long the producer spends in push(), once
+ * with the previous mutex based queue and once with the lock-free DataQueue.
+ */
+
+static const int subscriberCount = 8;
+
+void printUsage(const char *path)
+{
+    std::cout << "Measures the time needed to hand frames to 8 queue subscribers." << std::endl << std::endl
+              << path << std::endl
+              << "\t--frames=<count>\n\t\tFrames pushed per test (default 200000)" << std::endl
+                 ;
+}
+
+/** Stands in for SharedFrame: copying it touches an atomic reference count */
+typedef QSharedPointer<QByteArray> Frame;
+
+/** The mutex based DataQueue before it was made lock-free, in OverflowModeDiscardOldest */
+class LockedQueue
+{
+public:
+    explicit LockedQueue(int maxSize) : m_maxSize(maxSize) {}
+    void push(const Frame &item)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.size() == m_maxSize) {
+            m_queue.removeFirst();
+        }
+        m_queue.append(item);
+    }
+    bool tryPop(Frame &item)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queue.isEmpty()) {
+            return false;
+        }
+        item = m_queue.takeFirst();
+        return true;
+    }
+private:
+    QList<Frame> m_queue;
+    int m_maxSize;
+    QMutex m_mutex;
+};
+
+template <class Queue>
+class Subscriber : public QThread
+{
+public:
+    Subscriber(Queue *queue) : received(0), m_queue(queue), m_stop(0) {}
+    void stop() { m_stop.fetchAndStoreOrdered(1); }
+    qint64 received;
+protected:
+    void run()
+    {
+        Frame frame;
+        while (!m_stop.loadAcquire()) {
+            while (m_queue->tryPop(frame)) {
+                received++;
+            }
+        }
+    }
+private:
+    Queue *m_queue;
+    QAtomicInt m_stop;
+};
+
+template <class Queue>
+void runTest(const char *name, QVector<Queue *> queues, int frames)
+{
+    QVector<Subscriber<Queue> *> subscribers;
+    for (int i = 0; i < subscriberCount; ++i) {
+        subscribers << new Subscriber<Queue>(queues.at(i));
+        subscribers.last()->start();
+    }
+
+    Frame frame(new QByteArray(64, 0));
+    QElapsedTimer timer;
+    QElapsedTimer pushTimer;
+    qint64 worst = 0;
+    timer.start();
+    for (int i = 0; i < frames; ++i) {
+        pushTimer.start();
+        for (int s = 0; s < subscriberCount; ++s) {
+            queues.at(s)->push(frame);
+        }
+        worst = qMax(worst, pushTimer.nsecsElapsed());
+    }
+    const qint64 total = timer.nsecsElapsed();
+
+    qint64 received = 0;
+    foreach (Subscriber<Queue> *subscriber, subscribers) {
+        subscriber->stop();
+        subscriber->wait();
+        received += subscriber->received;
+        delete subscriber;
+    }
+    std::cout << name << std::endl
+              << "\tAverage time to hand a frame to all subscribers: " << (double) total / frames << " ns" << std::endl
+              << "\tWorst time: " << worst / 1000. << " us" << std::endl
+              << "\tFrames received: " << received << " of " << (qint64) frames * subscriberCount << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeAt(0);
+
+    int frames = 200000;
+    foreach (const QString &str, args) {
+        if (str.startsWith(QLatin1String("--frames="))) {
+            frames = qMax(1, str.section('=', 1).toInt());
+        } else {
+            printUsage(argv[0]);
+            return str == "-h" || str == "--help" ? 0 : 1;
+        }
+    }
+
+    QVector<LockedQueue *> lockedQueues;
+    QVector<DataQueue<Frame> *> queues;
+    for (int i = 0; i < subscriberCount; ++i) {
+        lockedQueues << new LockedQueue(3);
+        queues << new DataQueue<Frame>(3, DataQueue<Frame>::OverflowModeDiscardOldest);
+    }
+    runTest("QMutex and QList", lockedQueues, frames);
+    runTest("Lock-free DataQueue", queues, frames);
+    qDeleteAll(lockedQueues);
+    qDeleteAll(queues);
+    return 0;
+}
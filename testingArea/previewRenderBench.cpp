@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2016  Kdenlive developers
+This file is part of kdenlive. See www.kdenlive.org.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <mlt++/Mlt.h>
+#include <iostream>
+
+#include "../src/timeline/managers/previewrenderer.h"
+
+/*
+ * Renders the same timeline preview chunks of a scene twice: once by starting a renderer process
+ * per chunk (the way PreviewManager used to do it) and once with a persistent PreviewRenderer,
+ * then compares the wall time per chunk.
+ */
+
+void printUsage(const char *path)
+{
+    std::cout << "Compares per-process and in-process rendering of timeline preview chunks." << std::endl << std::endl
+              << path << " <scene.mlt>" << std::endl
+              << "\t--profile=<profile>\n\t\tMLT profile used for rendering (default dv_pal)" << std::endl
+              << "\t--chunks=<count>\n\t\tNumber of chunks to render (default 10)" << std::endl
+              << "\t--chunk-size=<frames>\n\t\tFrames per chunk (default 25)" << std::endl
+              << "\t--melt=<path>\n\t\tRenderer executable (default melt)" << std::endl
+              << "\t--params=<params>\n\t\tavformat consumer parameters (default \"f=mpegts vcodec=mpeg2video qscale=3 an=1\")" << std::endl
+                 ;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeAt(0);
+
+    QString scene;
+    QString profile = QStringLiteral("dv_pal");
+    QString melt = QStringLiteral("melt");
+    QStringList params = QStringLiteral("f=mpegts vcodec=mpeg2video qscale=3 an=1").split(' ');
+    int chunkCount = 10;
+    int chunkSize = 25;
+    foreach (const QString &str, args) {
+        if (str.startsWith(QLatin1String("--profile="))) {
+            profile = str.section('=', 1);
+        } else if (str.startsWith(QLatin1String("--chunks="))) {
+            chunkCount = qMax(1, str.section('=', 1).toInt());
+        } else if (str.startsWith(QLatin1String("--chunk-size="))) {
+            chunkSize = qMax(1, str.section('=', 1).toInt());
+        } else if (str.startsWith(QLatin1String("--melt="))) {
+            melt = str.section('=', 1);
+        } else if (str.startsWith(QLatin1String("--params="))) {
+            params = str.section('=', 1).split(' ', QString::SkipEmptyParts);
+        } else if (str == "-h" || str == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            scene = str;
+        }
+    }
+    if (scene.isEmpty() || !QFile::exists(scene)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    QTemporaryDir tmp;
+    if (!tmp.isValid()) {
+        std::cout << "Cannot create temporary folder" << std::endl;
+        return 1;
+    }
+
+    // Renderer process per chunk
+    QElapsedTimer timer;
+    qint64 processTime = 0;
+    int processFailures = 0;
+    for (int i = 0; i < chunkCount; ++i) {
+        QStringList processArgs;
+        processArgs << scene << "-profile" << profile;
+        processArgs << "in=" + QString::number(i * chunkSize) << "out=" + QString::number((i + 1) * chunkSize - 1);
+        processArgs << "-consumer" << "avformat:" + tmp.path() + QString("/process_%1.ts").arg(i);
+        processArgs << params;
+        timer.start();
+        QProcess process;
+        process.start(melt, processArgs);
+        if (!process.waitForStarted() || !process.waitForFinished(-1) || process.exitCode() != 0) {
+            processFailures++;
+        }
+        processTime += timer.elapsed();
+    }
+
+    // Persistent renderer
+    Mlt::Factory::init();
+    PreviewRenderer renderer(profile);
+    timer.start();
+    if (!renderer.loadScene(scene)) {
+        std::cout << "Cannot load scene " << scene.toStdString() << std::endl;
+        return 1;
+    }
+    qint64 loadTime = timer.elapsed();
+    qint64 renderTime = 0;
+    int renderFailures = 0;
+    for (int i = 0; i < chunkCount; ++i) {
+        timer.start();
+        // Loading the unchanged scene again must be free
+        renderer.loadScene(scene);
+        if (!renderer.renderChunk(i * chunkSize, (i + 1) * chunkSize - 1, tmp.path() + QString("/inprocess_%1.ts").arg(i), params)) {
+            renderFailures++;
+        }
+        renderTime += timer.elapsed();
+    }
+
+    std::cout << chunkCount << " chunks of " << chunkSize << " frames" << std::endl
+              << "Renderer process: " << processTime / chunkCount << " ms per chunk ("
+              << processFailures << " failed)" << std::endl
+              << "Persistent renderer: " << renderTime / chunkCount << " ms per chunk, scene loaded once in "
+              << loadTime << " ms (" << renderFailures << " failed)" << std::endl;
+    return processFailures + renderFailures == 0 ? 0 : 1;
+}
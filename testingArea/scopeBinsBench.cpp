@@ -0,0 +1,265 @@
+/*
+Copyright (C) 2016  Kdenlive developers
+This file is part of kdenlive. See www.kdenlive.org.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QStringList>
+#include <QVector>
+#include <mlt++/Mlt.h>
+#include <cmath>
+#include <iostream>
+
+#include "../src/scopes/colorscopes/scopebins.h"
+#include "../src/scopes/colorscopes/scopeframe.h"
+
+/*
+ * Counts the values of a synthetic frame the way the colour scopes used to do it, each scope
+ * looping over the RGB image on its own, and with a single ScopeBins pass serving all of them.
+ * Frames are tested as RGB images (GPU monitor) and as yuv420p planes (CPU monitor).
+ * Only the counting is timed, painting the scopes is the same in both cases.
+ * The accuracy of stratified sampling is compared to reading every 4th line at the same cost.
+ */
+
+static const int scopeWidth = 720;
+static const int scopeHeight = 400;
+
+void printUsage(const char *path)
+{
+    std::cout << "Compares per-scope and fused counting of frame values for the colour scopes." << std::endl << std::endl
+              << path << std::endl
+              << "\t--runs=<count>\n\t\tFrames counted per test (default 20)" << std::endl
+                 ;
+}
+
+// Per scope loops, as done by the scope generators before ScopeBins
+void legacyWaveform(const QImage &image, QVector<uint> &waveValues)
+{
+    const uint ww = scopeWidth;
+    const uint wh = scopeHeight;
+    const uint iw = image.bytesPerLine();
+    const uint byteCount = iw * image.height();
+    waveValues.fill(0, ww * wh);
+    const float hPrediv = (float)(wh - 1) / 255;
+    const float wPrediv = (float)(ww - 1) / (iw - 1);
+    const uchar *bits = image.bits();
+    for (uint i = 0, x = 0; i < byteCount; i += 4) {
+        const QRgb *col = (const QRgb *)bits;
+        double dY = .299 * qRed(*col) + .587 * qGreen(*col) + .114 * qBlue(*col);
+        waveValues[(int)(x * wPrediv) * wh + (int)(dY * hPrediv)]++;
+        bits += 4;
+        x += 4;
+        if (x > iw) {
+            x -= iw;
+        }
+    }
+}
+
+void legacyParade(const QImage &image, QVector<uint> &paradeValues)
+{
+    const uint partW = (scopeWidth - 20 - 40) / 3;
+    const uint iw = image.bytesPerLine();
+    const uint byteCount = iw * image.height();
+    paradeValues.fill(0, partW * 256 * 3);
+    const float wPrediv = (float)(partW - 1) / (iw - 1);
+    const uchar *bits = image.bits();
+    for (uint i = 0, x = 0; i < byteCount; i += 4) {
+        const QRgb *col = (const QRgb *)bits;
+        const int dx = x * wPrediv;
+        paradeValues[(dx * 256 + qRed(*col)) * 3]++;
+        paradeValues[(dx * 256 + qGreen(*col)) * 3 + 1]++;
+        paradeValues[(dx * 256 + qBlue(*col)) * 3 + 2]++;
+        bits += 4;
+        x += 4;
+        x %= iw;
+    }
+}
+
+void legacyHistogram(const QImage &image, QVector<int> &histogram)
+{
+    histogram.fill(0, 4 * 256);
+    int *r = histogram.data();
+    int *g = r + 256;
+    int *b = g + 256;
+    int *y = b + 256;
+    for (int Y = 0; Y < image.height(); ++Y) {
+        for (int X = 0; X < image.width(); ++X) {
+            QRgb col = image.pixel(X, Y);
+            r[qRed(col)]++;
+            g[qGreen(col)]++;
+            b[qBlue(col)]++;
+            y[(int)floor(.299 * qRed(col) + .587 * qGreen(col) + .114 * qBlue(col))]++;
+        }
+    }
+}
+
+void legacyVectorscope(const QImage &image, QVector<uint> &scope)
+{
+    const int cw = scopeHeight;
+    scope.fill(0, cw * cw);
+    const uchar *bits = image.bits();
+    for (int i = 0; i < image.bytesPerLine() * image.height(); i += 4) {
+        const QRgb *col = (const QRgb *)bits;
+        int r = qRed(*col);
+        int g = qGreen(*col);
+        int b = qBlue(*col);
+        double u = -0.0006671 * r - 0.001299 * g + 0.0019608 * b;
+        double v = 0.001961 * r - 0.001642 * g - 0.0003189 * b;
+        int x = (cw - 1) * (u / .7 + 1) / 2;
+        int y = (cw - 1) * (1 - (v / .7 + 1) / 2);
+        if (x >= 0 && x < cw && y >= 0 && y < cw) {
+            scope[y * cw + x]++;
+        }
+        bits += 4;
+    }
+}
+
+/** A gradient with some noise so that the counts are spread like in real footage */
+QImage createImage(int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    uint seed = 1;
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = (QRgb *) image.scanLine(y);
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1103515245 + 12345;
+            const int noise = (seed >> 16) & 31;
+            line[x] = qRgb((x * 255 / width + noise) & 255, (y * 255 / height + noise) & 255, ((x + y) * 127 / height) & 255);
+        }
+    }
+    return image;
+}
+
+/** Converts @param image to a yuv420p MLT frame */
+Mlt::Frame *createFrame(const QImage &image)
+{
+    const int w = image.width();
+    const int h = image.height();
+    const int size = w * h + 2 * (w / 2) * (h / 2);
+    uint8_t *data = (uint8_t *) mlt_pool_alloc(size);
+    uint8_t *yPlane = data;
+    uint8_t *uPlane = data + w * h;
+    uint8_t *vPlane = uPlane + (w / 2) * (h / 2);
+    for (int y = 0; y < h; ++y) {
+        const QRgb *line = (const QRgb *) image.constScanLine(y);
+        for (int x = 0; x < w; ++x) {
+            const int r = qRed(line[x]), g = qGreen(line[x]), b = qBlue(line[x]);
+            yPlane[y * w + x] = 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255;
+            if (x % 2 == 0 && y % 2 == 0 && x / 2 < w / 2 && y / 2 < h / 2) {
+                uPlane[(y / 2) * (w / 2) + x / 2] = 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255;
+                vPlane[(y / 2) * (w / 2) + x / 2] = 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255;
+            }
+        }
+    }
+    Mlt::Frame *frame = new Mlt::Frame(mlt_frame_init(NULL));
+    frame->set("format", mlt_image_yuv420p);
+    frame->set("width", w);
+    frame->set("height", h);
+    frame->set_image(data, size, mlt_pool_release);
+    return frame;
+}
+
+void runTest(int width, int height, int runs)
+{
+    const QImage image = createImage(width, height);
+    const int allComponents = ScopeBins::LumaColumns | ScopeBins::RgbColumns | ScopeBins::LumaHistogram
+                              | ScopeBins::RgbHistogram | ScopeBins::Chroma;
+    QElapsedTimer timer;
+
+    QVector<uint> waveValues;
+    QVector<uint> paradeValues;
+    QVector<int> histogram;
+    QVector<uint> vectorscope;
+    timer.start();
+    for (int i = 0; i < runs; ++i) {
+        legacyWaveform(image, waveValues);
+        legacyParade(image, paradeValues);
+        legacyHistogram(image, histogram);
+        legacyVectorscope(image, vectorscope);
+    }
+    const qint64 legacyTime = timer.elapsed();
+
+    timer.start();
+    for (int i = 0; i < runs; ++i) {
+        ScopeBins bins;
+        bins.compute(ScopeFrame(image), allComponents, false);
+    }
+    const qint64 rgbTime = timer.elapsed();
+
+    Mlt::Frame *mltFrame = createFrame(image);
+    SharedFrame sharedFrame(*mltFrame);
+    timer.start();
+    for (int i = 0; i < runs; ++i) {
+        ScopeBins bins;
+        bins.compute(ScopeFrame(sharedFrame), allComponents, false);
+    }
+    const qint64 yuvTime = timer.elapsed();
+    delete mltFrame;
+
+    // A quarter of the pixels, by stratified sampling and by reading every 4th line
+    const uint budget = width * height / 4;
+    timer.start();
+    for (int i = 0; i < runs; ++i) {
+        ScopeBins bins;
+        bins.compute(ScopeFrame(image), allComponents, false, budget);
+    }
+    const qint64 sampledTime = timer.elapsed();
+    ScopeBins full;
+    full.compute(ScopeFrame(image), ScopeBins::LumaHistogram, false);
+    ScopeBins sampled;
+    sampled.compute(ScopeFrame(image), ScopeBins::LumaHistogram, false, budget);
+    QVector<uint> skipped(256, 0);
+    uint skippedCount = 0;
+    for (int y = 0; y < height; y += 4) {
+        const QRgb *line = (const QRgb *) image.constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            skipped[(19595 * qRed(line[x]) + 38470 * qGreen(line[x]) + 7471 * qBlue(line[x]) + 32768) >> 16]++;
+            skippedCount++;
+        }
+    }
+    // L1 distance of the normalized luma histograms to the full frame one
+    double sampledError = 0;
+    double skippedError = 0;
+    for (int i = 0; i < 256; ++i) {
+        const double reference = (double) full.lumaHistogram()[i] / full.sampleCount();
+        sampledError += fabs((double) sampled.lumaHistogram()[i] / sampled.sampleCount() - reference);
+        skippedError += fabs((double) skipped.at(i) / skippedCount - reference);
+    }
+
+    std::cout << width << "x" << height << ", all four scopes" << std::endl
+              << "\tPer scope loops:     " << (double) legacyTime / runs << " ms per frame" << std::endl
+              << "\tFused pass, RGB:     " << (double) rgbTime / runs << " ms per frame" << std::endl
+              << "\tFused pass, yuv420p: " << (double) yuvTime / runs << " ms per frame" << std::endl
+              << "\tFused pass, RGB, 1/4 of the pixels: " << (double) sampledTime / runs << " ms per frame" << std::endl
+              << "\tLuma histogram error, stratified sampling: " << sampledError
+              << ", every 4th line: " << skippedError << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeAt(0);
+
+    int runs = 20;
+    foreach (const QString &str, args) {
+        if (str.startsWith(QLatin1String("--runs="))) {
+            runs = qMax(1, str.section('=', 1).toInt());
+        } else {
+            printUsage(argv[0]);
+            return str == "-h" || str == "--help" ? 0 : 1;
+        }
+    }
+
+    Mlt::Factory::init();
+    runTest(1920, 1080, runs);
+    runTest(3840, 2160, runs);
+    return 0;
+}
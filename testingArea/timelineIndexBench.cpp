@@ -0,0 +1,251 @@
+/*
+Copyright (C) 2016  Kdenlive developers
+This file is part of kdenlive. See www.kdenlive.org.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+*/
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsRectItem>
+#include <QGraphicsScene>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <iostream>
+
+#include "../src/timeline/trackitemindex.h"
+
+/*
+ * Replays an edit session against a synthetic timeline, once with QGraphicsScene point
+ * queries (the way CustomTrackView used to look up clips) and once with TrackItemIndex.
+ *
+ * Session files contain one operation per line:
+ *   lookup <track> <frame>
+ *   range <track> <start> <end>
+ *   move <track> <frame> <newtrack> <newframe>
+ * Without a session file, a deterministic session mimicking undo/redo of group moves is generated.
+ */
+
+static const int trackHeight = 50;
+
+struct Operation {
+    enum Type { Lookup, Range, Move } type;
+    int track;
+    int frame;
+    int arg1;
+    int arg2;
+};
+
+void printUsage(const char *path)
+{
+    std::cout << "Replays a timeline edit session with scene queries and with the track item index." << std::endl << std::endl
+              << path << " [session file]" << std::endl
+              << "\t--clips=<count>\n\t\tNumber of clips in the synthetic timeline (default 10000)" << std::endl
+              << "\t--tracks=<count>\n\t\tNumber of tracks (default 20)" << std::endl
+              << "\t--operations=<count>\n\t\tLength of the generated session (default 50000)" << std::endl
+                 ;
+}
+
+QVector<Operation> loadSession(const QString &path)
+{
+    QVector<Operation> session;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cout << "Cannot open session " << path.toStdString() << std::endl;
+        return session;
+    }
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QStringList data = stream.readLine().simplified().split(' ');
+        Operation op;
+        if (data.count() == 3 && data.at(0) == QLatin1String("lookup")) {
+            op.type = Operation::Lookup;
+            op.arg1 = op.arg2 = 0;
+        } else if (data.count() == 4 && data.at(0) == QLatin1String("range")) {
+            op.type = Operation::Range;
+            op.arg1 = data.at(3).toInt();
+            op.arg2 = 0;
+        } else if (data.count() == 5 && data.at(0) == QLatin1String("move")) {
+            op.type = Operation::Move;
+            op.arg1 = data.at(3).toInt();
+            op.arg2 = data.at(4).toInt();
+        } else {
+            continue;
+        }
+        op.track = data.at(1).toInt();
+        op.frame = data.at(2).toInt();
+        session.append(op);
+    }
+    return session;
+}
+
+QVector<Operation> generateSession(const QVector<QList<QGraphicsRectItem *> > &tracks, int count)
+{
+    QVector<Operation> session;
+    qsrand(42);
+    while (session.count() < count) {
+        // Pick a group of clips, move it, look up every moved clip, then undo
+        int track = qrand() % tracks.count();
+        int first = qrand() % tracks.at(track).count();
+        int groupSize = 1 + qrand() % 8;
+        int offset = 1 + qrand() % 10;
+        for (int undo = 0; undo < 2; undo++) {
+            for (int i = first; i < qMin(first + groupSize, tracks.at(track).count()); ++i) {
+                int start = (int) tracks.at(track).at(i)->pos().x();
+                Operation op;
+                op.type = Operation::Move;
+                op.track = track;
+                op.frame = undo ? start + offset : start;
+                op.arg1 = track;
+                op.arg2 = undo ? start : start + offset;
+                session.append(op);
+                op.type = Operation::Lookup;
+                op.frame = op.arg2;
+                session.append(op);
+            }
+            Operation range;
+            range.type = Operation::Range;
+            range.track = track;
+            range.frame = (int) tracks.at(track).at(first)->pos().x();
+            range.arg1 = range.frame + 500;
+            range.arg2 = 0;
+            session.append(range);
+        }
+    }
+    return session;
+}
+
+static QGraphicsRectItem *sceneItemAt(QGraphicsScene &scene, int track, int frame)
+{
+    QList<QGraphicsItem *> list = scene.items(QPointF(frame, track * trackHeight + trackHeight / 2));
+    for (int i = 0; i < list.count(); ++i) {
+        if (list.at(i)->type() == QGraphicsRectItem::Type) return static_cast<QGraphicsRectItem *>(list.at(i));
+    }
+    return NULL;
+}
+
+static QGraphicsRectItem *indexItemAt(const QVector<TrackItemIndex *> &index, int track, int frame)
+{
+    QList<QGraphicsItem *> list = index.at(track)->itemsAt(frame, QGraphicsRectItem::Type);
+    return list.isEmpty() ? NULL : static_cast<QGraphicsRectItem *>(list.first());
+}
+
+static void indexItem(const QVector<TrackItemIndex *> &index, QGraphicsRectItem *item, int track)
+{
+    index.at(track)->update(item, item->pos().x(), item->pos().x() + item->rect().width());
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeAt(0);
+
+    int clipCount = 10000;
+    int trackCount = 20;
+    int operationCount = 50000;
+    QString sessionFile;
+    foreach (const QString &str, args) {
+        if (str.startsWith(QLatin1String("--clips="))) {
+            clipCount = str.section('=', 1).toInt();
+        } else if (str.startsWith(QLatin1String("--tracks="))) {
+            trackCount = qMax(1, str.section('=', 1).toInt());
+        } else if (str.startsWith(QLatin1String("--operations="))) {
+            operationCount = str.section('=', 1).toInt();
+        } else if (str == "-h" || str == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            sessionFile = str;
+        }
+    }
+
+    // Build the synthetic timeline: clips of 10 to 200 frames separated by small gaps
+    QGraphicsScene scene;
+    QVector<QList<QGraphicsRectItem *> > tracks(trackCount);
+    QVector<TrackItemIndex *> index(trackCount);
+    QVector<int> trackEnd(trackCount, 0);
+    for (int i = 0; i < trackCount; ++i) {
+        index[i] = new TrackItemIndex;
+    }
+    qsrand(7);
+    for (int i = 0; i < clipCount; ++i) {
+        int track = i % trackCount;
+        int duration = 10 + qrand() % 190;
+        int start = trackEnd.at(track) + 20 + qrand() % 30;
+        QGraphicsRectItem *item = new QGraphicsRectItem(0, 0, duration - 0.02, trackHeight - 1);
+        item->setPos(start, track * trackHeight + 1);
+        scene.addItem(item);
+        tracks[track].append(item);
+        indexItem(index, item, track);
+        trackEnd[track] = start + duration;
+    }
+
+    QVector<Operation> session = sessionFile.isEmpty() ? generateSession(tracks, operationCount) : loadSession(sessionFile);
+    std::cout << "Timeline: " << clipCount << " clips on " << trackCount << " tracks, replaying "
+              << session.count() << " operations" << std::endl;
+
+    QElapsedTimer timer;
+    qint64 sceneTime = 0;
+    qint64 indexTime = 0;
+    int mismatches = 0;
+    for (int i = 0; i < session.count(); ++i) {
+        const Operation &op = session.at(i);
+        if (op.track < 0 || op.track >= trackCount) continue;
+        switch (op.type) {
+        case Operation::Lookup: {
+            timer.start();
+            QGraphicsRectItem *fromScene = sceneItemAt(scene, op.track, op.frame);
+            sceneTime += timer.nsecsElapsed();
+            timer.start();
+            QGraphicsRectItem *fromIndex = indexItemAt(index, op.track, op.frame);
+            indexTime += timer.nsecsElapsed();
+            if (fromScene != fromIndex) mismatches++;
+            break;
+        }
+        case Operation::Range: {
+            QRectF rect(op.frame, op.track * trackHeight + 1, op.arg1 - op.frame, trackHeight - 2);
+            timer.start();
+            int sceneCount = scene.items(rect, Qt::IntersectsItemBoundingRect).count();
+            sceneTime += timer.nsecsElapsed();
+            timer.start();
+            int indexCount = index.at(op.track)->itemsInRange(op.frame, op.arg1).count();
+            indexTime += timer.nsecsElapsed();
+            Q_UNUSED(sceneCount)
+            Q_UNUSED(indexCount)
+            break;
+        }
+        case Operation::Move: {
+            if (op.arg1 < 0 || op.arg1 >= trackCount) break;
+            // Moves need the same lookup in both modes, only the bookkeeping differs
+            timer.start();
+            QGraphicsRectItem *item = sceneItemAt(scene, op.track, op.frame);
+            sceneTime += timer.nsecsElapsed();
+            timer.start();
+            QGraphicsRectItem *indexed = indexItemAt(index, op.track, op.frame);
+            indexTime += timer.nsecsElapsed();
+            if (item != indexed) mismatches++;
+            if (!item) break;
+            timer.start();
+            item->setPos(op.arg2, op.arg1 * trackHeight + 1);
+            sceneTime += timer.nsecsElapsed();
+            timer.start();
+            if (op.arg1 != op.track) index.at(op.track)->remove(item);
+            indexItem(index, item, op.arg1);
+            indexTime += timer.nsecsElapsed();
+            break;
+        }
+        }
+    }
+
+    std::cout << "Scene queries: " << sceneTime / 1000000.0 << " ms" << std::endl
+              << "Track index:   " << indexTime / 1000000.0 << " ms" << std::endl
+              << "Mismatching lookups: " << mismatches << std::endl;
+    qDeleteAll(index);
+    return mismatches == 0 ? 0 : 1;
+}